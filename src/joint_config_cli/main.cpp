@@ -0,0 +1,708 @@
+﻿// PLEN2 - Joint Config CLI
+// ============================================================================
+// NOTE:
+// joint_config_guiと同じコマンド処理(core/)を、ダイアログなしで動かすための
+// コマンドラインツールです。標準入力から1行1コマンドのスクリプトを読み込み、
+// 順番に実行します。(FIFOなどを標準入力に繋げば、常駐させることもできます。)
+//
+// スクリプトの書式:
+//     # コメント
+//     open <device>            シリアルデバイス(またはpty)を開く
+//     scan                     PLEN2を探して接続する
+//     disconnect               PLEN2との接続を解除する
+//     close                    デバイスを閉じる
+//     sa   <joint> <angle>     角度を送信する ("#SA")
+//     max  <joint> <angle>     最大角を設定する ("#MA")
+//     min  <joint> <angle>     最小角を設定する ("#MI")
+//     home <joint> <angle>     初期角を設定する ("#HO")
+//     limit clamp|reject       範囲外の角度を丸めるか、破棄するか
+//     sleep <ms>               待機する
+//     stats                    送信数などを表示する
+//     quit                     終了する
+//
+// <joint>はGUIと同じ 1 - 18、<angle>は 0 - 1800 です。
+//
+// -lを指定すると、Unixドメインソケットで外部プロセスからのコマンドも受け付けます。
+// (プロトコルはcore/ipc_protocol.hを参照) スクリプトを読み終えた後も、
+// SIGINT/SIGTERMを受け取るまで常駐します。
+//     例: joint_config_cli -d /dev/ttyACM0 -s -l < /dev/null
+
+// 標準C++ライブラリ
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// POSIX
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+
+// 独自実装ライブラリ
+#include "../joint_config_gui/core/bgapi_transport.h"
+#include "../joint_config_gui/core/command.h"
+#include "../joint_config_gui/core/ipc_server.h"
+#include "../joint_config_gui/core/joint.h"
+#include "../joint_config_gui/core/platform.h"
+
+
+namespace CLI
+{
+	bool dry_run    = false;
+	bool keep_going = false;
+
+	// 標準入力のスクリプトと、外部プロセスからのコマンドを直列化する
+	std::mutex pipeline_mutex;
+
+	// 外部プロセスからのコマンドの受け渡し
+	// ========================================================================
+	// NOTE:
+	// サーバのスレッドはコマンドをキューに積むだけで、実際の送信はipc_threadが
+	// pipeline_mutexを取って行います。(送信待ちの間も、他のクライアントの受信や
+	// STATSへの応答を止めないため)
+	// GUIと同じく、送信待ちの"#SA"は関節ごとに最新の1件だけを残します。
+	std::mutex              ipc_mutex;
+	std::condition_variable ipc_ready;
+	std::vector<Ipc::Entry> ipc_queue;
+	int                     ipc_pending[Joint::SUM]; // ipc_queue内の送信待ちの"#SA"の位置 (なければ-1)
+	bool                    ipc_quit = false;
+	std::thread             ipc_thread;
+
+	// SIGINT/SIGTERMを受け取ったことと、それを待機中のpoll()に伝える自己パイプ
+	volatile std::sig_atomic_t interrupted = 0;
+	int                        signal_pipe[2] = { -1, -1 };
+
+	unsigned long      sent_count = 0;
+	unsigned long long start_time = 0;
+}
+
+
+namespace
+{
+	void usage(const char* name)
+	{
+		std::fprintf(stderr,
+			"usage: %s [-d device] [-s] [-n] [-k] [-v] [-l [socket]] < script\n"
+			"  -d device  open the serial device (or pty) before running the script\n"
+			"  -l socket  accept commands on a Unix domain socket (default %s),\n"
+			"             and keep running after the script until interrupted\n"
+			"  -s         scan and connect to PLEN2 after opening the device\n"
+			"  -n         dry run: validate and print commands instead of sending them\n"
+			"  -k         keep going after a failed command\n"
+			"  -v         print BGAPI debug log to stderr\n",
+			name, Ipc::DEFAULT_SOCKET_PATH);
+	}
+
+	void notifyError(const char* message)
+	{
+		std::fprintf(stderr, "error: %s\n", message);
+	}
+
+	void notifyConnected()
+	{
+		std::fprintf(stderr, "connected to PLEN2.\n");
+	}
+
+	void notifyScanned(const char* mac)
+	{
+		std::fprintf(stderr, "found %s\n", mac);
+	}
+
+	bool readJoint(std::istream& args, int& joint_id, int& angle)
+	{
+		int joint;
+
+		if (!(args >> joint >> angle))
+		{
+			return false;
+		}
+
+		if (   joint < 1 || joint > Joint::SUM
+			|| angle < 0 || angle > 1800 )
+		{
+			return false;
+		}
+
+		joint_id = joint - 1;
+
+		return true;
+	}
+
+	bool requireConnection()
+	{
+		if (CLI::dry_run || BGAPI::connected)
+		{
+			return true;
+		}
+
+		std::fprintf(stderr, "error: not connected to PLEN2.\n");
+
+		return false;
+	}
+
+	// 角度の送信 (ドライランの場合は標準出力へ書き出すだけ)
+	void setAngle(int joint_id, int angle)
+	{
+		Joint::settings[joint_id].now = angle;
+
+		if (CLI::dry_run)
+		{
+			// 送信はしないが、GUIと同じ検証を通す
+			if (Joint::validateAngle(joint_id, angle))
+			{
+				std::printf("#SA%s\n", Command::buildCmd(joint_id, angle).c_str());
+				Joint::last_sent[joint_id] = angle;
+				CLI::sent_count++;
+			}
+		}
+		else if (Command::sendAngle(joint_id, angle))
+		{
+			CLI::sent_count++;
+		}
+	}
+
+	// 設定値の送信 (kindはIpc::KIND_MIN, KIND_MAX, KIND_HOMEのいずれか)
+	void setLimit(int kind, int joint_id, int angle)
+	{
+		Joint::Settings& settings = Joint::settings[joint_id];
+
+		if (CLI::dry_run)
+		{
+			// Command::send*()と同様に、設定値も更新しておく
+			const char* header = (kind == Ipc::KIND_MAX) ? "#MA" : (kind == Ipc::KIND_MIN) ? "#MI" : "#HO";
+			unsigned int& value = (kind == Ipc::KIND_MAX) ? settings.max : (kind == Ipc::KIND_MIN) ? settings.min : settings.home;
+
+			value = angle;
+			std::printf("%s%s\n", header, Command::buildCmd(joint_id, angle).c_str());
+		}
+		else if (kind == Ipc::KIND_MAX)
+		{
+			Command::sendMax(joint_id, angle);
+		}
+		else if (kind == Ipc::KIND_MIN)
+		{
+			Command::sendMin(joint_id, angle);
+		}
+		else
+		{
+			Command::sendHome(joint_id, angle);
+		}
+
+		CLI::sent_count++;
+	}
+
+	// 外部プロセスからのコマンドをキューに積む (Ipc::Serverのスレッドから呼ばれる)
+	void queueIpc(int type, const Ipc::Entry* entries, int count)
+	{
+		std::lock_guard<std::mutex> lock(CLI::ipc_mutex);
+
+		for (int index = 0; index < count; index++)
+		{
+			const Ipc::Entry& entry = entries[index];
+
+			if (entry.kind == Ipc::KIND_ANGLE)
+			{
+				int& pending = CLI::ipc_pending[entry.joint];
+
+				if (pending >= 0)
+				{
+					CLI::ipc_queue[pending].angle = entry.angle;
+
+					continue;
+				}
+
+				pending = static_cast<int>(CLI::ipc_queue.size());
+			}
+			else
+			{
+				// 制限値の変更より前の"#SA"に、後の"#SA"をまとめてはいけない
+				CLI::ipc_pending[entry.joint] = -1;
+			}
+
+			CLI::ipc_queue.push_back(entry);
+		}
+
+		CLI::ipc_ready.notify_one();
+	}
+
+	// キューに積まれたコマンドを送信する (ipc_threadで動く)
+	void processIpc()
+	{
+		std::vector<Ipc::Entry> entries;
+
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(CLI::ipc_mutex);
+
+				while (!CLI::ipc_quit && CLI::ipc_queue.empty())
+				{
+					CLI::ipc_ready.wait(lock);
+				}
+
+				if (CLI::ipc_quit)
+				{
+					return;
+				}
+
+				entries.clear();
+				entries.swap(CLI::ipc_queue);
+				std::fill(CLI::ipc_pending, CLI::ipc_pending + Joint::SUM, -1);
+			}
+
+			std::lock_guard<std::mutex> lock(CLI::pipeline_mutex);
+
+			// 未接続の間に届いたコマンドは捨てる
+			if (!CLI::dry_run && !BGAPI::connected)
+			{
+				continue;
+			}
+
+			for (std::size_t index = 0; index < entries.size(); index++)
+			{
+				if (entries[index].kind == Ipc::KIND_ANGLE)
+				{
+					::setAngle(entries[index].joint, entries[index].angle);
+				}
+				else
+				{
+					::setLimit(entries[index].kind, entries[index].joint, entries[index].angle);
+				}
+			}
+		}
+	}
+
+	void reportIpc(const char* message)
+	{
+		std::fputs(message, stderr);
+	}
+
+	extern "C" void onSignal(int)
+	{
+		int saved_errno = errno;
+
+		CLI::interrupted = 1;
+
+		char wake = 0;
+		if (::write(CLI::signal_pipe[1], &wake, 1) < 0)
+		{
+			// パイプが一杯なら、既に起こされている
+		}
+
+		errno = saved_errno;
+	}
+
+	// シグナルハンドラを設定する
+	// ========================================================================
+	// NOTE:
+	// std::signal()はglibcではSA_RESTART付きで設定されるため、read()などが
+	// シグナルで中断されません。sigaction()でSA_RESTARTなしに設定し、さらに
+	// 自己パイプに書き込むことで、poll()で待機中のスレッドを確実に起こします。
+	bool installSignalHandlers()
+	{
+		if (::pipe(CLI::signal_pipe) != 0)
+		{
+			return false;
+		}
+
+		struct sigaction action;
+		std::memset(&action, 0, sizeof(action));
+		action.sa_handler = ::onSignal;
+		sigemptyset(&action.sa_mask);
+		action.sa_flags = 0;
+
+		return ::sigaction(SIGINT, &action, NULL) == 0 && ::sigaction(SIGTERM, &action, NULL) == 0;
+	}
+
+	// シグナルを受け取るか、timeout [ms] が経過するまで待つ (負の値なら無期限)
+	void waitSignal(int timeout)
+	{
+		struct pollfd wake = { CLI::signal_pipe[0], POLLIN, 0 };
+		::poll(&wake, 1, timeout);
+	}
+
+	// 標準入力から1行読み込む
+	// ========================================================================
+	// NOTE:
+	// 標準入力と自己パイプを同時にpoll()し、シグナルを受け取った時点でfalseを
+	// 返します。(std::getline()ではFIFOや端末からの入力待ちが中断できないため)
+	// 末尾に改行のない最後の行も1行として返します。
+	bool readLine(std::string& line)
+	{
+		static std::string pending;
+		static bool        eof = false;
+
+		for (;;)
+		{
+			std::string::size_type end = pending.find('\n');
+
+			if (end != std::string::npos)
+			{
+				line.assign(pending, 0, end);
+				pending.erase(0, end + 1);
+
+				return true;
+			}
+
+			if (eof || CLI::interrupted)
+			{
+				if (eof && !pending.empty() && !CLI::interrupted)
+				{
+					line.swap(pending);
+					pending.clear();
+
+					return true;
+				}
+
+				return false;
+			}
+
+			struct pollfd fds[2] =
+			{
+				{ STDIN_FILENO,        POLLIN, 0 },
+				{ CLI::signal_pipe[0], POLLIN, 0 }
+			};
+
+			if (::poll(fds, 2, -1) < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+
+				return false;
+			}
+
+			if (fds[1].revents != 0)
+			{
+				continue;
+			}
+
+			char    buffer[4096];
+			ssize_t read_size = ::read(STDIN_FILENO, buffer, sizeof(buffer));
+
+			if (read_size > 0)
+			{
+				pending.append(buffer, read_size);
+			}
+			else if (read_size == 0 || errno != EINTR)
+			{
+				eof = true;
+			}
+		}
+	}
+
+	void printStats()
+	{
+		double elapsed = (Platform::now() - CLI::start_time) / 1000000.0;
+
+		std::fprintf(stderr,
+			"sent %lu commands in %.3f s (%.1f cmd/s), clamped %ld, rejected %ld\n",
+			CLI::sent_count, elapsed, (elapsed > 0) ? CLI::sent_count / elapsed : 0.0,
+			Joint::clamped_count.load(), Joint::rejected_count.load());
+	}
+
+	// 1行分のコマンドを実行する
+	// 戻り値がfalseの場合は、コマンドが失敗したことを表す。
+	// lockはpipeline_mutexのロックで、sleepの間だけ外す。
+	bool execute(const std::string& line, bool& quit, std::unique_lock<std::mutex>& lock)
+	{
+		std::istringstream args(line);
+		std::string        command;
+
+		if (!(args >> command) || command[0] == '#')
+		{
+			return true;
+		}
+
+		if (command == "open")
+		{
+			std::string device;
+
+			if (!(args >> device))
+			{
+				return false;
+			}
+
+			if (CLI::dry_run)
+			{
+				return true;
+			}
+
+			return BGAPI::open(device.c_str());
+		}
+
+		if (command == "scan")
+		{
+			Joint::resetLastSent();
+
+			return CLI::dry_run || BGAPI::connectPLEN2();
+		}
+
+		if (command == "disconnect")
+		{
+			BGAPI::disconnectPLEN2();
+
+			return true;
+		}
+
+		if (command == "close")
+		{
+			BGAPI::close();
+
+			return true;
+		}
+
+		if (command == "sa")
+		{
+			int joint_id;
+			int angle;
+
+			if (!::readJoint(args, joint_id, angle) || !::requireConnection())
+			{
+				return false;
+			}
+
+			::setAngle(joint_id, angle);
+
+			return true;
+		}
+
+		if (command == "max" || command == "min" || command == "home")
+		{
+			int joint_id;
+			int angle;
+
+			if (!::readJoint(args, joint_id, angle) || !::requireConnection())
+			{
+				return false;
+			}
+
+			::setLimit((command == "max") ? Ipc::KIND_MAX : (command == "min") ? Ipc::KIND_MIN : Ipc::KIND_HOME, joint_id, angle);
+
+			return true;
+		}
+
+		if (command == "limit")
+		{
+			std::string mode;
+			args >> mode;
+
+			if (mode == "clamp")
+			{
+				Joint::limit_mode = Joint::LIMIT_CLAMP;
+			}
+			else if (mode == "reject")
+			{
+				Joint::limit_mode = Joint::LIMIT_REJECT;
+			}
+			else
+			{
+				return false;
+			}
+
+			return true;
+		}
+
+		if (command == "sleep")
+		{
+			unsigned int ms;
+
+			if (!(args >> ms))
+			{
+				return false;
+			}
+
+			// 待機中は外部プロセスからのコマンドを止めないように、ロックを外す
+			// SIGINT/SIGTERMで中断できるように、自己パイプを待つ
+			lock.unlock();
+
+			unsigned long long end = Platform::now() + ms * 1000ULL;
+
+			while (!CLI::interrupted)
+			{
+				unsigned long long now = Platform::now();
+
+				if (now >= end)
+				{
+					break;
+				}
+
+				::waitSignal(static_cast<int>((end - now + 999) / 1000));
+			}
+
+			lock.lock();
+
+			return true;
+		}
+
+		if (command == "stats")
+		{
+			::printStats();
+
+			return true;
+		}
+
+		if (command == "quit")
+		{
+			quit = true;
+
+			return true;
+		}
+
+		return false;
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	const char* device = NULL;
+	const char* socket_path = NULL;
+	bool        scan   = false;
+
+	for (int index = 1; index < argc; index++)
+	{
+		if (std::strcmp(argv[index], "-d") == 0 && index + 1 < argc)
+		{
+			device = argv[++index];
+		}
+		else if (std::strcmp(argv[index], "-s") == 0)
+		{
+			scan = true;
+		}
+		else if (std::strcmp(argv[index], "-n") == 0)
+		{
+			CLI::dry_run = true;
+		}
+		else if (std::strcmp(argv[index], "-k") == 0)
+		{
+			CLI::keep_going = true;
+		}
+		else if (std::strcmp(argv[index], "-l") == 0)
+		{
+			socket_path = (index + 1 < argc && argv[index + 1][0] != '-') ? argv[++index] : Ipc::DEFAULT_SOCKET_PATH;
+		}
+		else if (std::strcmp(argv[index], "-v") == 0)
+		{
+			Platform::verbose = true;
+		}
+		else
+		{
+			::usage(argv[0]);
+
+			return 2;
+		}
+	}
+
+	BGAPI::notify_error     = ::notifyError;
+	BGAPI::notify_connected = ::notifyConnected;
+	BGAPI::notify_scanned   = ::notifyScanned;
+	Joint::resetLastSent();
+
+	if (device != NULL && !CLI::dry_run)
+	{
+		if (!BGAPI::open(device))
+		{
+			std::fprintf(stderr, "error: failed to open %s.\n", device);
+
+			return 1;
+		}
+
+		if (scan && !BGAPI::connectPLEN2())
+		{
+			std::fprintf(stderr, "error: failed to connect to PLEN2.\n");
+			BGAPI::close();
+
+			return 1;
+		}
+	}
+
+	CLI::start_time = Platform::now();
+
+	if (!::installSignalHandlers())
+	{
+		std::fprintf(stderr, "error: failed to install signal handlers.\n");
+		BGAPI::close();
+
+		return 1;
+	}
+
+	Ipc::Server server;
+	std::fill(CLI::ipc_pending, CLI::ipc_pending + Joint::SUM, -1);
+
+	if (socket_path != NULL && !server.start(socket_path, ::queueIpc, ::reportIpc))
+	{
+		std::fprintf(stderr, "error: failed to listen on %s.\n", socket_path);
+		BGAPI::close();
+
+		return 1;
+	}
+
+	if (server.running())
+	{
+		CLI::ipc_thread = std::thread(::processIpc);
+	}
+
+	int         result = 0;
+	int         line_number = 0;
+	bool        quit = false;
+	std::string line;
+
+	while (!quit && !CLI::interrupted && ::readLine(line))
+	{
+		line_number++;
+
+		std::unique_lock<std::mutex> lock(CLI::pipeline_mutex);
+
+		if (!::execute(line, quit, lock))
+		{
+			std::fprintf(stderr, "line %d: failed: %s\n", line_number, line.c_str());
+			result = 1;
+
+			if (!CLI::keep_going)
+			{
+				break;
+			}
+		}
+	}
+
+	// 常駐する場合は、シグナルを受け取るまで外部プロセスからのコマンドを待つ
+	if (server.running() && !quit && (result == 0 || CLI::keep_going))
+	{
+		while (!CLI::interrupted)
+		{
+			::waitSignal(-1);
+		}
+	}
+
+	server.stop();
+
+	if (CLI::ipc_thread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(CLI::ipc_mutex);
+			CLI::ipc_quit = true;
+		}
+
+		CLI::ipc_ready.notify_one();
+		CLI::ipc_thread.join();
+	}
+
+	if (Platform::verbose)
+	{
+		::printStats();
+	}
+
+	BGAPI::close();
+
+	return result;
+}
@@ -18,7 +18,11 @@
 typedef unsigned char  uint8;
 typedef unsigned short uint16;
 typedef signed short   int16;
+#if defined(__LP64__)
+typedef unsigned int   uint32;
+#else
 typedef unsigned long  uint32;
+#endif
 typedef signed char    int8;
 
 typedef struct bd_addr_t
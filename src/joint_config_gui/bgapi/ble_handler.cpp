@@ -1,29 +1,15 @@
 ﻿// BGAPIを使用する場合、基本的にいじる必要があるのはこのファイルだけです。
 
 
-// Windows API関連
-#include <Windows.h>
-
 // 標準C++ライブラリ
+#include <cstring>
 #include <sstream>
 #include <iomanip>
 
 // 独自実装ライブラリ
-#include "../resource.h"
 #include "cmd_def.h"
-
-
-// main.cppと共有する変数
-namespace BGAPI
-{
-	extern volatile bool cmd_success;
-	extern volatile bool connected;
-}
-
-namespace GUI
-{
-	extern volatile HWND main_dlg;
-}
+#include "../core/bgapi_transport.h"
+#include "../core/platform.h"
 
 
 // 以下、メッセージに応じたイベントハンドラに必要な処理を記述
@@ -357,7 +343,7 @@ void ble_rsp_attributes_read_type(const struct ble_msg_attributes_read_type_rsp_
 
 void ble_rsp_connection_disconnect(const struct ble_msg_connection_disconnect_rsp_t* msg)
 {
-	OutputDebugString("<<< ble_rsp_connection_disconnect\n");
+	Platform::debugLog("<<< ble_rsp_connection_disconnect\n");
 }
 
 void ble_rsp_connection_get_rssi(const struct ble_msg_connection_get_rssi_rsp_t* msg)
@@ -414,7 +400,7 @@ void ble_rsp_attclient_read_by_handle(const struct ble_msg_attclient_read_by_han
 
 void ble_rsp_attclient_attribute_write(const struct ble_msg_attclient_attribute_write_rsp_t* msg)
 {
-	OutputDebugString("<<< ble_rsp_attclient_attribute_write\n");
+	Platform::debugLog("<<< ble_rsp_attclient_attribute_write\n");
 
 	BGAPI::cmd_success = (msg->result == 0);
 }
@@ -441,17 +427,17 @@ void ble_rsp_gap_set_mode(const struct ble_msg_gap_set_mode_rsp_t* msg)
 
 void ble_rsp_gap_discover(const struct ble_msg_gap_discover_rsp_t* msg)
 {
-	OutputDebugString("<<< ble_rsp_gap_discover\n");
+	Platform::debugLog("<<< ble_rsp_gap_discover\n");
 }
 
 void ble_rsp_gap_connect_direct(const struct ble_msg_gap_connect_direct_rsp_t* msg)
 {
-	OutputDebugString("<<< ble_rsp_gap_connect_direct\n");
+	Platform::debugLog("<<< ble_rsp_gap_connect_direct\n");
 }
 
 void ble_rsp_gap_end_procedure(const struct ble_msg_gap_end_procedure_rsp_t* msg)
 {
-	OutputDebugString("<<< ble_rsp_gap_end_procedure\n");
+	Platform::debugLog("<<< ble_rsp_gap_end_procedure\n");
 }
 
 void ble_rsp_hardware_io_port_config_irq(const struct ble_msg_hardware_io_port_config_irq_rsp_t* msg)
@@ -520,15 +506,18 @@ void ble_evt_flash_ps_key(const struct ble_msg_flash_ps_key_evt_t* msg)
 
 void ble_evt_connection_status(const struct ble_msg_connection_status_evt_t* msg)
 {
-	OutputDebugString("### ble_evt_connection_status\n");
+	Platform::debugLog("### ble_evt_connection_status\n");
 
 	if (msg->flags & connection_connected)
 	{
-		OutputDebugString("+++ Success.\n");
+		Platform::debugLog("+++ Success.\n");
 
 		// PLEN2との接続が完了したので、Characteristicsへの書き込み可能状態へ遷移
 		BGAPI::connected = true;
-		MessageBox( NULL, "PLEN2との接続に成功しました。", "ble_evt_connection_status()", MB_OK);
+		if (BGAPI::notify_connected != NULL)
+		{
+			BGAPI::notify_connected();
+		}
 	}
 }
 
@@ -578,14 +567,14 @@ void ble_evt_sm_smp_data(const struct ble_msg_sm_smp_data_evt_t* msg)
 
 void ble_evt_gap_scan_response(const struct ble_msg_gap_scan_response_evt_t* msg)
 {
-	static const char PLEN2_TX_CHARACTERISTIC_UUID[] =
+	static const unsigned char PLEN2_TX_CHARACTERISTIC_UUID[] =
 	{
 		0xF9, 0x0E, 0x9C, 0xFE, 0x7E, 0x05, 0x44, 0xA5, 0x9D, 0x75, 0xF1, 0x36, 0x44, 0xD6, 0xF6, 0x45
 	};
 	static const size_t UUID_LENGTH = sizeof(PLEN2_TX_CHARACTERISTIC_UUID) / sizeof(PLEN2_TX_CHARACTERISTIC_UUID[0]);
 
 
-	OutputDebugString("### ble_evt_gap_scan_response\n");
+	Platform::debugLog("### ble_evt_gap_scan_response\n");
 
 	// データパケットの長さが25以上であれば、UUIDが乗っていないかチェックする。
 	// ========================================================================
@@ -594,7 +583,7 @@ void ble_evt_gap_scan_response(const struct ble_msg_gap_scan_response_evt_t* msg
 	if (msg->data.len > 25)
 	{
 		// 10byte目から16byte分がUUIDと定義している。(iBeaconの実装を参考にした。)
-		char data_buf[16];
+		unsigned char data_buf[16];
 		memcpy(data_buf, (msg->data.data) + 9, 16);
 
 		if (memcmp(data_buf, PLEN2_TX_CHARACTERISTIC_UUID, UUID_LENGTH) == 0)
@@ -605,7 +594,10 @@ void ble_evt_gap_scan_response(const struct ble_msg_gap_scan_response_evt_t* msg
 				mac << std::setfill('0') << std::setw(2) << std::hex << static_cast<int>(msg->sender.addr[index]);
 			}
 
-			SetDlgItemText(GUI::main_dlg, EDIT_MAC, mac.str().c_str());
+			if (BGAPI::notify_scanned != NULL)
+			{
+				BGAPI::notify_scanned(mac.str().c_str());
+			}
 			
 			// PLEN2からのアドバタイズなので、接続を試みる
 			ble_cmd_gap_connect_direct(msg->sender.addr, 0, 60, 76, 100, 0);
@@ -630,7 +622,10 @@ void ble_evt_gap_scan_response(const struct ble_msg_gap_scan_response_evt_t* msg
 			mac << std::setfill('0') << std::setw(2) << std::hex << static_cast<int>(msg->sender.addr[index]);
 		}
 
-		SetDlgItemText(GUI::main_dlg, EDIT_MAC, mac.str().c_str());
+		if (BGAPI::notify_scanned != NULL)
+		{
+			BGAPI::notify_scanned(mac.str().c_str());
+		}
 			
 		// PLEN2からのアドバタイズなので、接続を試みる
 		ble_cmd_gap_connect_direct(msg->sender.addr, 0, 60, 76, 100, 0);
@@ -0,0 +1,315 @@
+﻿#ifdef _WIN32
+	// Windows API関連
+	#include <Windows.h>
+#else
+	// POSIX関連
+	#include <errno.h>
+	#include <fcntl.h>
+	#include <termios.h>
+	#include <unistd.h>
+#endif
+
+// 標準C++ライブラリ
+#include <string>
+
+// 独自実装ライブラリ
+#include "bgapi_transport.h"
+#include "platform.h"
+#include "../bgapi/cmd_def.h"
+
+
+namespace BGAPI
+{
+	volatile bool handle_created = false;
+	volatile bool cmd_success    = false;
+	volatile bool connected      = false;
+
+	void (*notify_error)(const char* message) = NULL;
+	void (*notify_connected)()                = NULL;
+	void (*notify_scanned)(const char* mac)   = NULL;
+}
+
+
+namespace
+{
+#ifdef _WIN32
+	volatile HANDLE bled112_handle = INVALID_HANDLE_VALUE;
+#else
+	volatile int    bled112_handle = -1;
+#endif
+
+	void notifyError(const char* message)
+	{
+		if (BGAPI::notify_error != NULL)
+		{
+			BGAPI::notify_error(message);
+		}
+	}
+
+	int lastError()
+	{
+#ifdef _WIN32
+		return GetLastError();
+#else
+		return (errno != 0) ? errno : -1;
+#endif
+	}
+
+	bool writeBytes(const unsigned char* buff, int size)
+	{
+#ifdef _WIN32
+		DWORD written_size;
+
+		return WriteFile(bled112_handle, buff, size, &written_size, NULL) != 0;
+#else
+		while (size > 0)
+		{
+			ssize_t written_size = ::write(bled112_handle, buff, size);
+			if (written_size < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+
+				return false;
+			}
+
+			buff += written_size;
+			size -= static_cast<int>(written_size);
+		}
+
+		return true;
+#endif
+	}
+
+	// 戻り値は読み込んだバイト数 (エラーの場合は-1)
+	// ========================================================================
+	// NOTE:
+	// Windowsではタイムアウトした場合に0を返すことがあります。
+	// POSIXではsizeバイト揃うまで読み続け、途中で切断された場合は-1を返します。
+	int readBytes(unsigned char* buff, int size)
+	{
+#ifdef _WIN32
+		DWORD read_size;
+
+		if (!ReadFile(bled112_handle, buff, size, &read_size, NULL))
+		{
+			return -1;
+		}
+
+		return static_cast<int>(read_size);
+#else
+		int total = 0;
+
+		while (total < size)
+		{
+			ssize_t read_size = ::read(bled112_handle, buff + total, size - total);
+			if (read_size < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+
+				return -1;
+			}
+
+			if (read_size == 0)
+			{
+				errno = 0;
+
+				return -1;
+			}
+
+			total += static_cast<int>(read_size);
+		}
+
+		return total;
+#endif
+	}
+}
+
+
+namespace BGAPI
+{
+	bool open(const char* port)
+	{
+		close();
+
+#ifdef _WIN32
+		std::string com = "\\\\.\\";
+		com += port;
+
+		bled112_handle = CreateFileA(com.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+		if (bled112_handle == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+#else
+		bled112_handle = ::open(port, O_RDWR | O_NOCTTY);
+		if (bled112_handle < 0)
+		{
+			return false;
+		}
+
+		// BLED112はUSB CDCなのでボーレートに意味はないが、ptyなども扱えるようにrawモードにしておく
+		if (isatty(bled112_handle))
+		{
+			struct termios attr;
+
+			if (tcgetattr(bled112_handle, &attr) == 0)
+			{
+				cfmakeraw(&attr);
+				cfsetispeed(&attr, B115200);
+				cfsetospeed(&attr, B115200);
+				attr.c_cc[VMIN]  = 1;
+				attr.c_cc[VTIME] = 0;
+
+				tcsetattr(bled112_handle, TCSANOW, &attr);
+			}
+		}
+#endif
+
+		// "cmd_def.c"内の"bglib_output"ポインタに関数ポインタを代入することで、
+		// コマンド送信処理を委譲してもらいます。(BGAPIが環境依存にならない工夫)
+		::bglib_output = output;
+		handle_created = true;
+
+		return true;
+	}
+
+	void close()
+	{
+		if (!handle_created)
+		{
+			return;
+		}
+
+		disconnectPLEN2();
+
+#ifdef _WIN32
+		CloseHandle(bled112_handle);
+		bled112_handle = INVALID_HANDLE_VALUE;
+#else
+		::close(bled112_handle);
+		bled112_handle = -1;
+#endif
+
+		handle_created = false;
+	}
+
+	// BLED112へのコマンド送信
+	void output(unsigned char header_len, unsigned char* header, unsigned short msg_len, unsigned char* msg)
+	{
+		if (!::writeBytes(header, header_len))
+		{
+			::notifyError("BLED112へのコマンド送信に失敗しました。");
+
+			return;
+		}
+
+		if (!::writeBytes(msg, msg_len))
+		{
+			::notifyError("BLED112へのコマンド送信に失敗しました。");
+
+			return;
+		}
+	}
+
+	// BLED112からのレスポンスを処理
+	// ========================================================================
+	// NOTE:
+	// この関数はBGAPIを呼び出した後、必要な回数だけ呼び出す必要があります。
+	// どのコマンドでもレスポンスが必ず1回発生するので、最低1回は必要です。
+	// 不定期にイベントとしてレスポンスが返ってくる場合は、ループ処理を
+	// 行う必要があります。(本アプリでも、)
+	//
+	// CAUTION:
+	// 現在非同期読み込みを行っていないため、読み込み部分でビジーウェイトが
+	// かかります。別スレッドに読み込み部分を任せる実装も試したのですが、
+	// 不可思議な挙動をしました。(おそらく読み書きの排他制御をする必要があります。)
+	int readMessage()
+	{
+		struct ble_header header;
+
+		int read_size = ::readBytes(reinterpret_cast<unsigned char*>(&header), 4);
+		if (read_size < 0)
+		{
+			return ::lastError();
+		}
+
+		if (read_size == 0)
+		{
+			return 0;
+		}
+
+		unsigned char data_buff[256];
+
+		if (header.lolen)
+		{
+			if (::readBytes(data_buff, header.lolen) < 0)
+			{
+				return ::lastError();
+			}
+		}
+
+		const struct ble_msg* msg = ble_get_msg_hdr(header);
+		if (!msg)
+		{
+			::notifyError("対応するメッセージハンドラが存在しません。");
+
+			return -1;
+		}
+
+		// メッセージハンドラに処理を委譲 (各イベントハンドラの実装は、ble_handler.cpp内を参照)
+		msg->handler(data_buff);
+
+		return 0;
+	}
+
+	bool connectPLEN2()
+	{
+		if (!handle_created)
+		{
+			return false;
+		}
+
+		ble_cmd_gap_end_procedure();
+		Platform::sleep(10);
+		readMessage();
+
+		ble_cmd_connection_disconnect(0);
+		Platform::sleep(10);
+		readMessage();
+
+		ble_cmd_gap_discover(gap_discover_generic);
+		Platform::sleep(10);
+		readMessage();
+
+		// ble_evt_connection_status()を発生回数分処理
+		while (!connected)
+		{
+			if (readMessage() != 0)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void disconnectPLEN2()
+	{
+		if (!connected)
+		{
+			return;
+		}
+
+		ble_cmd_connection_disconnect(0);
+		Platform::sleep(10);
+		readMessage();
+
+		connected = false;
+	}
+}
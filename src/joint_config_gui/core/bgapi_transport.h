@@ -0,0 +1,40 @@
+﻿#ifndef _CORE_BGAPI_TRANSPORT_H_
+#define _CORE_BGAPI_TRANSPORT_H_
+
+
+// BLED112との通信路
+// ============================================================================
+// NOTE:
+// WindowsではCOMポート("COM3"など)、Linuxではシリアルデバイスやpty
+// ("/dev/ttyACM0"など)を開いて、BGAPIのコマンド送信先にします。
+// GUIへの通知(メッセージボックスやMACアドレスの表示)は関数ポインタで委譲し、
+// 通信路自体がGUIに依存しないようにしています。
+namespace BGAPI
+{
+	extern volatile bool handle_created;
+	extern volatile bool cmd_success;
+	extern volatile bool connected;
+
+	// 通知先 (NULLの場合は何もしない)
+	extern void (*notify_error)(const char* message);
+	extern void (*notify_connected)();
+	extern void (*notify_scanned)(const char* mac);
+
+	bool open(const char* port);
+	void close();
+
+	// BLED112へのコマンド送信 ("bglib_output"に登録される)
+	void output(unsigned char header_len, unsigned char* header, unsigned short msg_len, unsigned char* msg);
+
+	// BLED112からのレスポンスを1件処理
+	int readMessage();
+
+	// PLEN2を探して接続する (接続完了まで戻りません)
+	bool connectPLEN2();
+
+	// PLEN2との接続を解除する
+	void disconnectPLEN2();
+}
+
+
+#endif // _CORE_BGAPI_TRANSPORT_H_
@@ -0,0 +1,64 @@
+﻿// 標準C++ライブラリ
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+
+// 独自実装ライブラリ
+#include "command.h"
+#include "bgapi_transport.h"
+#include "joint.h"
+#include "platform.h"
+#include "../bgapi/cmd_def.h"
+
+
+namespace Command
+{
+	std::string buildCmd(int joint_id, int angle)
+	{
+		std::stringstream cmd;
+		cmd << std::setfill('0') << std::setw(2) << std::hex << static_cast<std::int16_t>(Joint::map[joint_id]);
+		cmd << std::setfill('0') << std::setw(3) << std::hex << static_cast<std::int16_t>(angle);
+
+		return cmd.str();
+	}
+
+	void sendCmd(const std::string& cmd)
+	{
+		ble_cmd_attclient_attribute_write(0, 31, 8, cmd.c_str());
+		Platform::sleep(10);
+
+		BGAPI::readMessage();
+		BGAPI::readMessage();
+	}
+
+	bool sendAngle(int joint_id, int angle)
+	{
+		if (!Joint::validateAngle(joint_id, angle))
+		{
+			return false;
+		}
+
+		sendCmd("#SA" + buildCmd(joint_id, angle));
+		Joint::last_sent[joint_id] = angle;
+
+		return true;
+	}
+
+	void sendMax(int joint_id, int angle)
+	{
+		Joint::settings[joint_id].max = angle;
+		sendCmd("#MA" + buildCmd(joint_id, angle));
+	}
+
+	void sendMin(int joint_id, int angle)
+	{
+		Joint::settings[joint_id].min = angle;
+		sendCmd("#MI" + buildCmd(joint_id, angle));
+	}
+
+	void sendHome(int joint_id, int angle)
+	{
+		Joint::settings[joint_id].home = angle;
+		sendCmd("#HO" + buildCmd(joint_id, angle));
+	}
+}
@@ -0,0 +1,33 @@
+﻿#ifndef _CORE_COMMAND_H_
+#define _CORE_COMMAND_H_
+
+// 標準C++ライブラリ
+#include <string>
+
+
+// PLEN2へのコマンド
+// ============================================================================
+// NOTE:
+// コマンドは全て8バイト固定長です。(ヘッダ3文字 + 関節番号2桁 + 角度3桁、16進数)
+// 送信はBGAPI::open()で開いた通信路に対して行います。
+namespace Command
+{
+	// 関節番号(GUI上の番号)と角度から、ヘッダ以降の5文字を作る
+	std::string buildCmd(int joint_id, int angle);
+
+	// コマンドを送信し、書き込みのレスポンスと、それに続くイベントの2回分を処理する
+	void sendCmd(const std::string& cmd);
+
+	// 角度の送信 ("#SA")
+	// Joint::validateAngle()で弾かれた場合はfalseを返します。
+	bool sendAngle(int joint_id, int angle);
+
+	// 設定値の送信 ("#MA", "#MI", "#HO")
+	// 送信と同時に、Joint::settingsの該当する値も更新します。
+	void sendMax(int joint_id, int angle);
+	void sendMin(int joint_id, int angle);
+	void sendHome(int joint_id, int angle);
+}
+
+
+#endif // _CORE_COMMAND_H_
@@ -0,0 +1,73 @@
+﻿#ifndef _CORE_IPC_PROTOCOL_H_
+#define _CORE_IPC_PROTOCOL_H_
+
+// 標準C++ライブラリ
+#include <cstdint>
+
+
+// 外部プロセスからの操作用プロトコル
+// ============================================================================
+// NOTE:
+// Unixドメインソケット(Linux)または名前付きパイプ(Windows)の上に、以下の
+// フレームを並べて送るだけのバイナリプロトコルです。値は全てリトルエンディアンです。
+//
+//     Header (4byte) + Payload (Header::length byte)
+//
+// TYPE_SET_ANGLE, TYPE_SET_LIMIT, TYPE_POSE のペイロードはEntryの配列です。
+// 1フレームに複数のEntryを詰めることで、ポーズ単位でまとめて送ることができます。
+// 応答はTYPE_STATSに対してのみ返します。(それ以外は送りっぱなしです。)
+namespace Ipc
+{
+	// 既定の接続先
+	const char DEFAULT_PIPE_NAME[]   = "\\\\.\\pipe\\plen2_joint_config";
+	const char DEFAULT_SOCKET_PATH[] = "/tmp/plen2_joint_config.sock";
+
+	enum Type
+	{
+		TYPE_SET_ANGLE   = 0x01, // Entry x 1 ("#SA")
+		TYPE_SET_LIMIT   = 0x02, // Entry x 1 (kindで"#MI", "#MA", "#HO"を指定)
+		TYPE_POSE        = 0x03, // Entry x N ("#SA"をまとめて送る)
+		TYPE_STATS       = 0x10, // ペイロードなし、TYPE_STATS_REPLYが返る
+		TYPE_STATS_REPLY = 0x90  // Stats x 1
+	};
+
+	enum Kind
+	{
+		KIND_ANGLE = 0,
+		KIND_MIN   = 1,
+		KIND_MAX   = 2,
+		KIND_HOME  = 3
+	};
+
+	#pragma pack(push, 1)
+	struct Header
+	{
+		std::uint8_t  type;
+		std::uint8_t  reserved;
+		std::uint16_t length;  // ペイロードのバイト数
+	};
+
+	struct Entry
+	{
+		std::uint8_t  joint;   // GUI上の関節番号 (0 - 17)
+		std::uint8_t  kind;    // Kind (TYPE_SET_LIMIT以外では無視)
+		std::uint16_t angle;   // 0 - 1800
+	};
+
+	// クライアントごとの受信統計 (接続してからの累計)
+	struct Stats
+	{
+		std::uint32_t frames;
+		std::uint32_t entries;
+		std::uint64_t bytes;
+		std::uint32_t elapsed;  // [ms]
+		std::uint32_t errors;   // 範囲外などで捨てたEntryの数
+	};
+	#pragma pack(pop)
+
+	// Header::lengthの上限 (Entryの整数倍で、これを超えるフレームはプロトコル違反として切断)
+	const std::uint16_t MAX_PAYLOAD = 0xFFFC;
+}
+
+
+#endif // _CORE_IPC_PROTOCOL_H_
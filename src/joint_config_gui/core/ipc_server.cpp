@@ -0,0 +1,563 @@
+﻿#ifdef _WIN32
+	// Windows API関連
+	#include <Windows.h>
+#else
+	// POSIX関連
+	#include <errno.h>
+	#include <poll.h>
+	#include <sys/socket.h>
+	#include <sys/stat.h>
+	#include <sys/un.h>
+	#include <unistd.h>
+#endif
+
+// 標準C++ライブラリ
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// 独自実装ライブラリ
+#include "ipc_server.h"
+#include "joint.h"
+#include "platform.h"
+
+
+namespace
+{
+	const std::size_t READ_BUFFER_SIZE = 64 * 1024;
+
+	// クライアント1つ分の受信処理
+	// ========================================================================
+	// NOTE:
+	// 受信したバイト列をフレームに区切り、範囲チェックを通ったEntryだけを
+	// ハンドラへ渡します。フレームの途中で受信が途切れた場合は、次の受信まで
+	// 残りを保持しておきます。
+	class Session
+	{
+	public:
+		Session(unsigned int id, Ipc::Handler handler, Ipc::Report report)
+			: id(id)
+			, handler(handler)
+			, report(report)
+			, start_time(Platform::now())
+		{
+			std::memset(&stats, 0, sizeof(stats));
+
+			std::stringstream message;
+			message << "[ipc] client " << id << " connected.\n";
+			report(message.str().c_str());
+		}
+
+		~Session()
+		{
+			double elapsed = (Platform::now() - start_time) / 1000000.0;
+
+			std::stringstream message;
+			message << std::fixed << std::setprecision(3);
+			message << "[ipc] client " << id << " closed: "
+			        << stats.frames << " frames, " << stats.entries << " entries, " << stats.bytes << " bytes in "
+			        << elapsed << " s (" << std::setprecision(1) << ((elapsed > 0) ? stats.entries / elapsed : 0.0)
+			        << " entries/s, " << stats.errors << " errors)\n";
+
+			report(message.str().c_str());
+		}
+
+		// 戻り値がfalseの場合は、プロトコル違反なので切断すること。
+		bool feed(const unsigned char* data, std::size_t size, std::vector<unsigned char>& reply)
+		{
+			buffer.insert(buffer.end(), data, data + size);
+			stats.bytes += size;
+
+			std::size_t offset = 0;
+			bool        valid  = true;
+
+			while (buffer.size() - offset >= sizeof(Ipc::Header))
+			{
+				Ipc::Header header;
+				std::memcpy(&header, &buffer[offset], sizeof(header));
+
+				// ペイロードを受信し終える前に、長すぎるフレームは切断する
+				if (header.length > Ipc::MAX_PAYLOAD)
+				{
+					valid = false;
+
+					break;
+				}
+
+				if (buffer.size() - offset - sizeof(header) < header.length)
+				{
+					break;
+				}
+
+				if (!dispatch(header, &buffer[offset + sizeof(header)], reply))
+				{
+					valid = false;
+
+					break;
+				}
+
+				offset += sizeof(header) + header.length;
+			}
+
+			buffer.erase(buffer.begin(), buffer.begin() + offset);
+
+			return valid;
+		}
+
+	private:
+		bool dispatch(const Ipc::Header& header, const unsigned char* payload, std::vector<unsigned char>& reply)
+		{
+			stats.frames++;
+
+			switch (header.type)
+			{
+				case Ipc::TYPE_SET_ANGLE:
+				case Ipc::TYPE_SET_LIMIT:
+				{
+					if (header.length != sizeof(Ipc::Entry))
+					{
+						return false;
+					}
+
+					break;
+				}
+
+				case Ipc::TYPE_POSE:
+				{
+					if (header.length % sizeof(Ipc::Entry) != 0)
+					{
+						return false;
+					}
+
+					break;
+				}
+
+				case Ipc::TYPE_STATS:
+				{
+					stats.elapsed = static_cast<std::uint32_t>((Platform::now() - start_time) / 1000);
+
+					Ipc::Header reply_header = { Ipc::TYPE_STATS_REPLY, 0, sizeof(Ipc::Stats) };
+					const unsigned char* head = reinterpret_cast<const unsigned char*>(&reply_header);
+					const unsigned char* body = reinterpret_cast<const unsigned char*>(&stats);
+
+					reply.insert(reply.end(), head, head + sizeof(reply_header));
+					reply.insert(reply.end(), body, body + sizeof(stats));
+
+					return true;
+				}
+
+				default:
+				{
+					return false;
+				}
+			}
+
+			const int count = header.length / sizeof(Ipc::Entry);
+			entries.resize(count);
+			std::memcpy(entries.data(), payload, header.length);
+
+			int valid = 0;
+
+			for (int index = 0; index < count; index++)
+			{
+				Ipc::Entry& entry = entries[index];
+
+				if (header.type != Ipc::TYPE_SET_LIMIT)
+				{
+					entry.kind = Ipc::KIND_ANGLE;
+				}
+
+				if (   entry.joint >= Joint::SUM
+					|| entry.angle >  1800
+					|| (header.type == Ipc::TYPE_SET_LIMIT && (entry.kind < Ipc::KIND_MIN || entry.kind > Ipc::KIND_HOME)) )
+				{
+					stats.errors++;
+
+					continue;
+				}
+
+				entries[valid++] = entry;
+			}
+
+			stats.entries += count;
+
+			if (valid != 0)
+			{
+				handler(header.type, entries.data(), valid);
+			}
+
+			return true;
+		}
+
+		unsigned int       id;
+		Ipc::Handler       handler;
+		Ipc::Report        report;
+		unsigned long long start_time;
+		Ipc::Stats         stats;
+
+		std::vector<unsigned char> buffer;
+		std::vector<Ipc::Entry>    entries;
+	};
+}
+
+
+namespace Ipc
+{
+	Server::Server()
+		: handler(NULL)
+		, report(NULL)
+		, started(false)
+		, quit(false)
+		, next_id(1)
+#ifndef _WIN32
+		, listen_fd(-1)
+#endif
+	{
+#ifndef _WIN32
+		wake_fd[0] = -1;
+		wake_fd[1] = -1;
+#endif
+	}
+
+	Server::~Server()
+	{
+		stop();
+	}
+
+#ifdef _WIN32
+	// ========================================================================
+	// Windows (名前付きパイプ)
+	// ========================================================================
+	// NOTE:
+	// パイプのインスタンスをクライアントごとに作成し、それぞれ専用のスレッドで
+	// 受信します。
+	struct Server::Client
+	{
+		unsigned int  id;
+		HANDLE        pipe;
+		std::thread   thread;
+		volatile bool done;
+	};
+
+	bool Server::start(const char* name, Handler handler, Report report)
+	{
+		stop();
+
+		this->name    = name;
+		this->handler = handler;
+		this->report  = (report != NULL) ? report : Platform::debugLog;
+		quit          = false;
+
+		accept_thread = std::thread(&Server::acceptLoop, this);
+		started       = true;
+
+		return true;
+	}
+
+	void Server::stop()
+	{
+		if (!started)
+		{
+			return;
+		}
+
+		quit = true;
+
+		// ConnectNamedPipe()の待機を解除するため、自分自身に接続する
+		HANDLE self = CreateFileA(name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+		if (self != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(self);
+		}
+
+		accept_thread.join();
+
+		std::lock_guard<std::mutex> lock(clients_mutex);
+
+		for (std::list<Client*>::iterator it = clients.begin(); it != clients.end(); ++it)
+		{
+			// 受信待ちのReadFile()を中断させる
+			while (!(*it)->done)
+			{
+				CancelSynchronousIo((*it)->thread.native_handle());
+				Sleep(1);
+			}
+
+			(*it)->thread.join();
+			delete *it;
+		}
+
+		clients.clear();
+		started = false;
+	}
+
+	void Server::acceptLoop()
+	{
+		while (!quit)
+		{
+			HANDLE pipe = CreateNamedPipeA(name.c_str(), PIPE_ACCESS_DUPLEX, PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT,
+			                               PIPE_UNLIMITED_INSTANCES, READ_BUFFER_SIZE, READ_BUFFER_SIZE, 0, NULL);
+			if (pipe == INVALID_HANDLE_VALUE)
+			{
+				report("[ipc] CreateNamedPipe() failed.\n");
+
+				return;
+			}
+
+			bool connected = ConnectNamedPipe(pipe, NULL) ? true : (GetLastError() == ERROR_PIPE_CONNECTED);
+
+			if (quit || !connected)
+			{
+				CloseHandle(pipe);
+
+				continue;
+			}
+
+			std::lock_guard<std::mutex> lock(clients_mutex);
+
+			// 終了したクライアントの後始末
+			for (std::list<Client*>::iterator it = clients.begin(); it != clients.end(); )
+			{
+				if ((*it)->done)
+				{
+					(*it)->thread.join();
+					delete *it;
+					it = clients.erase(it);
+				}
+				else
+				{
+					++it;
+				}
+			}
+
+			Client* client = new Client;
+			client->id     = next_id++;
+			client->pipe   = pipe;
+			client->done   = false;
+			client->thread = std::thread(&Server::clientLoop, this, client);
+			clients.push_back(client);
+		}
+	}
+
+	void Server::clientLoop(Client* client)
+	{
+		{
+			Session session(client->id, handler, report);
+
+			std::vector<unsigned char> buffer(READ_BUFFER_SIZE);
+			std::vector<unsigned char> reply;
+
+			while (!quit)
+			{
+				DWORD read_size;
+
+				if (!ReadFile(client->pipe, buffer.data(), buffer.size(), &read_size, NULL) || read_size == 0)
+				{
+					break;
+				}
+
+				reply.clear();
+
+				if (!session.feed(buffer.data(), read_size, reply))
+				{
+					report("[ipc] protocol error, disconnecting.\n");
+
+					break;
+				}
+
+				if (!reply.empty())
+				{
+					DWORD written_size;
+					WriteFile(client->pipe, reply.data(), reply.size(), &written_size, NULL);
+				}
+			}
+		}
+
+		DisconnectNamedPipe(client->pipe);
+		CloseHandle(client->pipe);
+		client->done = true;
+	}
+
+#else
+	// ========================================================================
+	// POSIX (Unixドメインソケット)
+	// ========================================================================
+	// NOTE:
+	// 1つのスレッドでpoll()し、全てのクライアントを順番に処理します。
+	// 停止要求は自己パイプ(wake_fd)への書き込みで伝えます。
+	bool Server::start(const char* name, Handler handler, Report report)
+	{
+		stop();
+
+		struct sockaddr_un address;
+		std::memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+
+		if (std::strlen(name) >= sizeof(address.sun_path))
+		{
+			return false;
+		}
+
+		std::strcpy(address.sun_path, name);
+
+		// 前回の実行で残ったソケットファイルを削除する
+		struct stat status;
+		if (::stat(name, &status) == 0 && S_ISSOCK(status.st_mode))
+		{
+			::unlink(name);
+		}
+
+		listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		if (listen_fd < 0)
+		{
+			return false;
+		}
+
+		if (   ::bind(listen_fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0
+			|| ::listen(listen_fd, 16) != 0
+			|| ::pipe(wake_fd) != 0 )
+		{
+			::close(listen_fd);
+			listen_fd = -1;
+
+			return false;
+		}
+
+		this->name    = name;
+		this->handler = handler;
+		this->report  = (report != NULL) ? report : Platform::debugLog;
+		quit          = false;
+
+		accept_thread = std::thread(&Server::acceptLoop, this);
+		started       = true;
+
+		return true;
+	}
+
+	void Server::stop()
+	{
+		if (!started)
+		{
+			return;
+		}
+
+		quit = true;
+
+		char wake = 0;
+		while (::write(wake_fd[1], &wake, 1) < 0 && errno == EINTR)
+		{
+		}
+
+		accept_thread.join();
+
+		::close(listen_fd);
+		::close(wake_fd[0]);
+		::close(wake_fd[1]);
+		::unlink(name.c_str());
+
+		listen_fd  = -1;
+		wake_fd[0] = -1;
+		wake_fd[1] = -1;
+		started    = false;
+	}
+
+	void Server::acceptLoop()
+	{
+		std::map<int, Session*>    sessions;
+		std::vector<struct pollfd> fds;
+		std::vector<unsigned char> buffer(READ_BUFFER_SIZE);
+		std::vector<unsigned char> reply;
+
+		while (!quit)
+		{
+			fds.clear();
+
+			struct pollfd wake     = { wake_fd[0], POLLIN, 0 };
+			struct pollfd listener = { listen_fd,  POLLIN, 0 };
+			fds.push_back(wake);
+			fds.push_back(listener);
+
+			for (std::map<int, Session*>::iterator it = sessions.begin(); it != sessions.end(); ++it)
+			{
+				struct pollfd client = { it->first, POLLIN, 0 };
+				fds.push_back(client);
+			}
+
+			if (::poll(fds.data(), fds.size(), -1) < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+
+				report("[ipc] poll() failed.\n");
+
+				break;
+			}
+
+			if (fds[0].revents != 0)
+			{
+				break;
+			}
+
+			if (fds[1].revents & POLLIN)
+			{
+				int client_fd = ::accept(listen_fd, NULL, NULL);
+				if (client_fd >= 0)
+				{
+					sessions[client_fd] = new Session(next_id++, handler, report);
+				}
+			}
+
+			for (std::size_t index = 2; index < fds.size(); index++)
+			{
+				if (fds[index].revents == 0)
+				{
+					continue;
+				}
+
+				const int fd   = fds[index].fd;
+				bool      keep = false;
+
+				ssize_t read_size = ::read(fd, buffer.data(), buffer.size());
+
+				if (read_size > 0)
+				{
+					reply.clear();
+					keep = sessions[fd]->feed(buffer.data(), read_size, reply);
+
+					if (!keep)
+					{
+						report("[ipc] protocol error, disconnecting.\n");
+					}
+					else if (!reply.empty())
+					{
+						// 応答は小さいので、送りきれなかった場合は切断する
+						keep = (::send(fd, reply.data(), reply.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(reply.size()));
+					}
+				}
+				else if (read_size < 0 && errno == EINTR)
+				{
+					keep = true;
+				}
+
+				if (!keep)
+				{
+					delete sessions[fd];
+					sessions.erase(fd);
+					::close(fd);
+				}
+			}
+		}
+
+		for (std::map<int, Session*>::iterator it = sessions.begin(); it != sessions.end(); ++it)
+		{
+			delete it->second;
+			::close(it->first);
+		}
+	}
+#endif
+}
@@ -0,0 +1,75 @@
+﻿#ifndef _CORE_IPC_SERVER_H_
+#define _CORE_IPC_SERVER_H_
+
+// 標準C++ライブラリ
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// 独自実装ライブラリ
+#include "ipc_protocol.h"
+
+
+namespace Ipc
+{
+	// 受信したフレームの処理先
+	// ========================================================================
+	// NOTE:
+	// サーバのスレッドから呼び出されます。Windowsではクライアントごとに
+	// スレッドが分かれるため、複数のスレッドから同時に呼ばれる可能性があります。
+	// entriesは範囲チェック済みで、呼び出しから戻った後は無効になります。
+	// Linuxでは全クライアントを1つのスレッドで処理するため、ハンドラ内で
+	// 送信などの時間のかかる処理をしてはいけません。(キューに積むだけにすること)
+	typedef void (*Handler)(int type, const Entry* entries, int count);
+
+	// 接続・切断やスループットのログ出力先
+	typedef void (*Report)(const char* message);
+
+
+	// 多数のクライアントを受け付けるサーバ
+	// ========================================================================
+	// NOTE:
+	// nameはLinuxではソケットのパス、Windowsではパイプ名です。
+	class Server
+	{
+	public:
+		Server();
+		~Server();
+
+		bool start(const char* name, Handler handler, Report report = NULL);
+		void stop();
+
+		bool running() const { return started; }
+
+	private:
+		Server(const Server&);
+		Server& operator=(const Server&);
+
+		void acceptLoop();
+#ifdef _WIN32
+		struct Client;
+		void clientLoop(Client* client);
+#endif
+
+		std::string name;
+		Handler     handler;
+		Report      report;
+		bool        started;
+
+		volatile bool quit;
+		unsigned int  next_id;
+		std::thread   accept_thread;
+
+#ifdef _WIN32
+		std::mutex         clients_mutex;
+		std::list<Client*> clients;
+#else
+		int listen_fd;
+		int wake_fd[2];
+#endif
+	};
+}
+
+
+#endif // _CORE_IPC_SERVER_H_
@@ -0,0 +1,116 @@
+﻿// 標準C++ライブラリ
+#include <sstream>
+
+// 独自実装ライブラリ
+#include "joint.h"
+#include "platform.h"
+
+
+namespace
+{
+	// 関節ごとの直前の照合結果 (状態が変わった時だけログを出すため)
+	enum LimitState
+	{
+		STATE_IN_RANGE,
+		STATE_CLAMPED,
+		STATE_REJECTED
+	};
+
+	LimitState limit_state[Joint::SUM];
+}
+
+
+namespace Joint
+{
+	int map[SUM] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 13, 14, 15, 16, 17, 18, 19, 20 };
+	Settings settings[SUM] =
+	{
+		{ 250, 1550, 900,  900  },
+		{ 250, 1550, 1150, 1150 },
+		{ 250, 1550, 1200, 1200 },
+		{ 250, 1550, 800,  800  },
+		{ 250, 1550, 800,  800  },
+		{ 250, 1550, 850,  850  },
+		{ 250, 1550, 1400, 1400 },
+		{ 250, 1550, 1200, 1200 },
+		{ 250, 1550, 850,  850  },
+		{ 250, 1550, 900,  900  },
+		{ 250, 1550, 950,  950  },
+		{ 250, 1550, 600,  600  },
+		{ 250, 1550, 1100, 1100 },
+		{ 250, 1550, 1000, 1000 },
+		{ 250, 1550, 1100, 1100 },
+		{ 250, 1550, 400,  400  },
+		{ 250, 1550, 580,  580  },
+		{ 250, 1550, 1000, 1000 }
+	};
+
+	volatile LimitMode limit_mode = LIMIT_CLAMP;
+	std::atomic<long>  clamped_count(0);
+	std::atomic<long>  rejected_count(0);
+
+	int last_sent[SUM];
+
+	void resetLastSent()
+	{
+		for (int index = 0; index < SUM; index++)
+		{
+			last_sent[index]     = -1;
+			::limit_state[index] = STATE_IN_RANGE;
+		}
+	}
+
+	bool validateAngle(int joint_id, int& angle)
+	{
+		const Settings& joint = settings[joint_id];
+
+		::LimitState& state = ::limit_state[joint_id];
+
+		if (   angle >= static_cast<int>(joint.min)
+			&& angle <= static_cast<int>(joint.max) )
+		{
+			state = STATE_IN_RANGE;
+
+			return true;
+		}
+
+		int clamped = (angle < static_cast<int>(joint.min)) ? joint.min : joint.max;
+
+		if (limit_mode == LIMIT_REJECT)
+		{
+			long count = ++rejected_count;
+
+			if (state != STATE_REJECTED)
+			{
+				state = STATE_REJECTED;
+
+				std::stringstream log;
+				log << "[limit] joint " << joint_id << ": " << angle << " rejected. (total " << count << ")\n";
+				Platform::debugLog(log.str().c_str());
+			}
+
+			return false;
+		}
+
+		// 範囲外で動かし続けている間の、同じ角度の再送
+		if (last_sent[joint_id] == clamped)
+		{
+			return false;
+		}
+
+		long count = ++clamped_count;
+
+		if (state != STATE_CLAMPED)
+		{
+			state = STATE_CLAMPED;
+
+			std::stringstream log;
+			log << "[limit] joint " << joint_id << ": " << angle << " -> " << clamped << " clamped. (total " << count << ")\n";
+			Platform::debugLog(log.str().c_str());
+		}
+
+		angle = clamped;
+
+		return true;
+	}
+}
@@ -0,0 +1,58 @@
+﻿#ifndef _CORE_JOINT_H_
+#define _CORE_JOINT_H_
+
+// 標準C++ライブラリ
+#include <atomic>
+
+
+namespace Joint
+{
+	struct Settings
+	{
+		unsigned int min;
+		unsigned int max;
+		unsigned int home;
+		unsigned int now;
+	};
+
+	const int SUM = 18;
+
+	// GUI上の関節番号(0 - 17)から、PLEN2上の関節番号への対応表
+	extern int      map[SUM];
+	extern Settings settings[SUM];
+
+	// 送信前の角度チェック
+	// ========================================================================
+	// NOTE:
+	// "#SA"コマンドの角度がmin/maxの範囲外の場合、送信前に丸めるか破棄します。
+	// ファームウェア側でも弾かれるコマンドのために、無線の帯域を使わない工夫です。
+	enum LimitMode
+	{
+		LIMIT_CLAMP,  // 範囲内に丸めて送信する (既定)
+		LIMIT_REJECT  // 送信しない
+	};
+
+	extern volatile LimitMode limit_mode;
+	extern std::atomic<long>  clamped_count;
+	extern std::atomic<long>  rejected_count;
+
+	// 最後に送信した角度 (未送信なら-1)
+	extern int last_sent[SUM];
+
+	void resetLastSent();
+
+	// 角度をmin/maxと照合する
+	// ========================================================================
+	// NOTE:
+	// 送信すべき場合はtrueを返し、angleを送信する値に書き換えます。
+	// 丸めた結果が前回送信した角度と同じ場合も、送る意味がないので破棄します。
+	// (スライダーを範囲外で動かし続けた場合に、同じコマンドを連発しないため)
+	// この破棄はclamped_countにもrejected_countにも数えません。
+	//
+	// ログは関節ごとに、範囲内から丸め/破棄に変わった時だけ出力します。
+	// (範囲外でのスライダー操作のたびに、文字列を組み立てないため)
+	bool validateAngle(int joint_id, int& angle);
+}
+
+
+#endif // _CORE_JOINT_H_
@@ -0,0 +1,74 @@
+﻿#ifdef _WIN32
+	// Windows API関連
+	#include <Windows.h>
+#else
+	// POSIX関連
+	#include <time.h>
+	#include <errno.h>
+#endif
+
+// 標準C++ライブラリ
+#include <cstdio>
+
+// 独自実装ライブラリ
+#include "platform.h"
+
+
+namespace Platform
+{
+	bool verbose = false;
+
+#ifdef _WIN32
+	void sleep(unsigned int ms)
+	{
+		Sleep(ms);
+	}
+
+	unsigned long long now()
+	{
+		static LARGE_INTEGER freq = { 0 };
+		if (freq.QuadPart == 0)
+		{
+			QueryPerformanceFrequency(&freq);
+		}
+
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);
+
+		return static_cast<unsigned long long>(counter.QuadPart) * 1000000 / freq.QuadPart;
+	}
+
+	void debugLog(const char* message)
+	{
+		OutputDebugString(message);
+	}
+#else
+	void sleep(unsigned int ms)
+	{
+		struct timespec request;
+		request.tv_sec  = ms / 1000;
+		request.tv_nsec = (ms % 1000) * 1000000L;
+
+		// シグナルで中断された場合は、残り時間だけ再度スリープする
+		while (nanosleep(&request, &request) != 0 && errno == EINTR)
+		{
+		}
+	}
+
+	unsigned long long now()
+	{
+		struct timespec time;
+		clock_gettime(CLOCK_MONOTONIC, &time);
+
+		return static_cast<unsigned long long>(time.tv_sec) * 1000000 + time.tv_nsec / 1000;
+	}
+
+	void debugLog(const char* message)
+	{
+		if (verbose)
+		{
+			std::fputs(message, stderr);
+		}
+	}
+#endif
+}
@@ -0,0 +1,25 @@
+﻿#ifndef _CORE_PLATFORM_H_
+#define _CORE_PLATFORM_H_
+
+
+// 環境依存処理の窓口
+// ============================================================================
+// NOTE:
+// GUI(Windows)とCLI(Linux)の両方から使う処理は、ここを経由して環境依存の
+// APIを呼び出します。
+namespace Platform
+{
+	// ミリ秒単位のスリープ
+	void sleep(unsigned int ms);
+
+	// 単調増加する時刻 [us]
+	unsigned long long now();
+
+	// デバッグ出力
+	// Windowsでは OutputDebugString()、それ以外ではverboseがtrueの場合のみ標準エラー出力へ
+	void debugLog(const char* message);
+	extern bool verbose;
+}
+
+
+#endif // _CORE_PLATFORM_H_
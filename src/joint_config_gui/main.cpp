@@ -1,142 +1,56 @@
-// Windows API֘A
+// Windows API関連
 #include <Windows.h>
 #include <CommCtrl.h>
+#include <CommDlg.h>
 #pragma comment(lib, "ComCtl32.lib")
+#pragma comment(lib, "ComDlg32.lib")
 
-// WC++Cu
-#include <iomanip>
+// 標準C++ライブラリ
+#include <algorithm>
+#include <mutex>
 #include <sstream>
-#include <cstdint>
+#include <vector>
 
-// ƎCu
+// 独自実装ライブラリ
 #include "resource.h"
-#include "bgapi/cmd_def.h"
+#include "core/bgapi_transport.h"
+#include "core/command.h"
+#include "core/ipc_server.h"
+#include "core/joint.h"
+#include "motion/motion_file.h"
+#include "motion/motion_recorder.h"
 
 
-namespace BGAPI
-{
-	volatile HANDLE bled112_handle;
-	volatile bool   handle_created = false;
-	volatile bool   cmd_success    = false;
-	volatile bool   connected      = false;
-
-	// BLED112ւ̃R}hM
-	// ========================================================================
-	// NOTE:
-	// "cmd_def.c""bglib_output"|C^Ɋ֐|C^邱ƂŁA
-	// R}hMϏĂ炢܂B(BGAPIˑɂȂȂHv)
-	void output(std::uint8_t header_len, std::uint8_t* header, std::uint16_t msg_len, std::uint8_t* msg)
-	{
-		DWORD written_size;
-
-		if (WriteFile(BGAPI::bled112_handle, header, header_len, &written_size, NULL) == 0)
-		{
-			MessageBox(NULL, "BLED112ւ̃R}hMɎs܂B", "Error!", MB_OK);
-
-			return;
-		}
-
-		if (WriteFile(BGAPI::bled112_handle, msg, msg_len, &written_size, NULL) == 0)
-		{
-			MessageBox(NULL, "BLED112ւ̃R}hMɎs܂B", "Error!", MB_OK);
-
-			return;
-		}
-	}
-
-	// BLED112̃X|X
-	// ========================================================================
-	// NOTE:
-	// ̊֐BGAPIĂяoAKvȉ񐔂ĂяoKv܂B
-	// ǂ̃R}hłX|XK1񔭐̂ŁAŒ1͕KvłB
-	// sɃCxgƂăX|XԂĂꍇ́A[v
-	// sKv܂B({AvłA)
-	//
-	// CAUTION:
-	// ݔ񓯊ǂݍ݂sĂȂ߁AǂݍݕŃrW[EFCg
-	// ܂BʃXbhɓǂݍݕĈłA
-	// svcȋ܂B(炭ǂݏ̔rKv܂B)
-	int readMessage()
-	{
-		DWORD read_size;
-		struct ble_header header;
-
-		BOOL ret = ReadFile(BGAPI::bled112_handle, reinterpret_cast<unsigned char*>(&header), 4, &read_size, NULL);
-		if(!ret)
-		{
-			return GetLastError();
-		}
-
-		if (read_size == 0)
-		{
-			return 0;
-		}
-
-		unsigned char data_buff[256];
-		
-		ret = ReadFile(BGAPI::bled112_handle, data_buff, header.lolen, &read_size, NULL);
-		if(header.lolen)
-		{
-			if(!ret)
-			{
-				return GetLastError();
-			}
-		}
-
-		const struct ble_msg* msg = ble_get_msg_hdr(header);
-		if(!msg)
-		{
-			MessageBox(NULL, "Ή郁bZ[Wnh݂܂B", "Error!", MB_OK);
-
-			return -1;
-		}
-
-		// bZ[WnhɏϏ (eCxgnh̎́Able_handler.cppQ)
-		msg->handler(data_buff);
-
-		return 0;
-	}
-}
-
 namespace GUI
 {
 	volatile HWND main_dlg;
 	volatile int  checked_joint_id = 0;
-}
 
+	// モーション再生スレッドの状態
+	volatile bool motion_playing = false;
+	volatile bool motion_stop    = false;
+	HANDLE        motion_thread  = NULL;
+	char          motion_path[MAX_PATH];
 
-namespace Joint
-{
-	struct Settings
-	{
-		unsigned int min;
-		unsigned int max;
-		unsigned int home;
-		unsigned int now;
-	};
-
-	int map[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 13, 14, 15, 16, 17, 18, 19, 20 };
-	Settings settings[] =
-	{
-		{ 250, 1550, 900,  900  },
-		{ 250, 1550, 1150, 1150 },
-		{ 250, 1550, 1200, 1200 },
-		{ 250, 1550, 800,  800  },
-		{ 250, 1550, 800,  800  },
-		{ 250, 1550, 850,  850  },
-		{ 250, 1550, 1400, 1400 },
-		{ 250, 1550, 1200, 1200 },
-		{ 250, 1550, 850,  850  },
-		{ 250, 1550, 900,  900  },
-		{ 250, 1550, 950,  950  },
-		{ 250, 1550, 600,  600  },
-		{ 250, 1550, 1100, 1100 },
-		{ 250, 1550, 1000, 1000 },
-		{ 250, 1550, 1100, 1100 },
-		{ 250, 1550, 400,  400  },
-		{ 250, 1550, 580,  580  },
-		{ 250, 1550, 1000, 1000 }
-	};
+	// 関節操作の記録 (UIスレッドからのみ記録する)
+	Motion::Recorder motion_recorder;
+
+	// 外部プロセスからのコマンド
+	// ========================================================================
+	// NOTE:
+	// サーバのスレッドはコマンドをキューに積んでWM_IPC_COMMANDを投げるだけで、
+	// 実際の送信はUIスレッドがダイアログのメッセージとして処理します。
+	// (スライダー操作などと同じ経路を通すため)
+	// 送信待ちの"#SA"は関節ごとに最新の1件だけを残し、BLEの送信速度を超えて
+	// 送られてきた分は間引きます。ただし、間に同じ関節の"#MI", "#MA", "#HO"が
+	// 挟まった場合は、適用順が変わらないようにその前後をまとめません。
+	const UINT WM_IPC_COMMAND = WM_APP + 1;
+
+	Ipc::Server             ipc_server;
+	std::mutex              ipc_mutex;
+	std::vector<Ipc::Entry> ipc_queue;
+	int                     ipc_pending[Joint::SUM]; // ipc_queue内の送信待ちの"#SA"の位置 (なければ-1)
+	bool                    ipc_posted = false;
 }
 
 
@@ -225,15 +139,237 @@ namespace
 		setJointSettingNow(hWnd, init);
 	}
 
-	std::string buildCmd(HWND hWnd)
+	// BGAPIからの通知 (ble_handler.cppなどから呼ばれる)
+	void notifyError(const char* message)
 	{
-		int angle = 1800 - SendDlgItemMessage(hWnd, SLIDER_ANGLE, TBM_GETPOS, 0, 0);
-		
-		std::stringstream cmd;
-		cmd << std::setfill('0') << std::setw(2) << std::hex << static_cast<std::int16_t>(Joint::map[GUI::checked_joint_id]);
-		cmd << std::setfill('0') << std::setw(3) << std::hex << static_cast<std::int16_t>(angle);
+		MessageBox(NULL, message, "Error!", MB_OK);
+	}
+
+	void notifyConnected()
+	{
+		MessageBox(NULL, "PLEN2との接続に成功しました。", "ble_evt_connection_status()", MB_OK);
+	}
+
+	void notifyScanned(const char* mac)
+	{
+		SetDlgItemText(GUI::main_dlg, EDIT_MAC, mac);
+	}
+
+	// 外部プロセスからのコマンドをキューに積む (Ipc::Serverのスレッドから呼ばれる)
+	void queueIpcCommand(int type, const Ipc::Entry* entries, int count)
+	{
+		std::lock_guard<std::mutex> lock(GUI::ipc_mutex);
+
+		for (int index = 0; index < count; index++)
+		{
+			const Ipc::Entry& entry = entries[index];
+
+			if (entry.kind == Ipc::KIND_ANGLE)
+			{
+				int& pending = GUI::ipc_pending[entry.joint];
+
+				if (pending >= 0)
+				{
+					GUI::ipc_queue[pending].angle = entry.angle;
+
+					continue;
+				}
+
+				pending = static_cast<int>(GUI::ipc_queue.size());
+			}
+			else
+			{
+				// 制限値の変更より前の"#SA"に、後の"#SA"をまとめてはいけない
+				GUI::ipc_pending[entry.joint] = -1;
+			}
+
+			GUI::ipc_queue.push_back(entry);
+		}
+
+		if (!GUI::ipc_posted)
+		{
+			GUI::ipc_posted = true;
+			PostMessage(GUI::main_dlg, GUI::WM_IPC_COMMAND, 0, 0);
+		}
+	}
+
+	// 記録を終了し、結果を表示する
+	void stopRecording(HWND hWnd)
+	{
+		bool success = GUI::motion_recorder.stop();
+		SetDlgItemText(hWnd, BUTTON_MOTION_RECORD, "Record");
+
+		std::stringstream result;
+		result << GUI::motion_recorder.recorded() << "フレームを記録しました。";
+
+		if (GUI::motion_recorder.expired())
+		{
+			result << "\n(記録時間の上限(約71分)に達したため、記録を終了しました。)";
+		}
+
+		if (GUI::motion_recorder.dropped() != 0)
+		{
+			result << "\n(バッファが溢れたため、" << GUI::motion_recorder.dropped() << "フレームを破棄しました。)";
+		}
+
+		if (!success)
+		{
+			result << "\n(ファイルへの書き込みに失敗しました。)";
+		}
+
+		MessageBox(NULL, result.str().c_str(), success ? "Success." : "Error!", MB_OK);
+	}
+
+	// 角度を送信し、実際に送信した角度を記録する (UIスレッド)
+	// ========================================================================
+	// NOTE:
+	// 記録するのはJoint::validateAngle()で丸めた後の角度で、弾かれた角度は記録
+	// しません。(モーションファイルには、PLEN2へ送った"#SA"だけを残すため)
+	void sendAndRecordAngle(HWND hWnd, int joint_id, int angle)
+	{
+		if (!Command::sendAngle(joint_id, angle))
+		{
+			return;
+		}
+
+		GUI::motion_recorder.record(joint_id, Joint::last_sent[joint_id]);
+
+		if (GUI::motion_recorder.expired())
+		{
+			::stopRecording(hWnd);
+		}
+	}
+
+	// キューに積まれたコマンドを送信する (UIスレッド)
+	void processIpcCommand(HWND hWnd)
+	{
+		std::vector<Ipc::Entry> entries;
+
+		{
+			std::lock_guard<std::mutex> lock(GUI::ipc_mutex);
+
+			entries.swap(GUI::ipc_queue);
+			std::fill(GUI::ipc_pending, GUI::ipc_pending + Joint::SUM, -1);
+			GUI::ipc_posted = false;
+		}
+
+		// モーション再生中は、手動操作と同様に無視する
+		if (!BGAPI::connected || GUI::motion_playing)
+		{
+			return;
+		}
+
+		for (std::size_t index = 0; index < entries.size(); index++)
+		{
+			const Ipc::Entry& entry = entries[index];
+
+			switch (entry.kind)
+			{
+				case Ipc::KIND_ANGLE:
+				{
+					Joint::settings[entry.joint].now = entry.angle;
+					::sendAndRecordAngle(hWnd, entry.joint, entry.angle);
+
+					break;
+				}
+
+				case Ipc::KIND_MIN:
+				{
+					Command::sendMin(entry.joint, entry.angle);
+
+					break;
+				}
+
+				case Ipc::KIND_MAX:
+				{
+					Command::sendMax(entry.joint, entry.angle);
+
+					break;
+				}
+
+				case Ipc::KIND_HOME:
+				{
+					Command::sendHome(entry.joint, entry.angle);
+
+					break;
+				}
+			}
+		}
+
+		::loadJointSetting(hWnd);
+	}
+
+	// ファイル選択ダイアログ
+	bool selectFile(HWND hWnd, const char* filter, const char* ext, bool save, char* path)
+	{
+		path[0] = '\0';
+
+		OPENFILENAME ofn = { 0 };
+		ofn.lStructSize = sizeof(ofn);
+		ofn.hwndOwner   = hWnd;
+		ofn.lpstrFilter = filter;
+		ofn.lpstrFile   = path;
+		ofn.nMaxFile    = MAX_PATH;
+		ofn.lpstrDefExt = ext;
+
+		if (save)
+		{
+			ofn.Flags = OFN_OVERWRITEPROMPT | OFN_NOCHANGEDIR;
+
+			return GetSaveFileName(&ofn) != FALSE;
+		}
 
-		return cmd.str();
+		ofn.Flags = OFN_FILEMUSTEXIST | OFN_NOCHANGEDIR;
+
+		return GetOpenFileName(&ofn) != FALSE;
+	}
+
+	// モーション再生時のフレーム出力先 (Motion::playから呼ばれる)
+	void outputMotionFrame(int joint_id, int angle)
+	{
+		if (joint_id < 0 || joint_id >= Joint::SUM)
+		{
+			return;
+		}
+
+		Joint::settings[joint_id].now = angle;
+
+		if (BGAPI::connected)
+		{
+			Command::sendAngle(joint_id, angle);
+		}
+	}
+
+	DWORD WINAPI playMotionThread(LPVOID param)
+	{
+		if (Motion::play(GUI::motion_path, outputMotionFrame, &GUI::motion_stop) == Motion::PLAY_OPEN_FAILED)
+		{
+			MessageBox(NULL, "モーションファイルの読み込みに失敗しました。", "Error!", MB_OK);
+		}
+
+		GUI::motion_playing = false;
+
+		return 0;
+	}
+
+	// モーション再生を停止し、スレッドの終了を待つ
+	// ========================================================================
+	// NOTE:
+	// COMポートを閉じる前などに必ず呼び出してください。
+	// (再生スレッドがBLED112へ書き込み中の可能性があるため)
+	void stopMotion()
+	{
+		if (GUI::motion_thread == NULL)
+		{
+			return;
+		}
+
+		GUI::motion_stop = true;
+		WaitForSingleObject(GUI::motion_thread, INFINITE);
+		CloseHandle(GUI::motion_thread);
+
+		GUI::motion_thread  = NULL;
+		GUI::motion_playing = false;
 	}
 }
 
@@ -251,9 +387,15 @@ BOOL CALLBACK mainDlgProc(HWND hDlg, UINT msg, WPARAM wp, LPARAM lp)
 			SendDlgItemMessage(hDlg, SLIDER_ANGLE, TBM_SETPAGESIZE, 0, 25);
 			::loadJointSetting(hDlg);
 			::loadComList(hDlg);
+			Joint::resetLastSent();
+
+			BGAPI::notify_error     = ::notifyError;
+			BGAPI::notify_connected = ::notifyConnected;
+			BGAPI::notify_scanned   = ::notifyScanned;
+			GUI::main_dlg           = hDlg;
 
-			::bglib_output = BGAPI::output;
-			GUI::main_dlg  = hDlg;
+			std::fill(GUI::ipc_pending, GUI::ipc_pending + Joint::SUM, -1);
+			GUI::ipc_server.start(Ipc::DEFAULT_PIPE_NAME, ::queueIpcCommand);
 
 			return TRUE;
 		}
@@ -267,14 +409,9 @@ BOOL CALLBACK mainDlgProc(HWND hDlg, UINT msg, WPARAM wp, LPARAM lp)
 				Joint::settings[GUI::checked_joint_id].now = 1800 - position;
 				::setJointSettingNow(hDlg);
 
-				if (BGAPI::connected)
+				if (BGAPI::connected && !GUI::motion_playing)
 				{
-					std::string cmd = "#SA" + ::buildCmd(hDlg);
-					ble_cmd_attclient_attribute_write(0, 31, 8, cmd.c_str());
-					Sleep(10);
-
-					BGAPI::readMessage();
-					BGAPI::readMessage();
+					::sendAndRecordAngle(hDlg, GUI::checked_joint_id, 1800 - position);
 				}
 			}
 
@@ -296,14 +433,9 @@ BOOL CALLBACK mainDlgProc(HWND hDlg, UINT msg, WPARAM wp, LPARAM lp)
 						Joint::settings[GUI::checked_joint_id].now = 1800 - position;
 						::setJointSettingNow(hDlg);
 
-						if (BGAPI::connected)
+						if (BGAPI::connected && !GUI::motion_playing)
 						{
-							std::string cmd = "#SA" + ::buildCmd(hDlg);
-							ble_cmd_attclient_attribute_write(0, 31, 8, cmd.c_str());
-							Sleep(10);
-
-							BGAPI::readMessage();
-							BGAPI::readMessage();
+							::sendAndRecordAngle(hDlg, GUI::checked_joint_id, 1800 - position);
 						}
 					}
 
@@ -321,14 +453,9 @@ BOOL CALLBACK mainDlgProc(HWND hDlg, UINT msg, WPARAM wp, LPARAM lp)
 						Joint::settings[GUI::checked_joint_id].now = 1800 - position;
 						::setJointSettingNow(hDlg);
 
-						if (BGAPI::connected)
+						if (BGAPI::connected && !GUI::motion_playing)
 						{
-							std::string cmd = "#SA" + ::buildCmd(hDlg);
-							ble_cmd_attclient_attribute_write(0, 31, 8, cmd.c_str());
-							Sleep(10);
-
-							BGAPI::readMessage();
-							BGAPI::readMessage();
+							::sendAndRecordAngle(hDlg, GUI::checked_joint_id, 1800 - position);
 						}
 					}
 
@@ -337,17 +464,10 @@ BOOL CALLBACK mainDlgProc(HWND hDlg, UINT msg, WPARAM wp, LPARAM lp)
 
 				case BUTTON_MAX:
 				{
-					if (BGAPI::connected)
+					if (BGAPI::connected && !GUI::motion_playing)
 					{
-						Joint::settings[GUI::checked_joint_id].max = 1800 - SendDlgItemMessage(hDlg, SLIDER_ANGLE, TBM_GETPOS, 0, 0);
+						Command::sendMax(GUI::checked_joint_id, 1800 - SendDlgItemMessage(hDlg, SLIDER_ANGLE, TBM_GETPOS, 0, 0));
 						::setJointSettingMax(hDlg);
-
-						std::string cmd = "#MA" + ::buildCmd(hDlg);
-						ble_cmd_attclient_attribute_write(0, 31, 8, cmd.c_str());
-						Sleep(10);
-
-						BGAPI::readMessage();
-						BGAPI::readMessage();
 					}
 
 					break;
@@ -355,17 +475,10 @@ BOOL CALLBACK mainDlgProc(HWND hDlg, UINT msg, WPARAM wp, LPARAM lp)
 
 				case BUTTON_MIN:
 				{
-					if (BGAPI::connected)
+					if (BGAPI::connected && !GUI::motion_playing)
 					{
-						Joint::settings[GUI::checked_joint_id].min = 1800 - SendDlgItemMessage(hDlg, SLIDER_ANGLE, TBM_GETPOS, 0, 0);
+						Command::sendMin(GUI::checked_joint_id, 1800 - SendDlgItemMessage(hDlg, SLIDER_ANGLE, TBM_GETPOS, 0, 0));
 						::setJointSettingMin(hDlg);
-
-						std::string cmd = "#MI" + ::buildCmd(hDlg);
-						ble_cmd_attclient_attribute_write(0, 31, 8, cmd.c_str());
-						Sleep(10);
-
-						BGAPI::readMessage();
-						BGAPI::readMessage();
 					}
 
 					break;
@@ -373,17 +486,10 @@ BOOL CALLBACK mainDlgProc(HWND hDlg, UINT msg, WPARAM wp, LPARAM lp)
 
 				case BUTTON_HOME:
 				{
-					if (BGAPI::connected)
+					if (BGAPI::connected && !GUI::motion_playing)
 					{
-						Joint::settings[GUI::checked_joint_id].home = 1800 - SendDlgItemMessage(hDlg, SLIDER_ANGLE, TBM_GETPOS, 0, 0);
+						Command::sendHome(GUI::checked_joint_id, 1800 - SendDlgItemMessage(hDlg, SLIDER_ANGLE, TBM_GETPOS, 0, 0));
 						::setJointSettingHome(hDlg);
-
-						std::string cmd = "#HO" + ::buildCmd(hDlg);
-						ble_cmd_attclient_attribute_write(0, 31, 8, cmd.c_str());
-						Sleep(10);
-
-						BGAPI::readMessage();
-						BGAPI::readMessage();
 					}
 
 					break;
@@ -391,62 +497,39 @@ BOOL CALLBACK mainDlgProc(HWND hDlg, UINT msg, WPARAM wp, LPARAM lp)
 
 				case BUTTON_COM_CONNECT:
 				{
+					::stopMotion();
+
 					if (BGAPI::handle_created)
 					{
-						if (BGAPI::connected)
-						{
-							ble_cmd_connection_disconnect(0);
-							Sleep(10);
-							BGAPI::readMessage();
-
-							BGAPI::connected = false;
-							SetDlgItemText(hDlg, EDIT_MAC, "");
-						}
-
-						CloseHandle(BGAPI::bled112_handle);
-
-						BGAPI::handle_created = false;
+						BGAPI::close();
+						SetDlgItemText(hDlg, EDIT_MAC, "");
 					}
 
 					char buff[256] = { '\0' };
-					std::string com = "\\\\.\\";
 					SendDlgItemMessage(hDlg, LIST_COM, LB_GETTEXT, SendDlgItemMessage(hDlg, LIST_COM, LB_GETCURSEL, 0, 0), (LPARAM)buff);
-					
-					com += buff;
-					BGAPI::bled112_handle = CreateFileA(com.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
 
-					if (BGAPI::bled112_handle == INVALID_HANDLE_VALUE)
+					if (!BGAPI::open(buff))
 					{
-						MessageBox(NULL, "COM|[g̃I[vɎs܂B", "Error.", MB_OK);
+						MessageBox(NULL, "COMポートのオープンに失敗しました。", "Error.", MB_OK);
 
 						break;
 					}
 
-					BGAPI::handle_created = true;
-					MessageBox(NULL, "COM|[g̃I[vɐ܂B", "Success.", MB_OK);
+					MessageBox(NULL, "COMポートのオープンに成功しました。", "Success.", MB_OK);
 
 					break;
 				}
 
 				case BUTTON_COM_DISCONNECT:
 				{
+					::stopMotion();
+
 					if (BGAPI::handle_created)
 					{
-						if (BGAPI::connected)
-						{
-							ble_cmd_connection_disconnect(0);
-							Sleep(10);
-							BGAPI::readMessage();
-
-							BGAPI::connected = false;
-							SetDlgItemText(hDlg, EDIT_MAC, "");
-						}
-
-						CloseHandle(BGAPI::bled112_handle);
-
-						BGAPI::handle_created = false;
+						BGAPI::close();
+						SetDlgItemText(hDlg, EDIT_MAC, "");
 
-						MessageBox(NULL, "COM|[gN[Y܂B", "Success.", MB_OK);
+						MessageBox(NULL, "COMポートをクローズしました。", "Success.", MB_OK);
 					}				
 
 					break;
@@ -454,27 +537,16 @@ BOOL CALLBACK mainDlgProc(HWND hDlg, UINT msg, WPARAM wp, LPARAM lp)
 
 				case BUTTON_PLEN2_SCAN:
 				{
+					::stopMotion();
+
 					if (BGAPI::handle_created)
 					{
-						ble_cmd_gap_end_procedure();
-						Sleep(10);
-						BGAPI::readMessage();
-
-						ble_cmd_connection_disconnect(0);
-						Sleep(10);
-						BGAPI::readMessage();
-
-						ble_cmd_gap_discover(gap_discover_generic);
-						Sleep(10);
-						BGAPI::readMessage();
+						Joint::resetLastSent();
 
-						// ble_evt_connection_status()𔭐񐔕
-						while (!BGAPI::connected)
+						if (BGAPI::connectPLEN2())
 						{
-							BGAPI::readMessage();
+							::loadJointSetting(hDlg, true);
 						}
-
-						::loadJointSetting(hDlg, true);
 					}
 
 					break;
@@ -482,29 +554,144 @@ BOOL CALLBACK mainDlgProc(HWND hDlg, UINT msg, WPARAM wp, LPARAM lp)
 
 				case BUTTON_PLEN2_DISCONNECT:
 				{
+					::stopMotion();
+
 					if (BGAPI::connected)
 					{
-						ble_cmd_connection_disconnect(0);
-						Sleep(10);
-						BGAPI::readMessage();
-
-						BGAPI::connected = false;
+						BGAPI::disconnectPLEN2();
 						SetDlgItemText(hDlg, EDIT_MAC, "");
 
-						MessageBox(NULL, "PLEN2Ƃ̐ڑ܂B", "Success.", MB_OK);
+						MessageBox(NULL, "PLEN2との接続を解除しました。", "Success.", MB_OK);
 					}
 
 					break;
 				}
 
+				case BUTTON_MOTION_PLAY:
+				{
+					if (GUI::motion_playing)
+					{
+						break;
+					}
+
+					// 前回の再生スレッドの後始末
+					::stopMotion();
+
+					if (!::selectFile(hDlg, "Motion File (*.motion)\0*.motion\0", "motion", false, GUI::motion_path))
+					{
+						break;
+					}
+
+					GUI::motion_stop    = false;
+					GUI::motion_playing = true;
+					GUI::motion_thread  = CreateThread(NULL, 0, ::playMotionThread, NULL, 0, NULL);
+
+					if (GUI::motion_thread == NULL)
+					{
+						GUI::motion_playing = false;
+						MessageBox(NULL, "モーション再生スレッドの作成に失敗しました。", "Error!", MB_OK);
+					}
+
+					break;
+				}
+
+				case BUTTON_MOTION_STOP:
+				{
+					::stopMotion();
+					::loadJointSetting(hDlg);
+
+					break;
+				}
+
+				case BUTTON_MOTION_IMPORT:
+				{
+					char xml_path[MAX_PATH];
+					char motion_path[MAX_PATH];
+
+					if (   !::selectFile(hDlg, "XML File (*.xml)\0*.xml\0", "xml", false, xml_path)
+						|| !::selectFile(hDlg, "Motion File (*.motion)\0*.motion\0", "motion", true, motion_path) )
+					{
+						break;
+					}
+
+					if (!Motion::importXml(xml_path, motion_path))
+					{
+						MessageBox(NULL, "XMLファイルのインポートに失敗しました。", "Error!", MB_OK);
+
+						break;
+					}
+
+					MessageBox(NULL, "XMLファイルをインポートしました。", "Success.", MB_OK);
+
+					break;
+				}
+
+				case BUTTON_MOTION_EXPORT:
+				{
+					char motion_path[MAX_PATH];
+					char xml_path[MAX_PATH];
+
+					if (   !::selectFile(hDlg, "Motion File (*.motion)\0*.motion\0", "motion", false, motion_path)
+						|| !::selectFile(hDlg, "XML File (*.xml)\0*.xml\0", "xml", true, xml_path) )
+					{
+						break;
+					}
+
+					if (!Motion::exportXml(motion_path, xml_path))
+					{
+						MessageBox(NULL, "XMLファイルへのエクスポートに失敗しました。", "Error!", MB_OK);
+
+						break;
+					}
+
+					MessageBox(NULL, "XMLファイルへエクスポートしました。", "Success.", MB_OK);
+
+					break;
+				}
+
+				case BUTTON_MOTION_RECORD:
+				{
+					if (GUI::motion_recorder.recording())
+					{
+						::stopRecording(hDlg);
+
+						break;
+					}
+
+					char record_path[MAX_PATH];
+
+					if (!::selectFile(hDlg, "Motion File (*.motion)\0*.motion\0", "motion", true, record_path))
+					{
+						break;
+					}
+
+					if (!GUI::motion_recorder.start(record_path))
+					{
+						MessageBox(NULL, "記録ファイルの作成に失敗しました。", "Error!", MB_OK);
+
+						break;
+					}
+
+					SetDlgItemText(hDlg, BUTTON_MOTION_RECORD, "Stop Rec.");
+
+					break;
+				}
+
+				case CHECK_LIMIT_REJECT:
+				{
+					Joint::limit_mode = (IsDlgButtonChecked(hDlg, CHECK_LIMIT_REJECT) == BST_CHECKED) ? Joint::LIMIT_REJECT : Joint::LIMIT_CLAMP;
+
+					break;
+				}
+
 				default:
 				{
-					// WI{^NbNꂽȂAIDێB
+					// ラジオボタンがクリックされたなら、そのIDを保持する。
 					if (   LOWORD(wp) >= RADIO_JOINT01
 						&& LOWORD(wp) <= RADIO_JOINT18 )
 					{
 						GUI::checked_joint_id = (int)LPWORD(wp);
-						GUI::checked_joint_id -= RADIO_JOINT01; // LXg΍̂߁A2sɕ
+						GUI::checked_joint_id -= RADIO_JOINT01; // キャスト対策のため、2行に分ける
 						::loadJointSetting(hDlg);
 					}
 
@@ -517,21 +704,15 @@ BOOL CALLBACK mainDlgProc(HWND hDlg, UINT msg, WPARAM wp, LPARAM lp)
 
 		case WM_CLOSE:
 		{
-			int ret = MessageBox(NULL, "{ɃAvP[VI܂H\n(SĂ̍Ɨj܂B)", "ImF", MB_OKCANCEL);
+			int ret = MessageBox(NULL, "本当にアプリケーションを終了しますか？\n(全ての作業履歴が破棄されます。)", "終了確認", MB_OKCANCEL);
 
 			if (ret == IDOK)
 			{
-				if (BGAPI::connected)
-				{
-					ble_cmd_connection_disconnect(0);
-					Sleep(10);
-					BGAPI::readMessage();
-				}
+				GUI::ipc_server.stop();
+				::stopMotion();
+				GUI::motion_recorder.stop();
 
-				if (BGAPI::handle_created)
-				{
-					CloseHandle(BGAPI::bled112_handle);
-				}
+				BGAPI::close();
 
 				EndDialog(hDlg, 0);
 			}
@@ -541,6 +722,13 @@ BOOL CALLBACK mainDlgProc(HWND hDlg, UINT msg, WPARAM wp, LPARAM lp)
 
 		default:
 		{
+			if (msg == GUI::WM_IPC_COMMAND)
+			{
+				::processIpcCommand(hDlg);
+
+				return TRUE;
+			}
+
 			break;
 		}
 	}
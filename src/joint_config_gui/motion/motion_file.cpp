@@ -0,0 +1,394 @@
+﻿// Windows API関連
+#include <Windows.h>
+#include <MMSystem.h>
+#pragma comment(lib, "winmm.lib")
+
+// 標準C++ライブラリ
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// 独自実装ライブラリ
+#include "motion_file.h"
+#include "../tinyxml/tinyxml.h"
+
+
+namespace
+{
+	// この時間[us]より先のフレームはSleep()で待ち、それ以降はビジーウェイトする
+	const LONGLONG SPIN_THRESHOLD_US = 2000;
+
+	// XMLから読み込むフレームの整列用 (同時刻のフレームは記述順を保つ)
+	bool frameTimeLess(const Motion::Frame& lhs, const Motion::Frame& rhs)
+	{
+		return lhs.time < rhs.time;
+	}
+
+	void initHeader(Motion::Header& header, std::uint32_t frame_count)
+	{
+		std::memcpy(header.magic, Motion::MAGIC, sizeof(header.magic));
+		header.version     = Motion::VERSION;
+		header.frame_size  = sizeof(Motion::Frame);
+		header.frame_count = frame_count;
+		header.reserved    = 0;
+	}
+
+	// 基準時刻からtime[us]経過するまで待機する
+	// 戻り値がfalseの場合は、待機中に停止要求があったことを表す。
+	bool waitUntil(const LARGE_INTEGER& start, const LARGE_INTEGER& freq, std::uint32_t time, volatile bool* stop)
+	{
+		const LONGLONG target = start.QuadPart + static_cast<LONGLONG>(time) * freq.QuadPart / 1000000;
+
+		for (;;)
+		{
+			if (*stop)
+			{
+				return false;
+			}
+
+			LARGE_INTEGER now;
+			QueryPerformanceCounter(&now);
+
+			if (now.QuadPart >= target)
+			{
+				return true;
+			}
+
+			LONGLONG remain_us = (target - now.QuadPart) * 1000000 / freq.QuadPart;
+
+			if (remain_us > SPIN_THRESHOLD_US)
+			{
+				Sleep(static_cast<DWORD>((remain_us - SPIN_THRESHOLD_US) / 1000) + 1);
+			}
+			else
+			{
+				YieldProcessor();
+			}
+		}
+	}
+}
+
+
+namespace Motion
+{
+	// ========================================================================
+	// Writer
+	// ========================================================================
+	Writer::Writer()
+		: fp(NULL)
+		, frame_count(0)
+	{
+	}
+
+	Writer::~Writer()
+	{
+		close();
+	}
+
+	bool Writer::open(const char* path)
+	{
+		close();
+
+		fp = std::fopen(path, "wb");
+		if (fp == NULL)
+		{
+			return false;
+		}
+
+		// フレーム数は未確定なので、close()時に書き戻す
+		Header header;
+		::initHeader(header, 0);
+		frame_count = 0;
+
+		if (std::fwrite(&header, sizeof(header), 1, fp) != 1)
+		{
+			std::fclose(fp);
+			fp = NULL;
+
+			return false;
+		}
+
+		return true;
+	}
+
+	bool Writer::append(const Frame& frame)
+	{
+		return append(&frame, 1);
+	}
+
+	bool Writer::append(const Frame* frames, std::size_t count)
+	{
+		if (fp == NULL)
+		{
+			return false;
+		}
+
+		if (count == 0)
+		{
+			return true;
+		}
+
+		if (std::fwrite(frames, sizeof(Frame), count, fp) != count)
+		{
+			return false;
+		}
+
+		frame_count += static_cast<std::uint32_t>(count);
+
+		return true;
+	}
+
+	bool Writer::close()
+	{
+		if (fp == NULL)
+		{
+			return true;
+		}
+
+		Header header;
+		::initHeader(header, frame_count);
+
+		bool success =    std::fseek(fp, 0, SEEK_SET) == 0
+		               && std::fwrite(&header, sizeof(header), 1, fp) == 1;
+
+		success = (std::fclose(fp) == 0) && success;
+		fp = NULL;
+
+		return success;
+	}
+
+
+	// ========================================================================
+	// MappedFile
+	// ========================================================================
+	MappedFile::MappedFile()
+		: file_handle(INVALID_HANDLE_VALUE)
+		, mapping_handle(NULL)
+		, view(NULL)
+		, file_header(NULL)
+		, file_frames(NULL)
+	{
+	}
+
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+	bool MappedFile::open(const char* path)
+	{
+		close();
+
+		file_handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file_handle == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER size;
+		if (   !GetFileSizeEx(file_handle, &size)
+			|| size.QuadPart < static_cast<LONGLONG>(sizeof(Header)) )
+		{
+			close();
+
+			return false;
+		}
+
+		mapping_handle = CreateFileMapping(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping_handle == NULL)
+		{
+			close();
+
+			return false;
+		}
+
+		view = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+		if (view == NULL)
+		{
+			close();
+
+			return false;
+		}
+
+		const Header* header = static_cast<const Header*>(view);
+
+		// 壊れたファイルや、異なるバージョンのファイルを弾く
+		if (   std::memcmp(header->magic, MAGIC, sizeof(header->magic)) != 0
+			|| header->version    != VERSION
+			|| header->frame_size != sizeof(Frame)
+			|| static_cast<ULONGLONG>(size.QuadPart) < sizeof(Header) + static_cast<ULONGLONG>(header->frame_count) * sizeof(Frame) )
+		{
+			close();
+
+			return false;
+		}
+
+		file_header = header;
+		file_frames = reinterpret_cast<const Frame*>(header + 1);
+
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (view != NULL)
+		{
+			UnmapViewOfFile(view);
+			view = NULL;
+		}
+
+		if (mapping_handle != NULL)
+		{
+			CloseHandle(mapping_handle);
+			mapping_handle = NULL;
+		}
+
+		if (file_handle != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(file_handle);
+			file_handle = INVALID_HANDLE_VALUE;
+		}
+
+		file_header = NULL;
+		file_frames = NULL;
+	}
+
+
+	// ========================================================================
+	// XMLとの相互変換
+	// ========================================================================
+	bool importXml(const char* xml_path, const char* motion_path)
+	{
+		TiXmlDocument document;
+		if (!document.LoadFile(xml_path))
+		{
+			return false;
+		}
+
+		TiXmlElement* root = document.RootElement();
+		if (root == NULL || std::strcmp(root->Value(), "motion") != 0)
+		{
+			return false;
+		}
+
+		std::vector<Frame> frames;
+
+		for (TiXmlElement* element = root->FirstChildElement("frame"); element != NULL; element = element->NextSiblingElement("frame"))
+		{
+			double time;
+			int    joint;
+			int    angle;
+
+			if (   element->QueryDoubleAttribute("time", &time) != TIXML_SUCCESS
+				|| element->QueryIntAttribute("joint", &joint) != TIXML_SUCCESS
+				|| element->QueryIntAttribute("angle", &angle) != TIXML_SUCCESS )
+			{
+				return false;
+			}
+
+			if (   time  < 0 || time  > 4294967295.0
+				|| joint < 0 || joint > 255
+				|| angle < 0 || angle > 1800 )
+			{
+				return false;
+			}
+
+			Frame frame;
+			frame.time  = static_cast<std::uint32_t>(time);
+			frame.joint = static_cast<std::uint8_t>(joint);
+			frame.flags = 0;
+			frame.angle = static_cast<std::uint16_t>(angle);
+
+			frames.push_back(frame);
+		}
+
+		std::stable_sort(frames.begin(), frames.end(), ::frameTimeLess);
+
+		Writer writer;
+		if (!writer.open(motion_path))
+		{
+			return false;
+		}
+
+		if (!frames.empty() && !writer.append(&frames[0], frames.size()))
+		{
+			writer.close();
+
+			return false;
+		}
+
+		return writer.close();
+	}
+
+	bool exportXml(const char* motion_path, const char* xml_path)
+	{
+		MappedFile file;
+		if (!file.open(motion_path))
+		{
+			return false;
+		}
+
+		TiXmlDocument document;
+		document.LinkEndChild(new TiXmlDeclaration("1.0", "UTF-8", ""));
+
+		TiXmlElement* root = new TiXmlElement("motion");
+		root->SetAttribute("version", VERSION);
+		document.LinkEndChild(root);
+
+		const Frame* frames = file.frames();
+
+		for (std::uint32_t index = 0; index < file.count(); index++)
+		{
+			// timeはintの範囲を超え得るので、文字列として書き出す
+			char time_buff[16];
+			sprintf_s(time_buff, sizeof(time_buff), "%lu", static_cast<unsigned long>(frames[index].time));
+
+			TiXmlElement* element = new TiXmlElement("frame");
+			element->SetAttribute("time",  time_buff);
+			element->SetAttribute("joint", frames[index].joint);
+			element->SetAttribute("angle", frames[index].angle);
+			root->LinkEndChild(element);
+		}
+
+		return document.SaveFile(xml_path);
+	}
+
+
+	// ========================================================================
+	// 再生
+	// ========================================================================
+	PlayResult play(const char* motion_path, Output output, volatile bool* stop)
+	{
+		MappedFile file;
+		if (!file.open(motion_path))
+		{
+			return PLAY_OPEN_FAILED;
+		}
+
+		LARGE_INTEGER freq;
+		LARGE_INTEGER start;
+		QueryPerformanceFrequency(&freq);
+
+		// Sleep()の分解能を1msに上げる (既定では約15.6ms)
+		timeBeginPeriod(1);
+		QueryPerformanceCounter(&start);
+
+		const Frame* frames = file.frames();
+		PlayResult   result = PLAY_COMPLETED;
+
+		for (std::uint32_t index = 0; index < file.count(); index++)
+		{
+			if (!::waitUntil(start, freq, frames[index].time, stop))
+			{
+				result = PLAY_STOPPED;
+				break;
+			}
+
+			output(frames[index].joint, frames[index].angle);
+		}
+
+		timeEndPeriod(1);
+
+		return result;
+	}
+}
@@ -0,0 +1,136 @@
+﻿#ifndef _MOTION_FILE_H_
+#define _MOTION_FILE_H_
+
+// 標準C++ライブラリ
+#include <cstdio>
+#include <cstdint>
+
+
+// モーションファイル (*.motion)
+// ============================================================================
+// NOTE:
+// "#SA"コマンドとして送信した(関節, 角度)の組を、タイムスタンプ付きの固定長
+// フレームとして並べただけのバイナリ形式です。ヘッダに続いてフレームが時刻順に
+// 並びます。値は全てリトルエンディアンで格納します。
+//
+// 再生時はファイルをメモリマップしてフレームを先頭から順に読むだけなので、
+// 長いモーションでもパース処理は発生せず、使用メモリも一定です。
+// 手で編集する場合は、XMLとの相互変換(importXml/exportXml)を使用してください。
+namespace Motion
+{
+	const char          MAGIC[4] = { 'P', 'L', 'M', 'F' };
+	const std::uint16_t VERSION  = 1;
+
+	#pragma pack(push, 1)
+	struct Header
+	{
+		char          magic[4];    // "PLMF"
+		std::uint16_t version;     // VERSION
+		std::uint16_t frame_size;  // sizeof(Frame)
+		std::uint32_t frame_count;
+		std::uint32_t reserved;
+	};
+
+	struct Frame
+	{
+		std::uint32_t time;  // 先頭フレームからの経過時間 [us] (最大約71分)
+		std::uint8_t  joint; // GUI上の関節番号 (0 - 17)
+		std::uint8_t  flags; // 予約 (0)
+		std::uint16_t angle; // 0 - 1800
+	};
+	#pragma pack(pop)
+
+	// 再生時のフレーム出力先
+	// ========================================================================
+	// NOTE:
+	// BGAPI::outputと同様に、送信処理を関数ポインタで委譲してもらいます。
+	// (モーション再生処理がBLE周りに依存しない工夫)
+	typedef void (*Output)(int joint_id, int angle);
+
+
+	// モーションファイルの書き出し
+	// ========================================================================
+	// NOTE:
+	// フレーム数はclose()時にヘッダへ書き戻します。close()を呼ばずに破棄した
+	// 場合も、デストラクタでclose()します。
+	class Writer
+	{
+	public:
+		Writer();
+		~Writer();
+
+		bool open(const char* path);
+		bool append(const Frame& frame);
+		bool append(const Frame* frames, std::size_t count);
+		bool close();
+
+		std::uint32_t count() const { return frame_count; }
+
+	private:
+		Writer(const Writer&);
+		Writer& operator=(const Writer&);
+
+		std::FILE*    fp;
+		std::uint32_t frame_count;
+	};
+
+
+	// モーションファイルの読み込み (メモリマップ)
+	// ========================================================================
+	class MappedFile
+	{
+	public:
+		MappedFile();
+		~MappedFile();
+
+		bool open(const char* path);
+		void close();
+
+		const Header* header() const { return file_header; }
+		const Frame*  frames() const { return file_frames; }
+		std::uint32_t count()  const { return file_header ? file_header->frame_count : 0; }
+
+	private:
+		MappedFile(const MappedFile&);
+		MappedFile& operator=(const MappedFile&);
+
+		void*         file_handle;
+		void*         mapping_handle;
+		const void*   view;
+		const Header* file_header;
+		const Frame*  file_frames;
+	};
+
+
+	// XMLとの相互変換
+	// ========================================================================
+	// NOTE:
+	// XMLは以下の形式です。timeの単位はマイクロ秒です。
+	// インポート時、フレームは時刻順に並べ替えてから書き出します。
+	//
+	// <motion version="1">
+	//     <frame time="0" joint="0" angle="900" />
+	//     ...
+	// </motion>
+	bool importXml(const char* xml_path, const char* motion_path);
+	bool exportXml(const char* motion_path, const char* xml_path);
+
+
+	// モーションの再生
+	// ========================================================================
+	// NOTE:
+	// 各フレームの時刻になるまで待機し、outputへ(関節, 角度)を渡します。
+	// *stopがtrueになった時点で再生を中断し、PLAY_STOPPEDを返します。
+	// 待機はSleep()で大まかに待った後、残り僅かな時間だけビジーウェイトします。
+	enum PlayResult
+	{
+		PLAY_COMPLETED,  // 最後のフレームまで出力した
+		PLAY_STOPPED,    // 途中で中断した
+		PLAY_OPEN_FAILED // ファイルを開けなかった
+	};
+
+	PlayResult play(const char* motion_path, Output output, volatile bool* stop);
+}
+
+
+#endif // _MOTION_FILE_H_
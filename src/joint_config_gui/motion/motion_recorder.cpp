@@ -0,0 +1,238 @@
+﻿// Windows API関連
+#include <Windows.h>
+
+// 独自実装ライブラリ
+#include "motion_recorder.h"
+
+
+namespace
+{
+	// 書き出しスレッドが定期的に起床する間隔 [ms]
+	const DWORD FLUSH_INTERVAL = 50;
+
+	std::uint32_t roundUpPow2(std::uint32_t value)
+	{
+		std::uint32_t result = 1;
+
+		while (result < value)
+		{
+			result <<= 1;
+		}
+
+		return result;
+	}
+}
+
+
+namespace Motion
+{
+	Recorder::Recorder()
+		: mask(0)
+		, head(0)
+		, tail(0)
+		, active(false)
+		, quit(false)
+		, base_time(0)
+		, frequency(0)
+		, drop_count(0)
+		, time_over(false)
+		, write_error(false)
+		, thread_handle(NULL)
+		, wake_event(NULL)
+	{
+	}
+
+	Recorder::~Recorder()
+	{
+		stop();
+	}
+
+	bool Recorder::start(const char* path, std::uint32_t capacity)
+	{
+		stop();
+
+		// 記録中にメモリ確保が発生しないよう、ここで全て確保しておく
+		capacity = ::roundUpPow2(capacity < 2 ? 2 : capacity);
+		buffer.assign(capacity, Frame());
+		mask = capacity - 1;
+
+		head.store(0);
+		tail.store(0);
+		quit.store(false);
+		drop_count  = 0;
+		time_over   = false;
+		write_error = false;
+
+		if (!writer.open(path))
+		{
+			return false;
+		}
+
+		LARGE_INTEGER freq;
+		QueryPerformanceFrequency(&freq);
+		frequency = freq.QuadPart;
+
+		wake_event    = CreateEvent(NULL, FALSE, FALSE, NULL);
+		thread_handle = CreateThread(NULL, 0, flushThread, this, 0, NULL);
+
+		if (wake_event == NULL || thread_handle == NULL)
+		{
+			if (thread_handle != NULL)
+			{
+				CloseHandle(thread_handle);
+				thread_handle = NULL;
+			}
+
+			if (wake_event != NULL)
+			{
+				CloseHandle(wake_event);
+				wake_event = NULL;
+			}
+
+			writer.close();
+
+			return false;
+		}
+
+		// 書き出しスレッドがUIスレッドの邪魔をしないように
+		SetThreadPriority(thread_handle, THREAD_PRIORITY_BELOW_NORMAL);
+
+		active.store(true, std::memory_order_release);
+
+		return true;
+	}
+
+	bool Recorder::stop()
+	{
+		if (thread_handle == NULL)
+		{
+			return true;
+		}
+
+		active.store(false, std::memory_order_release);
+		quit.store(true, std::memory_order_release);
+		SetEvent(wake_event);
+
+		// 書き出しスレッドは、終了前にバッファの残りを全て書き出す
+		WaitForSingleObject(thread_handle, INFINITE);
+		CloseHandle(thread_handle);
+		CloseHandle(wake_event);
+		thread_handle = NULL;
+		wake_event    = NULL;
+
+		bool success = writer.close() && !write_error;
+
+		// 次の記録までバッファを保持しておく必要はない
+		std::vector<Frame>().swap(buffer);
+
+		return success;
+	}
+
+	void Recorder::record(int joint_id, int angle)
+	{
+		if (!active.load(std::memory_order_acquire) || time_over)
+		{
+			return;
+		}
+
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+
+		const std::uint32_t write_pos = head.load(std::memory_order_relaxed);
+		const std::uint32_t read_pos  = tail.load(std::memory_order_acquire);
+
+		if (write_pos - read_pos > mask)
+		{
+			drop_count++;
+
+			return;
+		}
+
+		// 先頭フレームの時刻を0とする
+		if (write_pos == 0)
+		{
+			base_time = now.QuadPart;
+		}
+
+		const long long elapsed = (now.QuadPart - base_time) * 1000000 / frequency;
+
+		if (elapsed > 0xFFFFFFFFLL)
+		{
+			time_over = true;
+
+			return;
+		}
+
+		Frame& frame = buffer[write_pos & mask];
+		frame.time  = static_cast<std::uint32_t>(elapsed);
+		frame.joint = static_cast<std::uint8_t>(joint_id);
+		frame.flags = 0;
+		frame.angle = static_cast<std::uint16_t>(angle);
+
+		head.store(write_pos + 1, std::memory_order_release);
+
+		// 半分埋まった瞬間だけ、書き出しスレッドを起こす
+		if (write_pos - read_pos + 1 == (mask + 1) / 2)
+		{
+			SetEvent(wake_event);
+		}
+	}
+
+	// バッファに溜まったフレームを書き出す
+	// ========================================================================
+	// NOTE:
+	// リングバッファの終端をまたぐ場合でも、書き込みは最大2回で済みます。
+	bool Recorder::flush()
+	{
+		const std::uint32_t write_pos = head.load(std::memory_order_acquire);
+		std::uint32_t       read_pos  = tail.load(std::memory_order_relaxed);
+
+		while (read_pos != write_pos)
+		{
+			const std::uint32_t index = read_pos & mask;
+			std::uint32_t       count = write_pos - read_pos;
+
+			if (count > mask + 1 - index)
+			{
+				count = mask + 1 - index;
+			}
+
+			if (!writer.append(&buffer[index], count))
+			{
+				return false;
+			}
+
+			read_pos += count;
+			tail.store(read_pos, std::memory_order_release);
+		}
+
+		return true;
+	}
+
+	unsigned long __stdcall Recorder::flushThread(void* param)
+	{
+		Recorder* self = static_cast<Recorder*>(param);
+
+		for (;;)
+		{
+			WaitForSingleObject(self->wake_event, FLUSH_INTERVAL);
+
+			// 終了要求を先に確認してから書き出すことで、取りこぼしを防ぐ
+			bool quit = self->quit.load(std::memory_order_acquire);
+
+			if (!self->flush())
+			{
+				// 書き込みに失敗しても、UIスレッドを止めないようにバッファは捨て続ける
+				self->write_error = true;
+				self->tail.store(self->head.load(std::memory_order_acquire), std::memory_order_release);
+			}
+
+			if (quit)
+			{
+				break;
+			}
+		}
+
+		return 0;
+	}
+}
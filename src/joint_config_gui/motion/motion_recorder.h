@@ -0,0 +1,73 @@
+﻿#ifndef _MOTION_RECORDER_H_
+#define _MOTION_RECORDER_H_
+
+// 標準C++ライブラリ
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// 独自実装ライブラリ
+#include "motion_file.h"
+
+
+namespace Motion
+{
+	// 関節操作の記録
+	// ========================================================================
+	// NOTE:
+	// record()はUIスレッドから、関節の角度が変わるたびに呼び出します。
+	// 記録はあらかじめ確保したリングバッファへの書き込みだけで、ロックも
+	// システムコールも発生しません。(バッファが半分埋まった時のみイベントを通知)
+	// バッファの内容は、バックグラウンドのスレッドがまとめてファイルへ書き出します。
+	//
+	// CAUTION:
+	// record()を呼び出せるのは単一のスレッドだけです。(Single Producer)
+	// バッファが溢れた場合、そのフレームは破棄され、dropped()に計上されます。
+	// Frame::timeの上限(約71分)を超えると、以降のフレームは記録せずexpired()が
+	// trueになります。(時刻が桁あふれして、時刻順に並ばなくなるのを防ぐため)
+	// 呼び出し側はexpired()を確認し、stop()してください。
+	class Recorder
+	{
+	public:
+		Recorder();
+		~Recorder();
+
+		// capacityは2のべき乗に切り上げられます。
+		bool start(const char* path, std::uint32_t capacity = 65536);
+		bool stop();
+
+		void record(int joint_id, int angle);
+
+		bool          recording() const { return active.load(std::memory_order_relaxed); }
+		std::uint32_t recorded()  const { return writer.count(); }
+		std::uint32_t dropped()   const { return drop_count; }
+		bool          expired()   const { return time_over; }
+
+	private:
+		Recorder(const Recorder&);
+		Recorder& operator=(const Recorder&);
+
+		static unsigned long __stdcall flushThread(void* param);
+		bool flush();
+
+		std::vector<Frame>         buffer;
+		std::uint32_t              mask;
+		std::atomic<std::uint32_t> head;   // 書き込み位置 (UIスレッドのみ更新)
+		std::atomic<std::uint32_t> tail;   // 読み出し位置 (書き出しスレッドのみ更新)
+		std::atomic<bool>          active;
+		std::atomic<bool>          quit;
+
+		long long     base_time;    // 先頭フレームのカウンタ値
+		long long     frequency;
+		std::uint32_t drop_count;   // UIスレッドのみ更新
+		bool          time_over;    // UIスレッドのみ更新
+
+		Writer writer;
+		bool   write_error;
+		void*  thread_handle;
+		void*  wake_event;
+	};
+}
+
+
+#endif // _MOTION_RECORDER_H_
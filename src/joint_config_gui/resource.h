@@ -33,5 +33,11 @@
 #define BUTTON_PLEN2_DISCONNECT                 40028
 #define BUTTON_COM_CONNECT                      40029
 #define BUTTON_PLEN2_SCAN                       40030
+#define BUTTON_MOTION_PLAY                      40031
+#define BUTTON_MOTION_STOP                      40032
+#define BUTTON_MOTION_IMPORT                    40033
+#define BUTTON_MOTION_EXPORT                    40034
+#define BUTTON_MOTION_RECORD                    40035
+#define CHECK_LIMIT_REJECT                      40036
 
 #endif // _RESOURCE_H_
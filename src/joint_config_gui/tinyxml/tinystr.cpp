@@ -25,13 +25,43 @@ distribution.
 #ifndef TIXML_USE_STL
 
 #include "tinystr.h"
+#include "tinyxml.h"
 
 // Error value for find primitive
 const TiXmlString::size_type TiXmlString::npos = static_cast< TiXmlString::size_type >(-1);
 
 
-// Null rep.
-TiXmlString::Rep TiXmlString::nullrep_ = { 0, 0, { '\0' } };
+// Null string.
+char TiXmlString::nullchar_ = '\0';
+
+
+char* TiXmlString::allocate(size_type bytes, Storage* storage)
+{
+	TiXmlArena* arena = TiXmlArena::Active();
+	if (arena)
+	{
+		*storage = STORAGE_ARENA;
+		return static_cast<char*>( arena->Allocate(bytes, 1) );
+	}
+	*storage = STORAGE_HEAP;
+	return new char[ bytes ];
+}
+
+
+void TiXmlString::resolve() const
+{
+	// Decode over the char in front, so the terminator lands inside the
+	// original text and never on a char the parser may still need.
+	TiXmlString* self = const_cast<TiXmlString*>(this);
+	char* out = start_ - 1;
+	size_type len = static_cast<size_type>( TiXmlBase::DecodeInSitu(out, start_, size_, flags_) );
+	out[len] = '\0';
+
+	self->start_ = out;
+	self->size_ = len;
+	self->storage_ = STORAGE_BUFFER;
+	self->flags_ = 0;
+}
 
 
 void TiXmlString::reserve (size_type cap)
@@ -51,6 +51,12 @@ distribution.
    Only the member functions relevant to the TinyXML project have been implemented.
    The buffer allocation is made by a simplistic power of 2 like mechanism : if we increase
    a string and there's no more room, we allocate a buffer twice as big as we need.
+   Strings of up to INLINE_CAPACITY chars -- most names, and values like "900" -- are
+   kept in the string itself and allocate nothing.
+   While a TiXmlArena is active on the calling thread (that is, while a document with
+   an arena is parsing) the buffer comes from that arena instead of the heap.
+   A document parsing in situ makes its strings refer to its own buffer instead; see
+   borrow().
 */
 class TiXmlString
 {
@@ -63,31 +69,41 @@ class TiXmlString
 
 
 	// TiXmlString empty constructor
-	TiXmlString () : rep_(&nullrep_)
+	TiXmlString () : start_(&nullchar_), size_(0), capacity_(0), storage_(STORAGE_NULL), flags_(0)
 	{
 	}
 
 	// TiXmlString copy constructor
-	TiXmlString ( const TiXmlString & copy) : rep_(0)
+	TiXmlString ( const TiXmlString & copy) : start_(0)
 	{
 		init(copy.length());
 		memcpy(start(), copy.data(), length());
 	}
 
 	// TiXmlString constructor, based on a string
-	TIXML_EXPLICIT TiXmlString ( const char * copy) : rep_(0)
+	TIXML_EXPLICIT TiXmlString ( const char * copy) : start_(0)
 	{
 		init( static_cast<size_type>( strlen(copy) ));
 		memcpy(start(), copy, length());
 	}
 
 	// TiXmlString constructor, based on a string
-	TIXML_EXPLICIT TiXmlString ( const char * str, size_type len) : rep_(0)
+	TIXML_EXPLICIT TiXmlString ( const char * str, size_type len) : start_(0)
 	{
 		init(len);
 		memcpy(start(), str, len);
 	}
 
+	#ifdef TIXML_RVALUE_REFS
+	// TiXmlString move constructor. Only a buffer of the string's own changes
+	// hands; see own().
+	TiXmlString ( TiXmlString && other) : start_(&nullchar_), size_(0), capacity_(0), storage_(STORAGE_NULL), flags_(0)
+	{
+		swap(other);
+		own();
+	}
+	#endif
+
 	// TiXmlString destructor
 	~TiXmlString ()
 	{
@@ -101,9 +117,18 @@ class TiXmlString
 
 	TiXmlString& operator = (const TiXmlString & copy)
 	{
-		return assign(copy.start(), copy.length());
+		return assign(copy.data(), copy.length());
 	}
 
+	#ifdef TIXML_RVALUE_REFS
+	TiXmlString& operator = (TiXmlString && other)
+	{
+		TiXmlString tmp(static_cast<TiXmlString &&>(other));
+		swap(tmp);
+		return *this;
+	}
+	#endif
+
 
 	// += operator. Maps to append
 	TiXmlString& operator += (const char * suffix)
@@ -125,36 +150,36 @@ class TiXmlString
 
 
 	// Convert a TiXmlString into a null-terminated char *
-	const char * c_str () const { return rep_->str; }
+	const char * c_str () const { touch(); return start_; }
 
 	// Convert a TiXmlString into a char * (need not be null terminated).
-	const char * data () const { return rep_->str; }
+	const char * data () const { touch(); return start_; }
 
 	// Return the length of a TiXmlString
-	size_type length () const { return rep_->size; }
+	size_type length () const { touch(); return size_; }
 
 	// Alias for length()
-	size_type size () const { return rep_->size; }
+	size_type size () const { touch(); return size_; }
 
 	// Checks if a TiXmlString is empty
-	bool empty () const { return rep_->size == 0; }
+	bool empty () const { touch(); return size_ == 0; }
 
 	// Return capacity of string
-	size_type capacity () const { return rep_->capacity; }
+	size_type capacity () const { touch(); return capacity_; }
 
 
 	// single char extraction
 	const char& at (size_type index) const
 	{
 		assert( index < length() );
-		return rep_->str[ index ];
+		return start_[ index ];
 	}
 
 	// [] operator
 	char& operator [] (size_type index) const
 	{
 		assert( index < length() );
-		return rep_->str[ index ];
+		return start_[ index ];
 	}
 
 	// find a char in a string. Return TiXmlString::npos if not found
@@ -196,58 +221,166 @@ class TiXmlString
 
 	void swap (TiXmlString& other)
 	{
-		Rep* r = rep_;
-		rep_ = other.rep_;
-		other.rep_ = r;
+		char* s = start_;
+		start_ = other.start_;
+		other.start_ = s;
+
+		size_type n = size_;
+		size_ = other.size_;
+		other.size_ = n;
+
+		n = capacity_;
+		capacity_ = other.capacity_;
+		other.capacity_ = n;
+
+		Storage st = storage_;
+		storage_ = other.storage_;
+		other.storage_ = st;
+
+		unsigned char f = flags_;
+		flags_ = other.flags_;
+		other.flags_ = f;
+
+		// Inline chars move with the strings, and have to be pointed at again.
+		if (storage_ == STORAGE_INLINE && other.storage_ == STORAGE_INLINE)
+		{
+			char buffer[ INLINE_CAPACITY + 1 ];
+			memcpy(buffer, inline_, other.size_ + 1);
+			memcpy(inline_, other.inline_, size_ + 1);
+			memcpy(other.inline_, buffer, other.size_ + 1);
+			start_ = inline_;
+			other.start_ = other.inline_;
+		}
+		else if (storage_ == STORAGE_INLINE)
+		{
+			memcpy(inline_, other.inline_, size_ + 1);
+			start_ = inline_;
+		}
+		else if (other.storage_ == STORAGE_INLINE)
+		{
+			memcpy(other.inline_, inline_, other.size_ + 1);
+			other.start_ = other.inline_;
+		}
 	}
 
-  private:
+	/*	[internal use] In-situ parsing: refer to 'len' chars of the buffer being
+		parsed instead of owning a copy. The chars are decoded (see
+		TiXmlBase::DecodeInSitu()) and terminated in place the first time the
+		string is read. That moves them down one char, so the char in front of
+		'str' must be one the parser no longer needs. The buffer has to outlive
+		the string, unless the string is assigned to first.
+	*/
+	void borrow (char * str, size_type len, int flags)
+	{
+		quit();
+		start_ = str;
+		size_ = len;
+		capacity_ = 0;
+		storage_ = STORAGE_RAW;
+		flags_ = static_cast<unsigned char>(flags);
+	}
 
-	void init(size_type sz) { init(sz, sz); }
-	void set_size(size_type sz) { rep_->str[ rep_->size = sz ] = '\0'; }
-	char* start() const { return rep_->str; }
-	char* finish() const { return rep_->str + rep_->size; }
+	/*	[internal use] Refer to 'len' chars that are already decoded and
+		terminated, such as those of a cache (see TiXmlDocument::LoadCache()),
+		instead of owning a copy. The chars have to outlive the string, unless
+		the string is assigned to first.
+	*/
+	void refer (const char * str, size_type len)
+	{
+		quit();
+		start_ = const_cast<char*>(str);
+		size_ = len;
+		capacity_ = 0;
+		storage_ = STORAGE_BUFFER;
+		flags_ = 0;
+	}
+
+	// [internal use] True if the string is borrowed and has not been read yet.
+	bool pending () const { return storage_ == STORAGE_RAW; }
+
+	/*	[internal use] Copy chars the string doesn't own -- borrowed ones, or
+		ones in an arena -- to a heap buffer of its own, so the string can
+		outlive the document it came from.
+	*/
+	void own ()
+	{
+		if (storage_ != STORAGE_HEAP && storage_ != STORAGE_INLINE && storage_ != STORAGE_NULL)
+		{
+			TiXmlString tmp(data(), length());
+			swap(tmp);
+		}
+	}
+
+  private:
 
-	struct Rep
+	// Where the characters live. Only heap buffers are released by the string;
+	// arena buffers are released in bulk by the arena they came from, and
+	// borrowed ones belong to the document that parsed them.
+	enum Storage
 	{
-		size_type size, capacity;
-		char str[1];
+		STORAGE_NULL,
+		STORAGE_INLINE,		// in inline_
+		STORAGE_HEAP,
+		STORAGE_ARENA,
+		STORAGE_BUFFER,		// borrowed, decoded and terminated
+		STORAGE_RAW			// borrowed, not decoded yet
 	};
 
+	void touch() const { if (storage_ == STORAGE_RAW) resolve(); }
+	void resolve() const;
+
+	void init(size_type sz) { init(sz, sz); }
+	// The shared null char is never written, so empty strings on different threads don't race.
+	void set_size(size_type sz) { size_ = sz; if (start_ != &nullchar_) start_[sz] = '\0'; }
+	char* start() const { return start_; }
+	char* finish() const { return start_ + size_; }
+
 	void init(size_type sz, size_type cap)
 	{
-		if (cap)
+		if (cap && cap <= INLINE_CAPACITY)
+		{
+			start_ = inline_;
+			capacity_ = INLINE_CAPACITY;
+			storage_ = STORAGE_INLINE;
+			set_size(sz);
+		}
+		else if (cap)
 		{
-			// Lee: the original form:
-			//	rep_ = static_cast<Rep*>(operator new(sizeof(Rep) + cap));
-			// doesn't work in some cases of new being overloaded. Switching
-			// to the normal allocation, although use an 'int' for systems
-			// that are overly picky about structure alignment.
-			const size_type bytesNeeded = sizeof(Rep) + cap;
-			const size_type intsNeeded = ( bytesNeeded + sizeof(int) - 1 ) / sizeof( int ); 
-			rep_ = reinterpret_cast<Rep*>( new int[ intsNeeded ] );
-
-			rep_->str[ rep_->size = sz ] = '\0';
-			rep_->capacity = cap;
+			start_ = allocate(cap + 1, &storage_);
+			capacity_ = cap;
+			set_size(sz);
 		}
 		else
 		{
-			rep_ = &nullrep_;
+			start_ = &nullchar_;
+			size_ = capacity_ = 0;
+			storage_ = STORAGE_NULL;
 		}
+		flags_ = 0;
 	}
 
 	void quit()
 	{
-		if (rep_ != &nullrep_)
+		if (storage_ == STORAGE_HEAP)
 		{
-			// The rep_ is really an array of ints. (see the allocator, above).
-			// Cast it back before delete, so the compiler won't incorrectly call destructors.
-			delete [] ( reinterpret_cast<int*>( rep_ ) );
+			delete [] start_;
 		}
 	}
 
-	Rep * rep_;
-	static Rep nullrep_;
+	// Allocates a buffer of 'bytes' chars from the active arena, or the heap.
+	static char* allocate(size_type bytes, Storage* storage);
+
+	// 18 chars and the terminator fill the object out to 48 bytes on 64 bit
+	// targets, where the members before them take 29.
+	enum { INLINE_CAPACITY = 18 };
+
+	char *    start_;
+	size_type size_;
+	size_type capacity_;
+	Storage   storage_;
+	unsigned char flags_;	// how a raw borrowed string has to be decoded
+	char      inline_[ INLINE_CAPACITY + 1 ];
+	static char nullchar_;
 
 } ;
 
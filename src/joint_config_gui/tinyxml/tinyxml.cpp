@@ -23,6 +23,8 @@ distribution.
 */
 
 #include <ctype.h>
+#include <locale.h>
+#include <math.h>
 
 #ifdef TIXML_USE_STL
 #include <sstream>
@@ -31,10 +33,53 @@ distribution.
 
 #include "tinyxml.h"
 
+#ifdef TIXML_THREADS
+#include <atomic>
+#include <thread>
+#endif
+
+#if defined(_WIN32)
+	#ifndef WIN32_LEAN_AND_MEAN
+	#define WIN32_LEAN_AND_MEAN
+	#endif
+	#ifndef NOMINMAX
+	#define NOMINMAX
+	#endif
+	#include <windows.h>
+	#include <io.h>
+#else
+	#include <dirent.h>
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <time.h>
+	#include <unistd.h>
+#endif
+
+// Thread local storage for the active arena, so that documents parsing on
+// different threads each allocate from their own arena.
+#if defined(_MSC_VER)
+	#define TIXML_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__)
+	#define TIXML_THREAD_LOCAL __thread
+#else
+	#define TIXML_THREAD_LOCAL
+#endif
+
 FILE* TiXmlFOpen( const char* filename, const char* mode );
 
 bool TiXmlBase::condenseWhiteSpace = true;
 
+static TIXML_THREAD_LOCAL TiXmlArena* activeArena = 0;
+
+// Placed in front of every TiXmlBase allocation. The union keeps the object
+// that follows suitably aligned.
+union TiXmlAllocHeader
+{
+	TiXmlArena*	arena;		// null for heap allocations
+	double		alignment;
+};
+
 // Microsoft compiler security
 FILE* TiXmlFOpen( const char* filename, const char* mode )
 {
@@ -49,1838 +94,5765 @@ FILE* TiXmlFOpen( const char* filename, const char* mode )
 	#endif
 }
 
-void TiXmlBase::EncodeString( const TIXML_STRING& str, TIXML_STRING* outString )
+
+TiXmlFileMap::TiXmlFileMap()
 {
-	int i=0;
+	data = 0;
+	size = 0;
+}
 
-	while( i<(int)str.length() )
-	{
-		unsigned char c = (unsigned char) str[i];
 
-		if (    c == '&' 
-		     && i < ( (int)str.length() - 2 )
-			 && str[i+1] == '#'
-			 && str[i+2] == 'x' )
+TiXmlFileMap::~TiXmlFileMap()
+{
+	Close();
+}
+
+
+bool TiXmlFileMap::Open( const char* filename, bool writable )
+{
+	Close();
+
+	#if defined(_WIN32)
+		HANDLE file = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0 );
+		if ( file == INVALID_HANDLE_VALUE )
+			return false;
+
+		LARGE_INTEGER length;
+		SYSTEM_INFO info;
+		GetSystemInfo( &info );
+		if (    GetFileSizeEx( file, &length )
+			 && length.QuadPart > 0
+			 && ( sizeof( size_t ) >= 8 || length.HighPart == 0 )
+			 && length.QuadPart % info.dwPageSize != 0 )		// room for the null character
 		{
-			// Hexadecimal character reference.
-			// Pass through unchanged.
-			// &#xA9;	-- copyright symbol, for example.
-			//
-			// The -1 is a bug fix from Rob Laveaux. It keeps
-			// an overflow from happening if there is no ';'.
-			// There are actually 2 ways to exit this loop -
-			// while fails (error case) and break (semicolon found).
-			// However, there is no mechanism (currently) for
-			// this function to return an error.
-			while ( i<(int)str.length()-1 )
+			HANDLE mapping = CreateFileMappingA( file, 0, writable ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, 0 );
+			if ( mapping )
 			{
-				outString->append( str.c_str() + i, 1 );
-				++i;
-				if ( str[i] == ';' )
-					break;
+				data = static_cast< char* >( MapViewOfFile( mapping, writable ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0 ) );
+				CloseHandle( mapping );
 			}
+			if ( data )
+				size = static_cast< size_t >( length.QuadPart );
 		}
-		else if ( c == '&' )
-		{
-			outString->append( entity[0].str, entity[0].strLength );
-			++i;
-		}
-		else if ( c == '<' )
-		{
-			outString->append( entity[1].str, entity[1].strLength );
-			++i;
-		}
-		else if ( c == '>' )
-		{
-			outString->append( entity[2].str, entity[2].strLength );
-			++i;
-		}
-		else if ( c == '\"' )
-		{
-			outString->append( entity[3].str, entity[3].strLength );
-			++i;
-		}
-		else if ( c == '\'' )
-		{
-			outString->append( entity[4].str, entity[4].strLength );
-			++i;
-		}
-		else if ( c < 32 )
-		{
-			// Easy pass at non-alpha/numeric/symbol
-			// Below 32 is symbolic.
-			char buf[ 32 ];
-			
-			#if defined(TIXML_SNPRINTF)		
-				TIXML_SNPRINTF( buf, sizeof(buf), "&#x%02X;", (unsigned) ( c & 0xff ) );
-			#else
-				sprintf( buf, "&#x%02X;", (unsigned) ( c & 0xff ) );
-			#endif		
-
-			//*ME:	warning C4267: convert 'size_t' to 'int'
-			//*ME:	Int-Cast to make compiler happy ...
-			outString->append( buf, (int)strlen( buf ) );
-			++i;
-		}
-		else
+		CloseHandle( file );
+	#else
+		int file = open( filename, O_RDONLY );
+		if ( file < 0 )
+			return false;
+
+		struct stat status;
+		long page = sysconf( _SC_PAGESIZE );
+		if (    fstat( file, &status ) == 0
+			 && S_ISREG( status.st_mode )
+			 && status.st_size > 0
+			 && page > 0
+			 && status.st_size % page != 0 )					// room for the null character
 		{
-			//char realc = (char) c;
-			//outString->append( &realc, 1 );
-			*outString += (char) c;	// somewhat more efficient function call.
-			++i;
+			void* p = mmap( 0, status.st_size, PROT_READ | ( writable ? PROT_WRITE : 0 ), MAP_PRIVATE, file, 0 );
+			if ( p != MAP_FAILED )
+			{
+				madvise( p, status.st_size, MADV_SEQUENTIAL );
+				data = static_cast< char* >( p );
+				size = static_cast< size_t >( status.st_size );
+			}
 		}
-	}
+		close( file );
+	#endif
+
+	return data != 0;
 }
 
 
-TiXmlNode::TiXmlNode( NodeType _type ) : TiXmlBase()
+void TiXmlFileMap::Close()
 {
-	parent = 0;
-	type = _type;
-	firstChild = 0;
-	lastChild = 0;
-	prev = 0;
-	next = 0;
+	if ( !data )
+		return;
+
+	#if defined(_WIN32)
+		UnmapViewOfFile( data );
+	#else
+		munmap( data, size );
+	#endif
+	data = 0;
+	size = 0;
 }
 
 
-TiXmlNode::~TiXmlNode()
+TiXmlArena::TiXmlArena( size_t _blockSize )
 {
-	TiXmlNode* node = firstChild;
-	TiXmlNode* temp = 0;
-
-	while ( node )
-	{
-		temp = node;
-		node = node->next;
-		delete temp;
-	}	
+	blocks = 0;
+	current = 0;
+	cursor = 0;
+	limit = 0;
+	blockSize = _blockSize;
+	used = 0;
+	reserved = 0;
 }
 
 
-void TiXmlNode::CopyTo( TiXmlNode* target ) const
+TiXmlArena::~TiXmlArena()
 {
-	target->SetValue (value.c_str() );
-	target->userData = userData; 
-	target->location = location;
+	while ( blocks )
+	{
+		Block* block = blocks;
+		blocks = blocks->next;
+		::operator delete( block );
+	}
 }
 
 
-void TiXmlNode::Clear()
+void* TiXmlArena::Allocate( size_t size, size_t alignment )
 {
-	TiXmlNode* node = firstChild;
-	TiXmlNode* temp = 0;
+	assert( alignment && ( alignment & ( alignment - 1 ) ) == 0 );
 
-	while ( node )
+	char* p = reinterpret_cast< char* >( ( reinterpret_cast< size_t >( cursor ) + alignment - 1 ) & ~( alignment - 1 ) );
+	if ( !cursor || p + size > limit )
 	{
-		temp = node;
-		node = node->next;
-		delete temp;
-	}	
+		size_t needed = size + alignment;
+		Block* block = static_cast< Block* >( ::operator new( sizeof( Block ) + ( needed > blockSize ? needed : blockSize ) ) );
+		block->size = needed > blockSize ? needed : blockSize;
+		reserved += block->size;
 
-	firstChild = 0;
-	lastChild = 0;
+		if ( needed > blockSize / 4 && current )
+		{
+			// Big requests get a block of their own, behind the current one, so
+			// the space left in the current block isn't wasted.
+			block->next = current->next;
+			current->next = block;
+			used += size;
+			return reinterpret_cast< char* >( ( reinterpret_cast< size_t >( Data( block ) ) + alignment - 1 ) & ~( alignment - 1 ) );
+		}
+
+		block->next = blocks;
+		blocks = block;
+		current = block;
+		cursor = Data( block );
+		limit = cursor + block->size;
+		p = reinterpret_cast< char* >( ( reinterpret_cast< size_t >( cursor ) + alignment - 1 ) & ~( alignment - 1 ) );
+	}
+	cursor = p + size;
+	used += size;
+	return p;
 }
 
 
-TiXmlNode* TiXmlNode::LinkEndChild( TiXmlNode* node )
+void TiXmlArena::Reset()
 {
-	assert( node->parent == 0 || node->parent == this );
-	assert( node->GetDocument() == 0 || node->GetDocument() == this->GetDocument() );
-
-	if ( node->Type() == TiXmlNode::TINYXML_DOCUMENT )
+	Block* keep = current;
+	while ( blocks )
 	{
-		delete node;
-		if ( GetDocument() ) 
-			GetDocument()->SetError( TIXML_ERROR_DOCUMENT_TOP_ONLY, 0, 0, TIXML_ENCODING_UNKNOWN );
-		return 0;
+		Block* block = blocks;
+		blocks = blocks->next;
+		if ( block != keep )
+		{
+			reserved -= block->size;
+			::operator delete( block );
+		}
+	}
+	if ( keep )
+	{
+		keep->next = 0;
+		blocks = keep;
+		cursor = Data( keep );
+		limit = cursor + keep->size;
 	}
+	used = 0;
+}
 
-	node->parent = this;
 
-	node->prev = lastChild;
-	node->next = 0;
+TiXmlArena* TiXmlArena::Active()
+{
+	return activeArena;
+}
 
-	if ( lastChild )
-		lastChild->next = node;
-	else
-		firstChild = node;			// it was an empty list.
 
-	lastChild = node;
-	return node;
+TiXmlArena::Scope::Scope( TiXmlArena* arena )
+{
+	previous = activeArena;
+	activeArena = arena;
 }
 
 
-TiXmlNode* TiXmlNode::InsertEndChild( const TiXmlNode& addThis )
+TiXmlArena::Scope::~Scope()
 {
-	if ( addThis.Type() == TiXmlNode::TINYXML_DOCUMENT )
-	{
-		if ( GetDocument() ) 
-			GetDocument()->SetError( TIXML_ERROR_DOCUMENT_TOP_ONLY, 0, 0, TIXML_ENCODING_UNKNOWN );
-		return 0;
-	}
-	TiXmlNode* node = addThis.Clone();
-	if ( !node )
-		return 0;
+	activeArena = previous;
+}
 
-	return LinkEndChild( node );
+
+TiXmlNameTable::TiXmlNameTable()
+{
+	slots = 0;
+	slotCount = 0;
+	count = 0;
+	blocks = 0;
+	cursor = 0;
+	limit = 0;
 }
 
 
-TiXmlNode* TiXmlNode::InsertBeforeChild( TiXmlNode* beforeThis, const TiXmlNode& addThis )
-{	
-	if ( !beforeThis || beforeThis->parent != this ) {
-		return 0;
-	}
-	if ( addThis.Type() == TiXmlNode::TINYXML_DOCUMENT )
+TiXmlNameTable::~TiXmlNameTable()
+{
+	delete [] slots;
+	while ( blocks )
 	{
-		if ( GetDocument() ) 
-			GetDocument()->SetError( TIXML_ERROR_DOCUMENT_TOP_ONLY, 0, 0, TIXML_ENCODING_UNKNOWN );
-		return 0;
+		Block* block = blocks;
+		blocks = blocks->next;
+		::operator delete( block );
 	}
+}
 
-	TiXmlNode* node = addThis.Clone();
-	if ( !node )
-		return 0;
-	node->parent = this;
 
-	node->next = beforeThis;
-	node->prev = beforeThis->prev;
-	if ( beforeThis->prev )
-	{
-		beforeThis->prev->next = node;
-	}
-	else
+TiXmlAtom TiXmlNameTable::Intern( const char* name, size_t length )
+{
+	if ( 2 * ( count + 1 ) > slotCount )
+		Rehash( slotCount ? 2 * slotCount : 64 );
+
+	const size_t hash = Hash( name, length );
+	size_t i = hash & ( slotCount - 1 );
+	for ( ; slots[i].name; i = ( i + 1 ) & ( slotCount - 1 ) )
 	{
-		assert( firstChild == beforeThis );
-		firstChild = node;
+		if (    slots[i].hash == hash
+			 && slots[i].length == length
+			 && memcmp( slots[i].name, name, length ) == 0 )
+			return TiXmlAtom( slots[i].name );
 	}
-	beforeThis->prev = node;
-	return node;
+
+	slots[i].name = Store( name, length );
+	slots[i].length = length;
+	slots[i].hash = hash;
+	++count;
+	return TiXmlAtom( slots[i].name );
 }
 
 
-TiXmlNode* TiXmlNode::InsertAfterChild( TiXmlNode* afterThis, const TiXmlNode& addThis )
+TiXmlAtom TiXmlNameTable::Find( const char* name, size_t length ) const
 {
-	if ( !afterThis || afterThis->parent != this ) {
-		return 0;
-	}
-	if ( addThis.Type() == TiXmlNode::TINYXML_DOCUMENT )
+	if ( !slotCount )
+		return TiXmlAtom();
+
+	const size_t hash = Hash( name, length );
+	for ( size_t i = hash & ( slotCount - 1 ); slots[i].name; i = ( i + 1 ) & ( slotCount - 1 ) )
 	{
-		if ( GetDocument() ) 
-			GetDocument()->SetError( TIXML_ERROR_DOCUMENT_TOP_ONLY, 0, 0, TIXML_ENCODING_UNKNOWN );
-		return 0;
+		if (    slots[i].hash == hash
+			 && slots[i].length == length
+			 && memcmp( slots[i].name, name, length ) == 0 )
+			return TiXmlAtom( slots[i].name );
 	}
+	return TiXmlAtom();
+}
 
-	TiXmlNode* node = addThis.Clone();
-	if ( !node )
-		return 0;
-	node->parent = this;
 
-	node->prev = afterThis;
-	node->next = afterThis->next;
-	if ( afterThis->next )
+size_t TiXmlNameTable::Hash( const char* name, size_t length )
+{
+	// FNV-1a
+	size_t hash = 2166136261u;
+	for ( const unsigned char* p = reinterpret_cast< const unsigned char* >( name ); length; ++p, --length )
+		hash = ( hash ^ *p ) * 16777619u;
+	return hash;
+}
+
+
+void TiXmlNameTable::Rehash( size_t size )
+{
+	Slot* old = slots;
+	size_t oldCount = slotCount;
+
+	slots = new Slot[ size ];
+	memset( slots, 0, size * sizeof( Slot ) );
+	slotCount = size;
+	for ( size_t j = 0; j < oldCount; ++j )
 	{
-		afterThis->next->prev = node;
+		if ( !old[j].name )
+			continue;
+		size_t i = old[j].hash & ( slotCount - 1 );
+		while ( slots[i].name )
+			i = ( i + 1 ) & ( slotCount - 1 );
+		slots[i] = old[j];
 	}
-	else
+	delete [] old;
+}
+
+
+const char* TiXmlNameTable::Store( const char* name, size_t length )
+{
+	if ( length + 1 > (size_t)( limit - cursor ) )
 	{
-		assert( lastChild == afterThis );
-		lastChild = node;
+		size_t size = length + 1 > BLOCK_SIZE ? length + 1 : (size_t) BLOCK_SIZE;
+		Block* block = static_cast< Block* >( ::operator new( sizeof( Block ) + size ) );
+		block->next = blocks;
+		blocks = block;
+		cursor = reinterpret_cast< char* >( block + 1 );
+		limit = cursor + size;
 	}
-	afterThis->next = node;
-	return node;
+
+	char* stored = cursor;
+	memcpy( stored, name, length );
+	stored[ length ] = 0;
+	cursor += length + 1;
+	return stored;
 }
 
 
-TiXmlNode* TiXmlNode::ReplaceChild( TiXmlNode* replaceThis, const TiXmlNode& withThis )
+void* TiXmlBase::operator new( size_t size )
 {
-	if ( !replaceThis )
-		return 0;
+	TiXmlArena* arena = activeArena;
+	TiXmlAllocHeader* header = static_cast< TiXmlAllocHeader* >( arena ? arena->Allocate( sizeof( TiXmlAllocHeader ) + size )
+																	   : ::operator new( sizeof( TiXmlAllocHeader ) + size ) );
+	header->arena = arena;
+	return header + 1;
+}
 
-	if ( replaceThis->parent != this )
-		return 0;
 
-	if ( withThis.ToDocument() ) {
-		// A document can never be a child.	Thanks to Noam.
-		TiXmlDocument* document = GetDocument();
-		if ( document ) 
-			document->SetError( TIXML_ERROR_DOCUMENT_TOP_ONLY, 0, 0, TIXML_ENCODING_UNKNOWN );
-		return 0;
-	}
+void TiXmlBase::operator delete( void* p )
+{
+	if ( !p )
+		return;
 
-	TiXmlNode* node = withThis.Clone();
-	if ( !node )
-		return 0;
+	// Arena memory is released in bulk, by the arena.
+	TiXmlAllocHeader* header = static_cast< TiXmlAllocHeader* >( p ) - 1;
+	if ( !header->arena )
+		::operator delete( header );
+}
 
-	node->next = replaceThis->next;
-	node->prev = replaceThis->prev;
 
-	if ( replaceThis->next )
-		replaceThis->next->prev = node;
-	else
-		lastChild = node;
+// Whether 'object', made with new, lives in an arena.
+static bool InArena( const TiXmlBase* object )
+{
+	return ( reinterpret_cast< const TiXmlAllocHeader* >( object ) - 1 )->arena != 0;
+}
 
-	if ( replaceThis->prev )
-		replaceThis->prev->next = node;
-	else
-		firstChild = node;
 
-	delete replaceThis;
-	node->parent = this;
-	return node;
+// Hands the chars of 'from' to 'to', leaving 'from' empty.
+static void MoveString( TIXML_STRING& from, TIXML_STRING& to )
+{
+	TIXML_STRING moved;
+	moved.swap( from );
+	to.swap( moved );
 }
 
 
-bool TiXmlNode::RemoveChild( TiXmlNode* removeThis )
+// Copies chars 'str' doesn't own to a buffer of its own. Only a TiXmlString
+// can borrow them.
+static void OwnString( TIXML_STRING& str )
 {
-	if ( !removeThis ) {
-		return false;
-	}
+#ifndef TIXML_USE_STL
+	str.own();
+#else
+	(void)str;
+#endif
+}
 
-	if ( removeThis->parent != this )
-	{	
-		assert( 0 );
-		return false;
-	}
 
-	if ( removeThis->next )
-		removeThis->next->prev = removeThis->prev;
-	else
-		lastChild = removeThis->prev;
+int TiXmlBase::Row() const
+{
+	ResolveLocation();
+	return location.row + 1;
+}
 
-	if ( removeThis->prev )
-		removeThis->prev->next = removeThis->next;
-	else
-		firstChild = removeThis->next;
 
-	delete removeThis;
-	return true;
+int TiXmlBase::Column() const
+{
+	ResolveLocation();
+	return location.col + 1;
 }
 
-const TiXmlNode* TiXmlNode::FirstChild( const char * _value ) const
+
+void TiXmlBase::ResolveLocation() const
 {
-	const TiXmlNode* node;
-	for ( node = firstChild; node; node = node->next )
-	{
-		if ( strcmp( node->Value(), _value ) == 0 )
-			return node;
-	}
-	return 0;
+	if ( !location.Pending() )
+		return;
+
+	const TiXmlDocument* document = LocationDocument();
+	if ( document )
+		document->ResolveLocation( &location );
+	else
+		location.Clear();
 }
 
 
-const TiXmlNode* TiXmlNode::LastChild( const char * _value ) const
+void TiXmlBase::EncodeString( const TIXML_STRING& str, TIXML_STRING* outString )
 {
-	const TiXmlNode* node;
-	for ( node = lastChild; node; node = node->prev )
-	{
-		if ( strcmp( node->Value(), _value ) == 0 )
-			return node;
-	}
-	return 0;
+	TiXmlWriter out( outString );
+	out.WriteEncoded( str );
 }
 
 
-const TiXmlNode* TiXmlNode::IterateChildren( const TiXmlNode* previous ) const
+int TiXmlBase::WriteInt( int value, char* buf )
 {
-	if ( !previous )
+	// Worked out from the end of 'digits', then copied out in order.
+	char digits[ 10 ];
+	char* q = digits + sizeof( digits );
+	unsigned n = value < 0 ? 0u - (unsigned)value : (unsigned)value;
+	do
 	{
-		return FirstChild();
+		*--q = (char)( '0' + n % 10 );
+		n /= 10;
 	}
-	else
+	while ( n );
+
+	int length = 0;
+	if ( value < 0 )
+		buf[ length++ ] = '-';
+	while ( q < digits + sizeof( digits ) )
+		buf[ length++ ] = *q++;
+	buf[ length ] = 0;
+	return length;
+}
+
+
+// Writes what WriteDouble() can't be sure of rounding as "%g" does with
+// snprintf(), and puts back the '.' the locale may have changed.
+static int WriteDoubleSlowly( double value, char* buf )
+{
+	#if defined(TIXML_SNPRINTF)
+		int length = TIXML_SNPRINTF( buf, TiXmlBase::NUMBER_BUFFER_SIZE, "%g", value );
+	#else
+		int length = sprintf( buf, "%g", value );
+	#endif
+
+	const char point = localeconv()->decimal_point[0];
+	if ( point != '.' )
 	{
-		assert( previous->parent == this );
-		return previous->NextSibling();
+		for ( int i = 0; i < length; ++i )
+		{
+			if ( buf[i] == point )
+				buf[i] = '.';
+		}
 	}
+	return length;
 }
 
-
-const TiXmlNode* TiXmlNode::IterateChildren( const char * val, const TiXmlNode* previous ) const
+int TiXmlBase::WriteDouble( double value, char* buf )
 {
-	if ( !previous )
+	// Powers of ten a double holds exactly.
+	static const double powers[] =
 	{
-		return FirstChild( val );
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	if ( value == 0 )
+	{
+		// "%g" keeps the sign of -0.
+		int length = 0;
+		if ( 1 / value < 0 )
+			buf[ length++ ] = '-';
+		buf[ length++ ] = '0';
+		buf[ length ] = 0;
+		return length;
+	}
+	if ( value != value || value - value != 0 )
+		return WriteDoubleSlowly( value, buf );		// nan and inf
+
+	// "%g" gives 6 significant digits. Scale them in front of the point, so
+	// 'scaled' is in [1e5, 1e6) and 'exponent' is the power of ten of the first.
+	const double magnitude = fabs( value );
+	int binaryExponent = 0;
+	frexp( magnitude, &binaryExponent );
+	int exponent = (int)floor( ( binaryExponent - 1 ) * 0.30102999566398120 );
+
+	double scaled = 0;
+	for ( int tries = 0; ; ++tries )
+	{
+		const int shift = 5 - exponent;
+		if ( tries == 3 || shift < -22 || shift > 22 )
+			return WriteDoubleSlowly( value, buf );
+		scaled = shift < 0 ? magnitude / powers[ -shift ] : magnitude * powers[ shift ];
+		if ( scaled < 1e5 )
+			--exponent;
+		else if ( scaled >= 1e6 )
+			++exponent;
+		else
+			break;
+	}
+
+	// 'scaled' came from one rounding, so it is within 1e-10 of the exact value.
+	// Leave what is too near a half to call to snprintf().
+	const double whole = floor( scaled );
+	const double fraction = scaled - whole;
+	if ( fabs( fraction - 0.5 ) < 1e-9 )
+		return WriteDoubleSlowly( value, buf );
+
+	unsigned n = (unsigned)whole + ( fraction > 0.5 ? 1 : 0 );
+	if ( n == 1000000 )
+	{
+		n = 100000;
+		++exponent;
+	}
+
+	char digits[ 6 ];
+	for ( int i = 5; i >= 0; --i )
+	{
+		digits[i] = (char)( '0' + n % 10 );
+		n /= 10;
+	}
+	int count = 6;
+	while ( digits[ count - 1 ] == '0' )
+		--count;
+
+	int length = 0;
+	if ( value < 0 )
+		buf[ length++ ] = '-';
+
+	if ( exponent < -4 || exponent >= 6 )
+	{
+		buf[ length++ ] = digits[0];
+		if ( count > 1 )
+		{
+			buf[ length++ ] = '.';
+			for ( int i = 1; i < count; ++i )
+				buf[ length++ ] = digits[i];
+		}
+		buf[ length++ ] = 'e';
+		buf[ length++ ] = exponent < 0 ? '-' : '+';
+		const int e = exponent < 0 ? -exponent : exponent;
+		if ( e >= 100 )
+			buf[ length++ ] = (char)( '0' + e / 100 );
+		buf[ length++ ] = (char)( '0' + e / 10 % 10 );
+		buf[ length++ ] = (char)( '0' + e % 10 );
+	}
+	else if ( exponent >= 0 )
+	{
+		for ( int i = 0; i <= exponent; ++i )
+			buf[ length++ ] = digits[i];
+		if ( count > exponent + 1 )
+		{
+			buf[ length++ ] = '.';
+			for ( int i = exponent + 1; i < count; ++i )
+				buf[ length++ ] = digits[i];
+		}
 	}
 	else
 	{
-		assert( previous->parent == this );
-		return previous->NextSibling( val );
+		buf[ length++ ] = '0';
+		buf[ length++ ] = '.';
+		for ( int i = -1; i > exponent; --i )
+			buf[ length++ ] = '0';
+		for ( int i = 0; i < count; ++i )
+			buf[ length++ ] = digits[i];
 	}
+	buf[ length ] = 0;
+	return length;
 }
 
 
-const TiXmlNode* TiXmlNode::NextSibling( const char * _value ) const 
+void TiXmlBase::Print( FILE* cfile, int depth ) const
 {
-	const TiXmlNode* node;
-	for ( node = next; node; node = node->next )
-	{
-		if ( strcmp( node->Value(), _value ) == 0 )
-			return node;
-	}
-	return 0;
+	assert( cfile );
+	TiXmlWriter out( cfile );
+	Write( &out, depth );
 }
 
 
-const TiXmlNode* TiXmlNode::PreviousSibling( const char * _value ) const
+// The bytes EncodeString() doesn't copy as they are: the controls, and the
+// characters with an entity.
+static const unsigned char writerEscapes[ 256 ] =
 {
-	const TiXmlNode* node;
-	for ( node = prev; node; node = node->prev )
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	0, 0, 1, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0,		// " & '
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0		// < >
+};
+
+
+void TiXmlWriter::Write( const char* text, size_t length )
+{
+	if ( str )
 	{
-		if ( strcmp( node->Value(), _value ) == 0 )
-			return node;
+		str->append( text, length );
+		return;
 	}
-	return 0;
+	if ( length > BUFFER_SIZE - used )
+	{
+		Flush();
+		if ( length >= BUFFER_SIZE )
+		{
+			fwrite( text, 1, length, file );
+			flushed += length;
+			return;
+		}
+	}
+	memcpy( buffer + used, text, length );
+	used += length;
 }
 
 
-void TiXmlElement::RemoveAttribute( const char * name )
+void TiXmlWriter::Indent( int depth )
 {
-    #ifdef TIXML_USE_STL
-	TIXML_STRING str( name );
-	TiXmlAttribute* node = attributeSet.Find( str );
-	#else
-	TiXmlAttribute* node = attributeSet.Find( name );
-	#endif
-	if ( node )
-	{
-		attributeSet.Remove( node );
-		delete node;
-	}
+	for ( int i=0; i<depth; i++ )
+		Write( "    ", 4 );
 }
 
-const TiXmlElement* TiXmlNode::FirstChildElement() const
+
+void TiXmlWriter::WriteEncoded( const TIXML_STRING& value )
 {
-	const TiXmlNode* node;
+	const char* p = value.c_str();
+	const char* end = p + value.length();
 
-	for (	node = FirstChild();
-			node;
-			node = node->NextSibling() )
+	while ( p < end )
 	{
-		if ( node->ToElement() )
-			return node->ToElement();
+		const char* run = p;
+		while ( run < end && !writerEscapes[ (unsigned char)*run ] )
+			++run;
+		if ( run != p )
+		{
+			Write( p, run - p );
+			p = run;
+			if ( p == end )
+				break;
+		}
+
+		unsigned char c = (unsigned char) *p;
+
+		if (    c == '&' 
+		     && end - p > 2
+			 && p[1] == '#'
+			 && p[2] == 'x' )
+		{
+			// Hexadecimal character reference.
+			// Pass through unchanged, up to the ';'.
+			// &#xA9;	-- copyright symbol, for example.
+			//
+			// Stopping a char short of the end keeps the reference from
+			// running over if there is no ';'.
+			const char* reference = p;
+			while ( end - p > 1 )
+			{
+				++p;
+				if ( *p == ';' )
+					break;
+			}
+			Write( reference, p - reference );
+		}
+		else if ( c < 32 )
+		{
+			// Easy pass at non-alpha/numeric/symbol
+			// Below 32 is symbolic.
+			static const char hex[] = "0123456789ABCDEF";
+			char buf[ 6 ] = { '&', '#', 'x', hex[ c >> 4 ], hex[ c & 15 ], ';' };
+			Write( buf, 6 );
+			++p;
+		}
+		else
+		{
+			int i = ( c == '&' ) ? 0 : ( c == '<' ) ? 1 : ( c == '>' ) ? 2 : ( c == '\"' ) ? 3 : 4;
+			Write( TiXmlBase::entity[i].str, TiXmlBase::entity[i].strLength );
+			++p;
+		}
 	}
-	return 0;
 }
 
 
-const TiXmlElement* TiXmlNode::FirstChildElement( const char * _value ) const
+void TiXmlWriter::Flush()
 {
-	const TiXmlNode* node;
+	if ( file && used )
+		fwrite( buffer, 1, used, file );
+	flushed += used;
+	used = 0;
+}
 
-	for (	node = FirstChild( _value );
-			node;
-			node = node->NextSibling( _value ) )
-	{
-		if ( node->ToElement() )
-			return node->ToElement();
-	}
-	return 0;
+
+void TiXmlWriter::Mark( const TiXmlNode* node, int begin )
+{
+	node->SetSourceRange( begin, Offset() );
 }
 
 
-const TiXmlElement* TiXmlNode::NextSiblingElement() const
+/*	The children of an element, indexed by value. The children are numbered in
+	order; 'names' maps each distinct value to the first and last child that
+	have it, and 'positions' maps each child to its number. Each child's entry
+	chains to the next child with the same value, so stepping through the
+	children of one name costs no walk at all.
+
+	Only TiXmlElement::BuildChildIndex() makes one. Appending a child extends
+	it; any other change to the children deletes it.
+*/
+class TiXmlChildIndex
 {
-	const TiXmlNode* node;
+public:
+	TiXmlChildIndex( const TiXmlNode* parent );
+	~TiXmlChildIndex();
 
-	for (	node = NextSibling();
-			node;
-			node = node->NextSibling() )
+	// The first child with the value 'name', or null.
+	const TiXmlNode* First( const char* name ) const;
+	// The first child after 'node', one of the children, with the value 'name', or null.
+	const TiXmlNode* Next( const TiXmlNode* node, const char* name ) const;
+
+	// 'node' was linked in at the end.
+	void Appended( const TiXmlNode* node );
+
+private:
+	TiXmlChildIndex( const TiXmlChildIndex& );	// not implemented.
+	void operator=( const TiXmlChildIndex& );	// not allowed.
+
+	enum { NONE = ~(size_t)0 };
+
+	struct Child
 	{
-		if ( node->ToElement() )
-			return node->ToElement();
+		const TiXmlNode*	node;
+		size_t				next;	// the number of the next child with the same value, or NONE
+	};
+
+	struct Name
+	{
+		size_t	hash;
+		size_t	first;		// NONE for an empty slot
+		size_t	last;
+	};
+
+	static size_t Hash( const char* name );
+	// The slot of 'name', or the empty slot that ends its probe.
+	Name* NameSlot( const char* name, size_t hash ) const;
+	// The number of 'node', which has to be one of the children.
+	size_t Position( const TiXmlNode* node ) const;
+
+	// Put child 'n' in the tables.
+	void Add( size_t n );
+	// Make the tables 'size' slots and add every child again.
+	void Rehash( size_t size );
+
+	size_t	count;
+	Child*	children;
+	size_t	capacity;
+	Name*	names;
+	size_t*	positions;	// child numbers, hashed by address; NONE for an empty slot
+	size_t	tableMask;	// of both tables, a power of two less one
+};
+
+
+TiXmlChildIndex::TiXmlChildIndex( const TiXmlNode* parent )
+{
+	count = 0;
+	for ( const TiXmlNode* node = parent->FirstChild(); node; node = node->NextSibling() )
+		++count;
+
+	capacity = count > 16 ? count : 16;
+	children = new Child[ capacity ];
+
+	size_t n = 0;
+	for ( const TiXmlNode* node = parent->FirstChild(); node; node = node->NextSibling(), ++n )
+	{
+		children[n].node = node;
+		children[n].next = NONE;
 	}
-	return 0;
+
+	names = 0;
+	positions = 0;
+	size_t size = 32;
+	while ( size < 2 * count )
+		size *= 2;
+	Rehash( size );
 }
 
 
-const TiXmlElement* TiXmlNode::NextSiblingElement( const char * _value ) const
+TiXmlChildIndex::~TiXmlChildIndex()
 {
-	const TiXmlNode* node;
+	delete [] children;
+	delete [] names;
+	delete [] positions;
+}
 
-	for (	node = NextSibling( _value );
-			node;
-			node = node->NextSibling( _value ) )
+
+void TiXmlChildIndex::Appended( const TiXmlNode* node )
+{
+	++count;
+	if ( count > capacity )
 	{
-		if ( node->ToElement() )
-			return node->ToElement();
+		Child* grown = new Child[ 2 * capacity ];
+		memcpy( grown, children, ( count - 1 ) * sizeof( Child ) );
+		delete [] children;
+		children = grown;
+		capacity *= 2;
 	}
-	return 0;
+	children[ count - 1 ].node = node;
+	children[ count - 1 ].next = NONE;
+	if ( 2 * count > tableMask + 1 )
+		Rehash( 2 * ( tableMask + 1 ) );
+	else
+		Add( count - 1 );
 }
 
 
-const TiXmlDocument* TiXmlNode::GetDocument() const
+void TiXmlChildIndex::Add( size_t n )
 {
-	const TiXmlNode* node;
-
-	for( node = this; node; node = node->parent )
+	const TiXmlNode* node = children[n].node;
+	size_t hash = Hash( node->Value() );
+	Name* name = NameSlot( node->Value(), hash );
+	if ( name->first == NONE )
 	{
-		if ( node->ToDocument() )
-			return node->ToDocument();
+		name->hash = hash;
+		name->first = n;
 	}
-	return 0;
+	else
+	{
+		children[ name->last ].next = n;
+	}
+	name->last = n;
+
+	size_t i = ( reinterpret_cast< size_t >( node ) / sizeof( void* ) ) & tableMask;
+	while ( positions[i] != NONE )
+		i = ( i + 1 ) & tableMask;
+	positions[i] = n;
 }
 
 
-TiXmlElement::TiXmlElement (const char * _value)
-	: TiXmlNode( TiXmlNode::TINYXML_ELEMENT )
+void TiXmlChildIndex::Rehash( size_t size )
 {
-	firstChild = lastChild = 0;
-	value = _value;
+	delete [] names;
+	delete [] positions;
+	names = new Name[ size ];
+	positions = new size_t[ size ];
+	tableMask = size - 1;
+	for ( size_t i = 0; i < size; ++i )
+	{
+		names[i].first = NONE;
+		positions[i] = NONE;
+	}
+
+	for ( size_t n = 0; n < count; ++n )
+	{
+		children[n].next = NONE;
+		Add( n );
+	}
 }
 
 
-#ifdef TIXML_USE_STL
-TiXmlElement::TiXmlElement( const std::string& _value ) 
-	: TiXmlNode( TiXmlNode::TINYXML_ELEMENT )
+size_t TiXmlChildIndex::Hash( const char* name )
 {
-	firstChild = lastChild = 0;
-	value = _value;
+	// FNV-1a
+	size_t hash = 2166136261u;
+	for ( const unsigned char* p = reinterpret_cast< const unsigned char* >( name ); *p; ++p )
+		hash = ( hash ^ *p ) * 16777619u;
+	return hash;
 }
-#endif
 
 
-TiXmlElement::TiXmlElement( const TiXmlElement& copy)
-	: TiXmlNode( TiXmlNode::TINYXML_ELEMENT )
+TiXmlChildIndex::Name* TiXmlChildIndex::NameSlot( const char* name, size_t hash ) const
 {
-	firstChild = lastChild = 0;
-	copy.CopyTo( this );	
+	size_t i = hash & tableMask;
+	while (    names[i].first != NONE
+			&& ( names[i].hash != hash || strcmp( children[ names[i].first ].node->Value(), name ) != 0 ) )
+		i = ( i + 1 ) & tableMask;
+	return &names[i];
 }
 
 
-TiXmlElement& TiXmlElement::operator=( const TiXmlElement& base )
+size_t TiXmlChildIndex::Position( const TiXmlNode* node ) const
 {
-	ClearThis();
-	base.CopyTo( this );
-	return *this;
+	size_t i = ( reinterpret_cast< size_t >( node ) / sizeof( void* ) ) & tableMask;
+	while ( children[ positions[i] ].node != node )
+		i = ( i + 1 ) & tableMask;
+	return positions[i];
 }
 
 
-TiXmlElement::~TiXmlElement()
+const TiXmlNode* TiXmlChildIndex::First( const char* name ) const
 {
-	ClearThis();
+	const Name* slot = NameSlot( name, Hash( name ) );
+	return slot->first != NONE ? children[ slot->first ].node : 0;
 }
 
 
-void TiXmlElement::ClearThis()
+const TiXmlNode* TiXmlChildIndex::Next( const TiXmlNode* node, const char* name ) const
 {
-	Clear();
-	while( attributeSet.First() )
+	size_t n = Position( node );
+	if ( strcmp( node->Value(), name ) == 0 )
 	{
-		TiXmlAttribute* node = attributeSet.First();
-		attributeSet.Remove( node );
-		delete node;
+		n = children[n].next;
+	}
+	else
+	{
+		// Follow the other name's chain past this child.
+		size_t after = n;
+		for ( n = NameSlot( name, Hash( name ) )->first; n != NONE && n < after; n = children[n].next )
+		{}
 	}
+	return n != NONE ? children[n].node : 0;
 }
 
 
-const char* TiXmlElement::Attribute( const char* name ) const
+const TiXmlChildIndex* TiXmlNode::ChildIndex() const
 {
-	const TiXmlAttribute* node = attributeSet.Find( name );
-	if ( node )
-		return node->Value();
-	return 0;
+	return type == TINYXML_ELEMENT ? static_cast< const TiXmlElement* >( this )->childIndex : 0;
 }
 
 
-#ifdef TIXML_USE_STL
-const std::string* TiXmlElement::Attribute( const std::string& name ) const
+void TiXmlNode::ChildLinked( const TiXmlNode* node )
 {
-	const TiXmlAttribute* attrib = attributeSet.Find( name );
-	if ( attrib )
-		return &attrib->ValueStr();
-	return 0;
+	if ( type == TINYXML_ELEMENT && static_cast< TiXmlElement* >( this )->childIndex )
+	{
+		if ( node == lastChild )
+			static_cast< TiXmlElement* >( this )->childIndex->Appended( node );
+		else
+			DropChildIndex();
+	}
+	MarkEdited();
 }
-#endif
 
 
-const char* TiXmlElement::Attribute( const char* name, int* i ) const
+void TiXmlNode::ChildUnlinked()
 {
-	const TiXmlAttribute* attrib = attributeSet.Find( name );
-	const char* result = 0;
-
-	if ( attrib ) {
-		result = attrib->Value();
-		if ( i ) {
-			attrib->QueryIntValue( i );
-		}
-	}
-	return result;
+	DropChildIndex();
+	MarkEdited();
 }
 
 
-#ifdef TIXML_USE_STL
-const std::string* TiXmlElement::Attribute( const std::string& name, int* i ) const
+void TiXmlNode::ChildrenChanged()
 {
-	const TiXmlAttribute* attrib = attributeSet.Find( name );
-	const std::string* result = 0;
+	DropChildIndex();
+}
 
-	if ( attrib ) {
-		result = &attrib->ValueStr();
-		if ( i ) {
-			attrib->QueryIntValue( i );
-		}
+
+void TiXmlNode::DropChildIndex()
+{
+	if ( type == TINYXML_ELEMENT )
+	{
+		TiXmlElement* element = static_cast< TiXmlElement* >( this );
+		delete element->childIndex;
+		element->childIndex = 0;
 	}
-	return result;
 }
-#endif
 
 
-const char* TiXmlElement::Attribute( const char* name, double* d ) const
+void TiXmlNode::Renamed()
 {
-	const TiXmlAttribute* attrib = attributeSet.Find( name );
-	const char* result = 0;
-
-	if ( attrib ) {
-		result = attrib->Value();
-		if ( d ) {
-			attrib->QueryDoubleValue( d );
-		}
-	}
-	return result;
+	atom = TiXmlAtom();
+	if ( parent )
+		parent->ChildrenChanged();
+	MarkEdited();
 }
 
 
-#ifdef TIXML_USE_STL
-const std::string* TiXmlElement::Attribute( const std::string& name, double* d ) const
+void TiXmlNode::NoteEdit( int how )
 {
-	const TiXmlAttribute* attrib = attributeSet.Find( name );
-	const std::string* result = 0;
-
-	if ( attrib ) {
-		result = &attrib->ValueStr();
-		if ( d ) {
-			attrib->QueryDoubleValue( d );
-		}
-	}
-	return result;
+	edits |= how;
+	for ( TiXmlNode* node = parent; node && !( node->edits & EDITED_BELOW ); node = node->parent )
+		node->edits |= EDITED_BELOW;
 }
-#endif
 
 
-int TiXmlElement::QueryIntAttribute( const char* name, int* ival ) const
+TiXmlNode::TiXmlNode( NodeType _type ) : TiXmlBase()
 {
-	const TiXmlAttribute* attrib = attributeSet.Find( name );
-	if ( !attrib )
-		return TIXML_NO_ATTRIBUTE;
-	return attrib->QueryIntValue( ival );
+	parent = 0;
+	type = _type;
+	edits = 0;
+	sourceBegin = sourceEnd = -1;
+	firstChild = 0;
+	lastChild = 0;
+	prev = 0;
+	next = 0;
 }
 
 
-int TiXmlElement::QueryUnsignedAttribute( const char* name, unsigned* value ) const
+TiXmlNode::~TiXmlNode()
 {
-	const TiXmlAttribute* node = attributeSet.Find( name );
-	if ( !node )
-		return TIXML_NO_ATTRIBUTE;
-
-	int ival = 0;
-	int result = node->QueryIntValue( &ival );
-	*value = (unsigned)ival;
-	return result;
+	DeleteChildren();
 }
 
 
-int TiXmlElement::QueryBoolAttribute( const char* name, bool* bval ) const
+void TiXmlNode::DeleteChildren()
 {
-	const TiXmlAttribute* node = attributeSet.Find( name );
-	if ( !node )
-		return TIXML_NO_ATTRIBUTE;
-	
-	int result = TIXML_WRONG_TYPE;
-	if (    StringEqual( node->Value(), "true", true, TIXML_ENCODING_UNKNOWN ) 
-		 || StringEqual( node->Value(), "yes", true, TIXML_ENCODING_UNKNOWN ) 
-		 || StringEqual( node->Value(), "1", true, TIXML_ENCODING_UNKNOWN ) ) 
-	{
-		*bval = true;
-		result = TIXML_SUCCESS;
-	}
-	else if (    StringEqual( node->Value(), "false", true, TIXML_ENCODING_UNKNOWN ) 
-			  || StringEqual( node->Value(), "no", true, TIXML_ENCODING_UNKNOWN ) 
-			  || StringEqual( node->Value(), "0", true, TIXML_ENCODING_UNKNOWN ) ) 
+	// Rather than each node deleting its own children, a node's children
+	// take its place in the line before it goes, and so on down.
+	TiXmlNode* node = firstChild;
+	while ( node )
 	{
-		*bval = false;
-		result = TIXML_SUCCESS;
+		TiXmlNode* following = node->next;
+		if ( node->firstChild )
+		{
+			node->lastChild->next = following;
+			following = node->firstChild;
+			node->firstChild = node->lastChild = 0;
+		}
+		delete node;
+		node = following;
 	}
-	return result;
 }
 
 
-
-#ifdef TIXML_USE_STL
-int TiXmlElement::QueryIntAttribute( const std::string& name, int* ival ) const
+void TiXmlNode::CopyTo( TiXmlNode* target ) const
 {
-	const TiXmlAttribute* attrib = attributeSet.Find( name );
-	if ( !attrib )
-		return TIXML_NO_ATTRIBUTE;
-	return attrib->QueryIntValue( ival );
+	target->SetValue (value.c_str() );
+	target->userData = userData; 
+	ResolveLocation();		// the copy can't go back to this document's text
+	target->location = location;
 }
-#endif
 
 
-int TiXmlElement::QueryDoubleAttribute( const char* name, double* dval ) const
+void TiXmlNode::CopyChildrenTo( TiXmlNode* target ) const
 {
-	const TiXmlAttribute* attrib = attributeSet.Find( name );
-	if ( !attrib )
-		return TIXML_NO_ATTRIBUTE;
-	return attrib->QueryDoubleValue( dval );
+	// The elements are copied here, not by their own Clone(): 'target' is the
+	// copy of the parent of 'node', and goes back up with it. The document is
+	// found once, for the pending locations, rather than by every copy.
+	const TiXmlDocument* document = GetDocument();
+	const TiXmlNode* node = firstChild;
+	while ( node )
+	{
+		if ( document && node->location.Pending() )
+			document->ResolveLocation( &node->location );
+		const TiXmlElement* element = node->ToElement();
+		TiXmlNode* copy;
+		if ( element )
+		{
+			TiXmlElement* copied = new TiXmlElement( element->Value() );
+			element->CopyTagTo( copied );
+			copy = copied;
+		}
+		else
+		{
+			copy = node->Clone();
+		}
+		target->LinkEndChild( copy );
+
+		if ( element && node->firstChild )
+		{
+			node = node->firstChild;
+			target = copy;
+			continue;
+		}
+		while ( !node->next && node->parent != this )
+		{
+			node = node->parent;
+			target = target->parent;
+		}
+		node = node->next;
+	}
 }
 
 
-#ifdef TIXML_USE_STL
-int TiXmlElement::QueryDoubleAttribute( const std::string& name, double* dval ) const
+void TiXmlNode::MoveTo( TiXmlNode* target )
 {
-	const TiXmlAttribute* attrib = attributeSet.Find( name );
-	if ( !attrib )
-		return TIXML_NO_ATTRIBUTE;
-	return attrib->QueryDoubleValue( dval );
-}
-#endif
+	assert( !target->firstChild );
+	Settle();
 
+	MoveString( value, target->value );
+	Renamed();
+	target->Renamed();
+	target->userData = userData;
+	target->location = location;
 
-void TiXmlElement::SetAttribute( const char * name, int val )
-{	
-	TiXmlAttribute* attrib = attributeSet.FindOrCreate( name );
-	if ( attrib ) {
-		attrib->SetIntValue( val );
-	}
+	target->firstChild = firstChild;
+	target->lastChild = lastChild;
+	for ( TiXmlNode* node = firstChild; node; node = node->next )
+		node->parent = target;
+	firstChild = lastChild = 0;
+	DropChildIndex();
+	target->DropChildIndex();
 }
 
 
-#ifdef TIXML_USE_STL
-void TiXmlElement::SetAttribute( const std::string& name, int val )
-{	
-	TiXmlAttribute* attrib = attributeSet.FindOrCreate( name );
-	if ( attrib ) {
-		attrib->SetIntValue( val );
-	}
-}
-#endif
-
+void TiXmlNode::Settle()
+{
+	// The nodes below this one are settled by this loop as well: 'node' goes
+	// down into the children, and back up to the next sibling. The document
+	// is found once, for the pending locations, rather than by every node.
+	SettleThis();
+	const TiXmlDocument* document = firstChild ? GetDocument() : 0;
+	TiXmlNode* node = firstChild;
+	while ( node )
+	{
+		if ( document && node->location.Pending() )
+			document->ResolveLocation( &node->location );
+		if ( InArena( node ) )
+			node = node->MoveOutOfArena();
+		else
+			node->SettleThis();
 
-void TiXmlElement::SetDoubleAttribute( const char * name, double val )
-{	
-	TiXmlAttribute* attrib = attributeSet.FindOrCreate( name );
-	if ( attrib ) {
-		attrib->SetDoubleValue( val );
+		if ( node->firstChild )
+		{
+			node = node->firstChild;
+			continue;
+		}
+		while ( !node->next && node->parent != this )
+			node = node->parent;
+		node = node->next;
 	}
 }
 
 
-#ifdef TIXML_USE_STL
-void TiXmlElement::SetDoubleAttribute( const std::string& name, double val )
-{	
-	TiXmlAttribute* attrib = attributeSet.FindOrCreate( name );
-	if ( attrib ) {
-		attrib->SetDoubleValue( val );
-	}
+void TiXmlNode::SettleThis()
+{
+	ResolveLocation();
+	OwnString( value );
+	atom = TiXmlAtom();		// belongs to the document
 }
-#endif 
 
 
-void TiXmlElement::SetAttribute( const char * cname, const char * cvalue )
+TiXmlNode* TiXmlNode::MoveOutOfArena()
 {
-	TiXmlAttribute* attrib = attributeSet.FindOrCreate( cname );
-	if ( attrib ) {
-		attrib->SetValue( cvalue );
-	}
+	// Without its children, MoveClone() settles only this node; they are
+	// handed over to the copy as they are.
+	TiXmlNode* first = firstChild;
+	TiXmlNode* last = lastChild;
+	firstChild = lastChild = 0;
+	DropChildIndex();
+
+	TiXmlNode* moved = MoveClone();
+	moved->firstChild = first;
+	moved->lastChild = last;
+	for ( TiXmlNode* node = first; node; node = node->next )
+		node->parent = moved;
+	return parent->LinkReplaceChild( this, moved );
 }
 
 
-#ifdef TIXML_USE_STL
-void TiXmlElement::SetAttribute( const std::string& _name, const std::string& _value )
+void TiXmlNode::Clear()
 {
-	TiXmlAttribute* attrib = attributeSet.FindOrCreate( _name );
-	if ( attrib ) {
-		attrib->SetValue( _value );
-	}
+	DeleteChildren();
+
+	if ( firstChild )
+		MarkEdited();
+	firstChild = 0;
+	lastChild = 0;
+	DropChildIndex();
 }
-#endif
 
 
-void TiXmlElement::Print( FILE* cfile, int depth ) const
+TiXmlNode* TiXmlNode::LinkEndChild( TiXmlNode* node )
 {
-	int i;
-	assert( cfile );
-	for ( i=0; i<depth; i++ ) {
-		fprintf( cfile, "    " );
-	}
-
-	fprintf( cfile, "<%s", value.c_str() );
+	assert( node->parent == 0 || node->parent == this );
+	assert( node->GetDocument() == 0 || node->GetDocument() == this->GetDocument() );
 
-	const TiXmlAttribute* attrib;
-	for ( attrib = attributeSet.First(); attrib; attrib = attrib->Next() )
+	if ( node->Type() == TiXmlNode::TINYXML_DOCUMENT )
 	{
-		fprintf( cfile, " " );
-		attrib->Print( cfile, depth );
+		delete node;
+		if ( GetDocument() ) 
+			GetDocument()->SetError( TIXML_ERROR_DOCUMENT_TOP_ONLY, 0, 0, TIXML_ENCODING_UNKNOWN );
+		return 0;
 	}
 
-	// There are 3 different formatting approaches:
-	// 1) An element without children is printed as a <foo /> node
-	// 2) An element with only a text child is printed as <foo> text </foo>
-	// 3) An element with children is printed on multiple lines.
-	TiXmlNode* node;
-	if ( !firstChild )
-	{
-		fprintf( cfile, " />" );
-	}
-	else if ( firstChild == lastChild && firstChild->ToText() )
-	{
-		fprintf( cfile, ">" );
-		firstChild->Print( cfile, depth + 1 );
-		fprintf( cfile, "</%s>", value.c_str() );
-	}
+	node->parent = this;
+
+	node->prev = lastChild;
+	node->next = 0;
+
+	if ( lastChild )
+		lastChild->next = node;
 	else
-	{
-		fprintf( cfile, ">" );
+		firstChild = node;			// it was an empty list.
 
-		for ( node = firstChild; node; node=node->NextSibling() )
-		{
-			if ( !node->ToText() )
-			{
-				fprintf( cfile, "\n" );
-			}
-			node->Print( cfile, depth+1 );
-		}
-		fprintf( cfile, "\n" );
-		for( i=0; i<depth; ++i ) {
-			fprintf( cfile, "    " );
-		}
-		fprintf( cfile, "</%s>", value.c_str() );
-	}
+	lastChild = node;
+	ChildLinked( node );
+	return node;
 }
 
 
-void TiXmlElement::CopyTo( TiXmlElement* target ) const
+TiXmlNode* TiXmlNode::InsertEndChild( const TiXmlNode& addThis )
 {
-	// superclass:
-	TiXmlNode::CopyTo( target );
+	if ( !Insertable( addThis ) )
+		return 0;
+	TiXmlNode* node = addThis.Clone();
+	if ( !node )
+		return 0;
 
-	// Element class: 
-	// Clone the attributes, then clone the children.
-	const TiXmlAttribute* attribute = 0;
-	for(	attribute = attributeSet.First();
-	attribute;
-	attribute = attribute->Next() )
-	{
-		target->SetAttribute( attribute->Name(), attribute->Value() );
-	}
+	return LinkEndChild( node );
+}
 
-	TiXmlNode* node = 0;
-	for ( node = firstChild; node; node = node->NextSibling() )
-	{
-		target->LinkEndChild( node->Clone() );
+
+TiXmlNode* TiXmlNode::InsertBeforeChild( TiXmlNode* beforeThis, const TiXmlNode& addThis )
+{	
+	if ( !beforeThis || beforeThis->parent != this ) {
+		return 0;
 	}
+	if ( !Insertable( addThis ) )
+		return 0;
+
+	TiXmlNode* node = addThis.Clone();
+	if ( !node )
+		return 0;
+	return LinkBeforeChild( beforeThis, node );
 }
 
-bool TiXmlElement::Accept( TiXmlVisitor* visitor ) const
+
+TiXmlNode* TiXmlNode::InsertAfterChild( TiXmlNode* afterThis, const TiXmlNode& addThis )
 {
-	if ( visitor->VisitEnter( *this, attributeSet.First() ) ) 
-	{
-		for ( const TiXmlNode* node=FirstChild(); node; node=node->NextSibling() )
-		{
-			if ( !node->Accept( visitor ) )
-				break;
-		}
+	if ( !afterThis || afterThis->parent != this ) {
+		return 0;
 	}
-	return visitor->VisitExit( *this );
+	if ( !Insertable( addThis ) )
+		return 0;
+
+	TiXmlNode* node = addThis.Clone();
+	if ( !node )
+		return 0;
+	return LinkAfterChild( afterThis, node );
 }
 
 
-TiXmlNode* TiXmlElement::Clone() const
+TiXmlNode* TiXmlNode::ReplaceChild( TiXmlNode* replaceThis, const TiXmlNode& withThis )
 {
-	TiXmlElement* clone = new TiXmlElement( Value() );
-	if ( !clone )
+	if ( !replaceThis )
 		return 0;
 
-	CopyTo( clone );
-	return clone;
+	if ( replaceThis->parent != this )
+		return 0;
+
+	if ( !Insertable( withThis ) )
+		return 0;
+
+	TiXmlNode* node = withThis.Clone();
+	if ( !node )
+		return 0;
+	return LinkReplaceChild( replaceThis, node );
 }
 
 
-const char* TiXmlElement::GetText() const
+#ifdef TIXML_RVALUE_REFS
+TiXmlNode* TiXmlNode::InsertEndChild( TiXmlNode&& addThis )
 {
-	const TiXmlNode* child = this->FirstChild();
-	if ( child ) {
-		const TiXmlText* childText = child->ToText();
-		if ( childText ) {
-			return childText->Value();
-		}
-	}
-	return 0;
+	if ( !Movable( addThis ) )
+		return 0;
+	TiXmlNode* node = addThis.MoveClone();
+	if ( !node )
+		return 0;
+
+	return LinkEndChild( node );
 }
 
 
-TiXmlDocument::TiXmlDocument() : TiXmlNode( TiXmlNode::TINYXML_DOCUMENT )
+TiXmlNode* TiXmlNode::InsertBeforeChild( TiXmlNode* beforeThis, TiXmlNode&& addThis )
 {
-	tabsize = 4;
-	useMicrosoftBOM = false;
-	ClearError();
-}
+	if ( !beforeThis || beforeThis->parent != this || !Movable( addThis ) )
+		return 0;
 
-TiXmlDocument::TiXmlDocument( const char * documentName ) : TiXmlNode( TiXmlNode::TINYXML_DOCUMENT )
-{
-	tabsize = 4;
-	useMicrosoftBOM = false;
-	value = documentName;
-	ClearError();
+	TiXmlNode* node = addThis.MoveClone();
+	if ( !node )
+		return 0;
+	return LinkBeforeChild( beforeThis, node );
 }
 
 
-#ifdef TIXML_USE_STL
-TiXmlDocument::TiXmlDocument( const std::string& documentName ) : TiXmlNode( TiXmlNode::TINYXML_DOCUMENT )
+TiXmlNode* TiXmlNode::InsertAfterChild( TiXmlNode* afterThis, TiXmlNode&& addThis )
 {
-	tabsize = 4;
-	useMicrosoftBOM = false;
-    value = documentName;
-	ClearError();
-}
-#endif
-
+	if ( !afterThis || afterThis->parent != this || !Movable( addThis ) )
+		return 0;
 
-TiXmlDocument::TiXmlDocument( const TiXmlDocument& copy ) : TiXmlNode( TiXmlNode::TINYXML_DOCUMENT )
-{
-	copy.CopyTo( this );
+	TiXmlNode* node = addThis.MoveClone();
+	if ( !node )
+		return 0;
+	return LinkAfterChild( afterThis, node );
 }
 
 
-TiXmlDocument& TiXmlDocument::operator=( const TiXmlDocument& copy )
+TiXmlNode* TiXmlNode::ReplaceChild( TiXmlNode* replaceThis, TiXmlNode&& withThis )
 {
-	Clear();
-	copy.CopyTo( this );
-	return *this;
+	if ( !replaceThis || replaceThis->parent != this || !Movable( withThis ) )
+		return 0;
+
+	TiXmlNode* node = withThis.MoveClone();
+	if ( !node )
+		return 0;
+	return LinkReplaceChild( replaceThis, node );
 }
+#endif
 
 
-bool TiXmlDocument::LoadFile( TiXmlEncoding encoding )
+bool TiXmlNode::Insertable( const TiXmlNode& addThis )
 {
-	return LoadFile( Value(), encoding );
+	if ( addThis.Type() == TiXmlNode::TINYXML_DOCUMENT )
+	{
+		// A document can never be a child.	Thanks to Noam.
+		if ( GetDocument() ) 
+			GetDocument()->SetError( TIXML_ERROR_DOCUMENT_TOP_ONLY, 0, 0, TIXML_ENCODING_UNKNOWN );
+		return false;
+	}
+	return true;
 }
 
 
-bool TiXmlDocument::SaveFile() const
+#ifdef TIXML_RVALUE_REFS
+bool TiXmlNode::Movable( const TiXmlNode& addThis )
 {
-	return SaveFile( Value() );
+	if ( !Insertable( addThis ) )
+		return false;
+
+	// Moving this node or one of its ancestors would relink this node
+	// under itself.
+	for ( const TiXmlNode* node = this; node; node = node->parent )
+	{
+		if ( node == &addThis )
+			return false;
+	}
+	return true;
 }
+#endif
 
-bool TiXmlDocument::LoadFile( const char* _filename, TiXmlEncoding encoding )
-{
-	TIXML_STRING filename( _filename );
-	value = filename;
 
-	// reading in binary mode so that tinyxml can normalize the EOL
-	FILE* file = TiXmlFOpen( value.c_str (), "rb" );	
+TiXmlNode* TiXmlNode::LinkBeforeChild( TiXmlNode* beforeThis, TiXmlNode* node )
+{
+	node->parent = this;
 
-	if ( file )
+	node->next = beforeThis;
+	node->prev = beforeThis->prev;
+	if ( beforeThis->prev )
 	{
-		bool result = LoadFile( file, encoding );
-		fclose( file );
-		return result;
+		beforeThis->prev->next = node;
 	}
 	else
 	{
-		SetError( TIXML_ERROR_OPENING_FILE, 0, 0, TIXML_ENCODING_UNKNOWN );
-		return false;
+		assert( firstChild == beforeThis );
+		firstChild = node;
 	}
+	beforeThis->prev = node;
+	ChildLinked( node );
+	return node;
 }
 
-bool TiXmlDocument::LoadFile( FILE* file, TiXmlEncoding encoding )
+
+TiXmlNode* TiXmlNode::LinkAfterChild( TiXmlNode* afterThis, TiXmlNode* node )
 {
-	if ( !file ) 
+	node->parent = this;
+
+	node->prev = afterThis;
+	node->next = afterThis->next;
+	if ( afterThis->next )
 	{
-		SetError( TIXML_ERROR_OPENING_FILE, 0, 0, TIXML_ENCODING_UNKNOWN );
-		return false;
+		afterThis->next->prev = node;
 	}
-
-	// Delete the existing data:
-	Clear();
-	location.Clear();
-
-	// Get the file size, so we can pre-allocate the string. HUGE speed impact.
-	long length = 0;
-	fseek( file, 0, SEEK_END );
-	length = ftell( file );
-	fseek( file, 0, SEEK_SET );
-
-	// Strange case, but good to handle up front.
-	if ( length <= 0 )
+	else
 	{
-		SetError( TIXML_ERROR_DOCUMENT_EMPTY, 0, 0, TIXML_ENCODING_UNKNOWN );
-		return false;
+		assert( lastChild == afterThis );
+		lastChild = node;
 	}
+	afterThis->next = node;
+	ChildLinked( node );
+	return node;
+}
 
-	// Subtle bug here. TinyXml did use fgets. But from the XML spec:
-	// 2.11 End-of-Line Handling
-	// <snip>
-	// <quote>
-	// ...the XML processor MUST behave as if it normalized all line breaks in external 
-	// parsed entities (including the document entity) on input, before parsing, by translating 
-	// both the two-character sequence #xD #xA and any #xD that is not followed by #xA to 
-	// a single #xA character.
-	// </quote>
-	//
-	// It is not clear fgets does that, and certainly isn't clear it works cross platform. 
-	// Generally, you expect fgets to translate from the convention of the OS to the c/unix
-	// convention, and not work generally.
 
-	/*
-	while( fgets( buf, sizeof(buf), file ) )
-	{
-		data += buf;
-	}
-	*/
+TiXmlNode* TiXmlNode::LinkReplaceChild( TiXmlNode* replaceThis, TiXmlNode* node )
+{
+	node->next = replaceThis->next;
+	node->prev = replaceThis->prev;
 
-	char* buf = new char[ length+1 ];
-	buf[0] = 0;
+	if ( replaceThis->next )
+		replaceThis->next->prev = node;
+	else
+		lastChild = node;
 
-	if ( fread( buf, length, 1, file ) != 1 ) {
-		delete [] buf;
-		SetError( TIXML_ERROR_OPENING_FILE, 0, 0, TIXML_ENCODING_UNKNOWN );
-		return false;
-	}
+	if ( replaceThis->prev )
+		replaceThis->prev->next = node;
+	else
+		firstChild = node;
 
-	// Process the buffer in place to normalize new lines. (See comment above.)
-	// Copies from the 'p' to 'q' pointer, where p can advance faster if
-	// a newline-carriage return is hit.
-	//
-	// Wikipedia:
-	// Systems based on ASCII or a compatible character set use either LF  (Line feed, '\n', 0x0A, 10 in decimal) or 
-	// CR (Carriage return, '\r', 0x0D, 13 in decimal) individually, or CR followed by LF (CR+LF, 0x0D 0x0A)...
-	//		* LF:    Multics, Unix and Unix-like systems (GNU/Linux, AIX, Xenix, Mac OS X, FreeBSD, etc.), BeOS, Amiga, RISC OS, and others
-    //		* CR+LF: DEC RT-11 and most other early non-Unix, non-IBM OSes, CP/M, MP/M, DOS, OS/2, Microsoft Windows, Symbian OS
-    //		* CR:    Commodore 8-bit machines, Apple II family, Mac OS up to version 9 and OS-9
+	delete replaceThis;
+	node->parent = this;
+	ChildrenChanged();
+	MarkEdited();
+	return node;
+}
 
-	const char* p = buf;	// the read head
-	char* q = buf;			// the write head
-	const char CR = 0x0d;
-	const char LF = 0x0a;
 
-	buf[length] = 0;
-	while( *p ) {
-		assert( p < (buf+length) );
-		assert( q <= (buf+length) );
-		assert( q <= p );
-
-		if ( *p == CR ) {
-			*q++ = LF;
-			p++;
-			if ( *p == LF ) {		// check for CR+LF (and skip LF)
-				p++;
-			}
-		}
-		else {
-			*q++ = *p++;
-		}
+bool TiXmlNode::RemoveChild( TiXmlNode* removeThis )
+{
+	if ( !removeThis ) {
+		return false;
 	}
-	assert( q <= (buf+length) );
-	*q = 0;
 
-	Parse( buf, 0, encoding );
+	if ( removeThis->parent != this )
+	{	
+		assert( 0 );
+		return false;
+	}
 
-	delete [] buf;
-	return !Error();
-}
+	if ( removeThis->next )
+		removeThis->next->prev = removeThis->prev;
+	else
+		lastChild = removeThis->prev;
 
+	if ( removeThis->prev )
+		removeThis->prev->next = removeThis->next;
+	else
+		firstChild = removeThis->next;
 
-bool TiXmlDocument::SaveFile( const char * filename ) const
-{
-	// The old c stuff lives on...
-	FILE* fp = TiXmlFOpen( filename, "w" );
-	if ( fp )
-	{
-		bool result = SaveFile( fp );
-		fclose( fp );
-		return result;
-	}
-	return false;
+	delete removeThis;
+	ChildUnlinked();
+	return true;
 }
 
-
-bool TiXmlDocument::SaveFile( FILE* fp ) const
+const TiXmlNode* TiXmlNode::FirstChild( const char * _value ) const
 {
-	if ( useMicrosoftBOM ) 
-	{
-		const unsigned char TIXML_UTF_LEAD_0 = 0xefU;
-		const unsigned char TIXML_UTF_LEAD_1 = 0xbbU;
-		const unsigned char TIXML_UTF_LEAD_2 = 0xbfU;
+	if ( const TiXmlChildIndex* index = ChildIndex() )
+		return index->First( _value );
 
-		fputc( TIXML_UTF_LEAD_0, fp );
-		fputc( TIXML_UTF_LEAD_1, fp );
-		fputc( TIXML_UTF_LEAD_2, fp );
+	const TiXmlNode* node;
+	for ( node = firstChild; node; node = node->next )
+	{
+		if ( strcmp( node->Value(), _value ) == 0 )
+			break;
 	}
-	Print( fp, 0 );
-	return (ferror(fp) == 0);
+	return node;
 }
 
 
-void TiXmlDocument::CopyTo( TiXmlDocument* target ) const
+const TiXmlNode* TiXmlNode::FirstChild( TiXmlAtom _atom ) const
 {
-	TiXmlNode::CopyTo( target );
-
-	target->error = error;
-	target->errorId = errorId;
-	target->errorDesc = errorDesc;
-	target->tabsize = tabsize;
-	target->errorLocation = errorLocation;
-	target->useMicrosoftBOM = useMicrosoftBOM;
+	if ( const TiXmlChildIndex* index = ChildIndex() )
+		return _atom.Name() ? index->First( _atom.Name() ) : 0;
 
-	TiXmlNode* node = 0;
-	for ( node = firstChild; node; node = node->NextSibling() )
+	const TiXmlNode* node;
+	for ( node = firstChild; node; node = node->next )
 	{
-		target->LinkEndChild( node->Clone() );
-	}	
+		if ( node->Is( _atom ) )
+			break;
+	}
+	return node;
 }
 
 
-TiXmlNode* TiXmlDocument::Clone() const
+const TiXmlNode* TiXmlNode::LastChild( const char * _value ) const
 {
-	TiXmlDocument* clone = new TiXmlDocument();
-	if ( !clone )
-		return 0;
-
-	CopyTo( clone );
-	return clone;
+	const TiXmlNode* node;
+	for ( node = lastChild; node; node = node->prev )
+	{
+		if ( strcmp( node->Value(), _value ) == 0 )
+			return node;
+	}
+	return 0;
 }
 
 
-void TiXmlDocument::Print( FILE* cfile, int depth ) const
+const TiXmlNode* TiXmlNode::IterateChildren( const TiXmlNode* previous ) const
 {
-	assert( cfile );
-	for ( const TiXmlNode* node=FirstChild(); node; node=node->NextSibling() )
+	if ( !previous )
+	{
+		return FirstChild();
+	}
+	else
 	{
-		node->Print( cfile, depth );
-		fprintf( cfile, "\n" );
+		assert( previous->parent == this );
+		return previous->NextSibling();
 	}
 }
 
 
-bool TiXmlDocument::Accept( TiXmlVisitor* visitor ) const
+const TiXmlNode* TiXmlNode::IterateChildren( const char * val, const TiXmlNode* previous ) const
 {
-	if ( visitor->VisitEnter( *this ) )
+	if ( !previous )
+	{
+		return FirstChild( val );
+	}
+	else
+	{
+		assert( previous->parent == this );
+		return previous->NextSibling( val );
+	}
+}
+
+
+const TiXmlNode* TiXmlNode::NextSibling( const char * _value ) const 
+{
+	if ( const TiXmlChildIndex* index = parent ? parent->ChildIndex() : 0 )
+		return index->Next( this, _value );
+
+	const TiXmlNode* node;
+	for ( node = next; node; node = node->next )
+	{
+		if ( strcmp( node->Value(), _value ) == 0 )
+			break;
+	}
+	return node;
+}
+
+
+const TiXmlNode* TiXmlNode::NextSibling( TiXmlAtom _atom ) const
+{
+	if ( const TiXmlChildIndex* index = parent ? parent->ChildIndex() : 0 )
+		return _atom.Name() ? index->Next( this, _atom.Name() ) : 0;
+
+	const TiXmlNode* node;
+	for ( node = next; node; node = node->next )
+	{
+		if ( node->Is( _atom ) )
+			break;
+	}
+	return node;
+}
+
+
+const TiXmlNode* TiXmlNode::PreviousSibling( const char * _value ) const
+{
+	const TiXmlNode* node;
+	for ( node = prev; node; node = node->prev )
+	{
+		if ( strcmp( node->Value(), _value ) == 0 )
+			return node;
+	}
+	return 0;
+}
+
+
+void TiXmlElement::RemoveAttribute( const char * name )
+{
+    #ifdef TIXML_USE_STL
+	TIXML_STRING str( name );
+	TiXmlAttribute* node = attributeSet.Find( str );
+	#else
+	TiXmlAttribute* node = attributeSet.Find( name );
+	#endif
+	if ( node )
+	{
+		attributeSet.Remove( node );
+		delete node;
+	}
+}
+
+const TiXmlElement* TiXmlNode::FirstChildElement() const
+{
+	const TiXmlNode* node;
+
+	for (	node = FirstChild();
+			node;
+			node = node->NextSibling() )
+	{
+		if ( node->ToElement() )
+			return node->ToElement();
+	}
+	return 0;
+}
+
+
+const TiXmlElement* TiXmlNode::FirstChildElement( const char * _value ) const
+{
+	const TiXmlNode* node;
+
+	for (	node = FirstChild( _value );
+			node;
+			node = node->NextSibling( _value ) )
+	{
+		if ( node->ToElement() )
+			return node->ToElement();
+	}
+	return 0;
+}
+
+
+const TiXmlElement* TiXmlNode::FirstChildElement( TiXmlAtom _atom ) const
+{
+	const TiXmlNode* node;
+
+	for (	node = FirstChild( _atom );
+			node;
+			node = node->NextSibling( _atom ) )
+	{
+		if ( node->ToElement() )
+			return node->ToElement();
+	}
+	return 0;
+}
+
+
+const TiXmlElement* TiXmlNode::NextSiblingElement() const
+{
+	const TiXmlNode* node;
+
+	for (	node = NextSibling();
+			node;
+			node = node->NextSibling() )
+	{
+		if ( node->ToElement() )
+			return node->ToElement();
+	}
+	return 0;
+}
+
+
+const TiXmlElement* TiXmlNode::NextSiblingElement( const char * _value ) const
+{
+	const TiXmlNode* node;
+
+	for (	node = NextSibling( _value );
+			node;
+			node = node->NextSibling( _value ) )
+	{
+		if ( node->ToElement() )
+			return node->ToElement();
+	}
+	return 0;
+}
+
+
+const TiXmlElement* TiXmlNode::NextSiblingElement( TiXmlAtom _atom ) const
+{
+	const TiXmlNode* node;
+
+	for (	node = NextSibling( _atom );
+			node;
+			node = node->NextSibling( _atom ) )
+	{
+		if ( node->ToElement() )
+			return node->ToElement();
+	}
+	return 0;
+}
+
+
+const TiXmlDocument* TiXmlNode::GetDocument() const
+{
+	const TiXmlNode* node;
+
+	for( node = this; node; node = node->parent )
+	{
+		if ( node->ToDocument() )
+			return node->ToDocument();
+	}
+	return 0;
+}
+
+
+TiXmlElement::TiXmlElement (const char * _value)
+	: TiXmlNode( TiXmlNode::TINYXML_ELEMENT )
+{
+	firstChild = lastChild = 0;
+	childIndex = 0;
+	sourceTagEnd = -1;
+	attributeSet.SetElement( this );
+	value = _value;
+}
+
+
+#ifdef TIXML_USE_STL
+TiXmlElement::TiXmlElement( const std::string& _value ) 
+	: TiXmlNode( TiXmlNode::TINYXML_ELEMENT )
+{
+	firstChild = lastChild = 0;
+	childIndex = 0;
+	sourceTagEnd = -1;
+	attributeSet.SetElement( this );
+	value = _value;
+}
+#endif
+
+
+TiXmlElement::TiXmlElement( const TiXmlElement& copy)
+	: TiXmlNode( TiXmlNode::TINYXML_ELEMENT )
+{
+	firstChild = lastChild = 0;
+	childIndex = 0;
+	sourceTagEnd = -1;
+	attributeSet.SetElement( this );
+	copy.CopyTo( this );	
+}
+
+
+TiXmlElement& TiXmlElement::operator=( const TiXmlElement& base )
+{
+	ClearThis();
+	base.CopyTo( this );
+	return *this;
+}
+
+
+#ifdef TIXML_RVALUE_REFS
+TiXmlElement::TiXmlElement( TiXmlElement&& move )
+	: TiXmlNode( TiXmlNode::TINYXML_ELEMENT )
+{
+	firstChild = lastChild = 0;
+	childIndex = 0;
+	sourceTagEnd = -1;
+	attributeSet.SetElement( this );
+	move.MoveTo( this );
+}
+
+
+TiXmlElement& TiXmlElement::operator=( TiXmlElement&& move )
+{
+	if ( &move != this )
+	{
+		ClearThis();
+		move.MoveTo( this );
+	}
+	return *this;
+}
+#endif
+
+
+TiXmlElement::~TiXmlElement()
+{
+	sourceBegin = -1;		// nothing to note as it goes
+	ClearThis();
+}
+
+
+void TiXmlElement::BuildChildIndex()
+{
+	if ( !childIndex )
+		childIndex = new TiXmlChildIndex( this );
+}
+
+
+void TiXmlElement::ClearThis()
+{
+	Clear();
+	while( attributeSet.First() )
+	{
+		TiXmlAttribute* node = attributeSet.First();
+		attributeSet.Remove( node );
+		delete node;
+	}
+}
+
+
+const char* TiXmlElement::Attribute( const char* name ) const
+{
+	const TiXmlAttribute* node = attributeSet.Find( name );
+	if ( node )
+		return node->Value();
+	return 0;
+}
+
+
+const char* TiXmlElement::Attribute( TiXmlAtom name ) const
+{
+	const TiXmlAttribute* node = attributeSet.Find( name );
+	if ( node )
+		return node->Value();
+	return 0;
+}
+
+
+#ifdef TIXML_USE_STL
+const std::string* TiXmlElement::Attribute( const std::string& name ) const
+{
+	const TiXmlAttribute* attrib = attributeSet.Find( name );
+	if ( attrib )
+		return &attrib->ValueStr();
+	return 0;
+}
+#endif
+
+
+const char* TiXmlElement::Attribute( const char* name, int* i ) const
+{
+	const TiXmlAttribute* attrib = attributeSet.Find( name );
+	const char* result = 0;
+
+	if ( attrib ) {
+		result = attrib->Value();
+		if ( i ) {
+			attrib->QueryIntValue( i );
+		}
+	}
+	return result;
+}
+
+
+#ifdef TIXML_USE_STL
+const std::string* TiXmlElement::Attribute( const std::string& name, int* i ) const
+{
+	const TiXmlAttribute* attrib = attributeSet.Find( name );
+	const std::string* result = 0;
+
+	if ( attrib ) {
+		result = &attrib->ValueStr();
+		if ( i ) {
+			attrib->QueryIntValue( i );
+		}
+	}
+	return result;
+}
+#endif
+
+
+const char* TiXmlElement::Attribute( const char* name, double* d ) const
+{
+	const TiXmlAttribute* attrib = attributeSet.Find( name );
+	const char* result = 0;
+
+	if ( attrib ) {
+		result = attrib->Value();
+		if ( d ) {
+			attrib->QueryDoubleValue( d );
+		}
+	}
+	return result;
+}
+
+
+#ifdef TIXML_USE_STL
+const std::string* TiXmlElement::Attribute( const std::string& name, double* d ) const
+{
+	const TiXmlAttribute* attrib = attributeSet.Find( name );
+	const std::string* result = 0;
+
+	if ( attrib ) {
+		result = &attrib->ValueStr();
+		if ( d ) {
+			attrib->QueryDoubleValue( d );
+		}
+	}
+	return result;
+}
+#endif
+
+
+int TiXmlElement::QueryIntAttribute( const char* name, int* ival ) const
+{
+	const TiXmlAttribute* attrib = attributeSet.Find( name );
+	if ( !attrib )
+		return TIXML_NO_ATTRIBUTE;
+	return attrib->QueryIntValue( ival );
+}
+
+
+int TiXmlElement::QueryIntAttribute( TiXmlAtom name, int* ival ) const
+{
+	const TiXmlAttribute* attrib = attributeSet.Find( name );
+	if ( !attrib )
+		return TIXML_NO_ATTRIBUTE;
+	return attrib->QueryIntValue( ival );
+}
+
+
+int TiXmlElement::QueryUnsignedAttribute( const char* name, unsigned* value ) const
+{
+	const TiXmlAttribute* node = attributeSet.Find( name );
+	if ( !node )
+		return TIXML_NO_ATTRIBUTE;
+
+	int ival = 0;
+	int result = node->QueryIntValue( &ival );
+	*value = (unsigned)ival;
+	return result;
+}
+
+
+int TiXmlElement::QueryBoolAttribute( const char* name, bool* bval ) const
+{
+	const TiXmlAttribute* node = attributeSet.Find( name );
+	if ( !node )
+		return TIXML_NO_ATTRIBUTE;
+	
+	int result = TIXML_WRONG_TYPE;
+	if (    StringEqual( node->Value(), "true", true, TIXML_ENCODING_UNKNOWN ) 
+		 || StringEqual( node->Value(), "yes", true, TIXML_ENCODING_UNKNOWN ) 
+		 || StringEqual( node->Value(), "1", true, TIXML_ENCODING_UNKNOWN ) ) 
+	{
+		*bval = true;
+		result = TIXML_SUCCESS;
+	}
+	else if (    StringEqual( node->Value(), "false", true, TIXML_ENCODING_UNKNOWN ) 
+			  || StringEqual( node->Value(), "no", true, TIXML_ENCODING_UNKNOWN ) 
+			  || StringEqual( node->Value(), "0", true, TIXML_ENCODING_UNKNOWN ) ) 
+	{
+		*bval = false;
+		result = TIXML_SUCCESS;
+	}
+	return result;
+}
+
+
+
+#ifdef TIXML_USE_STL
+int TiXmlElement::QueryIntAttribute( const std::string& name, int* ival ) const
+{
+	const TiXmlAttribute* attrib = attributeSet.Find( name );
+	if ( !attrib )
+		return TIXML_NO_ATTRIBUTE;
+	return attrib->QueryIntValue( ival );
+}
+#endif
+
+
+int TiXmlElement::QueryDoubleAttribute( const char* name, double* dval ) const
+{
+	const TiXmlAttribute* attrib = attributeSet.Find( name );
+	if ( !attrib )
+		return TIXML_NO_ATTRIBUTE;
+	return attrib->QueryDoubleValue( dval );
+}
+
+
+int TiXmlElement::QueryDoubleAttribute( TiXmlAtom name, double* dval ) const
+{
+	const TiXmlAttribute* attrib = attributeSet.Find( name );
+	if ( !attrib )
+		return TIXML_NO_ATTRIBUTE;
+	return attrib->QueryDoubleValue( dval );
+}
+
+
+#ifdef TIXML_USE_STL
+int TiXmlElement::QueryDoubleAttribute( const std::string& name, double* dval ) const
+{
+	const TiXmlAttribute* attrib = attributeSet.Find( name );
+	if ( !attrib )
+		return TIXML_NO_ATTRIBUTE;
+	return attrib->QueryDoubleValue( dval );
+}
+#endif
+
+
+void TiXmlElement::SetAttribute( const char * name, int val )
+{	
+	TiXmlAttribute* attrib = attributeSet.FindOrCreate( name );
+	if ( attrib ) {
+		attrib->SetIntValue( val );
+	}
+}
+
+
+#ifdef TIXML_USE_STL
+void TiXmlElement::SetAttribute( const std::string& name, int val )
+{	
+	TiXmlAttribute* attrib = attributeSet.FindOrCreate( name );
+	if ( attrib ) {
+		attrib->SetIntValue( val );
+	}
+}
+#endif
+
+
+void TiXmlElement::SetDoubleAttribute( const char * name, double val )
+{	
+	TiXmlAttribute* attrib = attributeSet.FindOrCreate( name );
+	if ( attrib ) {
+		attrib->SetDoubleValue( val );
+	}
+}
+
+
+#ifdef TIXML_USE_STL
+void TiXmlElement::SetDoubleAttribute( const std::string& name, double val )
+{	
+	TiXmlAttribute* attrib = attributeSet.FindOrCreate( name );
+	if ( attrib ) {
+		attrib->SetDoubleValue( val );
+	}
+}
+#endif 
+
+
+void TiXmlElement::SetAttribute( const char * cname, const char * cvalue )
+{
+	TiXmlAttribute* attrib = attributeSet.FindOrCreate( cname );
+	if ( attrib ) {
+		attrib->SetValue( cvalue );
+	}
+}
+
+
+#ifdef TIXML_USE_STL
+void TiXmlElement::SetAttribute( const std::string& _name, const std::string& _value )
+{
+	TiXmlAttribute* attrib = attributeSet.FindOrCreate( _name );
+	if ( attrib ) {
+		attrib->SetValue( _value );
+	}
+}
+#endif
+
+
+void TiXmlElement::WriteStartTag( TiXmlWriter* out ) const
+{
+	out->Put( '<' );
+	out->Write( value.c_str() );
+
+	const TiXmlAttribute* attrib;
+	for ( attrib = attributeSet.First(); attrib; attrib = attrib->Next() )
+	{
+		out->Put( ' ' );
+		attrib->Write( out, 0 );
+	}
+}
+
+
+void TiXmlElement::Write( TiXmlWriter* out, int depth ) const
+{
+	// The elements below this one are written by this loop as well, rather
+	// than each by its own call: 'node' goes down into the children of an
+	// element written on multiple lines, and back up to close it. A marking
+	// writer's begin offset waits in the element's source range till then.
+	const TiXmlNode* node = this;
+	for ( ;; )
+	{
+		const TiXmlElement* element = node->ToElement();
+		if ( element )
+		{
+			out->Indent( depth );
+
+			const int begin = out->Offset();
+			element->WriteStartTag( out );
+
+			// There are 3 different formatting approaches:
+			// 1) An element without children is printed as a <foo /> node
+			// 2) An element with only a text child is printed as <foo> text </foo>
+			// 3) An element with children is printed on multiple lines.
+			const TiXmlNode* child = element->firstChild;
+			if ( !child )
+			{
+				out->Write( " />", 3 );
+				if ( out->Marking() )
+					element->sourceTagEnd = out->Offset();
+			}
+			else if ( child == element->lastChild && child->ToText() )
+			{
+				out->Put( '>' );
+				if ( out->Marking() )
+					element->sourceTagEnd = out->Offset();
+				child->Write( out, depth + 1 );
+				out->Write( "</", 2 );
+				out->Write( element->value.c_str() );
+				out->Put( '>' );
+			}
+			else
+			{
+				out->Put( '>' );
+				if ( out->Marking() )
+				{
+					element->sourceTagEnd = out->Offset();
+					element->SetSourceRange( begin, -1 );
+				}
+
+				node = child;
+				++depth;
+				if ( !node->ToText() )
+				{
+					out->Put( '\n' );
+				}
+				continue;
+			}
+			out->Marked( element, begin );
+		}
+		else
+		{
+			node->Write( out, depth );
+		}
+
+		// On to the next sibling, closing the elements that have none left.
+		for ( ;; )
+		{
+			if ( node == this )
+				return;
+			if ( node->NextSibling() )
+			{
+				node = node->NextSibling();
+				if ( !node->ToText() )
+				{
+					out->Put( '\n' );
+				}
+				break;
+			}
+
+			const TiXmlElement* open = node->Parent()->ToElement();
+			--depth;
+			out->Put( '\n' );
+			out->Indent( depth );
+			out->Write( "</", 2 );
+			out->Write( open->value.c_str() );
+			out->Put( '>' );
+			out->Marked( open, open->sourceBegin );
+			node = open;
+		}
+	}
+}
+
+
+void TiXmlElement::CopyTo( TiXmlElement* target ) const
+{
+	// Clone the attributes, then clone the children.
+	CopyTagTo( target );
+	CopyChildrenTo( target );
+}
+
+
+void TiXmlElement::CopyTagTo( TiXmlElement* target ) const
+{
+	// superclass:
+	TiXmlNode::CopyTo( target );
+
+	const TiXmlAttribute* attribute = 0;
+	for(	attribute = attributeSet.First();
+	attribute;
+	attribute = attribute->Next() )
+	{
+		target->SetAttribute( attribute->Name(), attribute->Value() );
+	}
+}
+
+
+void TiXmlElement::MoveTo( TiXmlElement* target )
+{
+	TiXmlNode::MoveTo( target );
+
+	// Settle() has put every attribute on the heap; they change sets as they are.
+	for ( TiXmlAttribute* attribute = attributeSet.First(); attribute; attribute = attributeSet.First() )
+	{
+		attributeSet.Remove( attribute );
+		target->attributeSet.Add( attribute );
+	}
+}
+
+
+void TiXmlElement::SettleThis()
+{
+	TiXmlNode::SettleThis();
+
+	bool inArena = false;
+	TiXmlAttribute* attribute;
+	for ( attribute = attributeSet.First(); attribute; attribute = attribute->Next() )
+	{
+		attribute->Settle();
+		if ( InArena( attribute ) )
+			inArena = true;
+	}
+	if ( !inArena )
+		return;
+
+	// Going once round the set, from the front to the back, keeps the order.
+	TiXmlAttribute* last = attributeSet.Last();
+	do
+	{
+		attribute = attributeSet.First();
+		attributeSet.Remove( attribute );
+		TiXmlAttribute* moved = attribute;
+		if ( InArena( attribute ) )
+		{
+			moved = new TiXmlAttribute( attribute->Name(), attribute->Value() );
+			moved->location = attribute->location;
+			delete attribute;
+		}
+		attributeSet.Add( moved );
+	}
+	while ( attribute != last );
+}
+
+bool TiXmlElement::Accept( TiXmlVisitor* visitor ) const
+{
+	// The elements below this one are visited by this loop as well: 'node'
+	// goes down into an element the visitor enters, and back up to exit it.
+	// A false from a child stops its siblings, but its parent still exits.
+	const TiXmlNode* node = this;
+	for ( ;; )
+	{
+		bool result;
+		const TiXmlElement* element = node->ToElement();
+		if ( element )
+		{
+			if ( visitor->VisitEnter( *element, element->attributeSet.First() ) && element->firstChild )
+			{
+				node = element->firstChild;
+				continue;
+			}
+			result = visitor->VisitExit( *element );
+		}
+		else
+		{
+			result = node->Accept( visitor );
+		}
+
+		for ( ;; )
+		{
+			if ( node == this )
+				return result;
+			if ( result && node->NextSibling() )
+			{
+				node = node->NextSibling();
+				break;
+			}
+			node = node->Parent();
+			result = visitor->VisitExit( *node->ToElement() );
+		}
+	}
+}
+
+
+TiXmlNode* TiXmlElement::Clone() const
+{
+	TiXmlElement* clone = new TiXmlElement( Value() );
+	if ( !clone )
+		return 0;
+
+	CopyTo( clone );
+	return clone;
+}
+
+
+TiXmlNode* TiXmlElement::MoveClone()
+{
+	TiXmlElement* clone = new TiXmlElement( "" );
+	if ( !clone )
+		return 0;
+
+	MoveTo( clone );
+	return clone;
+}
+
+
+const char* TiXmlElement::GetText() const
+{
+	const TiXmlNode* child = this->FirstChild();
+	if ( child ) {
+		const TiXmlText* childText = child->ToText();
+		if ( childText ) {
+			return childText->Value();
+		}
+	}
+	return 0;
+}
+
+
+TiXmlDocument::TiXmlDocument() : TiXmlNode( TiXmlNode::TINYXML_DOCUMENT )
+{
+	tabsize = 4;
+	useMicrosoftBOM = false;
+	useArena = false;
+	arena = 0;
+	inSitu = false;
+	condense = TiXmlBase::IsWhiteSpaceCondensed();
+	parsingInSitu = false;
+	parsingFile = false;
+	reparsing = false;
+	sourceBuffer = 0;
+	sourceEncoding = TIXML_ENCODING_UNKNOWN;
+	fileSize = -1;
+	fileTime = 0;
+	ClearError();
+}
+
+TiXmlDocument::TiXmlDocument( const char * documentName ) : TiXmlNode( TiXmlNode::TINYXML_DOCUMENT )
+{
+	tabsize = 4;
+	useMicrosoftBOM = false;
+	useArena = false;
+	arena = 0;
+	inSitu = false;
+	condense = TiXmlBase::IsWhiteSpaceCondensed();
+	parsingInSitu = false;
+	parsingFile = false;
+	reparsing = false;
+	sourceBuffer = 0;
+	sourceEncoding = TIXML_ENCODING_UNKNOWN;
+	fileSize = -1;
+	fileTime = 0;
+	value = documentName;
+	ClearError();
+}
+
+
+#ifdef TIXML_USE_STL
+TiXmlDocument::TiXmlDocument( const std::string& documentName ) : TiXmlNode( TiXmlNode::TINYXML_DOCUMENT )
+{
+	tabsize = 4;
+	useMicrosoftBOM = false;
+	useArena = false;
+	arena = 0;
+	inSitu = false;
+	condense = TiXmlBase::IsWhiteSpaceCondensed();
+	parsingInSitu = false;
+	parsingFile = false;
+	reparsing = false;
+	sourceBuffer = 0;
+	sourceEncoding = TIXML_ENCODING_UNKNOWN;
+	fileSize = -1;
+	fileTime = 0;
+    value = documentName;
+	ClearError();
+}
+#endif
+
+
+TiXmlDocument::TiXmlDocument( const TiXmlDocument& copy ) : TiXmlNode( TiXmlNode::TINYXML_DOCUMENT )
+{
+	arena = 0;
+	parsingInSitu = false;
+	parsingFile = false;
+	reparsing = false;
+	sourceBuffer = 0;
+	sourceEncoding = TIXML_ENCODING_UNKNOWN;
+	fileSize = -1;
+	fileTime = 0;
+	copy.CopyTo( this );
+}
+
+
+TiXmlDocument& TiXmlDocument::operator=( const TiXmlDocument& copy )
+{
+	Clear();
+	copy.CopyTo( this );
+	return *this;
+}
+
+
+#ifdef TIXML_RVALUE_REFS
+TiXmlDocument::TiXmlDocument( TiXmlDocument&& move ) : TiXmlNode( TiXmlNode::TINYXML_DOCUMENT )
+{
+	arena = 0;
+	parsingInSitu = false;
+	parsingFile = false;
+	reparsing = false;
+	sourceBuffer = 0;
+	sourceEncoding = TIXML_ENCODING_UNKNOWN;
+	fileSize = -1;
+	fileTime = 0;
+	move.MoveTo( this );
+}
+
+
+TiXmlDocument& TiXmlDocument::operator=( TiXmlDocument&& move )
+{
+	if ( &move != this )
+	{
+		Clear();
+		move.MoveTo( this );
+	}
+	return *this;
+}
+#endif
+
+
+TiXmlDocument::~TiXmlDocument()
+{
+	// The children may live in the arena or refer to the in-situ buffer,
+	// so they have to go first.
+	Clear();
+	delete arena;
+}
+
+
+void TiXmlDocument::Clear()
+{
+	TiXmlNode::Clear();
+	SetSourceRange( -1, -1 );
+	edits = 0;
+	fileSize = -1;
+	lineIndex.Clear();
+	delete [] sourceBuffer;
+	sourceBuffer = 0;
+	sourceMap.Close();
+	if ( arena )
+		arena->Reset();
+}
+
+
+bool TiXmlDocument::LoadFile( TiXmlEncoding encoding )
+{
+	return LoadFile( Value(), encoding );
+}
+
+
+bool TiXmlDocument::SaveFile() const
+{
+	return SaveFile( Value() );
+}
+
+bool TiXmlDocument::LoadFile( const char* _filename, TiXmlEncoding encoding )
+{
+	TIXML_STRING filename( _filename );
+	value = filename;
+
+	// Parse the file where it lies, if it can be mapped. An in-situ DOM, or the
+	// line index, keeps using the mapping, which Clear() releases.
+	Clear();
+	location.Clear();
+	if ( sourceMap.Open( value.c_str(), inSitu ) )
+	{
+		ParseFile( sourceMap.Data(), encoding );
+		if ( !inSitu && lineIndex.Text() != sourceMap.Data() )
+			sourceMap.Close();
+		if ( !Error() )
+			StampSource();
+		return !Error();
+	}
+
+	// reading in binary mode so that tinyxml can normalize the EOL
+	FILE* file = TiXmlFOpen( value.c_str (), "rb" );	
+
+	if ( file )
+	{
+		bool result = LoadFile( file, encoding );
+		fclose( file );
+		if ( result )
+			StampSource();
+		return result;
+	}
+	else
+	{
+		SetError( TIXML_ERROR_OPENING_FILE, 0, 0, TIXML_ENCODING_UNKNOWN );
+		return false;
+	}
+}
+
+bool TiXmlDocument::LoadFile( FILE* file, TiXmlEncoding encoding )
+{
+	if ( !file ) 
+	{
+		SetError( TIXML_ERROR_OPENING_FILE, 0, 0, TIXML_ENCODING_UNKNOWN );
+		return false;
+	}
+
+	// Delete the existing data:
+	Clear();
+	location.Clear();
+
+	// Get the file size, so we can pre-allocate the string. HUGE speed impact.
+	long length = 0;
+	fseek( file, 0, SEEK_END );
+	length = ftell( file );
+	fseek( file, 0, SEEK_SET );
+
+	// Strange case, but good to handle up front.
+	if ( length <= 0 )
+	{
+		SetError( TIXML_ERROR_DOCUMENT_EMPTY, 0, 0, TIXML_ENCODING_UNKNOWN );
+		return false;
+	}
+
+	// Subtle bug here. TinyXml did use fgets. But from the XML spec:
+	// 2.11 End-of-Line Handling
+	// <snip>
+	// <quote>
+	// ...the XML processor MUST behave as if it normalized all line breaks in external 
+	// parsed entities (including the document entity) on input, before parsing, by translating 
+	// both the two-character sequence #xD #xA and any #xD that is not followed by #xA to 
+	// a single #xA character.
+	// </quote>
+	//
+	// It is not clear fgets does that, and certainly isn't clear it works cross platform. 
+	// Generally, you expect fgets to translate from the convention of the OS to the c/unix
+	// convention, and not work generally.
+
+	/*
+	while( fgets( buf, sizeof(buf), file ) )
+	{
+		data += buf;
+	}
+	*/
+
+	char* buf = new char[ length+1 ];
+	buf[0] = 0;
+
+	if ( fread( buf, length, 1, file ) != 1 ) {
+		delete [] buf;
+		SetError( TIXML_ERROR_OPENING_FILE, 0, 0, TIXML_ENCODING_UNKNOWN );
+		return false;
+	}
+
+	// New lines are normalized (see comment above) by the parser, which reads
+	// CR+LF and CR as LF as it goes. That saves a pass over the whole buffer,
+	// and lets a mapped file be parsed without a copy.
+	//
+	// Wikipedia:
+	// Systems based on ASCII or a compatible character set use either LF  (Line feed, '\n', 0x0A, 10 in decimal) or 
+	// CR (Carriage return, '\r', 0x0D, 13 in decimal) individually, or CR followed by LF (CR+LF, 0x0D 0x0A)...
+	//		* LF:    Multics, Unix and Unix-like systems (GNU/Linux, AIX, Xenix, Mac OS X, FreeBSD, etc.), BeOS, Amiga, RISC OS, and others
+    //		* CR+LF: DEC RT-11 and most other early non-Unix, non-IBM OSes, CP/M, MP/M, DOS, OS/2, Microsoft Windows, Symbian OS
+    //		* CR:    Commodore 8-bit machines, Apple II family, Mac OS up to version 9 and OS-9
+	buf[length] = 0;
+
+	ParseFile( buf, encoding );
+
+	// An in-situ DOM, or the line index, refers into the buffer; Clear()
+	// deletes it then.
+	if ( inSitu || lineIndex.Text() == buf )
+		sourceBuffer = buf;
+	else
+		delete [] buf;
+	return !Error();
+}
+
+
+bool TiXmlDocument::SaveFile( const char * filename ) const
+{
+	// The old c stuff lives on...
+	FILE* fp = TiXmlFOpen( filename, "w" );
+	if ( fp )
+	{
+		bool result = SaveFile( fp );
+		fclose( fp );
+		return result;
+	}
+	return false;
+}
+
+
+bool TiXmlDocument::SaveFile( FILE* fp ) const
+{
+	TiXmlWriter out( fp );
+	if ( useMicrosoftBOM ) 
+	{
+		const char utf8Bom[] = { (char)0xefU, (char)0xbbU, (char)0xbfU };
+		out.Write( utf8Bom, 3 );
+	}
+	Write( &out, 0 );
+	out.Flush();
+	return (ferror(fp) == 0);
+}
+
+
+/*	A cache file (see TiXmlDocument::SaveCache()) is a header, the node table,
+	the attribute table and the string pool, in that order. The tables are in
+	document order, and each node names its parent by index, so the tree is
+	built again in one pass. Strings are an offset and a length into the pool,
+	where each is followed by a terminator. The file is padded to an odd size,
+	so it never fills its last page and can be mapped (see TiXmlFileMap).
+*/
+struct TiXmlCacheStamp
+{
+	unsigned long long	size;
+	long long			time;
+	unsigned long long	hash;
+};
+
+struct TiXmlCacheHeader
+{
+	char				magic[8];
+	unsigned int		version;
+	unsigned int		byteOrder;		// CACHE_BYTE_ORDER as the writer stored it
+	unsigned int		recordSizes;	// of the header and the table records
+	unsigned int		encoding;
+	TiXmlCacheStamp		source;
+	unsigned int		flags;
+	int					tabSize;
+	unsigned int		nodeCount;
+	unsigned int		attributeCount;
+	unsigned int		stringBytes;
+	unsigned int		reserved;
+};
+
+struct TiXmlCacheNode
+{
+	unsigned char		type;			// a TiXmlNode::NodeType
+	unsigned char		cdata;
+	unsigned short		reserved;
+	unsigned int		parent;			// index, or CACHE_NO_PARENT for the document
+	unsigned int		value;
+	unsigned int		valueLength;
+	unsigned int		firstAttribute;	// version, encoding and standalone for a declaration
+	unsigned int		attributeCount;
+	int					row;
+	int					col;
+};
+
+struct TiXmlCacheAttribute
+{
+	unsigned int		name;
+	unsigned int		nameLength;
+	unsigned int		value;
+	unsigned int		valueLength;
+	int					row;
+	int					col;
+};
+
+static const char CACHE_MAGIC[8] = { 'T', 'i', 'X', 'm', 'l', 'D', 'O', 'M' };
+static const unsigned int CACHE_VERSION = 1;
+static const unsigned int CACHE_BYTE_ORDER = 0x01020304;
+static const unsigned int CACHE_RECORD_SIZES = ( sizeof( TiXmlCacheHeader ) << 16 ) | ( sizeof( TiXmlCacheNode ) << 8 ) | sizeof( TiXmlCacheAttribute );
+static const unsigned int CACHE_NO_PARENT = 0xffffffff;
+static const unsigned int CACHE_CONDENSE = 1;		// flags
+static const unsigned int CACHE_BOM = 2;
+
+
+// A quick hash to tell whether a file has changed. It is not meant to stand
+// up to anyone making collisions on purpose.
+static unsigned long long HashBytes( const char* p, size_t length )
+{
+	const unsigned long long prime = 0x100000001b3ULL;
+	unsigned long long h = 0xcbf29ce484222325ULL ^ length;
+	for ( ; length >= 8; p += 8, length -= 8 )
+	{
+		unsigned long long word;
+		memcpy( &word, p, 8 );
+		h = ( h ^ word ) * prime;
+		h ^= h >> 32;
+	}
+	for ( ; length; ++p, --length )
+		h = ( h ^ (unsigned char) *p ) * prime;
+	return h ^ ( h >> 29 );
+}
+
+
+// The size and modification time of a file.
+static bool StatFile( const char* filename, TiXmlCacheStamp* stamp )
+{
+	#if defined(_WIN32)
+		WIN32_FILE_ATTRIBUTE_DATA status;
+		if ( !GetFileAttributesExA( filename, GetFileExInfoStandard, &status ) )
+			return false;
+		stamp->size = ( (unsigned long long) status.nFileSizeHigh << 32 ) | status.nFileSizeLow;
+		stamp->time = (long long)( ( (unsigned long long) status.ftLastWriteTime.dwHighDateTime << 32 ) | status.ftLastWriteTime.dwLowDateTime );
+	#else
+		struct stat status;
+		if ( stat( filename, &status ) != 0 || !S_ISREG( status.st_mode ) )
+			return false;
+		stamp->size = (unsigned long long) status.st_size;
+		stamp->time = (long long) status.st_mtime;
+	#endif
+	return true;
+}
+
+
+// The size, modification time and hash of a file.
+static bool StampFile( const char* filename, TiXmlCacheStamp* stamp )
+{
+	if ( !StatFile( filename, stamp ) )
+		return false;
+
+	TiXmlFileMap map;
+	if ( map.Open( filename ) )
+	{
+		stamp->hash = HashBytes( map.Data(), map.Size() );
+		return map.Size() == stamp->size;
+	}
+
+	FILE* file = TiXmlFOpen( filename, "rb" );
+	if ( !file )
+		return false;
+	size_t length = (size_t) stamp->size;
+	char* buf = new char[ length + 1 ];
+	bool read = length == stamp->size && fread( buf, 1, length + 1, file ) == length;
+	if ( read )
+		stamp->hash = HashBytes( buf, length );
+	delete [] buf;
+	fclose( file );
+	return read;
+}
+
+
+// The string pool of a cache being written. Each distinct string is kept once.
+class TiXmlCachePool
+{
+public:
+	TiXmlCachePool() : slots( 0 ), mask( 0 ), count( 0 )	{ Rehash( 1024 ); }
+	~TiXmlCachePool()										{ delete [] slots; }
+
+	// The offset of 'text' in the pool, where it is added if it isn't yet.
+	unsigned int Intern( const char* text, size_t length )
+	{
+		size_t i = (size_t) HashBytes( text, length ) & mask;
+		for ( ; slots[i].length; i = ( i + 1 ) & mask )
+		{
+			if (    slots[i].length == length + 1
+				 && memcmp( bytes.c_str() + slots[i].offset, text, length ) == 0 )
+				return slots[i].offset;
+		}
+
+		const unsigned int offset = (unsigned int) bytes.length();
+		slots[i].offset = offset;
+		slots[i].length = (unsigned int)( length + 1 );
+		bytes.append( text, length );
+		bytes += '\0';
+		if ( ++count * 2 > mask )
+			Rehash( 2 * ( mask + 1 ) );
+		return offset;
+	}
+
+	const TIXML_STRING& Bytes() const	{ return bytes; }
+
+private:
+	TiXmlCachePool( const TiXmlCachePool& );	// not implemented.
+	void operator=( const TiXmlCachePool& );	// not allowed.
+
+	struct Slot
+	{
+		unsigned int offset;
+		unsigned int length;	// with the terminator; 0 for an empty slot
+	};
+
+	void Rehash( size_t size )
+	{
+		Slot* old = slots;
+		size_t oldSize = old ? mask + 1 : 0;
+		slots = new Slot[ size ];
+		memset( slots, 0, size * sizeof( Slot ) );
+		mask = size - 1;
+		for ( size_t j = 0; j < oldSize; ++j )
+		{
+			if ( !old[j].length )
+				continue;
+			size_t i = (size_t) HashBytes( bytes.c_str() + old[j].offset, old[j].length - 1 ) & mask;
+			while ( slots[i].length )
+				i = ( i + 1 ) & mask;
+			slots[i] = old[j];
+		}
+		delete [] old;
+	}
+
+	TIXML_STRING bytes;
+	Slot* slots;
+	size_t mask;
+	size_t count;
+};
+
+
+// The tables of a cache being written.
+struct TiXmlCacheTables
+{
+	TiXmlCacheTables() : nodeCount( 0 ), attributeCount( 0 ) {}
+
+	void AddAttribute( const char* name, size_t nameLength, const char* value, size_t valueLength, const TiXmlBase* base )
+	{
+		TiXmlCacheAttribute record;
+		memset( &record, 0, sizeof( record ) );
+		record.name = pool.Intern( name, nameLength );
+		record.nameLength = (unsigned int) nameLength;
+		record.value = pool.Intern( value, valueLength );
+		record.valueLength = (unsigned int) valueLength;
+		record.row = base ? base->Row() - 1 : -1;
+		record.col = base ? base->Column() - 1 : -1;
+		attributes.append( reinterpret_cast< const char* >( &record ), sizeof( record ) );
+		++attributeCount;
+	}
+
+	TiXmlCachePool pool;
+	TIXML_STRING nodes;
+	TIXML_STRING attributes;
+	unsigned int nodeCount;
+	unsigned int attributeCount;
+};
+
+
+// Add the nodes below 'top' in document order, in one loop for any depth.
+static void AddCacheNodes( const TiXmlNode* top, TiXmlCacheTables* tables )
+{
+	unsigned int parentIndex = CACHE_NO_PARENT;
+	const TiXmlNode* node = top->FirstChild();
+	while ( node )
+	{
+		TiXmlCacheNode record;
+		memset( &record, 0, sizeof( record ) );
+		record.type = (unsigned char) node->Type();
+		record.parent = parentIndex;
+		record.value = tables->pool.Intern( node->ValueTStr().c_str(), node->ValueTStr().length() );
+		record.valueLength = (unsigned int) node->ValueTStr().length();
+		record.firstAttribute = tables->attributeCount;
+		record.row = node->Row() - 1;
+		record.col = node->Column() - 1;
+
+		if ( const TiXmlElement* element = node->ToElement() )
+		{
+			for ( const TiXmlAttribute* attribute = element->FirstAttribute(); attribute; attribute = attribute->Next() )
+				tables->AddAttribute( attribute->Name(), attribute->NameTStr().length(), attribute->Value(), strlen( attribute->Value() ), attribute );
+		}
+		else if ( const TiXmlDeclaration* declaration = node->ToDeclaration() )
+		{
+			tables->AddAttribute( "", 0, declaration->Version(), strlen( declaration->Version() ), 0 );
+			tables->AddAttribute( "", 0, declaration->Encoding(), strlen( declaration->Encoding() ), 0 );
+			tables->AddAttribute( "", 0, declaration->Standalone(), strlen( declaration->Standalone() ), 0 );
+		}
+		else if ( const TiXmlText* text = node->ToText() )
+		{
+			record.cdata = text->CDATA() ? 1 : 0;
+		}
+		record.attributeCount = tables->attributeCount - record.firstAttribute;
+
+		unsigned int index = tables->nodeCount++;
+		tables->nodes.append( reinterpret_cast< const char* >( &record ), sizeof( record ) );
+
+		if ( node->FirstChild() )
+		{
+			parentIndex = index;
+			node = node->FirstChild();
+			continue;
+		}
+		// Going back up, each parent's record has the index of its own parent.
+		while ( !node->NextSibling() && node->Parent() != top )
+		{
+			node = node->Parent();
+			memcpy( &record, tables->nodes.c_str() + parentIndex * sizeof( record ), sizeof( record ) );
+			parentIndex = record.parent;
+		}
+		node = node->NextSibling();
+	}
+}
+
+
+// Makes 'str' the pool string of 'length' chars at 'offset', if there is one.
+static bool ReferToCache( TIXML_STRING* str, const char* pool, size_t poolSize, unsigned int offset, unsigned int length )
+{
+	if ( offset >= poolSize || length >= poolSize - offset || pool[ offset + length ] != 0 )
+		return false;
+
+	#ifdef TIXML_USE_STL
+	str->assign( pool + offset, length );
+	#else
+	str->refer( pool + offset, length );
+	#endif
+	return true;
+}
+
+
+bool TiXmlDocument::LoadCachedFile( const char* _filename, const char* cacheFile, TiXmlEncoding encoding )
+{
+	TIXML_STRING filename( _filename );		// may be Value(), which is about to change
+
+	// The stamp is taken first, so a file that changes while it loads leaves
+	// a cache that is stale rather than wrong.
+	TiXmlCacheStamp stamp;
+	bool stamped = StampFile( filename.c_str(), &stamp );
+	if ( stamped && ReadCache( filename.c_str(), cacheFile, stamp, encoding ) )
+		return true;
+
+	if ( !LoadFile( filename.c_str(), encoding ) )
+		return false;
+	if ( stamped )
+		WriteCache( cacheFile, stamp, encoding );
+	return true;
+}
+
+
+bool TiXmlDocument::SaveCache( const char* cacheFile, TiXmlEncoding encoding ) const
+{
+	TiXmlCacheStamp stamp;
+	return StampFile( Value(), &stamp ) && WriteCache( cacheFile, stamp, encoding );
+}
+
+
+bool TiXmlDocument::LoadCache( const char* _filename, const char* cacheFile, TiXmlEncoding encoding )
+{
+	TIXML_STRING filename( _filename );
+
+	TiXmlCacheStamp stamp;
+	if ( StampFile( filename.c_str(), &stamp ) )
+		return ReadCache( filename.c_str(), cacheFile, stamp, encoding );
+
+	Clear();
+	location.Clear();
+	ClearError();
+	value = filename;
+	return false;
+}
+
+
+bool TiXmlDocument::WriteCache( const char* cacheFile, const TiXmlCacheStamp& stamp, TiXmlEncoding encoding ) const
+{
+	if ( Error() )
+		return false;
+
+	TiXmlCacheTables tables;
+	ResolveLocations();		// at once, rather than each Row() looking for this document
+	AddCacheNodes( this, &tables );
+
+	TiXmlCacheHeader header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, CACHE_MAGIC, sizeof( header.magic ) );
+	header.version = CACHE_VERSION;
+	header.byteOrder = CACHE_BYTE_ORDER;
+	header.recordSizes = CACHE_RECORD_SIZES;
+	header.encoding = (unsigned int) encoding;
+	header.source = stamp;
+	header.flags = ( IsWhiteSpaceCondensed() ? CACHE_CONDENSE : 0 ) | ( useMicrosoftBOM ? CACHE_BOM : 0 );
+	header.tabSize = tabsize;
+	header.nodeCount = tables.nodeCount;
+	header.attributeCount = tables.attributeCount;
+	header.stringBytes = (unsigned int) tables.pool.Bytes().length();
+
+	FILE* file = TiXmlFOpen( cacheFile, "wb" );
+	if ( !file )
+		return false;
+
+	const size_t size = sizeof( header ) + tables.nodes.length() + tables.attributes.length() + tables.pool.Bytes().length();
+	fwrite( &header, sizeof( header ), 1, file );
+	fwrite( tables.nodes.data(), 1, tables.nodes.length(), file );
+	fwrite( tables.attributes.data(), 1, tables.attributes.length(), file );
+	fwrite( tables.pool.Bytes().data(), 1, tables.pool.Bytes().length(), file );
+	if ( size % 2 == 0 )
+		fputc( 0, file );
+
+	bool written = ferror( file ) == 0;
+	if ( fclose( file ) != 0 )
+		written = false;
+	if ( !written )
+		remove( cacheFile );
+	return written;
+}
+
+
+bool TiXmlDocument::ReadCache( const char* filename, const char* cacheFile, const TiXmlCacheStamp& stamp, TiXmlEncoding encoding )
+{
+	Clear();
+	location.Clear();
+	ClearError();
+	value = filename;
+
+	// The DOM refers to the cache, so it is kept like the text of an in-situ
+	// load: mapped (writable, so nothing can fault on it) or read into sourceBuffer.
+	const char* data = 0;
+	size_t size = 0;
+	if ( sourceMap.Open( cacheFile, true ) )
+	{
+		data = sourceMap.Data();
+		size = sourceMap.Size();
+	}
+	else
+	{
+		FILE* file = TiXmlFOpen( cacheFile, "rb" );
+		if ( !file )
+			return false;
+		fseek( file, 0, SEEK_END );
+		long length = ftell( file );
+		fseek( file, 0, SEEK_SET );
+		if ( length > 0 )
+		{
+			sourceBuffer = new char[ length ];
+			if ( fread( sourceBuffer, length, 1, file ) == 1 )
+			{
+				data = sourceBuffer;
+				size = (size_t) length;
+			}
+		}
+		fclose( file );
+	}
+
+	const TiXmlCacheHeader* header = reinterpret_cast< const TiXmlCacheHeader* >( data );
+	if (    size < sizeof( TiXmlCacheHeader )
+		 || memcmp( header->magic, CACHE_MAGIC, sizeof( header->magic ) ) != 0
+		 || header->version != CACHE_VERSION
+		 || header->byteOrder != CACHE_BYTE_ORDER
+		 || header->recordSizes != CACHE_RECORD_SIZES
+		 || header->encoding != (unsigned int) encoding
+		 || header->source.size != stamp.size
+		 || header->source.time != stamp.time
+		 || header->source.hash != stamp.hash
+		 || ( ( header->flags & CACHE_CONDENSE ) != 0 ) != IsWhiteSpaceCondensed()
+		 || header->tabSize != tabsize )
+	{
+		Clear();
+		return false;
+	}
+
+	const unsigned long long expected =   sizeof( TiXmlCacheHeader )
+										+ (unsigned long long) header->nodeCount * sizeof( TiXmlCacheNode )
+										+ (unsigned long long) header->attributeCount * sizeof( TiXmlCacheAttribute )
+										+ header->stringBytes;
+	if ( ( size != expected && size != expected + 1 ) || header->stringBytes == 0 )
+	{
+		Clear();
+		return false;
+	}
+
+	const TiXmlCacheNode* nodeTable = reinterpret_cast< const TiXmlCacheNode* >( header + 1 );
+	const TiXmlCacheAttribute* attributeTable = reinterpret_cast< const TiXmlCacheAttribute* >( nodeTable + header->nodeCount );
+	const char* pool = reinterpret_cast< const char* >( attributeTable + header->attributeCount );
+	const size_t poolSize = header->stringBytes;
+	const unsigned int nodeCount = header->nodeCount;
+	const unsigned int attributeCount = header->attributeCount;
+
+	// One block holds the whole DOM, unless the arena already has its own.
+	if ( !arena )
+	{
+		size_t estimate = nodeCount * ( sizeof( TiXmlElement ) + 2 * sizeof( double ) ) + attributeCount * ( sizeof( TiXmlAttribute ) + 2 * sizeof( double ) );
+		arena = new TiXmlArena( estimate > (size_t) TiXmlArena::DEFAULT_BLOCK_SIZE ? estimate : (size_t) TiXmlArena::DEFAULT_BLOCK_SIZE );
+	}
+
+	// Checked record by record as the tree is built; a damaged cache is dropped.
+	TiXmlNode** nodes = new TiXmlNode*[ nodeCount ? nodeCount : 1 ];
+	bool valid = true;
+	{
+		TiXmlArena::Scope scope( arena );
+
+		for ( unsigned int i = 0; valid && i < nodeCount; ++i )
+		{
+			const TiXmlCacheNode& record = nodeTable[i];
+			TiXmlNode* parent = this;
+			if ( record.parent != CACHE_NO_PARENT )
+			{
+				if ( record.parent >= i || !nodes[ record.parent ]->ToElement() )
+				{
+					valid = false;
+					break;
+				}
+				parent = nodes[ record.parent ];
+			}
+			if (    record.firstAttribute > attributeCount
+				 || record.attributeCount > attributeCount - record.firstAttribute )
+			{
+				valid = false;
+				break;
+			}
+
+			TiXmlNode* node = 0;
+			switch ( record.type )
+			{
+				case TINYXML_ELEMENT:		node = new TiXmlElement( "" );			break;
+				case TINYXML_COMMENT:		node = new TiXmlComment();				break;
+				case TINYXML_UNKNOWN:		node = new TiXmlUnknown();				break;
+				case TINYXML_TEXT:			node = new TiXmlText( "" );				break;
+				case TINYXML_DECLARATION:	node = new TiXmlDeclaration();			break;
+				default:					valid = false;							break;
+			}
+			if ( !node )
+				break;
+
+			node->location.row = record.row;
+			node->location.col = record.col;
+			parent->LinkEndChild( node );
+			nodes[i] = node;
+			if ( !ReferToCache( &node->value, pool, poolSize, record.value, record.valueLength ) )
+			{
+				valid = false;
+				break;
+			}
+
+			const TiXmlCacheAttribute* attributes = attributeTable + record.firstAttribute;
+			if ( TiXmlElement* element = node->ToElement() )
+			{
+				element->atom = names.Intern( element->value.c_str(), element->value.length() );
+				for ( unsigned int j = 0; valid && j < record.attributeCount; ++j )
+				{
+					TiXmlAttribute* attribute = new TiXmlAttribute();
+					attribute->location.row = attributes[j].row;
+					attribute->location.col = attributes[j].col;
+					attribute->SetDocument( this );
+					valid =    ReferToCache( &attribute->name, pool, poolSize, attributes[j].name, attributes[j].nameLength )
+							&& ReferToCache( &attribute->value, pool, poolSize, attributes[j].value, attributes[j].valueLength );
+					if ( valid )
+					{
+						attribute->atom = names.Intern( attribute->name.c_str(), attribute->name.length() );
+						valid = !element->attributeSet.Find( attribute->atom );
+					}
+					if ( valid )
+						element->attributeSet.Add( attribute );
+					else
+						delete attribute;
+				}
+			}
+			else if ( TiXmlDeclaration* declaration = node->ToDeclaration() )
+			{
+				valid =    record.attributeCount == 3
+						&& ReferToCache( &declaration->version, pool, poolSize, attributes[0].value, attributes[0].valueLength )
+						&& ReferToCache( &declaration->encoding, pool, poolSize, attributes[1].value, attributes[1].valueLength )
+						&& ReferToCache( &declaration->standalone, pool, poolSize, attributes[2].value, attributes[2].valueLength );
+			}
+			else
+			{
+				valid = record.attributeCount == 0;
+				if ( TiXmlText* text = node->ToText() )
+					text->SetCDATA( record.cdata != 0 );
+			}
+		}
+	}
+	delete [] nodes;
+
+	if ( !valid )
+	{
+		Clear();
+		return false;
+	}
+	useMicrosoftBOM = ( header->flags & CACHE_BOM ) != 0;
+	return true;
+}
+
+
+/*	A change SaveChanges() writes: the bytes [begin, end) of the file become
+	'text', which is 'node' written whole, or only its start tag. The patches
+	are in document order, and don't overlap.
+*/
+struct TiXmlSourcePatch
+{
+	TiXmlNode*		node;
+	bool			tag;
+	int				begin;
+	int				end;
+	int				marked;		// where a whole node began in the output that marked it
+	int				shift;		// the growth of this patch and those before it
+	TIXML_STRING	text;
+};
+
+
+// Where offset 'at' of the file goes once the patches are written.
+static int PatchedOffset( const TiXmlSourcePatch* patches, size_t count, int at )
+{
+	// The last patch that ends at or before 'at' moves it.
+	size_t low = 0;
+	size_t high = count;
+	while ( low < high )
+	{
+		const size_t mid = ( low + high ) / 2;
+		if ( patches[ mid ].end <= at )
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return low ? at + patches[ low - 1 ].shift : at;
+}
+
+
+/*	Whether the patch fits the bytes it replaces: an element can be padded
+	with spaces before the '>' or "/>" that ends it, and text whose white
+	space is condensed after its last char. With 'pad' set, pad it.
+*/
+static bool FitPatch( TiXmlSourcePatch* patch, bool condense, bool pad )
+{
+	const size_t length = patch->text.length();
+	const size_t room = (size_t)( patch->end - patch->begin );
+	if ( length >= room )
+		return length == room;
+
+	size_t at;
+	const TiXmlText* text = patch->node->ToText();
+	if ( patch->node->ToElement() )
+		at = ( !patch->tag && !patch->node->FirstChild() ) ? length - 2 : length - 1;
+	else if ( text && !text->CDATA() && condense )
+		at = length;
+	else
+		return false;
+
+	if ( pad )
+	{
+		TIXML_STRING padded;
+		padded.reserve( room );
+		padded.append( patch->text.c_str(), at );
+		while ( padded.length() < at + room - length )
+			padded += ' ';
+		padded.append( patch->text.c_str() + at, length - at );
+		patch->text.swap( padded );
+	}
+	return true;
+}
+
+
+static bool TruncateFile( FILE* file, long long size )
+{
+	#if defined(_WIN32)
+		return _chsize_s( _fileno( file ), size ) == 0;
+	#else
+		return ftruncate( fileno( file ), (off_t) size ) == 0;
+	#endif
+}
+
+
+bool TiXmlDocument::SaveChanges()
+{
+	TiXmlCacheStamp stamp;
+	if (    sourceBegin < 0 || fileSize < 0 || ( edits & EDITED )
+		 || !StatFile( value.c_str(), &stamp )
+		 || (long long) stamp.size != fileSize || stamp.time != fileTime )
+	{
+		return SaveWhole();
+	}
+	if ( !edits )
+		return true;
+
+	// Find the changed nodes, in document order. A node written whole takes
+	// along whatever changed below it.
+	struct Change
+	{
+		TiXmlNode* node;
+		bool tag;
+	};
+	Change* changes = 0;
+	size_t count = 0;
+	size_t capacity = 0;
+	TiXmlNode* node = firstChild;
+	while ( node )
+	{
+		TiXmlNode* below = 0;
+		if ( node->edits )
+		{
+			if ( node->sourceBegin < 0 )
+			{
+				delete [] changes;
+				return SaveWhole();
+			}
+			const TiXmlElement* element = node->ToElement();
+			if ( ( node->edits & EDITED_TAG ) && element && element->sourceTagEnd >= node->sourceEnd )
+				node->edits |= EDITED;		// the start tag is all of it
+			if ( node->edits & ( EDITED | EDITED_TAG ) )
+			{
+				if ( count == capacity )
+				{
+					capacity = capacity ? 2 * capacity : 16;
+					Change* grown = new Change[ capacity ];
+					if ( count )
+						memcpy( grown, changes, count * sizeof( Change ) );
+					delete [] changes;
+					changes = grown;
+				}
+				changes[ count ].node = node;
+				changes[ count ].tag = !( node->edits & EDITED );
+				++count;
+			}
+			if ( !( node->edits & EDITED ) && ( node->edits & EDITED_BELOW ) )
+				below = node->firstChild;
+		}
+		if ( below )
+		{
+			node = below;
+			continue;
+		}
+		while ( node != this && !node->next )
+			node = node->parent;
+		node = ( node != this ) ? node->next : 0;
+	}
+
+	// Write each one out. A whole node marks its new source ranges, relative
+	// to the output, on the way.
+	TiXmlSourcePatch* patches = new TiXmlSourcePatch[ count ];
+	for ( size_t i = 0; i < count; ++i )
+	{
+		TiXmlSourcePatch& patch = patches[i];
+		patch.node = changes[i].node;
+		patch.tag = changes[i].tag;
+		patch.begin = patch.node->sourceBegin;
+		if ( patch.tag )
+		{
+			const TiXmlElement* element = patch.node->ToElement();
+			patch.end = element->sourceTagEnd;
+			patch.marked = 0;
+			TiXmlWriter out( &patch.text );
+			element->WriteStartTag( &out );
+			out.Put( '>' );
+		}
+		else
+		{
+			patch.end = patch.node->sourceEnd;
+			int depth = 0;
+			for ( const TiXmlNode* ancestor = patch.node->parent; ancestor != this; ancestor = ancestor->parent )
+				++depth;
+			TIXML_STRING written;
+			{
+				TiXmlWriter out( &written );
+				out.SetMarking( 0 );
+				patch.node->Write( &out, depth );
+			}
+			patch.marked = patch.node->sourceBegin;
+			patch.text.assign( written.c_str() + patch.node->sourceBegin, patch.node->sourceEnd - patch.node->sourceBegin );
+		}
+	}
+	delete [] changes;
+
+	// Where every patch fits its bytes, only those are written. Otherwise
+	// the file is written again from the first one on.
+	bool fits = true;
+	for ( size_t i = 0; i < count && fits; ++i )
+		fits = FitPatch( &patches[i], condense, false );
+	for ( size_t i = 0; i < count; ++i )
+	{
+		if ( fits )
+			FitPatch( &patches[i], condense, true );
+		patches[i].shift = ( i ? patches[ i-1 ].shift : 0 ) + (int) patches[i].text.length() - ( patches[i].end - patches[i].begin );
+	}
+
+	ReleaseSource();
+	FILE* fp = TiXmlFOpen( value.c_str(), "r+b" );
+	bool result = fp != 0;
+	if ( fp && fits )
+	{
+		for ( size_t i = 0; i < count && result; ++i )
+		{
+			const TIXML_STRING& text = patches[i].text;
+			result =    fseek( fp, patches[i].begin, SEEK_SET ) == 0
+					 && fwrite( text.c_str(), 1, text.length(), fp ) == text.length();
+		}
+	}
+	else if ( fp )
+	{
+		const int first = patches[0].begin;
+		const size_t tailLength = (size_t)( fileSize - first );
+		char* tail = new char[ tailLength + 1 ];
+		result = fseek( fp, first, SEEK_SET ) == 0 && fread( tail, 1, tailLength, fp ) == tailLength;
+		if ( result )
+		{
+			TIXML_STRING rewritten;
+			rewritten.reserve( (size_t)( (long long) tailLength + patches[ count-1 ].shift ) );
+			int at = first;
+			for ( size_t i = 0; i < count; ++i )
+			{
+				rewritten.append( tail + ( at - first ), patches[i].begin - at );
+				rewritten.append( patches[i].text.c_str(), patches[i].text.length() );
+				at = patches[i].end;
+			}
+			rewritten.append( tail + ( at - first ), (size_t)( fileSize - at ) );
+			result =    fseek( fp, first, SEEK_SET ) == 0
+					 && fwrite( rewritten.c_str(), 1, rewritten.length(), fp ) == rewritten.length()
+					 && fflush( fp ) == 0
+					 && TruncateFile( fp, first + (long long) rewritten.length() );
+		}
+		delete [] tail;
+	}
+	if ( fp && fclose( fp ) != 0 )
+		result = false;
+	if ( !result )
+	{
+		// The ranges can't be trusted now; the next save writes it all.
+		fileSize = -1;
+		delete [] patches;
+		return false;
+	}
+
+	// Move the ranges of the nodes around the patches along. Where the file
+	// kept its length up to the end that is only the changed path.
+	node = firstChild;
+	while ( node )
+	{
+		TiXmlNode* below = 0;
+		if ( !( node->edits & EDITED ) && ( node->edits || !fits ) )
+		{
+			if ( !fits )
+			{
+				node->sourceBegin = PatchedOffset( patches, count, node->sourceBegin );
+				node->sourceEnd = PatchedOffset( patches, count, node->sourceEnd );
+				TiXmlElement* element = node->ToElement();
+				if ( element )
+					element->sourceTagEnd = PatchedOffset( patches, count, element->sourceTagEnd );
+			}
+			if ( !fits || ( node->edits & EDITED_BELOW ) )
+				below = node->firstChild;
+			node->edits = 0;
+		}
+		if ( below )
+		{
+			node = below;
+			continue;
+		}
+		while ( node != this && !node->next )
+			node = node->parent;
+		node = ( node != this ) ? node->next : 0;
+	}
+
+	// The nodes written whole have ranges relative to their output.
+	for ( size_t i = 0; i < count; ++i )
+	{
+		const TiXmlSourcePatch& patch = patches[i];
+		if ( patch.tag )
+			continue;
+		const int at = PatchedOffset( patches, count, patch.begin );
+		const int by = at - patch.marked;
+		for ( node = patch.node; node; )
+		{
+			node->sourceBegin += by;
+			node->sourceEnd += by;
+			TiXmlElement* element = node->ToElement();
+			if ( element )
+				element->sourceTagEnd += by;
+			node->edits = 0;
+
+			if ( node->firstChild )
+			{
+				node = node->firstChild;
+				continue;
+			}
+			while ( node != patch.node && !node->next )
+				node = node->parent;
+			node = ( node != patch.node ) ? node->next : 0;
+		}
+
+		// Padding went inside the end of it.
+		patch.node->sourceEnd = at + (int) patch.text.length();
+		if ( patch.node->ToElement() && !patch.node->firstChild )
+			patch.node->ToElement()->sourceTagEnd = patch.node->sourceEnd;
+	}
+
+	sourceEnd = PatchedOffset( patches, count, sourceEnd );
+	edits = 0;
+	delete [] patches;
+	StampSource();
+	return true;
+}
+
+
+bool TiXmlDocument::SaveWhole()
+{
+	ReleaseSource();
+	FILE* fp = TiXmlFOpen( value.c_str(), "wb" );
+	if ( !fp )
+		return false;
+
+	bool result;
+	{
+		TiXmlWriter out( fp );
+		out.SetMarking( 0 );
+		if ( useMicrosoftBOM )
+		{
+			const char utf8Bom[] = { (char)0xefU, (char)0xbbU, (char)0xbfU };
+			out.Write( utf8Bom, 3 );
+		}
+		Write( &out, 0 );
+		SetSourceRange( 0, out.Offset() );
+		out.Flush();
+		result = ( ferror( fp ) == 0 );
+	}
+	if ( fclose( fp ) != 0 )
+		result = false;
+
+	// Every node has been written, and marked.
+	TiXmlNode* node = this;
+	while ( node )
+	{
+		const bool below = node->edits != 0;
+		node->edits = 0;
+		if ( below && node->firstChild )
+		{
+			node = node->firstChild;
+			continue;
+		}
+		while ( node != this && !node->next )
+			node = node->parent;
+		node = ( node != this ) ? node->next : 0;
+	}
+
+	if ( result )
+		StampSource();
+	else
+		fileSize = -1;
+	return result;
+}
+
+
+void TiXmlDocument::ReleaseSource()
+{
+	if ( !sourceMap.Data() )
+		return;
+
+	// Locate the nodes while the text is indexed, and copy the strings that
+	// borrow from it: in situ, or from a cache.
+	TiXmlNode* node = firstChild;
+	while ( node )
+	{
+		node->Row();
+		OwnString( node->value );
+		TiXmlElement* element = node->ToElement();
+		TiXmlDeclaration* declaration = node->ToDeclaration();
+		if ( element )
+		{
+			for ( TiXmlAttribute* attribute = element->FirstAttribute(); attribute; attribute = attribute->Next() )
+			{
+				attribute->Row();
+				OwnString( attribute->name );
+				OwnString( attribute->value );
+			}
+		}
+		else if ( declaration )
+		{
+			OwnString( declaration->version );
+			OwnString( declaration->encoding );
+			OwnString( declaration->standalone );
+		}
+
+		if ( node->firstChild )
+		{
+			node = node->firstChild;
+			continue;
+		}
+		while ( node != this && !node->next )
+			node = node->parent;
+		node = ( node != this ) ? node->next : 0;
+	}
+	lineIndex.Clear();
+	sourceMap.Close();
+}
+
+
+void TiXmlDocument::StampSource()
+{
+	TiXmlCacheStamp stamp;
+	if ( StatFile( value.c_str(), &stamp ) )
+	{
+		fileSize = (long long) stamp.size;
+		fileTime = stamp.time;
+	}
+	else
+	{
+		fileSize = -1;
+	}
+}
+
+
+void TiXmlDocument::ResolveLocation( TiXmlCursor* cursor ) const
+{
+	if ( lineIndex.Active() )
+		lineIndex.Locate( cursor );
+	else
+		cursor->Clear();
+}
+
+
+void TiXmlDocument::CopyTo( TiXmlDocument* target ) const
+{
+	TiXmlNode::CopyTo( target );
+
+	target->error = error;
+	target->errorId = errorId;
+	target->errorDesc = errorDesc;
+	target->tabsize = tabsize;
+	target->errorLocation = errorLocation;
+	target->useMicrosoftBOM = useMicrosoftBOM;
+	target->useArena = useArena;
+	target->inSitu = inSitu;
+	target->condense = condense;
+
+	CopyChildrenTo( target );
+}
+
+
+void TiXmlDocument::MoveTo( TiXmlDocument* target )
+{
+	// The arena and the text stay here; Settle() has moved the nodes off them.
+	TiXmlNode::MoveTo( target );
+
+	target->error = error;
+	target->errorId = errorId;
+	target->errorDesc = errorDesc;
+	target->tabsize = tabsize;
+	target->errorLocation = errorLocation;
+	target->useMicrosoftBOM = useMicrosoftBOM;
+	target->useArena = useArena;
+	target->inSitu = inSitu;
+	target->condense = condense;
+}
+
+
+TiXmlNode* TiXmlDocument::Clone() const
+{
+	TiXmlDocument* clone = new TiXmlDocument();
+	if ( !clone )
+		return 0;
+
+	CopyTo( clone );
+	return clone;
+}
+
+
+TiXmlNode* TiXmlDocument::MoveClone()
+{
+	TiXmlDocument* clone = new TiXmlDocument();
+	if ( !clone )
+		return 0;
+
+	MoveTo( clone );
+	return clone;
+}
+
+
+void TiXmlDocument::Print( FILE* cfile, int depth ) const
+{
+	TiXmlBase::Print( cfile, depth );
+}
+
+
+void TiXmlDocument::Write( TiXmlWriter* out, int depth ) const
+{
+	for ( const TiXmlNode* node=FirstChild(); node; node=node->NextSibling() )
+	{
+		node->Write( out, depth );
+		out->Put( '\n' );
+	}
+}
+
+
+bool TiXmlDocument::Accept( TiXmlVisitor* visitor ) const
+{
+	if ( visitor->VisitEnter( *this ) )
 	{
 		for ( const TiXmlNode* node=FirstChild(); node; node=node->NextSibling() )
 		{
-			if ( !node->Accept( visitor ) )
-				break;
+			if ( !node->Accept( visitor ) )
+				break;
+		}
+	}
+	return visitor->VisitExit( *this );
+}
+
+
+const TiXmlAttribute* TiXmlAttribute::Next() const
+{
+	// We are using knowledge of the sentinel. The sentinel
+	// have a value or name.
+	if ( next->name.empty() && next->value.empty() )
+		return 0;
+	return next;
+}
+
+/*
+TiXmlAttribute* TiXmlAttribute::Next()
+{
+	// We are using knowledge of the sentinel. The sentinel
+	// have a value or name.
+	if ( next->name.empty() && next->value.empty() )
+		return 0;
+	return next;
+}
+*/
+
+const TiXmlAttribute* TiXmlAttribute::Previous() const
+{
+	// We are using knowledge of the sentinel. The sentinel
+	// have a value or name.
+	if ( prev->name.empty() && prev->value.empty() )
+		return 0;
+	return prev;
+}
+
+/*
+TiXmlAttribute* TiXmlAttribute::Previous()
+{
+	// We are using knowledge of the sentinel. The sentinel
+	// have a value or name.
+	if ( prev->name.empty() && prev->value.empty() )
+		return 0;
+	return prev;
+}
+*/
+
+void TiXmlAttribute::Print( FILE* cfile, int depth, TIXML_STRING* str ) const
+{
+	if ( cfile ) {
+		TiXmlWriter out( cfile );
+		Write( &out, depth );
+	}
+	if ( str ) {
+		TiXmlWriter out( str );
+		Write( &out, depth );
+	}
+}
+
+
+void TiXmlAttribute::Write( TiXmlWriter* out, int /*depth*/ ) const
+{
+	const char quote = ( value.find( '\"' ) == TIXML_STRING::npos ) ? '\"' : '\'';
+
+	out->WriteEncoded( name );
+	out->Put( '=' );
+	out->Put( quote );
+	out->WriteEncoded( value );
+	out->Put( quote );
+}
+
+
+int TiXmlAttribute::QueryIntValue( int* ival ) const
+{
+	if ( ReadInt( value.c_str(), ival ) )
+		return TIXML_SUCCESS;
+	return TIXML_WRONG_TYPE;
+}
+
+int TiXmlAttribute::QueryDoubleValue( double* dval ) const
+{
+	if ( ReadDouble( value.c_str(), dval ) )
+		return TIXML_SUCCESS;
+	return TIXML_WRONG_TYPE;
+}
+
+#ifdef TIXML_RVALUE_REFS
+TiXmlAttribute::TiXmlAttribute( TiXmlAttribute&& move )
+{
+	document = 0;
+	owner = 0;
+	prev = next = 0;
+	*this = static_cast< TiXmlAttribute&& >( move );
+}
+
+
+TiXmlAttribute& TiXmlAttribute::operator=( TiXmlAttribute&& move )
+{
+	if ( &move == this )
+		return *this;
+
+	move.ResolveLocation();
+	location = move.location;
+
+	if ( owner )
+		owner->Unindex( this );
+	if ( move.owner )
+	{
+		name = move.name;
+	}
+	else
+	{
+		MoveString( move.name, name );
+		OwnString( name );
+		move.atom = TiXmlAtom();
+	}
+	atom = TiXmlAtom();
+	if ( owner )
+		owner->Index( this );
+
+	MoveString( move.value, value );
+	OwnString( value );
+	Edited();
+	return *this;
+}
+#endif
+
+
+void TiXmlAttribute::Edited()
+{
+	if ( owner )
+		owner->Edited();
+}
+
+
+void TiXmlAttribute::Settle()
+{
+	ResolveLocation();
+	document = 0;
+	atom = TiXmlAtom();
+	OwnString( name );
+	OwnString( value );
+}
+
+
+void TiXmlAttribute::SetName( const char* _name )
+{
+	// A set that indexes this attribute has to hear of the new name.
+	if ( owner )
+		owner->Unindex( this );
+	name = _name;
+	atom = TiXmlAtom();
+	if ( owner )
+		owner->Index( this );
+	Edited();
+}
+
+#ifdef TIXML_USE_STL
+void TiXmlAttribute::SetName( const std::string& _name )
+{
+	if ( owner )
+		owner->Unindex( this );
+	name = _name;
+	atom = TiXmlAtom();
+	if ( owner )
+		owner->Index( this );
+	Edited();
+}
+#endif
+
+void TiXmlAttribute::SetIntValue( int _value )
+{
+	char buf [NUMBER_BUFFER_SIZE];
+	value.assign( buf, WriteInt( _value, buf ) );
+	Edited();
+}
+
+void TiXmlAttribute::SetDoubleValue( double _value )
+{
+	char buf [NUMBER_BUFFER_SIZE];
+	value.assign( buf, WriteDouble( _value, buf ) );
+	Edited();
+}
+
+int TiXmlAttribute::IntValue() const
+{
+	int i = 0;
+	ReadInt( value.c_str(), &i );
+	return i;
+}
+
+double  TiXmlAttribute::DoubleValue() const
+{
+	double d = 0;
+	ReadDouble( value.c_str(), &d );
+	return d;
+}
+
+
+TiXmlComment::TiXmlComment( const TiXmlComment& copy ) : TiXmlNode( TiXmlNode::TINYXML_COMMENT )
+{
+	copy.CopyTo( this );
+}
+
+
+TiXmlComment& TiXmlComment::operator=( const TiXmlComment& base )
+{
+	Clear();
+	base.CopyTo( this );
+	return *this;
+}
+
+
+void TiXmlComment::Write( TiXmlWriter* out, int depth ) const
+{
+	out->Indent( depth );
+	const int begin = out->Offset();
+	out->Write( "<!--", 4 );
+	out->Write( value.c_str() );
+	out->Write( "-->", 3 );
+	out->Marked( this, begin );
+}
+
+
+void TiXmlComment::CopyTo( TiXmlComment* target ) const
+{
+	TiXmlNode::CopyTo( target );
+}
+
+
+bool TiXmlComment::Accept( TiXmlVisitor* visitor ) const
+{
+	return visitor->Visit( *this );
+}
+
+
+TiXmlNode* TiXmlComment::Clone() const
+{
+	TiXmlComment* clone = new TiXmlComment();
+
+	if ( !clone )
+		return 0;
+
+	CopyTo( clone );
+	return clone;
+}
+
+
+TiXmlNode* TiXmlComment::MoveClone()
+{
+	TiXmlComment* clone = new TiXmlComment();
+
+	if ( !clone )
+		return 0;
+
+	MoveTo( clone );
+	return clone;
+}
+
+
+void TiXmlText::Write( TiXmlWriter* out, int depth ) const
+{
+	if ( cdata )
+	{
+		out->Put( '\n' );
+		out->Indent( depth );
+		const int begin = out->Offset();
+		out->Write( "<![CDATA[", 9 );
+		out->Write( value.c_str() );
+		out->Write( "]]>", 3 );
+		out->Marked( this, begin );
+		out->Put( '\n' );	// unformatted output
+	}
+	else
+	{
+		const int begin = out->Offset();
+		out->WriteEncoded( value );
+		out->Marked( this, begin );
+	}
+}
+
+
+void TiXmlText::CopyTo( TiXmlText* target ) const
+{
+	TiXmlNode::CopyTo( target );
+	target->cdata = cdata;
+}
+
+
+void TiXmlText::MoveTo( TiXmlText* target )
+{
+	TiXmlNode::MoveTo( target );
+	target->cdata = cdata;
+}
+
+
+bool TiXmlText::Accept( TiXmlVisitor* visitor ) const
+{
+	return visitor->Visit( *this );
+}
+
+
+TiXmlNode* TiXmlText::Clone() const
+{	
+	TiXmlText* clone = 0;
+	clone = new TiXmlText( "" );
+
+	if ( !clone )
+		return 0;
+
+	CopyTo( clone );
+	return clone;
+}
+
+
+TiXmlNode* TiXmlText::MoveClone()
+{	
+	TiXmlText* clone = new TiXmlText( "" );
+
+	if ( !clone )
+		return 0;
+
+	MoveTo( clone );
+	return clone;
+}
+
+
+TiXmlDeclaration::TiXmlDeclaration( const char * _version,
+									const char * _encoding,
+									const char * _standalone )
+	: TiXmlNode( TiXmlNode::TINYXML_DECLARATION )
+{
+	version = _version;
+	encoding = _encoding;
+	standalone = _standalone;
+}
+
+
+#ifdef TIXML_USE_STL
+TiXmlDeclaration::TiXmlDeclaration(	const std::string& _version,
+									const std::string& _encoding,
+									const std::string& _standalone )
+	: TiXmlNode( TiXmlNode::TINYXML_DECLARATION )
+{
+	version = _version;
+	encoding = _encoding;
+	standalone = _standalone;
+}
+#endif
+
+
+TiXmlDeclaration::TiXmlDeclaration( const TiXmlDeclaration& copy )
+	: TiXmlNode( TiXmlNode::TINYXML_DECLARATION )
+{
+	copy.CopyTo( this );	
+}
+
+
+TiXmlDeclaration& TiXmlDeclaration::operator=( const TiXmlDeclaration& copy )
+{
+	Clear();
+	copy.CopyTo( this );
+	return *this;
+}
+
+
+void TiXmlDeclaration::Print( FILE* cfile, int depth, TIXML_STRING* str ) const
+{
+	if ( cfile ) {
+		TiXmlWriter out( cfile );
+		Write( &out, depth );
+	}
+	if ( str ) {
+		TiXmlWriter out( str );
+		Write( &out, depth );
+	}
+}
+
+
+void TiXmlDeclaration::Write( TiXmlWriter* out, int /*depth*/ ) const
+{
+	const int begin = out->Offset();
+	out->Write( "<?xml ", 6 );
+
+	if ( !version.empty() ) {
+		out->Write( "version=\"", 9 );
+		out->Write( version.c_str() );
+		out->Write( "\" ", 2 );
+	}
+	if ( !encoding.empty() ) {
+		out->Write( "encoding=\"", 10 );
+		out->Write( encoding.c_str() );
+		out->Write( "\" ", 2 );
+	}
+	if ( !standalone.empty() ) {
+		out->Write( "standalone=\"", 12 );
+		out->Write( standalone.c_str() );
+		out->Write( "\" ", 2 );
+	}
+	out->Write( "?>", 2 );
+	out->Marked( this, begin );
+}
+
+
+void TiXmlDeclaration::CopyTo( TiXmlDeclaration* target ) const
+{
+	TiXmlNode::CopyTo( target );
+
+	target->version = version;
+	target->encoding = encoding;
+	target->standalone = standalone;
+}
+
+
+void TiXmlDeclaration::MoveTo( TiXmlDeclaration* target )
+{
+	TiXmlNode::MoveTo( target );
+
+	MoveString( version, target->version );
+	MoveString( encoding, target->encoding );
+	MoveString( standalone, target->standalone );
+}
+
+
+void TiXmlDeclaration::SettleThis()
+{
+	TiXmlNode::SettleThis();
+
+	OwnString( version );
+	OwnString( encoding );
+	OwnString( standalone );
+}
+
+
+bool TiXmlDeclaration::Accept( TiXmlVisitor* visitor ) const
+{
+	return visitor->Visit( *this );
+}
+
+
+TiXmlNode* TiXmlDeclaration::Clone() const
+{	
+	TiXmlDeclaration* clone = new TiXmlDeclaration();
+
+	if ( !clone )
+		return 0;
+
+	CopyTo( clone );
+	return clone;
+}
+
+
+TiXmlNode* TiXmlDeclaration::MoveClone()
+{	
+	TiXmlDeclaration* clone = new TiXmlDeclaration();
+
+	if ( !clone )
+		return 0;
+
+	MoveTo( clone );
+	return clone;
+}
+
+
+void TiXmlUnknown::Write( TiXmlWriter* out, int depth ) const
+{
+	out->Indent( depth );
+	const int begin = out->Offset();
+	out->Put( '<' );
+	out->Write( value.c_str() );
+	out->Put( '>' );
+	out->Marked( this, begin );
+}
+
+
+void TiXmlUnknown::CopyTo( TiXmlUnknown* target ) const
+{
+	TiXmlNode::CopyTo( target );
+}
+
+
+bool TiXmlUnknown::Accept( TiXmlVisitor* visitor ) const
+{
+	return visitor->Visit( *this );
+}
+
+
+TiXmlNode* TiXmlUnknown::Clone() const
+{
+	TiXmlUnknown* clone = new TiXmlUnknown();
+
+	if ( !clone )
+		return 0;
+
+	CopyTo( clone );
+	return clone;
+}
+
+
+TiXmlNode* TiXmlUnknown::MoveClone()
+{
+	TiXmlUnknown* clone = new TiXmlUnknown();
+
+	if ( !clone )
+		return 0;
+
+	MoveTo( clone );
+	return clone;
+}
+
+
+TiXmlAttributeSet::TiXmlAttributeSet()
+{
+	element = 0;
+	sentinel.next = &sentinel;
+	sentinel.prev = &sentinel;
+	count = 0;
+	table = 0;
+	tableSize = 0;
+}
+
+
+void TiXmlAttributeSet::Edited()
+{
+	if ( element )
+		element->MarkEdited( TiXmlNode::EDITED_TAG );
+}
+
+
+TiXmlAttributeSet::~TiXmlAttributeSet()
+{
+	assert( sentinel.next == &sentinel );
+	assert( sentinel.prev == &sentinel );
+	delete [] table;
+}
+
+
+void TiXmlAttributeSet::Add( TiXmlAttribute* addMe )
+{
+    #ifdef TIXML_USE_STL
+	assert( !Find( TIXML_STRING( addMe->Name() ) ) );	// Shouldn't be multiply adding to the set.
+	#else
+	assert( !Find( addMe->Name() ) );	// Shouldn't be multiply adding to the set.
+	#endif
+
+	addMe->next = &sentinel;
+	addMe->prev = sentinel.prev;
+
+	sentinel.prev->next = addMe;
+	sentinel.prev      = addMe;
+
+	addMe->owner = this;
+	++count;
+	if ( table )
+		Index( addMe );
+	else if ( count > INDEX_THRESHOLD )
+		Rehash( 4 * INDEX_THRESHOLD );
+	Edited();
+}
+
+void TiXmlAttributeSet::Remove( TiXmlAttribute* removeMe )
+{
+	if ( removeMe->owner != this )
+	{
+		assert( 0 );		// we tried to remove a non-linked attribute.
+		return;
+	}
+
+	Unindex( removeMe );
+	removeMe->prev->next = removeMe->next;
+	removeMe->next->prev = removeMe->prev;
+	removeMe->next = 0;
+	removeMe->prev = 0;
+	removeMe->owner = 0;
+
+	if ( --count == 0 )
+	{
+		delete [] table;
+		table = 0;
+		tableSize = 0;
+	}
+	Edited();
+}
+
+
+#ifdef TIXML_USE_STL
+TiXmlAttribute* TiXmlAttributeSet::Find( const std::string& name ) const
+{
+	if ( table )
+		return *Slot( name.c_str() );
+
+	for( TiXmlAttribute* node = sentinel.next; node != &sentinel; node = node->next )
+	{
+		if ( node->name == name )
+			return node;
+	}
+	return 0;
+}
+
+TiXmlAttribute* TiXmlAttributeSet::FindOrCreate( const std::string& _name )
+{
+	TiXmlAttribute* attrib = Find( _name );
+	if ( !attrib ) {
+		attrib = new TiXmlAttribute();
+		attrib->SetName( _name );
+		Add( attrib );
+	}
+	return attrib;
+}
+#endif
+
+
+TiXmlAttribute* TiXmlAttributeSet::Find( const char* name ) const
+{
+	if ( table )
+		return *Slot( name );
+
+	for( TiXmlAttribute* node = sentinel.next; node != &sentinel; node = node->next )
+	{
+		if ( strcmp( node->name.c_str(), name ) == 0 )
+			return node;
+	}
+	return 0;
+}
+
+
+TiXmlAttribute* TiXmlAttributeSet::Find( TiXmlAtom name ) const
+{
+	if ( table )
+		return name.Name() ? *Slot( name.Name() ) : 0;
+
+	for( TiXmlAttribute* node = sentinel.next; node != &sentinel; node = node->next )
+	{
+		if ( node->Is( name ) )
+			return node;
+	}
+	return 0;
+}
+
+
+TiXmlAttribute* TiXmlAttributeSet::FindOrCreate( const char* _name )
+{
+	TiXmlAttribute* attrib = Find( _name );
+	if ( !attrib ) {
+		attrib = new TiXmlAttribute();
+		attrib->SetName( _name );
+		Add( attrib );
+	}
+	return attrib;
+}
+
+
+size_t TiXmlAttributeSet::Hash( const char* name )
+{
+	// FNV-1a
+	size_t hash = 2166136261u;
+	for ( const unsigned char* p = reinterpret_cast< const unsigned char* >( name ); *p; ++p )
+	{
+		hash ^= *p;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+
+TiXmlAttribute** TiXmlAttributeSet::Slot( const char* name ) const
+{
+	// The table is never more than half full, so the probe ends.
+	const size_t mask = tableSize - 1;
+	size_t i = Hash( name ) & mask;
+	while ( table[i] && strcmp( table[i]->name.c_str(), name ) != 0 )
+		i = ( i + 1 ) & mask;
+	return &table[i];
+}
+
+
+void TiXmlAttributeSet::Index( TiXmlAttribute* attribute )
+{
+	if ( !table )
+		return;
+	if ( 2 * count > tableSize )
+	{
+		Rehash( 2 * tableSize );	// indexes every attribute, this one too
+		return;
+	}
+
+	// Duplicate names only come from renames. They take the next free slot;
+	// Find() returns whichever comes first in the probe.
+	const size_t mask = tableSize - 1;
+	size_t i = Hash( attribute->name.c_str() ) & mask;
+	while ( table[i] )
+		i = ( i + 1 ) & mask;
+	table[i] = attribute;
+}
+
+
+void TiXmlAttributeSet::Unindex( TiXmlAttribute* attribute )
+{
+	if ( !table )
+		return;
+
+	const size_t mask = tableSize - 1;
+	size_t i = Hash( attribute->name.c_str() ) & mask;
+	while ( table[i] != attribute )
+	{
+		assert( table[i] );
+		i = ( i + 1 ) & mask;
+	}
+
+	// Shift back the entries after the hole whose probe passed through it,
+	// so no probe stops early at an empty slot.
+	for ( size_t j = ( i + 1 ) & mask; table[j]; j = ( j + 1 ) & mask )
+	{
+		size_t home = Hash( table[j]->name.c_str() ) & mask;
+		if ( ( ( j - home ) & mask ) >= ( ( j - i ) & mask ) )
+		{
+			table[i] = table[j];
+			i = j;
+		}
+	}
+	table[i] = 0;
+}
+
+
+void TiXmlAttributeSet::Rehash( size_t size )
+{
+	delete [] table;
+	table = new TiXmlAttribute*[ size ];
+	tableSize = size;
+	memset( table, 0, size * sizeof( TiXmlAttribute* ) );
+
+	const size_t mask = tableSize - 1;
+	for( TiXmlAttribute* node = sentinel.next; node != &sentinel; node = node->next )
+	{
+		size_t i = Hash( node->name.c_str() ) & mask;
+		while ( table[i] )
+			i = ( i + 1 ) & mask;
+		table[i] = node;
+	}
+}
+
+
+#ifdef TIXML_USE_STL	
+std::istream& operator>> (std::istream & in, TiXmlNode & base)
+{
+	TIXML_STRING tag;
+	tag.reserve( 8 * 1000 );
+	base.StreamIn( &in, &tag );
+
+	base.Parse( tag.c_str(), 0, TIXML_DEFAULT_ENCODING );
+	return in;
+}
+#endif
+
+
+#ifdef TIXML_USE_STL	
+std::ostream& operator<< (std::ostream & out, const TiXmlNode & base)
+{
+	TiXmlPrinter printer;
+	printer.SetStreamPrinting();
+	base.Accept( &printer );
+	out << printer.Str();
+
+	return out;
+}
+
+
+std::string& operator<< (std::string& out, const TiXmlNode& base )
+{
+	TiXmlPrinter printer;
+	printer.SetStreamPrinting();
+	base.Accept( &printer );
+	out.append( printer.Str() );
+
+	return out;
+}
+#endif
+
+
+TiXmlHandle TiXmlHandle::FirstChild() const
+{
+	if ( node )
+	{
+		TiXmlNode* child = node->FirstChild();
+		if ( child )
+			return TiXmlHandle( child );
+	}
+	return TiXmlHandle( 0 );
+}
+
+
+TiXmlHandle TiXmlHandle::FirstChild( const char * value ) const
+{
+	if ( node )
+	{
+		TiXmlNode* child = node->FirstChild( value );
+		if ( child )
+			return TiXmlHandle( child );
+	}
+	return TiXmlHandle( 0 );
+}
+
+
+TiXmlHandle TiXmlHandle::FirstChildElement() const
+{
+	if ( node )
+	{
+		TiXmlElement* child = node->FirstChildElement();
+		if ( child )
+			return TiXmlHandle( child );
+	}
+	return TiXmlHandle( 0 );
+}
+
+
+TiXmlHandle TiXmlHandle::FirstChildElement( const char * value ) const
+{
+	if ( node )
+	{
+		TiXmlElement* child = node->FirstChildElement( value );
+		if ( child )
+			return TiXmlHandle( child );
+	}
+	return TiXmlHandle( 0 );
+}
+
+
+TiXmlHandle TiXmlHandle::Child( int count ) const
+{
+	if ( node )
+	{
+		int i;
+		TiXmlNode* child = node->FirstChild();
+		for (	i=0;
+				child && i<count;
+				child = child->NextSibling(), ++i )
+		{
+			// nothing
+		}
+		if ( child )
+			return TiXmlHandle( child );
+	}
+	return TiXmlHandle( 0 );
+}
+
+
+TiXmlHandle TiXmlHandle::Child( const char* value, int count ) const
+{
+	if ( node )
+	{
+		int i;
+		TiXmlNode* child = node->FirstChild( value );
+		for (	i=0;
+				child && i<count;
+				child = child->NextSibling( value ), ++i )
+		{
+			// nothing
+		}
+		if ( child )
+			return TiXmlHandle( child );
+	}
+	return TiXmlHandle( 0 );
+}
+
+
+TiXmlHandle TiXmlHandle::ChildElement( int count ) const
+{
+	if ( node )
+	{
+		int i;
+		TiXmlElement* child = node->FirstChildElement();
+		for (	i=0;
+				child && i<count;
+				child = child->NextSiblingElement(), ++i )
+		{
+			// nothing
 		}
+		if ( child )
+			return TiXmlHandle( child );
 	}
-	return visitor->VisitExit( *this );
+	return TiXmlHandle( 0 );
 }
 
 
-const TiXmlAttribute* TiXmlAttribute::Next() const
+TiXmlHandle TiXmlHandle::ChildElement( const char* value, int count ) const
 {
-	// We are using knowledge of the sentinel. The sentinel
-	// have a value or name.
-	if ( next->value.empty() && next->name.empty() )
-		return 0;
-	return next;
+	if ( node )
+	{
+		int i;
+		TiXmlElement* child = node->FirstChildElement( value );
+		for (	i=0;
+				child && i<count;
+				child = child->NextSiblingElement( value ), ++i )
+		{
+			// nothing
+		}
+		if ( child )
+			return TiXmlHandle( child );
+	}
+	return TiXmlHandle( 0 );
 }
 
-/*
-TiXmlAttribute* TiXmlAttribute::Next()
+
+TiXmlHandle TiXmlHandle::FirstChild( TiXmlAtom value ) const
 {
-	// We are using knowledge of the sentinel. The sentinel
-	// have a value or name.
-	if ( next->value.empty() && next->name.empty() )
-		return 0;
-	return next;
+	if ( node )
+	{
+		TiXmlNode* child = node->FirstChild( value );
+		if ( child )
+			return TiXmlHandle( child );
+	}
+	return TiXmlHandle( 0 );
 }
-*/
 
-const TiXmlAttribute* TiXmlAttribute::Previous() const
+
+TiXmlHandle TiXmlHandle::FirstChildElement( TiXmlAtom value ) const
 {
-	// We are using knowledge of the sentinel. The sentinel
-	// have a value or name.
-	if ( prev->value.empty() && prev->name.empty() )
-		return 0;
-	return prev;
+	if ( node )
+	{
+		TiXmlElement* child = node->FirstChildElement( value );
+		if ( child )
+			return TiXmlHandle( child );
+	}
+	return TiXmlHandle( 0 );
 }
 
-/*
-TiXmlAttribute* TiXmlAttribute::Previous()
+
+TiXmlHandle TiXmlHandle::Child( TiXmlAtom value, int count ) const
 {
-	// We are using knowledge of the sentinel. The sentinel
-	// have a value or name.
-	if ( prev->value.empty() && prev->name.empty() )
-		return 0;
-	return prev;
+	if ( node )
+	{
+		int i;
+		TiXmlNode* child = node->FirstChild( value );
+		for (	i=0;
+				child && i<count;
+				child = child->NextSibling( value ), ++i )
+		{
+			// nothing
+		}
+		if ( child )
+			return TiXmlHandle( child );
+	}
+	return TiXmlHandle( 0 );
+}
+
+
+TiXmlHandle TiXmlHandle::ChildElement( TiXmlAtom value, int count ) const
+{
+	if ( node )
+	{
+		int i;
+		TiXmlElement* child = node->FirstChildElement( value );
+		for (	i=0;
+				child && i<count;
+				child = child->NextSiblingElement( value ), ++i )
+		{
+			// nothing
+		}
+		if ( child )
+			return TiXmlHandle( child );
+	}
+	return TiXmlHandle( 0 );
+}
+
+
+bool TiXmlPrinter::VisitEnter( const TiXmlDocument& )
+{
+	return true;
+}
+
+bool TiXmlPrinter::VisitExit( const TiXmlDocument& )
+{
+	return true;
 }
-*/
 
-void TiXmlAttribute::Print( FILE* cfile, int /*depth*/, TIXML_STRING* str ) const
+bool TiXmlPrinter::VisitEnter( const TiXmlElement& element, const TiXmlAttribute* firstAttribute )
 {
-	TIXML_STRING n, v;
+	DoIndent();
+	buffer += "<";
+	buffer += element.Value();
 
-	EncodeString( name, &n );
-	EncodeString( value, &v );
+	for( const TiXmlAttribute* attrib = firstAttribute; attrib; attrib = attrib->Next() )
+	{
+		buffer += " ";
+		attrib->Print( 0, 0, &buffer );
+	}
 
-	if (value.find ('\"') == TIXML_STRING::npos) {
-		if ( cfile ) {
-			fprintf (cfile, "%s=\"%s\"", n.c_str(), v.c_str() );
+	if ( !element.FirstChild() ) 
+	{
+		buffer += " />";
+		DoLineBreak();
+	}
+	else 
+	{
+		buffer += ">";
+		if (    element.FirstChild()->ToText()
+			  && element.LastChild() == element.FirstChild()
+			  && element.FirstChild()->ToText()->CDATA() == false )
+		{
+			simpleTextPrint = true;
+			// no DoLineBreak()!
 		}
-		if ( str ) {
-			(*str) += n; (*str) += "=\""; (*str) += v; (*str) += "\"";
+		else
+		{
+			DoLineBreak();
 		}
 	}
-	else {
-		if ( cfile ) {
-			fprintf (cfile, "%s='%s'", n.c_str(), v.c_str() );
+	++depth;	
+	return true;
+}
+
+
+bool TiXmlPrinter::VisitExit( const TiXmlElement& element )
+{
+	--depth;
+	if ( !element.FirstChild() ) 
+	{
+		// nothing.
+	}
+	else 
+	{
+		if ( simpleTextPrint )
+		{
+			simpleTextPrint = false;
 		}
-		if ( str ) {
-			(*str) += n; (*str) += "='"; (*str) += v; (*str) += "'";
+		else
+		{
+			DoIndent();
 		}
+		buffer += "</";
+		buffer += element.Value();
+		buffer += ">";
+		DoLineBreak();
 	}
+	return true;
 }
 
 
-int TiXmlAttribute::QueryIntValue( int* ival ) const
+bool TiXmlPrinter::Visit( const TiXmlText& text )
 {
-	if ( TIXML_SSCANF( value.c_str(), "%d", ival ) == 1 )
-		return TIXML_SUCCESS;
-	return TIXML_WRONG_TYPE;
+	if ( text.CDATA() )
+	{
+		DoIndent();
+		buffer += "<![CDATA[";
+		buffer += text.Value();
+		buffer += "]]>";
+		DoLineBreak();
+	}
+	else if ( simpleTextPrint )
+	{
+		TiXmlBase::EncodeString( text.ValueTStr(), &buffer );
+	}
+	else
+	{
+		DoIndent();
+		TiXmlBase::EncodeString( text.ValueTStr(), &buffer );
+		DoLineBreak();
+	}
+	return true;
 }
 
-int TiXmlAttribute::QueryDoubleValue( double* dval ) const
+
+bool TiXmlPrinter::Visit( const TiXmlDeclaration& declaration )
 {
-	if ( TIXML_SSCANF( value.c_str(), "%lf", dval ) == 1 )
-		return TIXML_SUCCESS;
-	return TIXML_WRONG_TYPE;
+	DoIndent();
+	declaration.Print( 0, 0, &buffer );
+	DoLineBreak();
+	return true;
 }
 
-void TiXmlAttribute::SetIntValue( int _value )
+
+bool TiXmlPrinter::Visit( const TiXmlComment& comment )
 {
-	char buf [64];
-	#if defined(TIXML_SNPRINTF)		
-		TIXML_SNPRINTF(buf, sizeof(buf), "%d", _value);
-	#else
-		sprintf (buf, "%d", _value);
-	#endif
-	SetValue (buf);
+	DoIndent();
+	buffer += "<!--";
+	buffer += comment.Value();
+	buffer += "-->";
+	DoLineBreak();
+	return true;
 }
 
-void TiXmlAttribute::SetDoubleValue( double _value )
+
+bool TiXmlPrinter::Visit( const TiXmlUnknown& unknown )
 {
-	char buf [256];
-	#if defined(TIXML_SNPRINTF)		
-		TIXML_SNPRINTF( buf, sizeof(buf), "%g", _value);
-	#else
-		sprintf (buf, "%g", _value);
-	#endif
-	SetValue (buf);
+	DoIndent();
+	buffer += "<";
+	buffer += unknown.Value();
+	buffer += ">";
+	DoLineBreak();
+	return true;
 }
 
-int TiXmlAttribute::IntValue() const
+
+
+bool TiXmlSaxParser::ParseFile( const char* filename, TiXmlSaxHandler* _handler, TiXmlEncoding encoding )
+{
+	// Parse the file where it lies, if it can be mapped, so that no more than
+	// the pages being read are in memory.
+	TiXmlFileMap map;
+	if ( map.Open( filename, false ) )
+	{
+		newLines = true;
+		const bool result = Parse( map.Data(), _handler, encoding );
+		newLines = false;
+		return result;
+	}
+
+	// Else read it whole, as TiXmlDocument::LoadFile() does.
+	ClearError();
+	FILE* file = TiXmlFOpen( filename, "rb" );
+	if ( !file )
+	{
+		SetError( TiXmlBase::TIXML_ERROR_OPENING_FILE, 0 );
+		return false;
+	}
+
+	long length = 0;
+	fseek( file, 0, SEEK_END );
+	length = ftell( file );
+	fseek( file, 0, SEEK_SET );
+	if ( length <= 0 )
+	{
+		fclose( file );
+		SetError( TiXmlBase::TIXML_ERROR_DOCUMENT_EMPTY, 0 );
+		return false;
+	}
+
+	char* buf = new char[ length+1 ];
+	if ( fread( buf, length, 1, file ) != 1 )
+	{
+		delete [] buf;
+		fclose( file );
+		SetError( TiXmlBase::TIXML_ERROR_OPENING_FILE, 0 );
+		return false;
+	}
+	fclose( file );
+	buf[length] = 0;
+
+	newLines = true;
+	const bool result = Parse( buf, _handler, encoding );
+	newLines = false;
+	delete [] buf;
+	return result;
+}
+
+
+TiXmlPathResult::TiXmlPathResult()
 {
-	return atoi (value.c_str ());
+	entries = 0;
+	count = 0;
+	capacity = 0;
+	seen = 0;
+	seenMask = -1;
 }
 
-double  TiXmlAttribute::DoubleValue() const
+
+TiXmlPathResult::~TiXmlPathResult()
+{
+	delete [] entries;
+	delete [] seen;
+}
+
+
+const char* TiXmlPathResult::Value( int index ) const
 {
-	return atof (value.c_str ());
+	if ( Attribute( index ) )
+		return Attribute( index )->Value();
+	const TiXmlElement* element = Element( index );
+	return element ? element->GetText() : 0;
 }
 
 
-TiXmlComment::TiXmlComment( const TiXmlComment& copy ) : TiXmlNode( TiXmlNode::TINYXML_COMMENT )
+void TiXmlPathResult::Clear()
 {
-	copy.CopyTo( this );
+	count = 0;
+	delete [] seen;
+	seen = 0;
+	seenMask = -1;
 }
 
 
-TiXmlComment& TiXmlComment::operator=( const TiXmlComment& base )
+static size_t HashAddress( const void* p )
 {
-	Clear();
-	base.CopyTo( this );
-	return *this;
+	return reinterpret_cast< size_t >( p ) / sizeof( void* );
 }
 
 
-void TiXmlComment::Print( FILE* cfile, int depth ) const
+void TiXmlPathResult::Add( const TiXmlNode* node, const TiXmlAttribute* attribute, bool unique )
 {
-	assert( cfile );
-	for ( int i=0; i<depth; i++ )
+	if ( unique )
 	{
-		fprintf( cfile,  "    " );
+		if ( 2 * ( count + 1 ) > seenMask + 1 )
+			Rehash( seenMask < 0 ? 64 : 2 * ( seenMask + 1 ) );
+
+		int i = (int)( HashAddress( attribute ? static_cast< const void* >( attribute ) : node ) & seenMask );
+		for ( ; seen[i] >= 0; i = ( i + 1 ) & seenMask )
+		{
+			if ( entries[ seen[i] ].node == node && entries[ seen[i] ].attribute == attribute )
+				return;
+		}
+		seen[i] = count;
+	}
+
+	if ( count == capacity )
+	{
+		int grown = capacity ? 2 * capacity : 16;
+		Entry* bigger = new Entry[ grown ];
+		if ( count )
+			memcpy( bigger, entries, count * sizeof( Entry ) );
+		delete [] entries;
+		entries = bigger;
+		capacity = grown;
 	}
-	fprintf( cfile, "<!--%s-->", value.c_str() );
+	entries[count].node = node;
+	entries[count].attribute = attribute;
+	++count;
 }
 
 
-void TiXmlComment::CopyTo( TiXmlComment* target ) const
+void TiXmlPathResult::Rehash( int size )
 {
-	TiXmlNode::CopyTo( target );
+	delete [] seen;
+	seen = new int[ size ];
+	seenMask = size - 1;
+	for ( int i = 0; i < size; ++i )
+		seen[i] = -1;
+
+	for ( int n = 0; n < count; ++n )
+	{
+		int i = (int)( HashAddress( entries[n].attribute ? static_cast< const void* >( entries[n].attribute ) : entries[n].node ) & seenMask );
+		while ( seen[i] >= 0 )
+			i = ( i + 1 ) & seenMask;
+		seen[i] = n;
+	}
 }
 
 
-bool TiXmlComment::Accept( TiXmlVisitor* visitor ) const
+int TiXmlPathResult::Find( const TiXmlNode* node, const TiXmlAttribute* attribute ) const
 {
-	return visitor->Visit( *this );
+	if ( !count )
+		return -1;
+	int i = (int)( HashAddress( attribute ? static_cast< const void* >( attribute ) : node ) & seenMask );
+	for ( ; seen[i] >= 0; i = ( i + 1 ) & seenMask )
+	{
+		if ( entries[ seen[i] ].node == node && entries[ seen[i] ].attribute == attribute )
+			return seen[i];
+	}
+	return -1;
 }
 
 
-TiXmlNode* TiXmlComment::Clone() const
+void TiXmlPathResult::Sort( const TiXmlNode* top )
 {
-	TiXmlComment* clone = new TiXmlComment();
+	if ( count < 2 )
+		return;
 
-	if ( !clone )
-		return 0;
+	// One walk of the tree picks the results out in order.
+	Entry* sorted = new Entry[ capacity ];
+	int sortedCount = 0;
+	Collect( top, sorted, &sortedCount );
+	assert( sortedCount == count );
 
-	CopyTo( clone );
-	return clone;
+	delete [] entries;
+	entries = sorted;
+	Rehash( seenMask + 1 );
 }
 
 
-void TiXmlText::Print( FILE* cfile, int depth ) const
+void TiXmlPathResult::Collect( const TiXmlNode* top, Entry* sorted, int* sortedCount ) const
 {
-	assert( cfile );
-	if ( cdata )
+	// 'node' walks 'top' and the nodes below it in document order, in one
+	// loop for any depth, and stops once every result is picked out.
+	const TiXmlNode* node = top;
+	while ( node && *sortedCount < count )
 	{
-		int i;
-		fprintf( cfile, "\n" );
-		for ( i=0; i<depth; i++ ) {
-			fprintf( cfile, "    " );
+		CollectNode( node, sorted, sortedCount );
+
+		if ( node->FirstChild() )
+		{
+			node = node->FirstChild();
+			continue;
 		}
-		fprintf( cfile, "<![CDATA[%s]]>\n", value.c_str() );	// unformatted output
+		while ( node != top && !node->NextSibling() )
+			node = node->Parent();
+		node = ( node != top ) ? node->NextSibling() : 0;
 	}
-	else
+}
+
+
+void TiXmlPathResult::CollectNode( const TiXmlNode* node, Entry* sorted, int* sortedCount ) const
+{
+	if ( Find( node, 0 ) >= 0 )
+	{
+		sorted[ *sortedCount ].node = node;
+		sorted[ *sortedCount ].attribute = 0;
+		++*sortedCount;
+	}
+
+	const TiXmlElement* element = node->ToElement();
+	if ( element )
 	{
-		TIXML_STRING buffer;
-		EncodeString( value, &buffer );
-		fprintf( cfile, "%s", buffer.c_str() );
+		for ( const TiXmlAttribute* attribute = element->FirstAttribute(); attribute; attribute = attribute->Next() )
+		{
+			if ( Find( node, attribute ) >= 0 )
+			{
+				sorted[ *sortedCount ].node = node;
+				sorted[ *sortedCount ].attribute = attribute;
+				++*sortedCount;
+			}
+		}
 	}
 }
 
 
-void TiXmlText::CopyTo( TiXmlText* target ) const
+// Per run: where the results go, and the atoms of the path's names in the
+// document it runs on.
+struct TiXmlPath::Run
 {
-	TiXmlNode::CopyTo( target );
-	target->cdata = cdata;
+	enum { LOCAL_ATOMS = 16 };
+
+	Run( int names ) : result( 0 ), first( false ), count( 0 ), firstNode( 0 ), firstAttribute( 0 )
+	{
+		atoms = names > LOCAL_ATOMS ? new TiXmlAtom[ names ] : local;
+	}
+	~Run()
+	{
+		if ( atoms != local )
+			delete [] atoms;
+	}
+
+	TiXmlPathResult* result;	// or null to only count
+	bool first;					// stop at the first result
+	int count;
+	const TiXmlNode* firstNode;
+	const TiXmlAttribute* firstAttribute;
+	TiXmlAtom* atoms;			// of the steps, then of the predicates; null where the document has none
+	TiXmlAtom local[ LOCAL_ATOMS ];
+
+private:
+	Run( const Run& );			// not implemented.
+	void operator=( const Run& );
+};
+
+
+static const char* PATH_ERROR_EMPTY			= "Empty path";
+static const char* PATH_ERROR_STEP			= "Expected a step";
+static const char* PATH_ERROR_SLASH			= "Expected '/' or the end of the path";
+static const char* PATH_ERROR_ATTRIBUTE_LAST	= "An attribute step has to be the last";
+static const char* PATH_ERROR_ATTRIBUTE_PREDICATE	= "An attribute step can't have predicates";
+static const char* PATH_ERROR_PREDICATES	= "Too many predicates on one step";
+static const char* PATH_ERROR_PREDICATE		= "Expected a position or an attribute";
+static const char* PATH_ERROR_POSITION		= "Positions count from 1";
+static const char* PATH_ERROR_NAME			= "Expected a name";
+static const char* PATH_ERROR_VALUE			= "Expected a quoted text or a number";
+static const char* PATH_ERROR_TEXT_ORDER	= "Text can only be compared with = and !=";
+static const char* PATH_ERROR_QUOTE			= "Missing closing quote";
+static const char* PATH_ERROR_BRACKET		= "Expected ']'";
+
+
+static bool IsPathSpace( char c )
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
 }
 
 
-bool TiXmlText::Accept( TiXmlVisitor* visitor ) const
+static const char* SkipPathSpace( const char* p )
 {
-	return visitor->Visit( *this );
+	while ( IsPathSpace( *p ) )
+		++p;
+	return p;
 }
 
 
-TiXmlNode* TiXmlText::Clone() const
-{	
-	TiXmlText* clone = 0;
-	clone = new TiXmlText( "" );
+// Names in a path run up to the next char that means something to the path.
+static const char* ReadPathName( const char* p, TIXML_STRING* name )
+{
+	const char* start = p;
+	while ( *p && !strchr( "/[]@=!<>'\"*", *p ) && !IsPathSpace( *p ) )
+		++p;
+	name->assign( start, p - start );
+	return p;
+}
 
-	if ( !clone )
-		return 0;
 
-	CopyTo( clone );
-	return clone;
+TiXmlPath::TiXmlPath()
+{
+	steps = 0;
+	stepCapacity = 0;
+	predicates = 0;
+	predicateCapacity = 0;
+	Reset();
+	error = true;
+	errorDesc = PATH_ERROR_EMPTY;
 }
 
 
-TiXmlDeclaration::TiXmlDeclaration( const char * _version,
-									const char * _encoding,
-									const char * _standalone )
-	: TiXmlNode( TiXmlNode::TINYXML_DECLARATION )
+TiXmlPath::TiXmlPath( const char* path )
 {
-	version = _version;
-	encoding = _encoding;
-	standalone = _standalone;
+	steps = 0;
+	stepCapacity = 0;
+	predicates = 0;
+	predicateCapacity = 0;
+	Compile( path );
 }
 
 
 #ifdef TIXML_USE_STL
-TiXmlDeclaration::TiXmlDeclaration(	const std::string& _version,
-									const std::string& _encoding,
-									const std::string& _standalone )
-	: TiXmlNode( TiXmlNode::TINYXML_DECLARATION )
+TiXmlPath::TiXmlPath( const std::string& path )
 {
-	version = _version;
-	encoding = _encoding;
-	standalone = _standalone;
+	steps = 0;
+	stepCapacity = 0;
+	predicates = 0;
+	predicateCapacity = 0;
+	Compile( path.c_str() );
 }
 #endif
 
 
-TiXmlDeclaration::TiXmlDeclaration( const TiXmlDeclaration& copy )
-	: TiXmlNode( TiXmlNode::TINYXML_DECLARATION )
+TiXmlPath::~TiXmlPath()
 {
-	copy.CopyTo( this );	
+	delete [] steps;
+	delete [] predicates;
 }
 
 
-TiXmlDeclaration& TiXmlDeclaration::operator=( const TiXmlDeclaration& copy )
+void TiXmlPath::Reset()
 {
-	Clear();
-	copy.CopyTo( this );
-	return *this;
+	text = "";
+	absolute = false;
+	unique = false;
+	sort = false;
+	stepCount = 0;
+	predicateCount = 0;
+	error = false;
+	errorDesc = "";
+	errorOffset = 0;
 }
 
 
-void TiXmlDeclaration::Print( FILE* cfile, int /*depth*/, TIXML_STRING* str ) const
+bool TiXmlPath::Fail( const char* desc, const char* at )
 {
-	if ( cfile ) fprintf( cfile, "<?xml " );
-	if ( str )	 (*str) += "<?xml ";
+	error = true;
+	errorDesc = desc;
+	errorOffset = (int)( at - text.c_str() );
+	stepCount = 0;
+	predicateCount = 0;
+	return false;
+}
 
-	if ( !version.empty() ) {
-		if ( cfile ) fprintf (cfile, "version=\"%s\" ", version.c_str ());
-		if ( str ) { (*str) += "version=\""; (*str) += version; (*str) += "\" "; }
-	}
-	if ( !encoding.empty() ) {
-		if ( cfile ) fprintf (cfile, "encoding=\"%s\" ", encoding.c_str ());
-		if ( str ) { (*str) += "encoding=\""; (*str) += encoding; (*str) += "\" "; }
-	}
-	if ( !standalone.empty() ) {
-		if ( cfile ) fprintf (cfile, "standalone=\"%s\" ", standalone.c_str ());
-		if ( str ) { (*str) += "standalone=\""; (*str) += standalone; (*str) += "\" "; }
+
+TiXmlPath::Step* TiXmlPath::AddStep()
+{
+	if ( stepCount == stepCapacity )
+	{
+		int grown = stepCapacity ? 2 * stepCapacity : 8;
+		Step* bigger = new Step[ grown ];
+		for ( int i = 0; i < stepCount; ++i )
+			bigger[i] = steps[i];
+		delete [] steps;
+		steps = bigger;
+		stepCapacity = grown;
 	}
-	if ( cfile ) fprintf( cfile, "?>" );
-	if ( str )	 (*str) += "?>";
+	Step* step = &steps[ stepCount++ ];
+	step->kind = STEP_ELEMENT;
+	step->descendants = false;
+	step->name = "";
+	step->firstPredicate = predicateCount;
+	step->predicateCount = 0;
+	return step;
 }
 
 
-void TiXmlDeclaration::CopyTo( TiXmlDeclaration* target ) const
+TiXmlPath::Predicate* TiXmlPath::AddPredicate()
 {
-	TiXmlNode::CopyTo( target );
-
-	target->version = version;
-	target->encoding = encoding;
-	target->standalone = standalone;
+	if ( predicateCount == predicateCapacity )
+	{
+		int grown = predicateCapacity ? 2 * predicateCapacity : 8;
+		Predicate* bigger = new Predicate[ grown ];
+		for ( int i = 0; i < predicateCount; ++i )
+			bigger[i] = predicates[i];
+		delete [] predicates;
+		predicates = bigger;
+		predicateCapacity = grown;
+	}
+	Predicate* predicate = &predicates[ predicateCount++ ];
+	predicate->kind = PREDICATE_EXISTS;
+	predicate->op = OP_EQUAL;
+	predicate->position = 0;
+	predicate->name = "";
+	predicate->literal = "";
+	predicate->number = 0;
+	return predicate;
 }
 
 
-bool TiXmlDeclaration::Accept( TiXmlVisitor* visitor ) const
+bool TiXmlPath::Compile( const char* path )
 {
-	return visitor->Visit( *this );
-}
+	// 'path' may be Path() itself.
+	TIXML_STRING source( path ? path : "" );
+	Reset();
+	text = source;
 
+	const char* p = text.c_str();
+	if ( !*p )
+		return Fail( PATH_ERROR_EMPTY, p );
 
-TiXmlNode* TiXmlDeclaration::Clone() const
-{	
-	TiXmlDeclaration* clone = new TiXmlDeclaration();
+	bool descendants = false;
+	if ( *p == '/' )
+	{
+		absolute = true;
+		++p;
+		if ( *p == '/' )
+		{
+			descendants = true;
+			++p;
+		}
+		else if ( !*p )
+		{
+			return true;		// "/" is the document
+		}
+	}
 
-	if ( !clone )
-		return 0;
+	for ( ;; )
+	{
+		p = ReadStep( p, descendants );
+		if ( !p )
+			return false;
+		if ( !*p )
+			break;
+		if ( *p != '/' )
+			return Fail( PATH_ERROR_SLASH, p );
+		if ( steps[ stepCount - 1 ].kind == STEP_ATTRIBUTE )
+			return Fail( PATH_ERROR_ATTRIBUTE_LAST, p );
+
+		++p;
+		descendants = false;
+		if ( *p == '/' )
+		{
+			descendants = true;
+			++p;
+		}
+	}
 
-	CopyTo( clone );
-	return clone;
+	// Only a second "//", or a "..", can reach a node along two ways. After a
+	// "//" a node and one of its descendants can both go on to the next step,
+	// and what the first leads to needn't all come before what the second does.
+	int descendantSteps = 0;
+	for ( int i = 0; i < stepCount; ++i )
+	{
+		if ( descendantSteps && steps[i].kind != STEP_SELF && steps[i].kind != STEP_ATTRIBUTE )
+			sort = true;
+		if ( steps[i].descendants )
+			++descendantSteps;
+		if ( steps[i].kind == STEP_PARENT )
+			unique = sort = true;
+	}
+	if ( descendantSteps > 1 )
+		unique = true;
+	if ( sort )
+		unique = true;			// sorting looks the results up
+	return true;
 }
 
 
-void TiXmlUnknown::Print( FILE* cfile, int depth ) const
+const char* TiXmlPath::ReadStep( const char* p, bool descendants )
 {
-	for ( int i=0; i<depth; i++ )
-		fprintf( cfile, "    " );
-	fprintf( cfile, "<%s>", value.c_str() );
-}
+	Step* step = AddStep();
+	step->descendants = descendants;
 
+	if ( p[0] == '.' && p[1] == '.' )
+	{
+		step->kind = STEP_PARENT;
+		p += 2;
+	}
+	else if ( *p == '.' )
+	{
+		step->kind = STEP_SELF;
+		++p;
+	}
+	else
+	{
+		if ( *p == '@' )
+		{
+			step->kind = STEP_ATTRIBUTE;
+			++p;
+		}
+		if ( *p == '*' )
+		{
+			++p;
+		}
+		else
+		{
+			p = ReadPathName( p, &step->name );
+			if ( step->name.empty() )
+			{
+				Fail( step->kind == STEP_ATTRIBUTE ? PATH_ERROR_NAME : PATH_ERROR_STEP, p );
+				return 0;
+			}
+		}
+	}
 
-void TiXmlUnknown::CopyTo( TiXmlUnknown* target ) const
-{
-	TiXmlNode::CopyTo( target );
+	while ( *p == '[' )
+	{
+		if ( step->kind == STEP_ATTRIBUTE )
+		{
+			Fail( PATH_ERROR_ATTRIBUTE_PREDICATE, p );
+			return 0;
+		}
+		if ( step->predicateCount == MAX_PREDICATES )
+		{
+			Fail( PATH_ERROR_PREDICATES, p );
+			return 0;
+		}
+		p = ReadPredicate( p + 1, step );
+		if ( !p )
+			return 0;
+	}
+	return p;
 }
 
 
-bool TiXmlUnknown::Accept( TiXmlVisitor* visitor ) const
+const char* TiXmlPath::ReadPredicate( const char* p, Step* step )
 {
-	return visitor->Visit( *this );
-}
+	Predicate* predicate = AddPredicate();
+	++step->predicateCount;
 
+	p = SkipPathSpace( p );
+	if ( *p >= '0' && *p <= '9' )
+	{
+		const char* start = p;
+		int position = 0;
+		p = TiXmlBase::ReadInt( p, &position );
+		if ( !p || position < 1 )
+		{
+			Fail( PATH_ERROR_POSITION, start );
+			return 0;
+		}
+		predicate->kind = PREDICATE_POSITION;
+		predicate->position = position;
+	}
+	else if ( *p == '@' )
+	{
+		p = ReadPathName( p + 1, &predicate->name );
+		if ( predicate->name.empty() )
+		{
+			Fail( PATH_ERROR_NAME, p );
+			return 0;
+		}
 
-TiXmlNode* TiXmlUnknown::Clone() const
-{
-	TiXmlUnknown* clone = new TiXmlUnknown();
+		p = SkipPathSpace( p );
+		if ( *p != ']' )
+		{
+			const bool orEqual = ( p[1] == '=' );
+			if ( p[0] == '=' )
+				predicate->op = OP_EQUAL;
+			else if ( p[0] == '!' && orEqual )
+				predicate->op = OP_NOT_EQUAL;
+			else if ( p[0] == '<' )
+				predicate->op = orEqual ? OP_LESS_EQUAL : OP_LESS;
+			else if ( p[0] == '>' )
+				predicate->op = orEqual ? OP_GREATER_EQUAL : OP_GREATER;
+			else
+			{
+				Fail( PATH_ERROR_BRACKET, p );
+				return 0;
+			}
+			p += ( p[0] != '=' && orEqual ) ? 2 : 1;
 
-	if ( !clone )
+			p = SkipPathSpace( p );
+			if ( *p == '\'' || *p == '"' )
+			{
+				if ( predicate->op != OP_EQUAL && predicate->op != OP_NOT_EQUAL )
+				{
+					Fail( PATH_ERROR_TEXT_ORDER, p );
+					return 0;
+				}
+				const char* end = strchr( p + 1, *p );
+				if ( !end )
+				{
+					Fail( PATH_ERROR_QUOTE, p );
+					return 0;
+				}
+				predicate->kind = PREDICATE_STRING;
+				predicate->literal.assign( p + 1, end - p - 1 );
+				p = end + 1;
+			}
+			else
+			{
+				const char* end = TiXmlBase::ReadDouble( p, &predicate->number );
+				if ( !end )
+				{
+					Fail( PATH_ERROR_VALUE, p );
+					return 0;
+				}
+				predicate->kind = PREDICATE_NUMBER;
+				p = end;
+			}
+		}
+	}
+	else
+	{
+		Fail( PATH_ERROR_PREDICATE, p );
 		return 0;
+	}
 
-	CopyTo( clone );
-	return clone;
+	p = SkipPathSpace( p );
+	if ( *p != ']' )
+	{
+		Fail( PATH_ERROR_BRACKET, p );
+		return 0;
+	}
+	return p + 1;
 }
 
 
-TiXmlAttributeSet::TiXmlAttributeSet()
+void TiXmlPath::Evaluate( Run* run, const TiXmlNode* context ) const
 {
-	sentinel.next = &sentinel;
-	sentinel.prev = &sentinel;
-}
+	if ( error || !context )
+		return;
 
+	const TiXmlDocument* document = context->GetDocument();
+	for ( int i = 0; i < stepCount; ++i )
+		run->atoms[i] = ( document && !steps[i].name.empty() ) ? document->Interned( steps[i].name.c_str() ) : TiXmlAtom();
+	for ( int i = 0; i < predicateCount; ++i )
+		run->atoms[ stepCount + i ] = ( document && !predicates[i].name.empty() ) ? document->Interned( predicates[i].name.c_str() ) : TiXmlAtom();
 
-TiXmlAttributeSet::~TiXmlAttributeSet()
-{
-	assert( sentinel.next == &sentinel );
-	assert( sentinel.prev == &sentinel );
+	if ( absolute )
+	{
+		while ( context->Parent() )
+			context = context->Parent();
+	}
+	Apply( run, 0, context );
+
+	if ( sort && run->result )
+	{
+		// ".." can lead out of the tree of 'context'.
+		const TiXmlNode* top = context;
+		while ( top->Parent() )
+			top = top->Parent();
+		run->result->Sort( top );
+	}
 }
 
 
-void TiXmlAttributeSet::Add( TiXmlAttribute* addMe )
+bool TiXmlPath::Apply( Run* run, int index, const TiXmlNode* node ) const
 {
-    #ifdef TIXML_USE_STL
-	assert( !Find( TIXML_STRING( addMe->Name() ) ) );	// Shouldn't be multiply adding to the set.
-	#else
-	assert( !Find( addMe->Name() ) );	// Shouldn't be multiply adding to the set.
-	#endif
+	if ( index == stepCount )
+		return Selected( run, node, 0 );
 
-	addMe->next = &sentinel;
-	addMe->prev = sentinel.prev;
-
-	sentinel.prev->next = addMe;
-	sentinel.prev      = addMe;
-}
-
-void TiXmlAttributeSet::Remove( TiXmlAttribute* removeMe )
-{
-	TiXmlAttribute* node;
+	const Step& step = steps[ index ];
+	if ( !step.descendants )
+		return ApplyHere( run, index, node );
 
-	for( node = sentinel.next; node != &sentinel; node = node->next )
+	if ( step.kind == STEP_ELEMENT )
 	{
-		if ( node == removeMe )
+		// Go through the children in order, each followed by its own
+		// descendants, so that what is selected comes in document order.
+		int positions[ MAX_PREDICATES ] = { 0 };
+		bool done = false;
+		const TiXmlAtom atom = run->atoms[ index ];
+		for ( const TiXmlNode* child = node->FirstChild(); child; child = child->NextSibling() )
 		{
-			node->prev->next = node->next;
-			node->next->prev = node->prev;
-			node->next = 0;
-			node->prev = 0;
-			return;
+			if ( child->Type() != TiXmlNode::TINYXML_ELEMENT )
+				continue;
+			if (    !done
+				 && ( step.name.empty() || ( atom.Name() ? child->Is( atom ) : step.name == child->Value() ) )
+				 && Passes( run, step, child, positions, &done )
+				 && !Apply( run, index + 1, child ) )
+				return false;
+			if ( !Apply( run, index, child ) )
+				return false;
 		}
+		return true;
 	}
-	assert( 0 );		// we tried to remove a non-linked attribute.
-}
-
 
-#ifdef TIXML_USE_STL
-TiXmlAttribute* TiXmlAttributeSet::Find( const std::string& name ) const
-{
-	for( TiXmlAttribute* node = sentinel.next; node != &sentinel; node = node->next )
+	if ( !ApplyHere( run, index, node ) )
+		return false;
+	for ( const TiXmlNode* child = node->FirstChild(); child; child = child->NextSibling() )
 	{
-		if ( node->name == name )
-			return node;
-	}
-	return 0;
-}
-
-TiXmlAttribute* TiXmlAttributeSet::FindOrCreate( const std::string& _name )
-{
-	TiXmlAttribute* attrib = Find( _name );
-	if ( !attrib ) {
-		attrib = new TiXmlAttribute();
-		Add( attrib );
-		attrib->SetName( _name );
+		if ( child->Type() == TiXmlNode::TINYXML_ELEMENT && !Apply( run, index, child ) )
+			return false;
 	}
-	return attrib;
+	return true;
 }
-#endif
 
 
-TiXmlAttribute* TiXmlAttributeSet::Find( const char* name ) const
+bool TiXmlPath::ApplyHere( Run* run, int index, const TiXmlNode* node ) const
 {
-	for( TiXmlAttribute* node = sentinel.next; node != &sentinel; node = node->next )
+	const Step& step = steps[ index ];
+	int positions[ MAX_PREDICATES ] = { 0 };
+	bool done = false;
+
+	switch ( step.kind )
 	{
-		if ( strcmp( node->name.c_str(), name ) == 0 )
-			return node;
+	case STEP_ELEMENT:
+		{
+			const TiXmlAtom atom = run->atoms[ index ];
+			const TiXmlElement* child;
+			if ( step.name.empty() )
+				child = node->FirstChildElement();
+			else if ( atom.Name() )
+				child = node->FirstChildElement( atom );
+			else
+				child = node->FirstChildElement( step.name.c_str() );
+
+			while ( child && !done )
+			{
+				if ( Passes( run, step, child, positions, &done ) && !Apply( run, index + 1, child ) )
+					return false;
+
+				if ( step.name.empty() )
+					child = child->NextSiblingElement();
+				else if ( atom.Name() )
+					child = child->NextSiblingElement( atom );
+				else
+					child = child->NextSiblingElement( step.name.c_str() );
+			}
+			return true;
+		}
+
+	case STEP_SELF:
+		return !Passes( run, step, node, positions, &done ) || Apply( run, index + 1, node );
+
+	case STEP_PARENT:
+		return !node->Parent() || !Passes( run, step, node->Parent(), positions, &done ) || Apply( run, index + 1, node->Parent() );
+
+	case STEP_ATTRIBUTE:
+		{
+			const TiXmlElement* element = node->ToElement();
+			if ( !element )
+				return true;
+			if ( step.name.empty() )
+			{
+				for ( const TiXmlAttribute* attribute = element->FirstAttribute(); attribute; attribute = attribute->Next() )
+				{
+					if ( !Selected( run, node, attribute ) )
+						return false;
+				}
+				return true;
+			}
+			const TiXmlAtom atom = run->atoms[ index ];
+			const TiXmlAttribute* attribute = atom.Name() ? element->attributeSet.Find( atom ) : element->attributeSet.Find( step.name.c_str() );
+			return !attribute || Selected( run, node, attribute );
+		}
 	}
-	return 0;
+	return true;
 }
 
 
-TiXmlAttribute* TiXmlAttributeSet::FindOrCreate( const char* _name )
+bool TiXmlPath::Passes( const Run* run, const Step& step, const TiXmlNode* node, int* positions, bool* done ) const
 {
-	TiXmlAttribute* attrib = Find( _name );
-	if ( !attrib ) {
-		attrib = new TiXmlAttribute();
-		Add( attrib );
-		attrib->SetName( _name );
+	for ( int i = 0; i < step.predicateCount; ++i )
+	{
+		const Predicate& predicate = predicates[ step.firstPredicate + i ];
+		if ( predicate.kind == PREDICATE_POSITION )
+		{
+			if ( ++positions[i] != predicate.position )
+			{
+				// Nothing after this one can be at the position either.
+				if ( positions[i] > predicate.position )
+					*done = true;
+				return false;
+			}
+		}
+		else
+		{
+			const TiXmlElement* element = node->ToElement();
+			if ( !element || !Matches( run, step.firstPredicate + i, element ) )
+				return false;
+		}
 	}
-	return attrib;
+	return true;
 }
 
 
-#ifdef TIXML_USE_STL	
-std::istream& operator>> (std::istream & in, TiXmlNode & base)
+bool TiXmlPath::Matches( const Run* run, int index, const TiXmlElement* element ) const
 {
-	TIXML_STRING tag;
-	tag.reserve( 8 * 1000 );
-	base.StreamIn( &in, &tag );
-
-	base.Parse( tag.c_str(), 0, TIXML_DEFAULT_ENCODING );
-	return in;
-}
-#endif
+	const Predicate& predicate = predicates[ index ];
+	const TiXmlAtom atom = run->atoms[ stepCount + index ];
+	const TiXmlAttribute* attribute = atom.Name() ? element->attributeSet.Find( atom ) : element->attributeSet.Find( predicate.name.c_str() );
+	if ( !attribute )
+		return false;
 
+	switch ( predicate.kind )
+	{
+	case PREDICATE_STRING:
+		return ( predicate.literal == attribute->Value() ) == ( predicate.op == OP_EQUAL );
 
-#ifdef TIXML_USE_STL	
-std::ostream& operator<< (std::ostream & out, const TiXmlNode & base)
-{
-	TiXmlPrinter printer;
-	printer.SetStreamPrinting();
-	base.Accept( &printer );
-	out << printer.Str();
+	case PREDICATE_NUMBER:
+		{
+			double value = 0;
+			const char* end = TiXmlBase::ReadDouble( attribute->Value(), &value );
+			if ( !end || *SkipPathSpace( end ) )
+				return predicate.op == OP_NOT_EQUAL;		// not a number, so unequal to all
+			switch ( predicate.op )
+			{
+			case OP_EQUAL:			return value == predicate.number;
+			case OP_NOT_EQUAL:		return value != predicate.number;
+			case OP_LESS:			return value < predicate.number;
+			case OP_LESS_EQUAL:		return value <= predicate.number;
+			case OP_GREATER:		return value > predicate.number;
+			case OP_GREATER_EQUAL:	return value >= predicate.number;
+			}
+			return false;
+		}
 
-	return out;
+	default:
+		return true;
+	}
 }
 
 
-std::string& operator<< (std::string& out, const TiXmlNode& base )
+bool TiXmlPath::Selected( Run* run, const TiXmlNode* node, const TiXmlAttribute* attribute ) const
 {
-	TiXmlPrinter printer;
-	printer.SetStreamPrinting();
-	base.Accept( &printer );
-	out.append( printer.Str() );
-
-	return out;
+	if ( run->result )
+	{
+		run->result->Add( node, attribute, unique );
+	}
+	else if ( run->first )
+	{
+		run->firstNode = node;
+		run->firstAttribute = attribute;
+		return false;
+	}
+	++run->count;
+	return true;
 }
-#endif
 
 
-TiXmlHandle TiXmlHandle::FirstChild() const
+int TiXmlPath::Select( const TiXmlNode* context, TiXmlPathResult* result ) const
 {
-	if ( node )
-	{
-		TiXmlNode* child = node->FirstChild();
-		if ( child )
-			return TiXmlHandle( child );
-	}
-	return TiXmlHandle( 0 );
+	result->Clear();
+	Run run( stepCount + predicateCount );
+	run.result = result;
+	Evaluate( &run, context );
+	return result->Count();
 }
 
 
-TiXmlHandle TiXmlHandle::FirstChild( const char * value ) const
+void TiXmlPath::SelectEach( const TiXmlNode* const* contexts, int count, TiXmlPathResult* results, int threads ) const
 {
-	if ( node )
+#ifdef TIXML_THREADS
+	if ( threads <= 0 )
+		threads = (int)std::thread::hardware_concurrency();
+	if ( threads > count )
+		threads = count;
+	if ( threads > 1 )
 	{
-		TiXmlNode* child = node->FirstChild( value );
-		if ( child )
-			return TiXmlHandle( child );
+		std::atomic< int > next( 0 );
+		auto work = [&]()
+		{
+			for ( int i = next++; i < count; i = next++ )
+				Select( contexts[i], &results[i] );
+		};
+
+		std::thread* helpers = new std::thread[ threads - 1 ];
+		for ( int i = 0; i < threads - 1; ++i )
+			helpers[i] = std::thread( work );
+		work();
+		for ( int i = 0; i < threads - 1; ++i )
+			helpers[i].join();
+		delete [] helpers;
+		return;
 	}
-	return TiXmlHandle( 0 );
+#else
+	(void)threads;
+#endif
+	for ( int i = 0; i < count; ++i )
+		Select( contexts[i], &results[i] );
 }
 
 
-TiXmlHandle TiXmlHandle::FirstChildElement() const
+const TiXmlNode* TiXmlPath::FindNode( const TiXmlNode* context ) const
 {
-	if ( node )
+	if ( sort )
 	{
-		TiXmlElement* child = node->FirstChildElement();
-		if ( child )
-			return TiXmlHandle( child );
+		TiXmlPathResult result;
+		return Select( context, &result ) ? result.Node( 0 ) : 0;
 	}
-	return TiXmlHandle( 0 );
+	Run run( stepCount + predicateCount );
+	run.first = true;
+	Evaluate( &run, context );
+	return run.firstNode;
 }
 
 
-TiXmlHandle TiXmlHandle::FirstChildElement( const char * value ) const
+const TiXmlElement* TiXmlPath::FindElement( const TiXmlNode* context ) const
 {
-	if ( node )
-	{
-		TiXmlElement* child = node->FirstChildElement( value );
-		if ( child )
-			return TiXmlHandle( child );
-	}
-	return TiXmlHandle( 0 );
+	const TiXmlNode* node = FindNode( context );
+	return node ? node->ToElement() : 0;
 }
 
 
-TiXmlHandle TiXmlHandle::Child( int count ) const
+const char* TiXmlPath::FindValue( const TiXmlNode* context ) const
 {
-	if ( node )
+	if ( sort )
 	{
-		int i;
-		TiXmlNode* child = node->FirstChild();
-		for (	i=0;
-				child && i<count;
-				child = child->NextSibling(), ++i )
-		{
-			// nothing
-		}
-		if ( child )
-			return TiXmlHandle( child );
+		TiXmlPathResult result;
+		return Select( context, &result ) ? result.Value( 0 ) : 0;
 	}
-	return TiXmlHandle( 0 );
+	Run run( stepCount + predicateCount );
+	run.first = true;
+	Evaluate( &run, context );
+	if ( run.firstAttribute )
+		return run.firstAttribute->Value();
+	const TiXmlElement* element = run.firstNode ? run.firstNode->ToElement() : 0;
+	return element ? element->GetText() : 0;
 }
 
 
-TiXmlHandle TiXmlHandle::Child( const char* value, int count ) const
+int TiXmlPath::Count( const TiXmlNode* context ) const
 {
-	if ( node )
+	if ( unique )
 	{
-		int i;
-		TiXmlNode* child = node->FirstChild( value );
-		for (	i=0;
-				child && i<count;
-				child = child->NextSibling( value ), ++i )
-		{
-			// nothing
-		}
-		if ( child )
-			return TiXmlHandle( child );
+		TiXmlPathResult result;
+		return Select( context, &result );
 	}
-	return TiXmlHandle( 0 );
+	Run run( stepCount + predicateCount );
+	Evaluate( &run, context );
+	return run.count;
 }
 
 
-TiXmlHandle TiXmlHandle::ChildElement( int count ) const
+// A steady clock, in seconds.
+static double TiXmlSeconds()
 {
-	if ( node )
-	{
-		int i;
-		TiXmlElement* child = node->FirstChildElement();
-		for (	i=0;
-				child && i<count;
-				child = child->NextSiblingElement(), ++i )
-		{
-			// nothing
-		}
-		if ( child )
-			return TiXmlHandle( child );
-	}
-	return TiXmlHandle( 0 );
+#if defined(_WIN32)
+	LARGE_INTEGER now, frequency;
+	QueryPerformanceCounter( &now );
+	QueryPerformanceFrequency( &frequency );
+	return (double)now.QuadPart / (double)frequency.QuadPart;
+#else
+	timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return now.tv_sec + now.tv_nsec * 1e-9;
+#endif
 }
 
 
-TiXmlHandle TiXmlHandle::ChildElement( const char* value, int count ) const
+TiXmlDirectoryLoader::TiXmlDirectoryLoader()
 {
-	if ( node )
-	{
-		int i;
-		TiXmlElement* child = node->FirstChildElement( value );
-		for (	i=0;
-				child && i<count;
-				child = child->NextSiblingElement( value ), ++i )
-		{
-			// nothing
-		}
-		if ( child )
-			return TiXmlHandle( child );
-	}
-	return TiXmlHandle( 0 );
+	threads = 0;
+	extension = ".xml";
+	condense = TiXmlBase::IsWhiteSpaceCondensed();
+	inSitu = false;
+	useArena = false;
+	encoding = TIXML_DEFAULT_ENCODING;
+	stopped = false;
+	files = 0;
+	fileCount = 0;
+	fileCapacity = 0;
 }
 
 
-bool TiXmlPrinter::VisitEnter( const TiXmlDocument& )
+TiXmlDirectoryLoader::~TiXmlDirectoryLoader()
 {
-	return true;
+	delete [] files;
 }
 
-bool TiXmlPrinter::VisitExit( const TiXmlDocument& )
+
+static int CompareFileNames( const void* a, const void* b )
 {
-	return true;
+	return strcmp( *static_cast< const char* const* >( a ), *static_cast< const char* const* >( b ) );
 }
 
-bool TiXmlPrinter::VisitEnter( const TiXmlElement& element, const TiXmlAttribute* firstAttribute )
+
+int TiXmlDirectoryLoader::Load( const char* directory, TiXmlLoadHandler* handler )
 {
-	DoIndent();
-	buffer += "<";
-	buffer += element.Value();
+	stopped = false;
+	fileCount = 0;
+	if ( !ListFiles( directory ) )
+		return -1;
+	if ( !fileCount )
+		return 0;
 
-	for( const TiXmlAttribute* attrib = firstAttribute; attrib; attrib = attrib->Next() )
-	{
-		buffer += " ";
-		attrib->Print( 0, 0, &buffer );
-	}
+	const char** names = new const char*[ fileCount ];
+	for ( int i = 0; i < fileCount; ++i )
+		names[i] = files[i].c_str();
+	qsort( names, fileCount, sizeof( const char* ), CompareFileNames );
 
-	if ( !element.FirstChild() ) 
-	{
-		buffer += " />";
-		DoLineBreak();
-	}
-	else 
-	{
-		buffer += ">";
-		if (    element.FirstChild()->ToText()
-			  && element.LastChild() == element.FirstChild()
-			  && element.FirstChild()->ToText()->CDATA() == false )
-		{
-			simpleTextPrint = true;
-			// no DoLineBreak()!
-		}
-		else
-		{
-			DoLineBreak();
-		}
-	}
-	++depth;	
-	return true;
+	int loaded = LoadFiles( names, fileCount, handler );
+	delete [] names;
+	return loaded;
 }
 
 
-bool TiXmlPrinter::VisitExit( const TiXmlElement& element )
+bool TiXmlDirectoryLoader::ListFiles( const char* directory )
 {
-	--depth;
-	if ( !element.FirstChild() ) 
-	{
-		// nothing.
-	}
-	else 
+#if defined(_WIN32)
+	TIXML_STRING pattern( directory );
+	pattern += "\\*";
+	WIN32_FIND_DATAA found;
+	HANDLE search = FindFirstFileA( pattern.c_str(), &found );
+	if ( search == INVALID_HANDLE_VALUE )
+		return GetLastError() == ERROR_FILE_NOT_FOUND;
+	do
 	{
-		if ( simpleTextPrint )
-		{
-			simpleTextPrint = false;
-		}
-		else
-		{
-			DoIndent();
-		}
-		buffer += "</";
-		buffer += element.Value();
-		buffer += ">";
-		DoLineBreak();
+		if ( !( found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) )
+			AddFile( directory, found.cFileName );
 	}
+	while ( FindNextFileA( search, &found ) );
+	FindClose( search );
+	return true;
+#else
+	DIR* dir = opendir( directory );
+	if ( !dir )
+		return false;
+	for ( dirent* entry = readdir( dir ); entry; entry = readdir( dir ) )
+		AddFile( directory, entry->d_name );
+	closedir( dir );
 	return true;
+#endif
 }
 
 
-bool TiXmlPrinter::Visit( const TiXmlText& text )
+void TiXmlDirectoryLoader::AddFile( const char* directory, const char* name )
 {
-	if ( text.CDATA() )
-	{
-		DoIndent();
-		buffer += "<![CDATA[";
-		buffer += text.Value();
-		buffer += "]]>";
-		DoLineBreak();
-	}
-	else if ( simpleTextPrint )
+	const size_t length = strlen( name );
+	const size_t extensionLength = extension.length();
+	if ( length < extensionLength )
+		return;
+	for ( size_t i = 0; i < extensionLength; ++i )
 	{
-		TIXML_STRING str;
-		TiXmlBase::EncodeString( text.ValueTStr(), &str );
-		buffer += str;
+		if ( tolower( (unsigned char)name[ length - extensionLength + i ] ) != tolower( (unsigned char)extension[i] ) )
+			return;
 	}
-	else
+
+	TIXML_STRING path( directory );
+	if ( !path.empty() && path[ path.length() - 1 ] != '/' && path[ path.length() - 1 ] != '\\' )
+		path += '/';
+	path += name;
+
+#if !defined(_WIN32)
+	// Only regular files (or links to them); readdir() doesn't always say.
+	struct stat status;
+	if ( stat( path.c_str(), &status ) != 0 || !S_ISREG( status.st_mode ) )
+		return;
+#endif
+
+	if ( fileCount == fileCapacity )
 	{
-		DoIndent();
-		TIXML_STRING str;
-		TiXmlBase::EncodeString( text.ValueTStr(), &str );
-		buffer += str;
-		DoLineBreak();
+		int grown = fileCapacity ? 2 * fileCapacity : 64;
+		TIXML_STRING* bigger = new TIXML_STRING[ grown ];
+		for ( int i = 0; i < fileCount; ++i )
+			bigger[i] = files[i];
+		delete [] files;
+		files = bigger;
+		fileCapacity = grown;
 	}
-	return true;
+	files[ fileCount++ ] = path;
 }
 
 
-bool TiXmlPrinter::Visit( const TiXmlDeclaration& declaration )
+bool TiXmlDirectoryLoader::LoadOne( const char* filename, TiXmlLoadHandler* handler, bool* ok ) const
 {
-	DoIndent();
-	declaration.Print( 0, 0, &buffer );
-	DoLineBreak();
-	return true;
-}
+	TiXmlDocument document;
+	document.SetCondenseWhiteSpace( condense );
+	document.SetInSitu( inSitu );
+	document.SetUseArena( useArena );
 
+	const double start = TiXmlSeconds();
+	*ok = document.LoadFile( filename, encoding );
+	const double seconds = TiXmlSeconds() - start;
 
-bool TiXmlPrinter::Visit( const TiXmlComment& comment )
-{
-	DoIndent();
-	buffer += "<!--";
-	buffer += comment.Value();
-	buffer += "-->";
-	DoLineBreak();
-	return true;
+	return handler->Loaded( filename, document, seconds );
 }
 
 
-bool TiXmlPrinter::Visit( const TiXmlUnknown& unknown )
+int TiXmlDirectoryLoader::LoadFiles( const char* const* filenames, int count, TiXmlLoadHandler* handler )
 {
-	DoIndent();
-	buffer += "<";
-	buffer += unknown.Value();
-	buffer += ">";
-	DoLineBreak();
-	return true;
-}
+	stopped = false;
+
+#ifdef TIXML_THREADS
+	int pool = threads > 0 ? threads : (int)std::thread::hardware_concurrency();
+	if ( pool > count )
+		pool = count;
+	if ( pool > 1 )
+	{
+		// Each thread takes the next file that nobody has, until they run out.
+		std::atomic< int > next( 0 );
+		std::atomic< int > loaded( 0 );
+		std::atomic< bool > stop( false );
+		auto work = [&]()
+		{
+			for ( int i = next++; i < count && !stop; i = next++ )
+			{
+				bool ok = false;
+				if ( !LoadOne( filenames[i], handler, &ok ) )
+					stop = true;
+				if ( ok )
+					++loaded;
+			}
+		};
+
+		std::thread* helpers = new std::thread[ pool - 1 ];
+		for ( int i = 0; i < pool - 1; ++i )
+			helpers[i] = std::thread( work );
+		work();
+		for ( int i = 0; i < pool - 1; ++i )
+			helpers[i].join();
+		delete [] helpers;
+
+		stopped = stop;
+		return loaded;
+	}
+#endif
 
+	int loaded = 0;
+	for ( int i = 0; i < count && !stopped; ++i )
+	{
+		bool ok = false;
+		if ( !LoadOne( filenames[i], handler, &ok ) )
+			stopped = true;
+		if ( ok )
+			++loaded;
+	}
+	return loaded;
+}
@@ -43,6 +43,20 @@ distribution.
 #define DEBUG
 #endif
 
+// Move constructors and assignment, and the functions that insert a node moved
+// from, need rvalue references: Visual Studio 2010 and later, or a C++11
+// compiler. Define TIXML_NO_RVALUE_REFS to leave them out.
+#if !defined( TIXML_NO_RVALUE_REFS ) && ( ( defined( _MSC_VER ) && _MSC_VER >= 1600 ) || __cplusplus >= 201103L )
+	#define TIXML_RVALUE_REFS
+#endif
+
+// TiXmlPath::SelectEach() spreads its work over threads with std::thread:
+// Visual Studio 2012 and later, or a C++11 compiler. Define TIXML_NO_THREADS
+// to do it all on the calling thread.
+#if !defined( TIXML_NO_THREADS ) && ( ( defined( _MSC_VER ) && _MSC_VER >= 1700 ) || __cplusplus >= 201103L )
+	#define TIXML_THREADS
+#endif
+
 #ifdef TIXML_USE_STL
 	#include <string>
  	#include <iostream>
@@ -80,14 +94,20 @@ distribution.
 	#endif
 #endif	
 
+class TiXmlNode;
 class TiXmlDocument;
 class TiXmlElement;
 class TiXmlComment;
 class TiXmlUnknown;
 class TiXmlAttribute;
+class TiXmlAttributeSet;
 class TiXmlText;
 class TiXmlDeclaration;
 class TiXmlParsingData;
+class TiXmlPathResult;
+class TiXmlArena;
+struct TiXmlCacheStamp;
+class TiXmlChildIndex;
 
 const int TIXML_MAJOR_VERSION = 2;
 const int TIXML_MINOR_VERSION = 6;
@@ -101,11 +121,205 @@ struct TiXmlCursor
 	TiXmlCursor()		{ Clear(); }
 	void Clear()		{ row = col = -1; }
 
+	// A pending location holds only the byte offset from the start of the
+	// parsed text (in 'col'); its document works out the row and column
+	// when they are asked for.
+	enum { PENDING = -2 };
+	void SetOffset( int offset )	{ row = PENDING; col = offset; }
+	bool Pending() const			{ return row == PENDING; }
+	int Offset() const				{ return col; }
+
 	int row;	// 0 based.
 	int col;	// 0 based.
 };
 
 
+/**	A block allocator for the objects of one parsed document. Allocation is a
+	pointer bump inside large blocks; nothing is freed individually, and all
+	memory is released at once by Reset() or the destructor.
+
+	A document with an arena (see TiXmlDocument::SetUseArena()) allocates its
+	nodes, attributes and, in non-STL mode, string storage here while it parses.
+	Deleting such an object runs its destructor but leaves its memory to the
+	arena.
+*/
+class TiXmlArena
+{
+public:
+	enum { DEFAULT_BLOCK_SIZE = 64 * 1024 };
+
+	TiXmlArena( size_t _blockSize = DEFAULT_BLOCK_SIZE );
+	~TiXmlArena();
+
+	/// Return 'size' bytes aligned to 'alignment', which must be a power of 2.
+	void* Allocate( size_t size, size_t alignment = sizeof( double ) );
+
+	/// Release everything allocated so far. One block is kept for reuse.
+	void Reset();
+
+	/// Bytes handed out since construction or the last Reset().
+	size_t BytesUsed() const		{ return used; }
+	/// Bytes currently held from the heap, including unused space in blocks.
+	size_t BytesReserved() const	{ return reserved; }
+
+	/// The arena that allocations on the calling thread currently go to, or null.
+	static TiXmlArena* Active();
+
+	/**	Makes an arena (or, given null, the heap) the target of TinyXml
+		allocations on the calling thread for the lifetime of the scope.
+		Scopes nest.
+	*/
+	class Scope
+	{
+	public:
+		Scope( TiXmlArena* arena );
+		~Scope();
+
+	private:
+		Scope( const Scope& );				// not implemented.
+		void operator=( const Scope& );		// not allowed.
+
+		TiXmlArena* previous;
+	};
+
+private:
+	TiXmlArena( const TiXmlArena& );		// not implemented.
+	void operator=( const TiXmlArena& );	// not allowed.
+
+	struct Block
+	{
+		Block*	next;
+		size_t	size;		// bytes of data following the header
+	};
+
+	static char* Data( Block* block )	{ return reinterpret_cast< char* >( block + 1 ); }
+
+	Block*	blocks;			// every block, most recent first
+	Block*	current;		// the block cursor points into
+	char*	cursor;
+	char*	limit;
+	size_t	blockSize;
+	size_t	used;
+	size_t	reserved;
+};
+
+
+/**	A whole file mapped into memory: mmap() on POSIX systems, a file mapping on
+	Windows. The pages are read from the file as they are touched, and belong to
+	the system's file cache rather than the heap.
+
+	The mapping is always followed by a null character (the rest of its last
+	page), so it can be parsed where it lies. Files that fill their last page
+	exactly, and empty files, are not mapped; read those instead.
+*/
+class TiXmlFileMap
+{
+public:
+	TiXmlFileMap();
+	~TiXmlFileMap();
+
+	/**	Map the file. With 'writable' set the mapping can be written to; written
+		pages become private copies, and the file is never changed.
+		Returns false if the file could not be mapped.
+	*/
+	bool Open( const char* filename, bool writable = false );
+
+	/// Unmap the file, if one is mapped.
+	void Close();
+
+	/// The contents of the file, or null if none is mapped.
+	char* Data() const		{ return data; }
+	/// The size of the file in bytes.
+	size_t Size() const		{ return size; }
+
+private:
+	TiXmlFileMap( const TiXmlFileMap& );	// not implemented.
+	void operator=( const TiXmlFileMap& );	// not allowed.
+
+	char*	data;
+	size_t	size;
+};
+
+
+/**	A name interned by a document (see TiXmlDocument::Intern()). The elements
+	and attributes a document parses or loads carry the atom of their name, so
+	the lookups that take one -- TiXmlNode::FirstChildElement( TiXmlAtom ),
+	TiXmlHandle::ChildElement( TiXmlAtom, int ), TiXmlElement::Attribute( TiXmlAtom )
+	and the like -- compare pointers instead of strings.
+
+	An atom belongs to the document that made it, and stays valid across
+	Clear() and later loads for as long as that document lives. Elements and
+	attributes added by hand, copied or renamed carry no atom; they are
+	compared by name, which gives the same answer more slowly.
+*/
+class TiXmlAtom
+{
+public:
+	/// A null atom, which matches nothing.
+	TiXmlAtom() : name( 0 )	{}
+
+	/// The interned name, or null.
+	const char* Name() const							{ return name; }
+
+	bool operator==( const TiXmlAtom& other ) const	{ return name == other.name; }
+	bool operator!=( const TiXmlAtom& other ) const	{ return name != other.name; }
+
+private:
+	friend class TiXmlNameTable;
+	explicit TiXmlAtom( const char* _name ) : name( _name )	{}
+
+	const char* name;
+};
+
+
+/*	[internal use] The names a document has interned. Each distinct name is
+	copied once into blocks of the table's own, on the heap rather than in an
+	arena, and is found again through a hash table (open addressing, linear
+	probing).
+*/
+class TiXmlNameTable
+{
+public:
+	TiXmlNameTable();
+	~TiXmlNameTable();
+
+	// The atom of the 'length' chars at 'name', interned if they aren't yet.
+	TiXmlAtom Intern( const char* name, size_t length );
+	// The atom of the 'length' chars at 'name' if they are interned, else a null atom.
+	TiXmlAtom Find( const char* name, size_t length ) const;
+
+private:
+	TiXmlNameTable( const TiXmlNameTable& );	// not implemented.
+	void operator=( const TiXmlNameTable& );	// not allowed.
+
+	enum { BLOCK_SIZE = 4096 };
+
+	struct Slot
+	{
+		const char*	name;		// null for an empty slot
+		size_t		length;
+		size_t		hash;
+	};
+
+	struct Block
+	{
+		Block*	next;
+	};
+
+	static size_t Hash( const char* name, size_t length );
+	void Rehash( size_t size );
+	// Copy 'length' chars and a terminator into the blocks.
+	const char* Store( const char* name, size_t length );
+
+	Slot*	slots;
+	size_t	slotCount;		// a power of two, at least twice 'count'
+	size_t	count;
+	Block*	blocks;			// every block, most recent first
+	char*	cursor;
+	char*	limit;
+};
+
+
 /**
 	Implements the interface to the "Visitor pattern" (see the Accept() method.)
 	If you call the Accept() method, it requires being passed a TiXmlVisitor
@@ -169,6 +383,117 @@ enum TiXmlEncoding
 
 const TiXmlEncoding TIXML_DEFAULT_ENCODING = TIXML_ENCODING_UNKNOWN;
 
+/*	[internal use]
+	Works out the row and column of pending locations (see TiXmlCursor) from the
+	text a document parsed. The start of every line is found on the first
+	Locate(), with one vectorized pass that counts the new lines and another
+	that records them; a location is then the binary search for its line plus
+	the columns up to it. Locating forward on the same line goes on from the
+	last location instead.
+
+	The text must stay as it was parsed while the index is in use. It is either
+	owned by the document (a file it loaded) or copied by Reset().
+*/
+class TiXmlLineIndex
+{
+public:
+	TiXmlLineIndex();
+	~TiXmlLineIndex();
+
+	/*	Start indexing 'text', which begins at the given row and column. With
+		'copy' set the index keeps a copy of the text, else the caller keeps
+		the text unchanged until Clear(). With 'newLines' set the text is a
+		file, whose LF+CR is two new lines (see TiXmlParsingData).
+	*/
+	void Reset( const char* text, bool copy, bool newLines, int row, int col, int tabsize, TiXmlEncoding encoding );
+	// The text from 'from' on is in another encoding than the text before.
+	void SetEncoding( TiXmlEncoding _encoding, int from );
+	// Index 'text', an edited form of the text, in its place; see Reset().
+	void Replace( const char* text, bool copy, bool newLines );
+	void Clear();
+
+	bool Active() const				{ return text != 0; }
+	const char* Text() const		{ return text; }
+
+	// Replace a pending location with its row and column.
+	void Locate( TiXmlCursor* cursor );
+
+private:
+	TiXmlLineIndex( const TiXmlLineIndex& );	// not implemented.
+	void operator=( const TiXmlLineIndex& );	// not allowed.
+
+	void Build();
+
+	const char* text;
+	char* copied;			// the copy of 'text', if Reset() made one
+	bool newLines;			// the text is a file; see Reset()
+	int row0, col0;			// where the text starts
+	int tabsize;
+	TiXmlEncoding encoding;
+	TiXmlEncoding headEncoding;	// the encoding before 'split', see SetEncoding()
+	int split;
+	int* lines;				// the offset of each line, built by the first Locate()
+	int lineCount;
+	int lastLine;			// the last location found, or -1
+	int lastOffset;
+	TiXmlCursor last;
+};
+
+
+/*	[internal use]
+	Collects what the nodes print, for a FILE or for a string. Output for a FILE
+	is gathered in a buffer and written with one fwrite() each time the buffer
+	fills, instead of an fprintf() for every tag, name and value. Output for a
+	string is appended to it. WriteEncoded() escapes a value the way
+	TiXmlBase::EncodeString() does, copying the runs of bytes that need no
+	escaping in one go.
+*/
+class TiXmlWriter
+{
+public:
+	TiXmlWriter( FILE* _file ) : file( _file ), str( 0 ), used( 0 ), flushed( 0 ), base( 0 ), marking( false ) {}
+	TiXmlWriter( TIXML_STRING* _str ) : file( 0 ), str( _str ), used( 0 ), flushed( 0 ), base( 0 ), marking( false ) {}
+	~TiXmlWriter()									{ Flush(); }
+
+	void Write( const char* text, size_t length );
+	void Write( const char* text )					{ Write( text, strlen( text ) ); }
+	void Put( char c )								{ if ( str ) *str += c; else { if ( used == BUFFER_SIZE ) Flush(); buffer[ used++ ] = c; } }
+	// Four spaces for each level of depth.
+	void Indent( int depth );
+	void WriteEncoded( const TIXML_STRING& value );
+
+	// Write out what is in the buffer.
+	void Flush();
+
+	/*	With marking on, each node written notes where it lies in the output as
+		its source range (see TiXmlNode::SourceBegin()), counting the next byte
+		as offset 'at'. TiXmlDocument::SaveChanges() uses it.
+	*/
+	void SetMarking( int at )						{ marking = true; base = at - Offset(); }
+	bool Marking() const							{ return marking; }
+	// The offset of the next byte, as marking counts it.
+	int Offset() const								{ return base + (int)( str ? str->length() : flushed + used ); }
+	// The node written from 'begin' up to here.
+	void Marked( const TiXmlNode* node, int begin )	{ if ( marking ) Mark( node, begin ); }
+
+private:
+	TiXmlWriter( const TiXmlWriter& );		// not implemented.
+	void operator=( const TiXmlWriter& );	// not allowed.
+
+	void Mark( const TiXmlNode* node, int begin );
+
+	enum { BUFFER_SIZE = 16384 };
+
+	FILE* file;
+	TIXML_STRING* str;
+	size_t used;
+	size_t flushed;			// bytes written to 'file' so far
+	int base;
+	bool marking;
+	char buffer[ BUFFER_SIZE ];
+};
+
+
 /** TiXmlBase is a base class for every class in TinyXml.
 	It does little except to establish that TinyXml classes
 	can be printed and provide some utility functions.
@@ -196,11 +521,20 @@ class TiXmlBase
 	friend class TiXmlNode;
 	friend class TiXmlElement;
 	friend class TiXmlDocument;
+	friend class TiXmlSaxParser;
+	friend class TiXmlWriter;
 
 public:
 	TiXmlBase()	:	userData(0)		{}
 	virtual ~TiXmlBase()			{}
 
+	/*	Every TinyXml object is allocated from the active TiXmlArena if there is
+		one, otherwise from the heap. A small header in front of the object
+		remembers which, so delete does the right thing for both.
+	*/
+	static void* operator new( size_t size );
+	static void operator delete( void* p );
+
 	/**	All TinyXml classes can print themselves to a filestream
 		or the string class (TiXmlString in non-STL mode, std::string
 		in STL mode.) Either or both cfile and str can be null.
@@ -210,17 +544,28 @@ public:
 		
 		(For an unformatted stream, use the << operator.)
 	*/
-	virtual void Print( FILE* cfile, int depth ) const = 0;
+	virtual void Print( FILE* cfile, int depth ) const;
+
+	// [internal use] Prints to 'out'; Print() and SaveFile() go through it.
+	virtual void Write( TiXmlWriter* out, int depth ) const = 0;
+
+	/**	@deprecated use TiXmlDocument::SetCondenseWhiteSpace(),
+		TiXmlSaxParser::SetCondenseWhiteSpace() or
+		TiXmlDirectoryLoader::SetCondenseWhiteSpace().
+
+		The world does not agree on whether white space should be kept or
+		not. In order to make everyone happy, TinyXml can condense all white
+		space into a single space or keep it. The default is to condense.
 
-	/**	The world does not agree on whether white space should be kept or
-		not. In order to make everyone happy, these global, static functions
-		are provided to set whether or not TinyXml will condense all white space
-		into a single space or not. The default is to condense. Note changing this
-		value is not thread safe.
+		Each document, SAX parser and directory loader has its own setting,
+		which is what parsing goes by. This global one is only the default they
+		take when they are made, and every constructor reads it without a lock.
+		So it may only be set once, at start-up, before any thread makes one of
+		them; setting it at any other time is a data race.
 	*/
 	static void SetCondenseWhiteSpace( bool condense )		{ condenseWhiteSpace = condense; }
 
-	/// Return the current white space setting.
+	/// Return the default white space setting.
 	static bool IsWhiteSpaceCondensed()						{ return condenseWhiteSpace; }
 
 	/** Return the position, in the original source file, of this node or attribute.
@@ -236,13 +581,18 @@ public:
 		(by adding or changing nodes and attributes) the new values will NOT update to
 		reflect changes in the document.
 
-		There is a minor performance cost to computing the row and column. Computation
-		can be disabled if TiXmlDocument::SetTabSize() is called with 0 as the value.
+		For a file it loads, the document keeps the text, and the parser only
+		notes where each node and attribute starts; the row and column are
+		worked out from the text the first time they are asked for. Text
+		parsed from memory stays the caller's, and in situ documents change
+		theirs, so those are worked out while parsing. Reparse() keeps a copy
+		of its text, and works them out on demand. Computation can be disabled if
+		TiXmlDocument::SetTabSize() is called with 0 as the value.
 
 		@sa TiXmlDocument::SetTabSize()
 	*/
-	int Row() const			{ return location.row + 1; }
-	int Column() const		{ return location.col + 1; }	///< See Row()
+	int Row() const;
+	int Column() const;		///< See Row()
 
 	void  SetUserData( void* user )			{ userData = user; }	///< Set a pointer to arbitrary user data.
 	void* GetUserData()						{ return userData; }	///< Get a pointer to arbitrary user data.
@@ -261,6 +611,39 @@ public:
 	*/
 	static void EncodeString( const TIXML_STRING& str, TIXML_STRING* out );
 
+	/**	Number conversions that don't depend on the locale: '.' is always the
+		decimal point. They are what the numeric attribute calls use.
+
+		ReadInt() and ReadDouble() skip leading white space and read a number,
+		returning a pointer just past it. If there is no number there, or an
+		integer doesn't fit in an int, they return null and leave 'value' alone.
+
+		WriteInt() and WriteDouble() write what printf's "%d" and "%g" would,
+		in the "C" locale, into 'buf', which must have room for
+		NUMBER_BUFFER_SIZE chars. They return the length written.
+	*/
+	static const char* ReadInt( const char* p, int* value );
+	static const char* ReadDouble( const char* p, double* value );		///< See ReadInt().
+	static int WriteInt( int value, char* buf );						///< See ReadInt().
+	static int WriteDouble( double value, char* buf );					///< See ReadInt().
+
+	enum { NUMBER_BUFFER_SIZE = 32 };
+
+	// [internal use] How a value borrowed by in-situ parsing has to be decoded.
+	enum
+	{
+		INSITU_ENTITIES	= 1,	// has entity references
+		INSITU_CONDENSE	= 2,	// has white space to condense
+		INSITU_UTF8		= 4,	// is UTF-8
+		INSITU_NEWLINES	= 8		// has CR+LF or CR to read as LF
+	};
+
+	/*	[internal use] Decodes 'length' chars read in situ, as described by 'flags',
+		into 'out'. 'out' may overlap 'in' from below. Returns the decoded length,
+		which is never more than 'length'.
+	*/
+	static size_t DecodeInSitu( char* out, const char* in, size_t length, int flags );
+
 	enum
 	{
 		TIXML_NO_ERROR = 0,
@@ -301,23 +684,50 @@ protected:
 	#ifdef TIXML_USE_STL
 	static bool	StreamWhiteSpace( std::istream * in, TIXML_STRING * tag );
 	static bool StreamTo( std::istream * in, int character, TIXML_STRING * tag );
+
+	/*	Appends to 'tag' the chars 'in' has buffered, up to the next 'stop',
+		'stop2' or null, in runs rather than one get() at a time. The char it
+		stops at is left in the stream, and the stream state is left alone, so
+		callers go on char by char from there as before. Returns that char,
+		or EOF if there isn't one buffered.
+	*/
+	static int StreamUntil( std::istream * in, TIXML_STRING * tag, char stop, char stop2 );
 	#endif
 
-	/*	Reads an XML name into the string provided. Returns
+	/*	Reads an XML name into the string provided (if any). Returns
 		a pointer just past the last character of the name,
 		or 0 if the function has an error.
 	*/
 	static const char* ReadName( const char* p, TIXML_STRING* name, TiXmlEncoding encoding );
 
+	// Where ReadText() found the text, for in-situ parsing.
+	struct TextSpan
+	{
+		const char* start;
+		const char* end;
+		int flags;			// INSITU_*
+	};
+
 	/*	Reads text. Returns a pointer past the given end tag.
 		Wickedly complex options, but it keeps the (sensitive) code in one place.
 	*/
 	static const char* ReadText(	const char* in,				// where to start
-									TIXML_STRING* text,			// the string read
-									bool ignoreWhiteSpace,		// whether to keep the white space
+									TIXML_STRING* text,			// the string read, or null
+									bool ignoreWhiteSpace,		// whether to condense the white space
 									const char* endTag,			// what ends this text
 									bool ignoreCase,			// whether to ignore case in the end tag
-									TiXmlEncoding encoding );	// the current encoding
+									TiXmlEncoding encoding,		// the current encoding
+									bool normalizeNewLines = false,	// read CR+LF and CR as LF
+									TextSpan* span = 0 );		// where the text is, if wanted
+
+	/*	Reads chars as they are (except for new lines, if asked) up to the given
+		end tag. Returns a pointer to the end tag, or to the end of the input.
+	*/
+	static const char* ReadRaw( const char* p, TIXML_STRING* text, const char* endTag, TiXmlEncoding encoding,
+								bool normalizeNewLines, TextSpan* span );
+
+	// In-situ parsing: make 'str' borrow [start, end) of the buffer being parsed.
+	static void Borrow( TIXML_STRING* str, const char* start, const char* end, int flags );
 
 	// If an entity has been found, transform it into a character.
 	static const char* GetEntity( const char* in, char* value, int* length, TiXmlEncoding encoding );
@@ -348,10 +758,14 @@ protected:
 		{
 			//strncpy( _value, p, *length );	// lots of compilers don't like this function (unsafe),
 												// and the null terminator isn't needed
-			for( int i=0; p[i] && i<*length; ++i ) {
+			// A sequence cut short by the end of the input stops there, rather
+			// than stepping past the null terminator.
+			int i=0;
+			for( ; p[i] && i<*length; ++i ) {
 				_value[i] = p[i];
 			}
-			return p + (*length);
+			*length = i;
+			return p + i;
 		}
 		else
 		{
@@ -370,7 +784,12 @@ protected:
 
 	static const char* errorString[ TIXML_ERROR_STRING_COUNT ];
 
-	TiXmlCursor location;
+	// The document that can work out a pending location, if any.
+	virtual const TiXmlDocument* LocationDocument() const	{ return 0; }
+	// Make 'location' a row and column, if it is pending.
+	void ResolveLocation() const;
+
+	mutable TiXmlCursor location;
 
     /// Field containing a generic user pointer
 	void*			userData;
@@ -419,11 +838,19 @@ private:
 	Nodes have siblings, a parent, and children. A node can be
 	in a document, or stand on its own. The type of a TiXmlNode
 	can be queried, and it can be cast to its more defined type.
+
+	Thread safety: the const member functions don't change the DOM, so
+	several threads may read one document at once as long as none of them
+	changes it. Row() and Column() are the exception for a document that
+	works out locations on demand (see TiXmlBase::Row()): the first call
+	for a node writes its location. Anything that changes the DOM,
+	including TiXmlElement::BuildChildIndex(), needs the readers to wait.
 */
 class TiXmlNode : public TiXmlBase
 {
 	friend class TiXmlDocument;
 	friend class TiXmlElement;
+	friend class TiXmlPath;			// compares atoms
 
 public:
 	#ifdef TIXML_USE_STL	
@@ -505,16 +932,39 @@ public:
 		Text:		the text string
 		@endverbatim
 	*/
-	void SetValue(const char * _value) { value = _value;}
+	void SetValue(const char * _value) { value = _value; Renamed(); }
 
     #ifdef TIXML_USE_STL
 	/// STL std::string form.
-	void SetValue( const std::string& _value )	{ value = _value; }
+	void SetValue( const std::string& _value )	{ value = _value; Renamed(); }
 	#endif
 
 	/// Delete all the children of this node. Does not affect 'this'.
 	void Clear();
 
+	/**	Where the node lies in the text it was parsed from, or was last written
+		to by TiXmlDocument::SaveChanges(): the offset of its first byte, and of
+		the byte after its last. Both are -1 for a node without one, such as a
+		node created since.
+	*/
+	int SourceBegin() const						{ return sourceBegin; }
+	int SourceEnd() const						{ return sourceEnd; }	///< See SourceBegin().
+
+	/**	True if the node, or something below it, has changed since its source
+		range was set; TiXmlDocument::SaveChanges() writes only such nodes.
+	*/
+	bool Edited() const							{ return edits != 0; }
+
+	// [internal use]
+	void SetSourceRange( int begin, int end ) const	{ sourceBegin = begin; sourceEnd = end; }
+
+	/*	[internal use]
+		Note a change to a node that has a source range: to the node itself, or
+		only to the start tag of an element. Its ancestors note EDITED_BELOW.
+	*/
+	enum { EDITED = 1, EDITED_TAG = 2, EDITED_BELOW = 4 };
+	void MarkEdited( int how = EDITED )			{ if ( sourceBegin >= 0 && !( edits & how ) ) NoteEdit( how ); }
+
 	/// One step up the DOM.
 	TiXmlNode* Parent()							{ return parent; }
 	const TiXmlNode* Parent() const				{ return parent; }
@@ -528,6 +978,11 @@ public:
 		// call the method, cast the return back to non-const.
 		return const_cast< TiXmlNode* > ((const_cast< const TiXmlNode* >(this))->FirstChild( _value ));
 	}
+	/// The first child of this node whose value is the name 'atom' stands for (see TiXmlAtom).
+	const TiXmlNode* FirstChild( TiXmlAtom atom ) const;
+	TiXmlNode* FirstChild( TiXmlAtom _atom ) {
+		return const_cast< TiXmlNode* > ((const_cast< const TiXmlNode* >(this))->FirstChild( _atom ));
+	}
 	const TiXmlNode* LastChild() const	{ return lastChild; }		/// The last child of this node. Will be null if there are no children.
 	TiXmlNode* LastChild()	{ return lastChild; }
 	
@@ -580,6 +1035,16 @@ public:
 	*/
 	TiXmlNode* InsertEndChild( const TiXmlNode& addThis );
 
+	#ifdef TIXML_RVALUE_REFS
+	/** Add a new node related to this, moving 'addThis' into it instead of copying it:
+		its children are relinked and its strings change hands, and 'addThis' is
+		left empty. See MoveClone(). Returns NULL if 'addThis' is this node or one of
+		its ancestors. The same holds for the other insert and replace functions that
+		take a node to move from.
+	*/
+	TiXmlNode* InsertEndChild( TiXmlNode&& addThis );
+	#endif
+
 
 	/** Add a new node related to this. Adds a child past the LastChild.
 
@@ -596,16 +1061,25 @@ public:
 		Returns a pointer to the new object or NULL if an error occured.
 	*/
 	TiXmlNode* InsertBeforeChild( TiXmlNode* beforeThis, const TiXmlNode& addThis );
+	#ifdef TIXML_RVALUE_REFS
+	TiXmlNode* InsertBeforeChild( TiXmlNode* beforeThis, TiXmlNode&& addThis );	///< Moves 'addThis', see InsertEndChild( TiXmlNode&& ).
+	#endif
 
 	/** Add a new node related to this. Adds a child after the specified child.
 		Returns a pointer to the new object or NULL if an error occured.
 	*/
 	TiXmlNode* InsertAfterChild(  TiXmlNode* afterThis, const TiXmlNode& addThis );
+	#ifdef TIXML_RVALUE_REFS
+	TiXmlNode* InsertAfterChild(  TiXmlNode* afterThis, TiXmlNode&& addThis );	///< Moves 'addThis', see InsertEndChild( TiXmlNode&& ).
+	#endif
 
 	/** Replace a child of this node.
 		Returns a pointer to the new object or NULL if an error occured.
 	*/
 	TiXmlNode* ReplaceChild( TiXmlNode* replaceThis, const TiXmlNode& withThis );
+	#ifdef TIXML_RVALUE_REFS
+	TiXmlNode* ReplaceChild( TiXmlNode* replaceThis, TiXmlNode&& withThis );	///< Moves 'withThis', see InsertEndChild( TiXmlNode&& ).
+	#endif
 
 	/// Delete a child of this node.
 	bool RemoveChild( TiXmlNode* removeThis );
@@ -637,6 +1111,12 @@ public:
 		return const_cast< TiXmlNode* >( (const_cast< const TiXmlNode* >(this))->NextSibling( _next ) );
 	}
 
+	/// Navigate to a sibling node with the name 'atom' stands for (see TiXmlAtom).
+	const TiXmlNode* NextSibling( TiXmlAtom ) const;
+	TiXmlNode* NextSibling( TiXmlAtom _next ) {
+		return const_cast< TiXmlNode* >( (const_cast< const TiXmlNode* >(this))->NextSibling( _next ) );
+	}
+
 	/** Convenience function to get through elements.
 		Calls NextSibling and ToElement. Will skip all non-Element
 		nodes. Returns 0 if there is not another element.
@@ -655,6 +1135,12 @@ public:
 		return const_cast< TiXmlElement* >( (const_cast< const TiXmlNode* >(this))->NextSiblingElement( _next ) );
 	}
 
+	/// Convenience function to get through elements, by atom (see TiXmlAtom).
+	const TiXmlElement* NextSiblingElement( TiXmlAtom ) const;
+	TiXmlElement* NextSiblingElement( TiXmlAtom _next ) {
+		return const_cast< TiXmlElement* >( (const_cast< const TiXmlNode* >(this))->NextSiblingElement( _next ) );
+	}
+
     #ifdef TIXML_USE_STL
 	const TiXmlElement* NextSiblingElement( const std::string& _value) const	{	return NextSiblingElement (_value.c_str ());	}	///< STL std::string form.
 	TiXmlElement* NextSiblingElement( const std::string& _value)				{	return NextSiblingElement (_value.c_str ());	}	///< STL std::string form.
@@ -672,6 +1158,12 @@ public:
 		return const_cast< TiXmlElement* >( (const_cast< const TiXmlNode* >(this))->FirstChildElement( _value ) );
 	}
 
+	/// Convenience function to get through elements, by atom (see TiXmlAtom).
+	const TiXmlElement* FirstChildElement( TiXmlAtom _atom ) const;
+	TiXmlElement* FirstChildElement( TiXmlAtom _atom ) {
+		return const_cast< TiXmlElement* >( (const_cast< const TiXmlNode* >(this))->FirstChildElement( _atom ) );
+	}
+
     #ifdef TIXML_USE_STL
 	const TiXmlElement* FirstChildElement( const std::string& _value ) const	{	return FirstChildElement (_value.c_str ());	}	///< STL std::string form.
 	TiXmlElement* FirstChildElement( const std::string& _value )				{	return FirstChildElement (_value.c_str ());	}	///< STL std::string form.
@@ -713,6 +1205,14 @@ public:
 	*/
 	virtual TiXmlNode* Clone() const = 0;
 
+	/** Create a node like Clone() does, but move this node into it: the children
+		are relinked rather than copied, and the strings change hands. This node
+		is left empty. Strings and nodes that belong to the document this node
+		came from -- read in situ, or into its arena -- are copied, as they can't
+		outlive it.
+	*/
+	virtual TiXmlNode* MoveClone() = 0;
+
 	/** Accept a hierchical visit the nodes in the TinyXML DOM. Every node in the 
 		XML tree will be conditionally visited and the host will be called back
 		via the TiXmlVisitor interface.
@@ -743,6 +1243,19 @@ protected:
 	// Copy to the allocated object. Shared functionality between Clone, Copy constructor,
 	// and the assignment operator.
 	void CopyTo( TiXmlNode* target ) const;
+	// Copy the nodes below this one to 'target', in one loop for any depth.
+	void CopyChildrenTo( TiXmlNode* target ) const;
+	// Move to the allocated object, which has no children. Shared functionality
+	// between MoveClone, the move constructor, and the move assignment.
+	void MoveTo( TiXmlNode* target );
+	/*	Make this node fit to leave its document: work out the locations, copy the
+		strings it doesn't own, and put the nodes below it that live in its
+		document's arena on the heap. One loop for any depth; MoveTo() does this
+		first.
+	*/
+	void Settle();
+	// Settle this node's own location and strings, not the nodes below it.
+	virtual void SettleThis();
 
 	#ifdef TIXML_USE_STL
 	    // The real work of the input operator.
@@ -752,20 +1265,64 @@ protected:
 	// Figure out what is at *p, and parse it. Returns null if it is not an xml node.
 	TiXmlNode* Identify( const char* start, TiXmlEncoding encoding );
 
+	virtual const TiXmlDocument* LocationDocument() const	{ return GetDocument(); }
+
+	/*	An element may index its children by value (see TiXmlChildIndex and
+		TiXmlElement::BuildChildIndex()). Changes to the children are passed on
+		to the index.
+	*/
+	// The index of this node's children, if it has one, or null.
+	const TiXmlChildIndex* ChildIndex() const;
+	void ChildLinked( const TiXmlNode* node );
+	void ChildUnlinked();
+	// A child was replaced or renamed.
+	void ChildrenChanged();
+	void DropChildIndex();
+	// The value has changed: drop its atom, and tell the parent.
+	void Renamed();
+	// MarkEdited() for a node that has a source range.
+	void NoteEdit( int how );
+	// Delete the nodes below this one without recursing; the links to them
+	// are left as they are.
+	void DeleteChildren();
+
 	TiXmlNode*		parent;
 	NodeType		type;
+	unsigned char	edits;		// EDITED and the rest, see MarkEdited()
 
 	TiXmlNode*		firstChild;
 	TiXmlNode*		lastChild;
 
 	TIXML_STRING	value;
+	TiXmlAtom		atom;		// of 'value', for an element its document parsed or loaded
 
 	TiXmlNode*		prev;
 	TiXmlNode*		next;
 
+	mutable int		sourceBegin;	// see SourceBegin(); a marking TiXmlWriter sets them
+	mutable int		sourceEnd;
+
 private:
 	TiXmlNode( const TiXmlNode& );				// not implemented.
+
+	// Whether the value is the name 'name' stands for: by atom if this node
+	// has one, by string if not.
+	bool Is( TiXmlAtom name ) const	{ return atom.Name() ? atom == name : ( name.Name() && strcmp( value.c_str(), name.Name() ) == 0 ); }
 	void operator=( const TiXmlNode& base );	// not allowed.
+
+	// Whether 'addThis' may become a child; sets the document's error if not.
+	bool Insertable( const TiXmlNode& addThis );
+	// For Settle(): replace this node, which is in the arena, with a settled
+	// copy on the heap that takes over the children. Returns the copy.
+	TiXmlNode* MoveOutOfArena();
+	#ifdef TIXML_RVALUE_REFS
+	// As Insertable, and refuses 'addThis' if it is this node or one of its ancestors.
+	bool Movable( const TiXmlNode& addThis );
+	#endif
+	// Link in 'node', a new node, for the insert and replace functions.
+	TiXmlNode* LinkBeforeChild( TiXmlNode* beforeThis, TiXmlNode* node );
+	TiXmlNode* LinkAfterChild( TiXmlNode* afterThis, TiXmlNode* node );
+	TiXmlNode* LinkReplaceChild( TiXmlNode* replaceThis, TiXmlNode* node );
 };
 
 
@@ -779,12 +1336,14 @@ private:
 class TiXmlAttribute : public TiXmlBase
 {
 	friend class TiXmlAttributeSet;
+	friend class TiXmlDocument;		// reads and writes caches
 
 public:
 	/// Construct an empty attribute.
 	TiXmlAttribute() : TiXmlBase()
 	{
 		document = 0;
+		owner = 0;
 		prev = next = 0;
 	}
 
@@ -795,6 +1354,7 @@ public:
 		name = _name;
 		value = _value;
 		document = 0;
+		owner = 0;
 		prev = next = 0;
 	}
 	#endif
@@ -805,9 +1365,18 @@ public:
 		name = _name;
 		value = _value;
 		document = 0;
+		owner = 0;
 		prev = next = 0;
 	}
 
+	#ifdef TIXML_RVALUE_REFS
+	/** Take over the name and value of another attribute. The name is copied
+		if that attribute is in an element, which finds it by its name.
+	*/
+	TiXmlAttribute( TiXmlAttribute&& move );
+	TiXmlAttribute& operator=( TiXmlAttribute&& move );
+	#endif
+
 	const char*		Name()  const		{ return name.c_str(); }		///< Return the name of this attribute.
 	const char*		Value() const		{ return value.c_str(); }		///< Return the value of this attribute.
 	#ifdef TIXML_USE_STL
@@ -823,7 +1392,7 @@ public:
 		IntValue() method with richer error checking.
 		If the value is an integer, it is stored in 'value' and 
 		the call returns TIXML_SUCCESS. If it is not
-		an integer, it returns TIXML_WRONG_TYPE.
+		an integer, or is too big for an int, it returns TIXML_WRONG_TYPE.
 
 		A specialized but useful call. Note that for success it returns 0,
 		which is the opposite of almost all other TinyXml calls.
@@ -832,17 +1401,17 @@ public:
 	/// QueryDoubleValue examines the value string. See QueryIntValue().
 	int QueryDoubleValue( double* _value ) const;
 
-	void SetName( const char* _name )	{ name = _name; }				///< Set the name of this attribute.
-	void SetValue( const char* _value )	{ value = _value; }				///< Set the value.
+	void SetName( const char* _name );									///< Set the name of this attribute.
+	void SetValue( const char* _value )	{ value = _value; Edited(); }	///< Set the value.
 
 	void SetIntValue( int _value );										///< Set the value from an integer.
 	void SetDoubleValue( double _value );								///< Set the value from a double.
 
     #ifdef TIXML_USE_STL
 	/// STL std::string form.
-	void SetName( const std::string& _name )	{ name = _name; }	
+	void SetName( const std::string& _name );
 	/// STL std::string form.	
-	void SetValue( const std::string& _value )	{ value = _value; }
+	void SetValue( const std::string& _value )	{ value = _value; Edited(); }
 	#endif
 
 	/// Get the next sibling attribute in the DOM. Returns null at end.
@@ -871,17 +1440,31 @@ public:
 		Print( cfile, depth, 0 );
 	}
 	void Print( FILE* cfile, int depth, TIXML_STRING* str ) const;
+	virtual void Write( TiXmlWriter* out, int depth ) const;
 
 	// [internal use]
 	// Set the document pointer so the attribute can report errors.
 	void SetDocument( TiXmlDocument* doc )	{ document = doc; }
 
+	// [internal use]
+	// Make the attribute fit to leave its document, see TiXmlNode::Settle().
+	void Settle();
+
 private:
 	TiXmlAttribute( const TiXmlAttribute& );				// not implemented.
 	void operator=( const TiXmlAttribute& base );	// not allowed.
 
+	virtual const TiXmlDocument* LocationDocument() const	{ return document; }
+	// The attribute has changed; its element's start tag has to be written again.
+	void Edited();
+
+	// Whether the name is the one 'atom' stands for, see TiXmlNode::Is().
+	bool Is( TiXmlAtom _atom ) const	{ return atom.Name() ? atom == _atom : ( _atom.Name() && strcmp( name.c_str(), _atom.Name() ) == 0 ); }
+
 	TiXmlDocument*	document;	// A pointer back to a document, for error reporting.
+	TiXmlAttributeSet* owner;	// The set the attribute is in, which indexes its name.
 	TIXML_STRING name;
+	TiXmlAtom atom;				// of 'name', if its document parsed or loaded it
 	TIXML_STRING value;
 	TiXmlAttribute*	prev;
 	TiXmlAttribute*	next;
@@ -899,6 +1482,10 @@ private:
 	This version is implemented with circular lists because:
 		- I like circular lists
 		- it demonstrates some independence from the (typical) doubly linked list.
+
+	The list keeps the attributes in document order. Once a set holds more than
+	INDEX_THRESHOLD attributes, their names are also kept in a hash table
+	(open addressing, linear probing) so Find() doesn't walk the list.
 */
 class TiXmlAttributeSet
 {
@@ -915,6 +1502,7 @@ public:
 	TiXmlAttribute* Last()					{ return ( sentinel.prev == &sentinel ) ? 0 : sentinel.prev; }
 
 	TiXmlAttribute*	Find( const char* _name ) const;
+	TiXmlAttribute*	Find( TiXmlAtom _name ) const;
 	TiXmlAttribute* FindOrCreate( const char* _name );
 
 #	ifdef TIXML_USE_STL
@@ -922,14 +1510,35 @@ public:
 	TiXmlAttribute* FindOrCreate( const std::string& _name );
 #	endif
 
+	// [internal use]
+	// The element the set belongs to, which hears of changes to the attributes.
+	void SetElement( TiXmlElement* _element )	{ element = _element; }
+
 
 private:
+	friend class TiXmlAttribute;	// renames go through Unindex() and Index()
+
 	//*ME:	Because of hidden/disabled copy-construktor in TiXmlAttribute (sentinel-element),
 	//*ME:	this class must be also use a hidden/disabled copy-constructor !!!
 	TiXmlAttributeSet( const TiXmlAttributeSet& );	// not allowed
 	void operator=( const TiXmlAttributeSet& );	// not allowed (as TiXmlAttribute)
 
+	enum { INDEX_THRESHOLD = 8 };	// sets with more attributes than this are indexed
+
+	static size_t Hash( const char* name );
+	// The slot of the attribute with this name, or the empty slot that ends its probe.
+	TiXmlAttribute** Slot( const char* name ) const;
+	void Index( TiXmlAttribute* attribute );
+	void Unindex( TiXmlAttribute* attribute );
+	void Rehash( size_t size );
+	// An attribute was added, removed or changed.
+	void Edited();
+
+	TiXmlElement* element;
 	TiXmlAttribute sentinel;
+	size_t count;
+	TiXmlAttribute** table;		// null until the set grows past INDEX_THRESHOLD
+	size_t tableSize;			// a power of two, at least twice 'count'
 };
 
 
@@ -939,6 +1548,10 @@ private:
 */
 class TiXmlElement : public TiXmlNode
 {
+	friend class TiXmlNode;			// indexes the children
+	friend class TiXmlDocument;		// reads and writes caches
+	friend class TiXmlPath;			// finds attributes
+
 public:
 	/// Construct an element.
 	TiXmlElement (const char * in_value);
@@ -950,6 +1563,11 @@ public:
 
 	TiXmlElement( const TiXmlElement& );
 
+	#ifdef TIXML_RVALUE_REFS
+	TiXmlElement( TiXmlElement&& move );
+	TiXmlElement& operator=( TiXmlElement&& move );
+	#endif
+
 	TiXmlElement& operator=( const TiXmlElement& base );
 
 	virtual ~TiXmlElement();
@@ -959,6 +1577,9 @@ public:
 	*/
 	const char* Attribute( const char* name ) const;
 
+	/// Attribute() by the atom of the name (see TiXmlAtom).
+	const char* Attribute( TiXmlAtom name ) const;
+
 	/** Given an attribute name, Attribute() returns the value
 		for the attribute of that name, or null if none exists.
 		If the attribute exists and can be converted to an integer,
@@ -983,6 +1604,8 @@ public:
 		does not exist, then TIXML_NO_ATTRIBUTE is returned.
 	*/	
 	int QueryIntAttribute( const char* name, int* _value ) const;
+	/// QueryIntAttribute() by the atom of the name (see TiXmlAtom).
+	int QueryIntAttribute( TiXmlAtom name, int* _value ) const;
 	/// QueryUnsignedAttribute examines the attribute - see QueryIntAttribute().
 	int QueryUnsignedAttribute( const char* name, unsigned* _value ) const;
 	/** QueryBoolAttribute examines the attribute - see QueryIntAttribute(). 
@@ -992,6 +1615,8 @@ public:
 	int QueryBoolAttribute( const char* name, bool* _value ) const;
 	/// QueryDoubleAttribute examines the attribute - see QueryIntAttribute().
 	int QueryDoubleAttribute( const char* name, double* _value ) const;
+	/// QueryDoubleAttribute() by the atom of the name (see TiXmlAtom).
+	int QueryDoubleAttribute( TiXmlAtom name, double* _value ) const;
 	/// QueryFloatAttribute examines the attribute - see QueryIntAttribute().
 	int QueryFloatAttribute( const char* name, float* _value ) const {
 		double d;
@@ -1034,6 +1659,10 @@ public:
 		return TIXML_WRONG_TYPE;
 	}
 
+	// Numbers skip the stream, and read the same way as QueryIntAttribute() and QueryDoubleAttribute().
+	int QueryValueAttribute( const std::string& name, int* outValue ) const		{ return QueryIntAttribute( name, outValue ); }
+	int QueryValueAttribute( const std::string& name, double* outValue ) const	{ return QueryDoubleAttribute( name, outValue ); }
+
 	int QueryValueAttribute( const std::string& name, std::string* outValue ) const
 	{
 		const TiXmlAttribute* node = attributeSet.Find( name );
@@ -1120,10 +1749,26 @@ public:
 	*/
 	const char* GetText() const;
 
+	/**	Index the children of this element by value, so that the named lookups
+		(FirstChild(), NextSibling(), FirstChildElement(), NextSiblingElement()
+		and their atom forms) find a child without walking the ones before it.
+		This pays off for an element with many children that is searched by
+		name again and again.
+
+		Appending a child keeps the index up to date. Inserting, removing,
+		replacing or renaming a child deletes it, and the lookups walk the
+		children again until BuildChildIndex() is called once more.
+
+		The lookups themselves never build or change the index; see the
+		thread safety note at TiXmlNode.
+	*/
+	void BuildChildIndex();
+
 	/// Creates a new Element and returns it - the returned element is a copy.
 	virtual TiXmlNode* Clone() const;
-	// Print the Element to a FILE stream.
-	virtual void Print( FILE* cfile, int depth ) const;
+	virtual TiXmlNode* MoveClone();
+	// Print the Element.
+	virtual void Write( TiXmlWriter* out, int depth ) const;
 
 	/*	Attribtue parsing starts: next char past '<'
 						 returns: next char past '>'
@@ -1140,6 +1785,8 @@ public:
 protected:
 
 	void CopyTo( TiXmlElement* target ) const;
+	void MoveTo( TiXmlElement* target );
+	virtual void SettleThis();
 	void ClearThis();	// like clear, but initializes 'this' object as well
 
 	// Used to be public [internal use]
@@ -1147,13 +1794,36 @@ protected:
 	virtual void StreamIn( std::istream * in, TIXML_STRING * tag );
 	#endif
 	/*	[internal use]
-		Reads the "value" of the element -- another element, or text.
-		This should terminate with the current end tag.
+		Reads the "value" of the element -- another element, or text -- and
+		the end tag. The elements inside it are read by the same loop, so the
+		depth of the document costs no stack.
 	*/
 	const char* ReadValue( const char* in, TiXmlParsingData* prevData, TiXmlEncoding encoding );
 
 private:
+	friend class TiXmlNode;			// copies the elements below a node
+
+	// Write '<', the name and the attributes.
+	void WriteStartTag( TiXmlWriter* out ) const;
+	// Copy the value and the attributes, but not the children.
+	void CopyTagTo( TiXmlElement* target ) const;
+	/*	Read the start tag, from the '<' to just past the '>'; 'open' is set if
+		the element has a value and an end tag to read, rather than ending
+		in "/>".
+	*/
+	const char* ReadStartTag( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding, TiXmlDocument* document, bool* open );
+	#ifdef TIXML_USE_STL
+	// For StreamIn(): stream to the end of the start tag. True if the value
+	// and the end tag follow.
+	bool StreamStartTag( std::istream* in, TIXML_STRING* tag );
+	// For StreamIn(): stream the value up to the end tag, or up to the start
+	// of an element inside it. True for the latter.
+	bool StreamValue( std::istream* in, TIXML_STRING* tag );
+	#endif
+
 	TiXmlAttributeSet attributeSet;
+	TiXmlChildIndex* childIndex;	// see BuildChildIndex()
+	mutable int sourceTagEnd;		// where the start tag ends, within the source range
 };
 
 
@@ -1170,13 +1840,18 @@ public:
 	}
 	TiXmlComment( const TiXmlComment& );
 	TiXmlComment& operator=( const TiXmlComment& base );
+	#ifdef TIXML_RVALUE_REFS
+	TiXmlComment( TiXmlComment&& move ) : TiXmlNode( TiXmlNode::TINYXML_COMMENT )	{ move.MoveTo( this ); }
+	TiXmlComment& operator=( TiXmlComment&& move )									{ if ( &move != this ) { Clear(); move.MoveTo( this ); } return *this; }
+	#endif
 
 	virtual ~TiXmlComment()	{}
 
 	/// Returns a copy of this Comment.
 	virtual TiXmlNode* Clone() const;
-	// Write this Comment to a FILE stream.
-	virtual void Print( FILE* cfile, int depth ) const;
+	virtual TiXmlNode* MoveClone();
+	// Write this Comment.
+	virtual void Write( TiXmlWriter* out, int depth ) const;
 
 	/*	Attribtue parsing starts: at the ! of the !--
 						 returns: next char past '>'
@@ -1235,14 +1910,18 @@ public:
 
 	TiXmlText( const TiXmlText& copy ) : TiXmlNode( TiXmlNode::TINYXML_TEXT )	{ copy.CopyTo( this ); }
 	TiXmlText& operator=( const TiXmlText& base )							 	{ base.CopyTo( this ); return *this; }
+	#ifdef TIXML_RVALUE_REFS
+	TiXmlText( TiXmlText&& move ) : TiXmlNode( TiXmlNode::TINYXML_TEXT )			{ move.MoveTo( this ); }
+	TiXmlText& operator=( TiXmlText&& move )									{ if ( &move != this ) { Clear(); move.MoveTo( this ); } return *this; }
+	#endif
 
-	// Write this text object to a FILE stream.
-	virtual void Print( FILE* cfile, int depth ) const;
+	// Write this text object.
+	virtual void Write( TiXmlWriter* out, int depth ) const;
 
 	/// Queries whether this represents text using a CDATA section.
 	bool CDATA() const				{ return cdata; }
 	/// Turns on or off a CDATA representation of text.
-	void SetCDATA( bool _cdata )	{ cdata = _cdata; }
+	void SetCDATA( bool _cdata )	{ cdata = _cdata; MarkEdited(); }
 
 	virtual const char* Parse( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding );
 
@@ -1256,7 +1935,9 @@ public:
 protected :
 	///  [internal use] Creates a new Element and returns it.
 	virtual TiXmlNode* Clone() const;
+	virtual TiXmlNode* MoveClone();
 	void CopyTo( TiXmlText* target ) const;
+	void MoveTo( TiXmlText* target );
 
 	bool Blank() const;	// returns true if all white space and new lines
 	// [internal use]
@@ -1284,6 +1965,8 @@ private:
 */
 class TiXmlDeclaration : public TiXmlNode
 {
+	friend class TiXmlDocument;		// reads and writes caches
+
 public:
 	/// Construct an empty declaration.
 	TiXmlDeclaration()   : TiXmlNode( TiXmlNode::TINYXML_DECLARATION ) {}
@@ -1302,6 +1985,10 @@ public:
 
 	TiXmlDeclaration( const TiXmlDeclaration& copy );
 	TiXmlDeclaration& operator=( const TiXmlDeclaration& copy );
+	#ifdef TIXML_RVALUE_REFS
+	TiXmlDeclaration( TiXmlDeclaration&& move ) : TiXmlNode( TiXmlNode::TINYXML_DECLARATION )	{ move.MoveTo( this ); }
+	TiXmlDeclaration& operator=( TiXmlDeclaration&& move )										{ if ( &move != this ) { Clear(); move.MoveTo( this ); } return *this; }
+	#endif
 
 	virtual ~TiXmlDeclaration()	{}
 
@@ -1314,11 +2001,13 @@ public:
 
 	/// Creates a copy of this Declaration and returns it.
 	virtual TiXmlNode* Clone() const;
+	virtual TiXmlNode* MoveClone();
 	// Print this declaration to a FILE stream.
 	virtual void Print( FILE* cfile, int depth, TIXML_STRING* str ) const;
 	virtual void Print( FILE* cfile, int depth ) const {
 		Print( cfile, depth, 0 );
 	}
+	virtual void Write( TiXmlWriter* out, int depth ) const;
 
 	virtual const char* Parse( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding );
 
@@ -1331,6 +2020,8 @@ public:
 
 protected:
 	void CopyTo( TiXmlDeclaration* target ) const;
+	void MoveTo( TiXmlDeclaration* target );
+	virtual void SettleThis();
 	// used to be public
 	#ifdef TIXML_USE_STL
 	virtual void StreamIn( std::istream * in, TIXML_STRING * tag );
@@ -1359,11 +2050,16 @@ public:
 
 	TiXmlUnknown( const TiXmlUnknown& copy ) : TiXmlNode( TiXmlNode::TINYXML_UNKNOWN )		{ copy.CopyTo( this ); }
 	TiXmlUnknown& operator=( const TiXmlUnknown& copy )										{ copy.CopyTo( this ); return *this; }
+	#ifdef TIXML_RVALUE_REFS
+	TiXmlUnknown( TiXmlUnknown&& move ) : TiXmlNode( TiXmlNode::TINYXML_UNKNOWN )			{ move.MoveTo( this ); }
+	TiXmlUnknown& operator=( TiXmlUnknown&& move )											{ if ( &move != this ) { Clear(); move.MoveTo( this ); } return *this; }
+	#endif
 
 	/// Creates a copy of this Unknown and returns it.
 	virtual TiXmlNode* Clone() const;
-	// Print this Unknown to a FILE stream.
-	virtual void Print( FILE* cfile, int depth ) const;
+	virtual TiXmlNode* MoveClone();
+	// Print this Unknown.
+	virtual void Write( TiXmlWriter* out, int depth ) const;
 
 	virtual const char* Parse( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding );
 
@@ -1406,11 +2102,74 @@ public:
 	TiXmlDocument( const TiXmlDocument& copy );
 	TiXmlDocument& operator=( const TiXmlDocument& copy );
 
-	virtual ~TiXmlDocument() {}
+	#ifdef TIXML_RVALUE_REFS
+	/** Take over the nodes of another document. Its locations are worked out and
+		its strings copied where they refer to its text, since that stays with it.
+	*/
+	TiXmlDocument( TiXmlDocument&& move );
+	TiXmlDocument& operator=( TiXmlDocument&& move );
+	#endif
+
+	virtual ~TiXmlDocument();
+
+	/** Delete all the children of the document. If the document has an arena,
+		the memory of everything parsed into it is released as well.
+	*/
+	void Clear();
+
+	/** Allocate the nodes, attributes and (in non-STL mode) strings created by
+		Parse() and LoadFile() from a per-document TiXmlArena instead of one heap
+		allocation each. Large documents load and Clear() much faster.
+
+		The memory of nodes removed from the document is not reused until the
+		next Clear() (which every LoadFile() does). Nodes added by the program
+		are allocated normally. Must be set before the load.
+	*/
+	void SetUseArena( bool _useArena )	{ useArena = _useArena; }
+	bool UseArena() const				{ return useArena; }
+
+	/// The arena of this document, or null if it has not parsed with one.
+	const TiXmlArena* Arena() const		{ return arena; }
+
+	/** Parse in situ: LoadFile() keeps the file contents in a buffer (or a
+		mapping) owned by the document, and the names and values of the DOM refer
+		to it instead of being copied. Entities and white space are decoded in place, the first time a
+		value is read. Together with SetUseArena(), a load allocates nothing per
+		string at all.
+
+		Short names and values fit in the string itself, so a copying load
+		only allocates the long ones; in situ saves those allocations but
+		keeps the whole file. The memory of a DOM is mostly its nodes and
+		attributes either way.
+
+		Since reading a value can write to the buffer, two threads must not read
+		the same in-situ document before its values have been read once.
+		Row() and Column() are exact. Must be set before the load; STL mode
+		ignores the setting.
+	*/
+	void SetInSitu( bool _inSitu )
+	{
+		#ifndef TIXML_USE_STL
+		inSitu = _inSitu;
+		#endif
+	}
+	bool InSitu() const					{ return inSitu; }
+
+	/**	Whether this document condenses white space when it parses. A new
+		document takes TiXmlBase::IsWhiteSpaceCondensed(); these hide the
+		static functions of the same names, so TiXmlDocument::SetCondenseWhiteSpace()
+		on a document sets only its own.
+	*/
+	void SetCondenseWhiteSpace( bool _condense )	{ condense = _condense; }
+	bool IsWhiteSpaceCondensed() const				{ return condense; }
 
 	/** Load a file using the current document value.
 		Returns true if successful. Will delete any existing
 		document data before loading.
+
+		Files loaded by name are mapped into memory (see TiXmlFileMap) and
+		parsed where they lie, where the platform allows; otherwise they are
+		read into a buffer. Either way, CR+LF and CR are read as LF.
 	*/
 	bool LoadFile( TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING );
 	/// Save a file using the current document value. Returns true if successful.
@@ -1428,6 +2187,86 @@ public:
 	/// Save a file using the given FILE*. Returns true if successful.
 	bool SaveFile( FILE* ) const;
 
+	/**	Save the changes made since the file was loaded, or last saved by this
+		function, to the file the document names (see Value()). Only the nodes
+		that changed are written (see TiXmlNode::Edited()): when each fits the
+		bytes it came from, padded with spaces inside its tags where need be,
+		it is written over them and the rest of the file is left alone; when
+		not, the file is rewritten from the first change on. A document parsed
+		from memory, loaded from a cache, or whose file has since changed size
+		or modification time, is written whole.
+
+		The file is changed where it lies, so a failure part of the way can
+		leave it damaged; SaveFile() to another name is the safe way. New lines
+		are written as LF. Returns true if successful.
+	*/
+	bool SaveChanges();
+
+	/**	The text this document was parsed from has been edited: 'removed' bytes
+		at 'offset' were replaced by 'inserted' others, giving 'text'. Parse
+		only the innermost element around the edit again, and move the source
+		ranges and locations of the nodes after it along.
+
+		The whole text is parsed again when that isn't possible: when the
+		document has no source ranges, has changed since they were set, is in
+		situ, or the edit isn't inside one element that still parses as one.
+		With a tab size other than 0, a document parsed from memory is parsed
+		whole the first time too, as its locations can't be moved without the
+		old text; from then on the document keeps a copy of the text.
+		Returns true if the new text parsed.
+	*/
+	bool Reparse( const char* text, int offset, int removed, int inserted, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING );
+
+	/** Intern 'name', and return the atom that the document's elements and
+		attributes of that name carry (see TiXmlAtom). An atom can be made
+		before the document is loaded, and keeps working after it is reloaded.
+	*/
+	TiXmlAtom Intern( const char* name )				{ return names.Intern( name, strlen( name ) ); }
+	#ifdef TIXML_USE_STL
+	TiXmlAtom Intern( const std::string& name )			{ return names.Intern( name.data(), name.length() ); }	///< STL std::string form.
+	#endif
+	// [internal use]
+	TiXmlAtom Intern( const char* name, size_t length )	{ return names.Intern( name, length ); }
+
+	/**	The atom of 'name' if the document has interned it, else a null atom.
+		Unlike Intern() it never adds a name, so threads may call it together.
+	*/
+	TiXmlAtom Interned( const char* name ) const		{ return names.Find( name, strlen( name ) ); }
+
+	/** Load a file through a cache: if 'cacheFile' holds a snapshot of 'filename'
+		as the file is now, load that (see LoadCache()), otherwise LoadFile() and
+		write the snapshot for next time (see SaveCache()). Returns true if
+		successful; a cache that can't be written doesn't make it fail.
+	*/
+	bool LoadCachedFile( const char* filename, const char* cacheFile, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING );
+
+	/** Save a binary snapshot of the document to 'cacheFile': a table of the
+		nodes and attributes in document order, and a pool that holds each
+		distinct name and value once, already decoded. It is stamped with the
+		size, modification time and a hash of the file named by Value(), which
+		the document should have been loaded from, and with the settings that
+		change what a parse gives ('encoding', the tab size and
+		SetCondenseWhiteSpace()). Returns false if the document has an error, or
+		either file can't be read or written.
+
+		The snapshot is of this build's memory layout, so it is a cache for the
+		machine that wrote it, not a file format to pass around.
+	*/
+	bool SaveCache( const char* cacheFile, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING ) const;
+
+	/** Load the snapshot SaveCache() wrote to 'cacheFile', if it was made from
+		'filename' as the file is now and with the same settings. The cache is
+		mapped into memory and checked; the nodes and attributes are built in
+		the document's arena (see SetUseArena(), which this doesn't need), and
+		in non-STL mode their names and values refer to the mapping. So a load
+		makes no allocation per node or string, and does no parsing.
+
+		Returns false, leaving the document empty and without an error, if the
+		cache is missing, stale or damaged. Row() and Column() are as they were
+		when the cache was saved.
+	*/
+	bool LoadCache( const char* filename, const char* cacheFile, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING );
+
 	#ifdef TIXML_USE_STL
 	bool LoadFile( const std::string& filename, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING )			///< STL std::string version.
 	{
@@ -1445,6 +2284,12 @@ public:
 	*/
 	virtual const char* Parse( const char* p, TiXmlParsingData* data = 0, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING );
 
+	/** Parse the given null terminated block of xml data in situ (see SetInSitu()).
+		The block is written to and must not be deleted before the document is
+		cleared or destroyed. In STL mode this is the same as Parse().
+	*/
+	const char* ParseInSitu( char* p, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING );
+
 	/** Get the root element -- the only top level element -- of the document.
 		In well formed XML, there should only be one. TinyXml is tolerant of
 		multiple elements at the document level.
@@ -1482,8 +2327,8 @@ public:
 		or input in any way.
 		
 		By calling this method, with a tab size
-		greater than 0, the row and column of each node and attribute is stored
-		when the file is loaded. Very useful for tracking the DOM back in to
+		greater than 0, the row and column of each node and attribute can be
+		found after the file is loaded. Very useful for tracking the DOM back in to
 		the source file.
 
 		The tab size is required for calculating the location of nodes. If not
@@ -1526,8 +2371,12 @@ public:
 
 	/// Print this Document to a FILE stream.
 	virtual void Print( FILE* cfile, int depth = 0 ) const;
+	virtual void Write( TiXmlWriter* out, int depth ) const;
 	// [internal use]
 	void SetError( int err, const char* errorLocation, TiXmlParsingData* prevData, TiXmlEncoding encoding );
+	// [internal use]
+	// Replace a pending location of one of this document's nodes with its row and column.
+	void ResolveLocation( TiXmlCursor* cursor ) const;
 
 	virtual const TiXmlDocument*    ToDocument()    const { return this; } ///< Cast to a more defined type. Will return null not of the requested type.
 	virtual TiXmlDocument*          ToDocument()          { return this; } ///< Cast to a more defined type. Will return null not of the requested type.
@@ -1539,12 +2388,35 @@ public:
 protected :
 	// [internal use]
 	virtual TiXmlNode* Clone() const;
+	virtual TiXmlNode* MoveClone();
 	#ifdef TIXML_USE_STL
 	virtual void StreamIn( std::istream * in, TIXML_STRING * tag );
 	#endif
 
 private:
 	void CopyTo( TiXmlDocument* target ) const;
+	void MoveTo( TiXmlDocument* target );
+
+	// Parse the contents of a file, with new lines normalized. With inSitu set,
+	// the DOM borrows 'p'.
+	void ParseFile( char* p, TiXmlEncoding encoding );
+
+	// Save and load a cache with the stamp of its source taken beforehand.
+	bool WriteCache( const char* cacheFile, const TiXmlCacheStamp& stamp, TiXmlEncoding encoding ) const;
+	bool ReadCache( const char* filename, const char* cacheFile, const TiXmlCacheStamp& stamp, TiXmlEncoding encoding );
+
+	// For SaveChanges(): write the whole file, marking where the nodes went.
+	bool SaveWhole();
+	// Take the DOM off the mapped file before it is written to.
+	void ReleaseSource();
+	// Note the file the source ranges now refer to.
+	void StampSource();
+	// Locate the nodes and attributes below the document, in one walk: before
+	// their text goes away, or before a walk that asks each of them.
+	void ResolveLocations() const;
+	// For Reparse(): move the nodes below 'node' but outside 'skip' along from
+	// offset 'end' on, and their locations from 'from' to 'to'.
+	void MoveSource( TiXmlNode* node, const TiXmlNode* skip, int end, int delta, const TiXmlCursor& from, const TiXmlCursor& to );
 
 	bool error;
 	int  errorId;
@@ -1552,6 +2424,205 @@ private:
 	int tabsize;
 	TiXmlCursor errorLocation;
 	bool useMicrosoftBOM;		// the UTF-8 BOM were found when read. Note this, and try to write.
+	bool useArena;
+	TiXmlArena* arena;			// created by the first Parse() with useArena set.
+	bool inSitu;
+	bool condense;				// white space, see SetCondenseWhiteSpace()
+	bool parsingInSitu;			// set by ParseInSitu() while it runs.
+	bool parsingFile;			// set by ParseFile() while it runs.
+	bool reparsing;				// set by Reparse() while it parses the whole text.
+	char* sourceBuffer;			// the file read by LoadFile(), kept for an in-situ DOM or lineIndex,
+	TiXmlFileMap sourceMap;		// or mapped by it. LoadCache() keeps the cache the same way.
+	mutable TiXmlLineIndex lineIndex;	// locates the nodes of the last Parse(), unless in situ.
+	TiXmlNameTable names;		// the atoms of the names; kept by Clear().
+	TiXmlEncoding sourceEncoding;	// found by the last Parse(), for Reparse()
+	long long fileSize;			// of the file the source ranges refer to, or -1; see SaveChanges()
+	long long fileTime;
+};
+
+
+/**	The attributes of an element, as TiXmlSaxParser reports them in
+	TiXmlSaxHandler::StartElement(). They are in document order. The names and
+	values are only valid during the callback.
+*/
+class TiXmlSaxAttributes
+{
+public:
+	/// The number of attributes.
+	int Count() const						{ return count; }
+	/// The name of the attribute at 'index', from 0 to Count()-1.
+	const char* Name( int index ) const		{ assert( index >= 0 && index < count ); return names[index].c_str(); }
+	/// The value of the attribute at 'index', from 0 to Count()-1.
+	const char* Value( int index ) const	{ assert( index >= 0 && index < count ); return values[index].c_str(); }
+	/// The value of the attribute with the given name, or null if there is none.
+	const char* Find( const char* name ) const;
+
+private:
+	friend class TiXmlSaxParser;
+
+	TiXmlSaxAttributes();
+	~TiXmlSaxAttributes();
+	TiXmlSaxAttributes( const TiXmlSaxAttributes& );	// not implemented.
+	void operator=( const TiXmlSaxAttributes& );		// not allowed.
+
+	// Make room for one more attribute and return its index. The strings of
+	// earlier elements are reused, so they keep their capacity.
+	int Add();
+	void Clear()							{ count = 0; }
+
+	TIXML_STRING* names;
+	TIXML_STRING* values;
+	int count;
+	int capacity;
+};
+
+
+/**	Implements the callbacks of a TiXmlSaxParser. Each returns true to go on
+	parsing, or false to stop it. The default implementations do nothing and go
+	on, so a handler only overrides what it needs.
+
+	The strings passed are only valid during the callback.
+
+	@sa TiXmlSaxParser
+*/
+class TiXmlSaxHandler
+{
+public:
+	virtual ~TiXmlSaxHandler() {}
+
+	/// Called before anything else is read.
+	virtual bool StartDocument()												{ return true; }
+	/// Called after the last event, if there was no error and nothing stopped the parse.
+	virtual bool EndDocument()													{ return true; }
+
+	/// Called for the <?xml ... ?> declaration. What it doesn't have is empty.
+	virtual bool Declaration( const char* /*version*/, const char* /*encoding*/, const char* /*standalone*/ )	{ return true; }
+	/// Called for a start tag, or an empty element tag, with its attributes.
+	virtual bool StartElement( const char* /*name*/, const TiXmlSaxAttributes& /*attributes*/ )	{ return true; }
+	/// Called for an end tag, and right after StartElement() for an empty element tag.
+	virtual bool EndElement( const char* /*name*/ )								{ return true; }
+	/// Called for text that isn't only white space, and for every CDATA section.
+	virtual bool Text( const char* /*text*/, bool /*cdata*/ )					{ return true; }
+	/// Called for a comment.
+	virtual bool Comment( const char* /*value*/ )								{ return true; }
+	/// Called for any other tag TinyXml doesn't know, like a DOCTYPE.
+	virtual bool Unknown( const char* /*value*/ )								{ return true; }
+};
+
+
+/**	Reads XML the way TiXmlDocument::Parse() does, but reports what it finds to
+	a TiXmlSaxHandler instead of building nodes. It uses the same tokenizer, so
+	names, text, entities, white space (see SetCondenseWhiteSpace())
+	and errors come out as they would in the DOM.
+
+	Nothing is kept once it is reported: the parser reuses its strings, so the
+	memory it needs only grows with the depth of the elements and the number
+	of attributes on one element, not with the size of the document. A large
+	log can be scanned like this:
+
+	@verbatim
+	class FrameCounter : public TiXmlSaxHandler
+	{
+	public:
+		FrameCounter() : frames( 0 ) {}
+		virtual bool StartElement( const char* name, const TiXmlSaxAttributes& )
+		{
+			if ( strcmp( name, "frame" ) == 0 )
+				++frames;
+			return true;
+		}
+		int frames;
+	};
+
+	FrameCounter counter;
+	TiXmlSaxParser parser;
+	if ( !parser.ParseFile( "motion.xml", &counter ) )
+		printf( "%s at %d,%d\n", parser.ErrorDesc(), parser.ErrorRow(), parser.ErrorCol() );
+	@endverbatim
+*/
+class TiXmlSaxParser
+{
+public:
+	TiXmlSaxParser();
+	~TiXmlSaxParser();
+
+	/**	Parse the given null terminated text, calling the handler as it goes.
+		Returns true if there was no error; a handler that stops the parse is
+		not an error (see Stopped()).
+	*/
+	bool Parse( const char* p, TiXmlSaxHandler* handler, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING );
+
+	/**	Parse a file, mapped into memory where the system can, else read whole.
+		New lines are normalized, as in TiXmlDocument::LoadFile().
+	*/
+	bool ParseFile( const char* filename, TiXmlSaxHandler* handler, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING );
+
+	/// True if a callback of the last parse returned false.
+	bool Stopped() const					{ return stopped; }
+
+	/// If an error occurs, Error will be set to true. See TiXmlDocument::Error().
+	bool Error() const						{ return error; }
+	/// Contains a textual (english) description of the error if one occurs.
+	const char* ErrorDesc() const			{ return errorDesc.c_str (); }
+	/// The error id, one of the TiXmlBase codes.
+	int ErrorId() const						{ return errorId; }
+	/// The row and column of the error, as TiXmlDocument::ErrorRow() has them.
+	int ErrorRow() const					{ return errorLocation.row+1; }
+	int ErrorCol() const					{ return errorLocation.col+1; }	///< See ErrorRow()
+
+	/**	During a callback, the row and column where the reported tag or text
+		starts, 1-based. They are worked out only when asked for, as
+		TiXmlBase::Row() does. 0 if the tab size is 0, or outside a callback.
+	*/
+	int Row() const;
+	int Column() const;						///< See Row()
+
+	/// The tab size for Row(), Column() and the error location. See TiXmlDocument::SetTabSize().
+	void SetTabSize( int _tabsize )			{ tabsize = _tabsize; }
+	int TabSize() const						{ return tabsize; }
+
+	/// Whether text is reported with its white space condensed. See TiXmlDocument::SetCondenseWhiteSpace().
+	void SetCondenseWhiteSpace( bool _condense )	{ condense = _condense; }
+	bool IsWhiteSpaceCondensed() const				{ return condense; }
+
+private:
+	TiXmlSaxParser( const TiXmlSaxParser& );	// not implemented.
+	void operator=( const TiXmlSaxParser& );	// not allowed.
+
+	// The tags, as TiXmlNode::Identify() tells them apart. Each returns where
+	// it stopped, or null if the parse can't go on.
+	const char* ReadMarkup( const char* p, TiXmlEncoding* encoding );
+	const char* ReadElement( const char* p, TiXmlEncoding encoding );
+	const char* ReadEndTag( const char* p, TiXmlEncoding encoding );
+	const char* ReadDeclaration( const char* p, TiXmlEncoding* encoding );
+	const char* ReadAttribute( const char* p, TIXML_STRING* name, TIXML_STRING* value, TiXmlEncoding encoding, bool report );
+
+	// Note the handler's answer; false stops the parse.
+	bool Go( bool result )					{ if ( !result ) stopped = true; return result; }
+	TIXML_STRING& Push();
+	void Locate( TiXmlCursor* cursor, const char* p ) const;
+	void ClearError();
+	void SetError( int err, const char* pError );
+
+	TiXmlSaxHandler* handler;
+	const char* start;			// the text being parsed
+	const char* current;		// where the reported tag or text starts
+	bool newLines;				// set by ParseFile() while it runs.
+	bool stopped;
+	int depth;
+	TIXML_STRING* open;			// the names of the open elements, 'depth' of them
+	int openCapacity;
+	TiXmlSaxAttributes attributes;
+	TIXML_STRING text;
+	TIXML_STRING version, encodingName, standalone;
+
+	bool error;
+	int errorId;
+	TIXML_STRING errorDesc;
+	TiXmlCursor errorLocation;
+	int tabsize;
+	bool condense;
+	mutable TiXmlLineIndex lineIndex;
 };
 
 
@@ -1672,6 +2743,12 @@ public:
 	*/
 	TiXmlHandle ChildElement( int index ) const;
 
+	/// The functions above that take a name, by its atom (see TiXmlAtom).
+	TiXmlHandle FirstChild( TiXmlAtom value ) const;
+	TiXmlHandle FirstChildElement( TiXmlAtom value ) const;
+	TiXmlHandle Child( TiXmlAtom value, int index ) const;
+	TiXmlHandle ChildElement( TiXmlAtom value, int index ) const;
+
 	#ifdef TIXML_USE_STL
 	TiXmlHandle FirstChild( const std::string& _value ) const				{ return FirstChild( _value.c_str() ); }
 	TiXmlHandle FirstChildElement( const std::string& _value ) const		{ return FirstChildElement( _value.c_str() ); }
@@ -1715,6 +2792,329 @@ private:
 };
 
 
+/**	The nodes a TiXmlPath selected, in document order, each once. If the path
+	ends in an attribute step, each result is an attribute, with the element
+	it is on.
+
+	A result can be used for one Select() after another; it keeps its memory.
+	The pointers are only good while the document is unchanged.
+*/
+class TiXmlPathResult
+{
+public:
+	TiXmlPathResult();
+	~TiXmlPathResult();
+
+	/// The number of results.
+	int Count() const							{ return count; }
+
+	/// The node of the result at 'index', from 0 to Count()-1: the element an attribute is on.
+	const TiXmlNode* Node( int index ) const	{ assert( index >= 0 && index < count ); return entries[index].node; }
+	TiXmlNode* Node( int index )				{ assert( index >= 0 && index < count ); return const_cast< TiXmlNode* >( entries[index].node ); }
+	/// The node of the result at 'index' as an element, or null if it isn't one.
+	const TiXmlElement* Element( int index ) const	{ return Node( index )->ToElement(); }
+	TiXmlElement* Element( int index )				{ return Node( index )->ToElement(); }
+	/// The attribute of the result at 'index', or null if the path doesn't end in one.
+	const TiXmlAttribute* Attribute( int index ) const	{ assert( index >= 0 && index < count ); return entries[index].attribute; }
+	TiXmlAttribute* Attribute( int index )				{ assert( index >= 0 && index < count ); return const_cast< TiXmlAttribute* >( entries[index].attribute ); }
+
+	/**	The value of the result at 'index': the attribute's value, or else the
+		element's text (see TiXmlElement::GetText()). May be null.
+	*/
+	const char* Value( int index ) const;
+
+	/// Forget the results.
+	void Clear();
+
+private:
+	friend class TiXmlPath;
+
+	TiXmlPathResult( const TiXmlPathResult& );	// not implemented.
+	void operator=( const TiXmlPathResult& );	// not allowed.
+
+	struct Entry
+	{
+		const TiXmlNode*		node;
+		const TiXmlAttribute*	attribute;
+	};
+
+	// Add a result; if 'unique', only if it isn't there yet.
+	void Add( const TiXmlNode* node, const TiXmlAttribute* attribute, bool unique );
+	// The entry of a result, or -1. Only after unique adds.
+	int Find( const TiXmlNode* node, const TiXmlAttribute* attribute ) const;
+	void Rehash( int size );
+	// Put the results, all in the tree of 'top', in document order. Only after unique adds.
+	void Sort( const TiXmlNode* top );
+	// Append the results of 'top' and the nodes below it to 'sorted', in document order.
+	void Collect( const TiXmlNode* top, Entry* sorted, int* sortedCount ) const;
+	// Append the results of 'node' itself: the node, then its attributes.
+	void CollectNode( const TiXmlNode* node, Entry* sorted, int* sortedCount ) const;
+
+	Entry* entries;
+	int count;
+	int capacity;
+	int* seen;				// entry numbers hashed by address, -1 when empty; only for unique adds
+	int seenMask;			// a power of two less one, or -1 if 'seen' isn't built
+};
+
+
+/**	A query over the DOM, compiled once and run as often as needed. It takes a
+	subset of XPath:
+
+	- Steps are separated by '/', which selects the children of each node so
+	  far, or by "//", which selects the children of each node and all of its
+	  descendants. A step is an element name, or '*' for any element, or '.'
+	  for the node itself, or ".." for its parent.
+	- A path that starts with '/' or "//" starts at the document; any other
+	  starts at the node it is run on.
+	- The last step may be an attribute, "@name" or "@*".
+	- A step may have predicates in brackets, each of which keeps only some of
+	  the nodes the step selects from one node: [n] the n-th (counting from 1),
+	  [@name] those with the attribute, [@name='value'] or [@name!='value'] those
+	  whose attribute is, or isn't, the text, and [@name=n], [@name!=n],
+	  [@name<n], [@name<=n], [@name>n], [@name>=n] those whose attribute is a
+	  number that compares so. Predicates apply in turn: "joint[@min<0][2]" is
+	  the second of the joints with a negative minimum.
+
+	For example:
+	@verbatim
+	TiXmlPath homes( "/library/robot[@name='plen2-7']/joint/@home" );
+	TiXmlPathResult result;
+	homes.Select( &document, &result );
+	for ( int i=0; i<result.Count(); ++i )
+		printf( "%s\n", result.Value( i ) );
+	@endverbatim
+
+	Child steps by name go through the lookups of TiXmlNode, so they use the
+	document's atoms and the index of wide elements' children.
+
+	A compiled path can be shared between threads. Running it doesn't change
+	the document as far as the DOM shows, but it can build a lookup index
+	inside it, so the same document must not be queried on two threads at once.
+*/
+class TiXmlPath
+{
+public:
+	TiXmlPath();
+	/// Compile 'path'. Check Error() for whether that worked.
+	explicit TiXmlPath( const char* path );
+	#ifdef TIXML_USE_STL
+	explicit TiXmlPath( const std::string& path );	///< STL std::string form.
+	#endif
+	~TiXmlPath();
+
+	/// Compile 'path', replacing the one before. Returns true if there was no error.
+	bool Compile( const char* path );
+	#ifdef TIXML_USE_STL
+	bool Compile( const std::string& path )	{ return Compile( path.c_str() ); }	///< STL std::string form.
+	#endif
+
+	/// The path as it was compiled.
+	const char* Path() const				{ return text.c_str(); }
+
+	/// True if the last Compile() failed. A path that failed selects nothing.
+	bool Error() const						{ return error; }
+	/// A textual (english) description of the error.
+	const char* ErrorDesc() const			{ return errorDesc; }
+	/// Where in the path the error is, a char offset from 0.
+	int ErrorOffset() const					{ return errorOffset; }
+
+	/**	Run the path on 'context', and put what it selects in 'result'.
+		Returns the number of results.
+	*/
+	int Select( const TiXmlNode* context, TiXmlPathResult* result ) const;
+
+	/**	Run the path on each of the 'count' nodes at 'contexts', into the result
+		of the same index. The nodes have to be in different documents. The
+		work is spread over 'threads' threads, the calling one included; 0
+		means as many as the system can run at once.
+	*/
+	void SelectEach( const TiXmlNode* const* contexts, int count, TiXmlPathResult* results, int threads = 0 ) const;
+
+	/// The first node the path selects: the element an attribute is on. Null if none.
+	const TiXmlNode* FindNode( const TiXmlNode* context ) const;
+	TiXmlNode* FindNode( TiXmlNode* context ) const	{ return const_cast< TiXmlNode* >( FindNode( const_cast< const TiXmlNode* >( context ) ) ); }
+	/// The first node the path selects, if it is an element. Null if none.
+	const TiXmlElement* FindElement( const TiXmlNode* context ) const;
+	TiXmlElement* FindElement( TiXmlNode* context ) const	{ return const_cast< TiXmlElement* >( FindElement( const_cast< const TiXmlNode* >( context ) ) ); }
+	/// The value of the first result, as TiXmlPathResult::Value() has it. Null if none.
+	const char* FindValue( const TiXmlNode* context ) const;
+
+	/// The number of nodes the path selects.
+	int Count( const TiXmlNode* context ) const;
+
+private:
+	TiXmlPath( const TiXmlPath& );			// not implemented.
+	void operator=( const TiXmlPath& );	// not allowed.
+
+	enum { MAX_PREDICATES = 8 };			// per step
+
+	enum StepKind { STEP_ELEMENT, STEP_SELF, STEP_PARENT, STEP_ATTRIBUTE };
+	enum PredicateKind { PREDICATE_POSITION, PREDICATE_EXISTS, PREDICATE_STRING, PREDICATE_NUMBER };
+	enum Operator { OP_EQUAL, OP_NOT_EQUAL, OP_LESS, OP_LESS_EQUAL, OP_GREATER, OP_GREATER_EQUAL };
+
+	struct Step
+	{
+		StepKind kind;
+		bool descendants;			// after "//"
+		TIXML_STRING name;			// empty for any
+		int firstPredicate;
+		int predicateCount;
+	};
+
+	struct Predicate
+	{
+		PredicateKind kind;
+		Operator op;
+		int position;				// PREDICATE_POSITION
+		TIXML_STRING name;			// of the attribute
+		TIXML_STRING literal;		// PREDICATE_STRING
+		double number;				// PREDICATE_NUMBER
+	};
+
+	// One run of the path. Atoms are looked up per document.
+	struct Run;
+
+	void Reset();
+	bool Fail( const char* desc, const char* at );
+	const char* ReadStep( const char* p, bool descendants );
+	const char* ReadPredicate( const char* p, Step* step );
+	Step* AddStep();
+	Predicate* AddPredicate();
+
+	// Run the path on 'context'.
+	void Evaluate( Run* run, const TiXmlNode* context ) const;
+	// Apply step 'index' to 'node', and the steps after it to what it selects.
+	bool Apply( Run* run, int index, const TiXmlNode* node ) const;
+	bool ApplyHere( Run* run, int index, const TiXmlNode* node ) const;
+	// Whether the node passes the predicates of 'step'; 'positions' counts those it was tested against.
+	bool Passes( const Run* run, const Step& step, const TiXmlNode* node, int* positions, bool* done ) const;
+	bool Matches( const Run* run, int predicate, const TiXmlElement* element ) const;
+	// The last step selected 'node' (and 'attribute'); false to stop.
+	bool Selected( Run* run, const TiXmlNode* node, const TiXmlAttribute* attribute ) const;
+
+	TIXML_STRING text;
+	bool absolute;
+	bool unique;					// whether a run can find a node twice, and has to skip repeats
+	bool sort;						// whether a run can find nodes out of document order, and has to sort them
+	Step* steps;
+	int stepCount;
+	int stepCapacity;
+	Predicate* predicates;
+	int predicateCount;
+	int predicateCapacity;
+
+	bool error;
+	const char* errorDesc;
+	int errorOffset;
+};
+
+
+/**	Receives the documents a TiXmlDirectoryLoader loads.
+
+	Loaded() is called on the loader's threads, several at once when it uses
+	more than one, so a handler that gathers results has to guard them.
+*/
+class TiXmlLoadHandler
+{
+public:
+	virtual ~TiXmlLoadHandler() {}
+
+	/**	Called once for each file, after LoadFile() has returned: check
+		document.Error() for whether it worked. 'seconds' is how long the load
+		took. The document is deleted after the call; to keep it, move it out
+		or Clone() it. Return true to go on, or false to stop the loader
+		starting any more files.
+	*/
+	virtual bool Loaded( const char* filename, TiXmlDocument& document, double seconds ) = 0;
+};
+
+
+/**	Loads many files at once: every file of a directory with a given
+	extension, or a list of files. Each is loaded into a document of its own
+	with TiXmlDocument::LoadFile(), on a pool of threads, and handed to a
+	TiXmlLoadHandler.
+
+	A thread holds one document at a time, and gives it up when the handler
+	returns, so no more documents are in memory at once than there are threads
+	(besides those the handler keeps).
+
+	@verbatim
+	class ProfileReader : public TiXmlLoadHandler
+	{
+	public:
+		virtual bool Loaded( const char* filename, TiXmlDocument& document, double seconds )
+		{
+			if ( document.Error() )
+				printf( "%s: %s\n", filename, document.ErrorDesc() );
+			return true;
+		}
+	};
+
+	ProfileReader reader;
+	TiXmlDirectoryLoader loader;
+	loader.Load( "profiles", &reader );
+	@endverbatim
+
+	The threads need TIXML_THREADS; without it, the files load one after the
+	other on the calling thread.
+*/
+class TiXmlDirectoryLoader
+{
+public:
+	TiXmlDirectoryLoader();
+	~TiXmlDirectoryLoader();
+
+	/// The number of threads, the calling one included. 0, the default, means as many as the system can run at once.
+	void SetThreads( int _threads )					{ threads = _threads; }
+	int Threads() const								{ return threads; }
+
+	/// The extension of the files Load() takes from a directory, ".xml" by default. The case is ignored.
+	void SetExtension( const char* _extension )		{ extension = _extension ? _extension : ""; }
+	const char* Extension() const					{ return extension.c_str(); }
+
+	/// These are passed on to each document; see TiXmlDocument.
+	void SetCondenseWhiteSpace( bool _condense )	{ condense = _condense; }
+	void SetInSitu( bool _inSitu )					{ inSitu = _inSitu; }
+	void SetUseArena( bool _useArena )				{ useArena = _useArena; }
+	void SetEncoding( TiXmlEncoding _encoding )		{ encoding = _encoding; }
+
+	/**	Load the files in 'directory' (not its subdirectories) whose names end
+		in the extension, in the order of their names. Returns the number of
+		files loaded without an error, or -1 if the directory can't be read.
+	*/
+	int Load( const char* directory, TiXmlLoadHandler* handler );
+
+	/// Load the 'count' files named at 'filenames'. Returns the number loaded without an error.
+	int LoadFiles( const char* const* filenames, int count, TiXmlLoadHandler* handler );
+
+	/// True if the handler stopped the last load.
+	bool Stopped() const							{ return stopped; }
+
+private:
+	TiXmlDirectoryLoader( const TiXmlDirectoryLoader& );	// not implemented.
+	void operator=( const TiXmlDirectoryLoader& );			// not allowed.
+
+	// Fill 'files' with the names Load() takes from 'directory'.
+	bool ListFiles( const char* directory );
+	void AddFile( const char* directory, const char* name );
+	// Load one file; false if the handler stops.
+	bool LoadOne( const char* filename, TiXmlLoadHandler* handler, bool* ok ) const;
+
+	int threads;
+	TIXML_STRING extension;
+	bool condense;
+	bool inSitu;
+	bool useArena;
+	TiXmlEncoding encoding;
+	bool stopped;
+
+	TIXML_STRING* files;		// listed by Load()
+	int fileCount;
+	int fileCapacity;
+};
+
+
 /** Print to memory functionality. The TiXmlPrinter is useful when you need to:
 
 	-# Print to memory (especially in non-STL mode)
@@ -1783,6 +3183,8 @@ public:
 
 private:
 	void DoIndent()	{
+		if ( indent.empty() )
+			return;		// nothing to write, however deep
 		for( int i=0; i<depth; ++i )
 			buffer += indent;
 	}
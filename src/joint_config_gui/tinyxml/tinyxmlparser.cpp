@@ -23,10 +23,26 @@ distribution.
 */
 
 #include <ctype.h>
+#include <locale.h>
 #include <stddef.h>
 
 #include "tinyxml.h"
 
+// SSE2 is always there on x64, and on x86 when the compiler targets it. AVX2 is
+// checked for at run time. Define TIXML_NO_SIMD (or TIXML_NO_AVX2) to leave the
+// kernels out.
+#if !defined( TIXML_NO_SIMD ) && ( defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 ) )
+#	define TIXML_SCAN_SSE2
+#	include <emmintrin.h>
+#	if !defined( TIXML_NO_AVX2 ) && ( ( defined( _MSC_VER ) && _MSC_VER >= 1700 ) || defined( __GNUC__ ) )
+#		define TIXML_SCAN_AVX2
+#		include <immintrin.h>
+#	endif
+#	if defined( _MSC_VER )
+#		include <intrin.h>
+#	endif
+#endif
+
 //#define DEBUG_PARSER
 #if defined( DEBUG_PARSER )
 #	if defined( DEBUG ) && defined( _MSC_VER )
@@ -168,31 +184,463 @@ void TiXmlBase::ConvertUTF32ToUTF8( unsigned long input, char* output, int* leng
 }
 
 
+// The tokenizer skips white space and copies plain text in runs. ScanSpace()
+// and ScanText() find where a run ends, 32 (AVX2) or 16 (SSE2) bytes at a time
+// where the CPU can, else byte by byte. They may only stop early: a run holds
+// nothing but ASCII white space, or nothing but ASCII bytes the caller takes as
+// they are. Everything else -- white space isspace() finds in the locale, UTF-8
+// sequences, entities, ends -- is left to the code that reads one char at a time.
+// ScanColumns() does the same for Stamp(), up to the given end: it finds the
+// first byte that isn't a column of its own. CountNewLines() counts the CR and
+// LF bytes up to the null character, for the line index.
+//
+// The vector loads are aligned, so they never cross a page after the null
+// character, though they do read the bytes after it.
+
+struct TiXmlScanSet
+{
+	char stop[4];	// stop at these, and at the null character
+	bool high;		// stop at bytes 0x80 and up
+	bool space;		// stop at ASCII white space
+};
+
+static void MakeScanSet( TiXmlScanSet* set, char a, char b, char c, char d, bool high, bool space )
+{
+	set->stop[0] = a;
+	set->stop[1] = b;
+	set->stop[2] = c;
+	set->stop[3] = d;
+	set->high = high;
+	set->space = space;
+}
+
+inline static bool IsAsciiSpace( unsigned char c )
+{
+	return c == ' ' || ( c >= '\t' && c <= '\r' );
+}
+
+#if !defined( TIXML_SCAN_SSE2 )
+
+static const char* ScanSpaceScalar( const char* p )
+{
+	while ( IsAsciiSpace( *p ) )
+		++p;
+	return p;
+}
+
+static const char* ScanTextScalar( const char* p, const TiXmlScanSet* set )
+{
+	for( ;; ++p )
+	{
+		const unsigned char c = *p;
+		if (    c == 0
+			 || c == (unsigned char)set->stop[0] || c == (unsigned char)set->stop[1]
+			 || c == (unsigned char)set->stop[2] || c == (unsigned char)set->stop[3]
+			 || ( set->high && c >= 0x80 )
+			 || ( set->space && IsAsciiSpace( c ) ) )
+			return p;
+	}
+}
+
+static const char* ScanColumnsScalar( const char* p, const char* end )
+{
+	for( ; p < end; ++p )
+	{
+		const unsigned char c = *p;
+		if ( c == 0 || c == '\t' || c == '\n' || c == '\r' || c >= 0x80 )
+			break;
+	}
+	return p;
+}
+
+static int CountNewLinesScalar( const char* p )
+{
+	int count = 0;
+	for( ; *p; ++p )
+	{
+		if ( *p == '\n' || *p == '\r' )
+			++count;
+	}
+	return count;
+}
+
+#else	// TIXML_SCAN_SSE2
+
+// The loads may read past the end of an allocation, which is fine for the
+// hardware but not for AddressSanitizer.
+#if defined( __GNUC__ )
+#	define TIXML_SCAN_UNCHECKED __attribute__(( no_sanitize_address ))
+#else
+#	define TIXML_SCAN_UNCHECKED
+#endif
+
+inline static int FirstBit( unsigned mask )
+{
+	#if defined( _MSC_VER )
+		unsigned long index;
+		_BitScanForward( &index, mask );
+		return (int)index;
+	#else
+		return __builtin_ctz( mask );
+	#endif
+}
+
+inline static int BitCount( unsigned mask )
+{
+	mask = mask - ( ( mask >> 1 ) & 0x55555555u );
+	mask = ( mask & 0x33333333u ) + ( ( mask >> 2 ) & 0x33333333u );
+	return (int)( ( ( ( mask + ( mask >> 4 ) ) & 0x0f0f0f0fu ) * 0x01010101u ) >> 24 );
+}
+
+inline static __m128i SpaceBytes16( __m128i v )
+{
+	const __m128i t = _mm_sub_epi8( v, _mm_set1_epi8( '\t' ) );		// \t..\r to 0..4
+	return _mm_or_si128( _mm_cmpeq_epi8( v, _mm_set1_epi8( ' ' ) ),
+						 _mm_cmpeq_epi8( _mm_min_epu8( t, _mm_set1_epi8( 4 ) ), t ) );
+}
+
+inline static unsigned StopMask16( __m128i v, const TiXmlScanSet* set )
+{
+	__m128i m = _mm_cmpeq_epi8( v, _mm_setzero_si128() );
+	m = _mm_or_si128( m, _mm_cmpeq_epi8( v, _mm_set1_epi8( set->stop[0] ) ) );
+	m = _mm_or_si128( m, _mm_cmpeq_epi8( v, _mm_set1_epi8( set->stop[1] ) ) );
+	m = _mm_or_si128( m, _mm_cmpeq_epi8( v, _mm_set1_epi8( set->stop[2] ) ) );
+	m = _mm_or_si128( m, _mm_cmpeq_epi8( v, _mm_set1_epi8( set->stop[3] ) ) );
+	if ( set->space )
+		m = _mm_or_si128( m, SpaceBytes16( v ) );
+	unsigned mask = _mm_movemask_epi8( m );
+	if ( set->high )
+		mask |= _mm_movemask_epi8( v );
+	return mask;
+}
+
+TIXML_SCAN_UNCHECKED static const char* ScanSpaceSSE2( const char* p )
+{
+	const size_t offset = (size_t)p & 15;
+	const char* block = p - offset;
+	unsigned mask = ~_mm_movemask_epi8( SpaceBytes16( _mm_load_si128( (const __m128i*)block ) ) ) & ( 0xffffu << offset );
+	while ( !mask )
+	{
+		block += 16;
+		mask = ~_mm_movemask_epi8( SpaceBytes16( _mm_load_si128( (const __m128i*)block ) ) ) & 0xffffu;
+	}
+	return block + FirstBit( mask );
+}
+
+TIXML_SCAN_UNCHECKED static const char* ScanTextSSE2( const char* p, const TiXmlScanSet* set )
+{
+	const size_t offset = (size_t)p & 15;
+	const char* block = p - offset;
+	unsigned mask = StopMask16( _mm_load_si128( (const __m128i*)block ), set ) & ( 0xffffu << offset );
+	while ( !mask )
+	{
+		block += 16;
+		mask = StopMask16( _mm_load_si128( (const __m128i*)block ), set );
+	}
+	return block + FirstBit( mask );
+}
+
+inline static unsigned ColumnMask16( __m128i v )
+{
+	__m128i m = _mm_cmpeq_epi8( v, _mm_setzero_si128() );
+	m = _mm_or_si128( m, _mm_cmpeq_epi8( v, _mm_set1_epi8( '\t' ) ) );
+	m = _mm_or_si128( m, _mm_cmpeq_epi8( v, _mm_set1_epi8( '\n' ) ) );
+	m = _mm_or_si128( m, _mm_cmpeq_epi8( v, _mm_set1_epi8( '\r' ) ) );
+	return _mm_movemask_epi8( m ) | _mm_movemask_epi8( v );
+}
+
+TIXML_SCAN_UNCHECKED static const char* ScanColumnsSSE2( const char* p, const char* end )
+{
+	if ( p >= end )
+		return p;
+	const size_t offset = (size_t)p & 15;
+	const char* block = p - offset;
+	unsigned mask = ColumnMask16( _mm_load_si128( (const __m128i*)block ) ) & ( 0xffffu << offset );
+	while ( !mask )
+	{
+		block += 16;
+		if ( block >= end )
+			return end;
+		mask = ColumnMask16( _mm_load_si128( (const __m128i*)block ) );
+	}
+	const char* stop = block + FirstBit( mask );
+	return ( stop < end ) ? stop : end;
+}
+
+TIXML_SCAN_UNCHECKED static int CountNewLinesSSE2( const char* p )
+{
+	const size_t offset = (size_t)p & 15;
+	const char* block = p - offset;
+	unsigned keep = 0xffffu << offset;
+	int count = 0;
+	for( ;; )
+	{
+		const __m128i v = _mm_load_si128( (const __m128i*)block );
+		const unsigned lines = _mm_movemask_epi8( _mm_or_si128( _mm_cmpeq_epi8( v, _mm_set1_epi8( '\n' ) ),
+																 _mm_cmpeq_epi8( v, _mm_set1_epi8( '\r' ) ) ) ) & keep;
+		const unsigned end = _mm_movemask_epi8( _mm_cmpeq_epi8( v, _mm_setzero_si128() ) ) & keep;
+		if ( end )
+			return count + BitCount( lines & ( ( 1u << FirstBit( end ) ) - 1 ) );
+		count += BitCount( lines );
+		block += 16;
+		keep = 0xffffu;
+	}
+}
+
+#endif	// TIXML_SCAN_SSE2
+
+#if defined( TIXML_SCAN_AVX2 )
+
+#if defined( __GNUC__ )
+#	define TIXML_SCAN_AVX2_TARGET __attribute__(( target( "avx2" ) ))
+#else
+#	define TIXML_SCAN_AVX2_TARGET
+#endif
+
+TIXML_SCAN_AVX2_TARGET inline static __m256i SpaceBytes32( __m256i v )
+{
+	const __m256i t = _mm256_sub_epi8( v, _mm256_set1_epi8( '\t' ) );
+	return _mm256_or_si256( _mm256_cmpeq_epi8( v, _mm256_set1_epi8( ' ' ) ),
+							_mm256_cmpeq_epi8( _mm256_min_epu8( t, _mm256_set1_epi8( 4 ) ), t ) );
+}
+
+TIXML_SCAN_AVX2_TARGET inline static unsigned StopMask32( __m256i v, const TiXmlScanSet* set )
+{
+	__m256i m = _mm256_cmpeq_epi8( v, _mm256_setzero_si256() );
+	m = _mm256_or_si256( m, _mm256_cmpeq_epi8( v, _mm256_set1_epi8( set->stop[0] ) ) );
+	m = _mm256_or_si256( m, _mm256_cmpeq_epi8( v, _mm256_set1_epi8( set->stop[1] ) ) );
+	m = _mm256_or_si256( m, _mm256_cmpeq_epi8( v, _mm256_set1_epi8( set->stop[2] ) ) );
+	m = _mm256_or_si256( m, _mm256_cmpeq_epi8( v, _mm256_set1_epi8( set->stop[3] ) ) );
+	if ( set->space )
+		m = _mm256_or_si256( m, SpaceBytes32( v ) );
+	unsigned mask = (unsigned)_mm256_movemask_epi8( m );
+	if ( set->high )
+		mask |= (unsigned)_mm256_movemask_epi8( v );
+	return mask;
+}
+
+TIXML_SCAN_AVX2_TARGET TIXML_SCAN_UNCHECKED static const char* ScanSpaceAVX2( const char* p )
+{
+	const size_t offset = (size_t)p & 31;
+	const char* block = p - offset;
+	unsigned mask = ~(unsigned)_mm256_movemask_epi8( SpaceBytes32( _mm256_load_si256( (const __m256i*)block ) ) ) & ( 0xffffffffu << offset );
+	while ( !mask )
+	{
+		block += 32;
+		mask = ~(unsigned)_mm256_movemask_epi8( SpaceBytes32( _mm256_load_si256( (const __m256i*)block ) ) );
+	}
+	return block + FirstBit( mask );
+}
+
+TIXML_SCAN_AVX2_TARGET TIXML_SCAN_UNCHECKED static const char* ScanTextAVX2( const char* p, const TiXmlScanSet* set )
+{
+	const size_t offset = (size_t)p & 31;
+	const char* block = p - offset;
+	unsigned mask = StopMask32( _mm256_load_si256( (const __m256i*)block ), set ) & ( 0xffffffffu << offset );
+	while ( !mask )
+	{
+		block += 32;
+		mask = StopMask32( _mm256_load_si256( (const __m256i*)block ), set );
+	}
+	return block + FirstBit( mask );
+}
+
+TIXML_SCAN_AVX2_TARGET inline static unsigned ColumnMask32( __m256i v )
+{
+	__m256i m = _mm256_cmpeq_epi8( v, _mm256_setzero_si256() );
+	m = _mm256_or_si256( m, _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '\t' ) ) );
+	m = _mm256_or_si256( m, _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '\n' ) ) );
+	m = _mm256_or_si256( m, _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '\r' ) ) );
+	return (unsigned)_mm256_movemask_epi8( m ) | (unsigned)_mm256_movemask_epi8( v );
+}
+
+TIXML_SCAN_AVX2_TARGET TIXML_SCAN_UNCHECKED static const char* ScanColumnsAVX2( const char* p, const char* end )
+{
+	if ( p >= end )
+		return p;
+	const size_t offset = (size_t)p & 31;
+	const char* block = p - offset;
+	unsigned mask = ColumnMask32( _mm256_load_si256( (const __m256i*)block ) ) & ( 0xffffffffu << offset );
+	while ( !mask )
+	{
+		block += 32;
+		if ( block >= end )
+			return end;
+		mask = ColumnMask32( _mm256_load_si256( (const __m256i*)block ) );
+	}
+	const char* stop = block + FirstBit( mask );
+	return ( stop < end ) ? stop : end;
+}
+
+TIXML_SCAN_AVX2_TARGET TIXML_SCAN_UNCHECKED static int CountNewLinesAVX2( const char* p )
+{
+	const size_t offset = (size_t)p & 31;
+	const char* block = p - offset;
+	unsigned keep = 0xffffffffu << offset;
+	int count = 0;
+	for( ;; )
+	{
+		const __m256i v = _mm256_load_si256( (const __m256i*)block );
+		const unsigned lines = (unsigned)_mm256_movemask_epi8( _mm256_or_si256( _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '\n' ) ),
+																				_mm256_cmpeq_epi8( v, _mm256_set1_epi8( '\r' ) ) ) ) & keep;
+		const unsigned end = (unsigned)_mm256_movemask_epi8( _mm256_cmpeq_epi8( v, _mm256_setzero_si256() ) ) & keep;
+		if ( end )
+			return count + BitCount( lines & ( ( 1u << FirstBit( end ) ) - 1 ) );
+		count += BitCount( lines );
+		block += 32;
+		keep = 0xffffffffu;
+	}
+}
+
+static bool HasAVX2()
+{
+	#if defined( _MSC_VER )
+		int info[4];
+		__cpuid( info, 0 );
+		if ( info[0] < 7 )
+			return false;
+		__cpuid( info, 1 );
+		const int osxsave = 1 << 27, avx = 1 << 28;
+		if ( ( info[2] & ( osxsave | avx ) ) != ( osxsave | avx ) || ( _xgetbv( 0 ) & 6 ) != 6 )
+			return false;		// the OS doesn't save the YMM registers
+		__cpuidex( info, 7, 0 );
+		return ( info[1] & ( 1 << 5 ) ) != 0;
+	#else
+		return __builtin_cpu_supports( "avx2" ) != 0;
+	#endif
+}
+
+#endif	// TIXML_SCAN_AVX2
+
+// The kernels are picked on first use.
+static const char* ScanSpaceFirst( const char* p );
+static const char* ScanTextFirst( const char* p, const TiXmlScanSet* set );
+static const char* ScanColumnsFirst( const char* p, const char* end );
+static int CountNewLinesFirst( const char* p );
+
+static const char* ( *ScanSpace )( const char* p ) = ScanSpaceFirst;
+static const char* ( *ScanText )( const char* p, const TiXmlScanSet* set ) = ScanTextFirst;
+static const char* ( *ScanColumns )( const char* p, const char* end ) = ScanColumnsFirst;
+static int ( *CountNewLines )( const char* p ) = CountNewLinesFirst;
+
+static void SelectScanKernels()
+{
+	#if defined( TIXML_SCAN_AVX2 )
+		if ( HasAVX2() )
+		{
+			ScanSpace = ScanSpaceAVX2;
+			ScanText = ScanTextAVX2;
+			ScanColumns = ScanColumnsAVX2;
+			CountNewLines = CountNewLinesAVX2;
+			return;
+		}
+	#endif
+	#if defined( TIXML_SCAN_SSE2 )
+		ScanSpace = ScanSpaceSSE2;
+		ScanText = ScanTextSSE2;
+		ScanColumns = ScanColumnsSSE2;
+		CountNewLines = CountNewLinesSSE2;
+	#else
+		ScanSpace = ScanSpaceScalar;
+		ScanText = ScanTextScalar;
+		ScanColumns = ScanColumnsScalar;
+		CountNewLines = CountNewLinesScalar;
+	#endif
+}
+
+static const char* ScanSpaceFirst( const char* p )
+{
+	SelectScanKernels();
+	return ScanSpace( p );
+}
+
+static const char* ScanTextFirst( const char* p, const TiXmlScanSet* set )
+{
+	SelectScanKernels();
+	return ScanText( p, set );
+}
+
+static const char* ScanColumnsFirst( const char* p, const char* end )
+{
+	SelectScanKernels();
+	return ScanColumns( p, end );
+}
+
+static int CountNewLinesFirst( const char* p )
+{
+	SelectScanKernels();
+	return CountNewLines( p );
+}
+
+
 class TiXmlParsingData
 {
 	friend class TiXmlDocument;
+	friend class TiXmlLineIndex;
   public:
 	void Stamp( const char* now, TiXmlEncoding encoding );
 
 	const TiXmlCursor& Cursor() const	{ return cursor; }
 
+	// The offset of 'p' from the start of the text, for source ranges.
+	int Offset( const char* p ) const	{ return (int)( p - start ); }
+
+	// True if the strings of the DOM borrow from the buffer being parsed.
+	bool InSitu() const					{ return inSitu; }
+
+	// True if CR+LF and CR are read as LF, as they are in files. LF+CR is then
+	// two new lines, not one.
+	bool NormalizeNewLines() const		{ return newLines; }
+
+	// True if text has its white space condensed; see TiXmlDocument::SetCondenseWhiteSpace().
+	bool CondenseWhiteSpace() const		{ return condense; }
+
+	// The document being parsed, or null.
+	TiXmlDocument* Document() const		{ return document; }
+
   private:
 	// Only used by the document!
-	TiXmlParsingData( const char* start, int _tabsize, int row, int col )
+	// A lazy one only notes the offset of each stamp from 'start'; see TiXmlLineIndex.
+	TiXmlParsingData( const char* _start, int _tabsize, int row, int col, bool _inSitu, bool _newLines, bool _condense, bool _lazy = false )
 	{
-		assert( start );
-		stamp = start;
+		assert( _start );
+		start = _start;
+		stamp = _start;
 		tabsize = _tabsize;
 		cursor.row = row;
 		cursor.col = col;
+		inSitu = _inSitu;
+		newLines = _newLines;
+		condense = _condense;
+		lazy = _lazy;
+		document = 0;
 	}
 
 	TiXmlCursor		cursor;
+	const char*		start;
 	const char*		stamp;
 	int				tabsize;
+	bool			inSitu;
+	bool			newLines;
+	bool			condense;
+	bool			lazy;
+	TiXmlDocument*	document;
 };
 
 
+// The document a node being parsed belongs to. The parsing data knows it,
+// which saves walking up from a node deep down; a node not linked in yet
+// has none.
+static TiXmlDocument* ParsingDocument( TiXmlNode* node, TiXmlParsingData* data )
+{
+	if ( !node->Parent() )
+		return 0;
+	if ( data && data->Document() )
+		return data->Document();
+	return node->GetDocument();
+}
+
+
 void TiXmlParsingData::Stamp( const char* now, TiXmlEncoding encoding )
 {
 	assert( now );
@@ -203,6 +651,12 @@ void TiXmlParsingData::Stamp( const char* now, TiXmlEncoding encoding )
 		return;
 	}
 
+	if ( lazy )
+	{
+		cursor.SetOffset( (int)( now - start ) );
+		return;
+	}
+
 	// Get the current row, column.
 	int row = cursor.row;
 	int col = cursor.col;
@@ -211,12 +665,27 @@ void TiXmlParsingData::Stamp( const char* now, TiXmlEncoding encoding )
 
 	while ( p < now )
 	{
+		// Plain ASCII chars are a column each, counted in runs.
+		const char* run = ScanColumns( p, now );
+		col += (int)( run - p );
+		p = run;
+		if ( p == now )
+			break;
+
 		// Treat p as unsigned, so we have a happy compiler.
 		const unsigned char* pU = (const unsigned char*)p;
 
 		// Code contributed by Fletcher Dunn: (modified by lee)
 		switch (*pU) {
 			case 0:
+				// A name that was read in situ has been terminated over its
+				// last char, and counts the same.
+				if ( inSitu )
+				{
+					++p;
+					++col;
+					break;
+				}
 				// We *should* never get here, but in case we do, don't
 				// advance past the terminating null character, ever
 				return;
@@ -244,8 +713,9 @@ void TiXmlParsingData::Stamp( const char* now, TiXmlEncoding encoding )
 
 				// Check for \n\r sequence, and treat this as a single
 				// character.  (Yes, this bizarre thing does occur still
-				// on some arcane platforms...)
-				if (*p == '\r') {
+				// on some arcane platforms...) A file reads the CR as
+				// a new line of its own.
+				if (*p == '\r' && !newLines) {
 					++p;
 				}
 				break;
@@ -311,6 +781,207 @@ void TiXmlParsingData::Stamp( const char* now, TiXmlEncoding encoding )
 }
 
 
+TiXmlLineIndex::TiXmlLineIndex()
+{
+	text = 0;
+	copied = 0;
+	lines = 0;
+	Clear();
+}
+
+
+TiXmlLineIndex::~TiXmlLineIndex()
+{
+	Clear();
+}
+
+
+void TiXmlLineIndex::Reset( const char* _text, bool copy, bool _newLines, int row, int col, int _tabsize, TiXmlEncoding _encoding )
+{
+	Clear();
+	if ( copy )
+	{
+		const size_t length = strlen( _text );
+		copied = new char[ length + 1 ];
+		memcpy( copied, _text, length + 1 );
+		text = copied;
+	}
+	else
+	{
+		text = _text;
+	}
+	newLines = _newLines;
+	row0 = row;
+	col0 = col;
+	tabsize = _tabsize;
+	headEncoding = encoding = _encoding;
+	split = 0;
+}
+
+
+void TiXmlLineIndex::SetEncoding( TiXmlEncoding _encoding, int from )
+{
+	// The lines depend on how UTF-8 is stepped over.
+	delete [] lines;
+	lines = 0;
+	lineCount = 0;
+	lastLine = -1;
+
+	headEncoding = encoding;
+	split = from;
+	encoding = _encoding;
+}
+
+
+void TiXmlLineIndex::Replace( const char* _text, bool copy, bool _newLines )
+{
+	char* old = copied;
+	copied = 0;
+	if ( copy )
+	{
+		const size_t length = strlen( _text );
+		copied = new char[ length + 1 ];
+		memcpy( copied, _text, length + 1 );
+		text = copied;
+	}
+	else
+	{
+		text = _text;
+	}
+	delete [] old;
+	newLines = _newLines;
+
+	delete [] lines;
+	lines = 0;
+	lineCount = 0;
+	lastLine = -1;
+	lastOffset = 0;
+	last.Clear();
+}
+
+
+void TiXmlLineIndex::Clear()
+{
+	delete [] copied;
+	delete [] lines;
+	text = 0;
+	copied = 0;
+	newLines = false;
+	row0 = col0 = 0;
+	tabsize = 0;
+	headEncoding = encoding = TIXML_ENCODING_UNKNOWN;
+	split = 0;
+	lines = 0;
+	lineCount = 0;
+	lastLine = -1;
+	lastOffset = 0;
+	last.Clear();
+}
+
+
+// Step over one char from 'p' the way Stamp() does, up to 'end'.
+static const char* StepUtf8( const char* p, const char* end )
+{
+	const unsigned char* pU = (const unsigned char*)p;
+	int step = 1;
+	if ( *pU == TIXML_UTF_LEAD_0 )
+		step = ( *(p+1) && *(p+2) ) ? 3 : 1;
+	else if ( *pU >= 0x80 )
+		step = TiXmlBase::utf8ByteTable[ *pU ] ? TiXmlBase::utf8ByteTable[ *pU ] : 1;
+	return ( end - p > step ) ? p + step : end;
+}
+
+
+void TiXmlLineIndex::Build()
+{
+	// Each CR or LF starts at most one line; Stamp() takes CR+LF as one, and
+	// LF+CR too unless the text is a file.
+	lines = new int[ CountNewLines( text ) + 1 ];
+	lines[0] = 0;
+	lineCount = 1;
+
+	TiXmlScanSet breaks;
+	MakeScanSet( &breaks, '\r', '\n', '\r', '\n', false, false );
+	const char* end = text + strlen( text );
+	const char* sync = text;		// a char Stamp() steps onto
+	const char* p = ScanText( text, &breaks );
+	while ( *p )
+	{
+		// In UTF-8, Stamp() steps over a new line that ends a broken sequence.
+		// That can only follow one of the 3 chars before it. The encoding only
+		// ever changes from unknown, which steps one char at a time.
+		if ( encoding == TIXML_ENCODING_UTF8 && p >= text + split )
+		{
+			if ( sync < text + split )
+				sync = text + split;
+			const char* q = ( p - sync > 3 ) ? p - 3 : sync;
+			while ( q < p && (unsigned char)*q < 0x80 )
+				++q;
+			if ( q < p )
+			{
+				while ( sync < p )
+					sync = StepUtf8( sync, end );
+				if ( sync > p )
+				{
+					p = ScanText( sync, &breaks );
+					continue;
+				}
+			}
+		}
+
+		const char c = *p++;
+		if ( ( c == '\r' && *p == '\n' ) || ( c == '\n' && *p == '\r' && !newLines ) )
+			++p;
+		lines[ lineCount++ ] = (int)( p - text );
+		sync = p;
+		p = ScanText( p, &breaks );
+	}
+}
+
+
+void TiXmlLineIndex::Locate( TiXmlCursor* cursor )
+{
+	assert( text && cursor->Pending() );
+	if ( !lines )
+		Build();
+
+	// Find the last line that starts at or before the offset.
+	const int offset = cursor->Offset();
+	int line = 0;
+	int high = lineCount - 1;
+	while ( line < high )
+	{
+		const int mid = ( line + high + 1 ) / 2;
+		if ( lines[ mid ] <= offset )
+			line = mid;
+		else
+			high = mid - 1;
+	}
+
+	// Count the columns from the start of the line, or from the last location.
+	int from = lines[ line ];
+	TiXmlCursor at;
+	at.row = row0 + line;
+	at.col = line ? 0 : col0;
+	if ( line == lastLine && offset >= lastOffset )
+	{
+		from = lastOffset;
+		at = last;
+	}
+	TiXmlParsingData data( text + from, tabsize, at.row, at.col, false, newLines, true );
+	if ( from < split )
+		data.Stamp( text + ( offset < split ? offset : split ), headEncoding );
+	if ( offset > split )
+		data.Stamp( text + offset, encoding );
+	*cursor = data.Cursor();
+
+	// Stamp() can stop past the offset, after a CR+LF or a UTF-8 sequence.
+	lastLine = line;
+	lastOffset = (int)( data.stamp - text );
+	last = *cursor;
+}
+
+
 const char* TiXmlBase::SkipWhiteSpace( const char* p, TiXmlEncoding encoding )
 {
 	if ( !p || !*p )
@@ -321,6 +992,7 @@ const char* TiXmlBase::SkipWhiteSpace( const char* p, TiXmlEncoding encoding )
 	{
 		while ( *p )
 		{
+			p = ScanSpace( p );
 			const unsigned char* pU = (const unsigned char*)p;
 			
 			// Skip the stupid Microsoft UTF-8 Byte order marks
@@ -346,7 +1018,7 @@ const char* TiXmlBase::SkipWhiteSpace( const char* p, TiXmlEncoding encoding )
 				continue;
 			}
 
-			if ( IsWhiteSpace( *p ) )		// Still using old rules for white space.
+			if ( *p && IsWhiteSpace( *p ) )		// Still using old rules for white space.
 				++p;
 			else
 				break;
@@ -354,8 +1026,9 @@ const char* TiXmlBase::SkipWhiteSpace( const char* p, TiXmlEncoding encoding )
 	}
 	else
 	{
+		p = ScanSpace( p );
 		while ( *p && IsWhiteSpace( *p ) )
-			++p;
+			p = ScanSpace( p + 1 );
 	}
 
 	return p;
@@ -382,6 +1055,8 @@ const char* TiXmlBase::SkipWhiteSpace( const char* p, TiXmlEncoding encoding )
 	//assert( character > 0 && character < 128 );	// else it won't work in utf-8
 	while ( in->good() )
 	{
+		StreamUntil( in, tag, (char) character, (char) character );
+
 		int c = in->peek();
 		if ( c == character )
 			return true;
@@ -393,6 +1068,43 @@ const char* TiXmlBase::SkipWhiteSpace( const char* p, TiXmlEncoding encoding )
 	}
 	return false;
 }
+
+// Reaches the get area of a streambuf, which is protected, so buffered chars
+// can be searched and copied in runs.
+class TiXmlStreamBuffer : public std::streambuf
+{
+public:
+	static char* Next( std::streambuf* buf )			{ return ( buf->*&TiXmlStreamBuffer::gptr )(); }
+	static char* End( std::streambuf* buf )				{ return ( buf->*&TiXmlStreamBuffer::egptr )(); }
+	static void Skip( std::streambuf* buf, int count )	{ ( buf->*&TiXmlStreamBuffer::gbump )( count ); }
+};
+
+/*static*/ int TiXmlBase::StreamUntil( std::istream * in, TIXML_STRING * tag, char stop, char stop2 )
+{
+	std::streambuf* buf = in->rdbuf();
+	while ( buf && in->good() )
+	{
+		// Fills the get area if it is empty, without taking anything.
+		int c = buf->sgetc();
+		if ( c == EOF )
+			return EOF;
+
+		const char* p = TiXmlStreamBuffer::Next( buf );
+		const char* end = TiXmlStreamBuffer::End( buf );
+		if ( p == end )
+			return EOF;		// Not buffered: left to the caller.
+
+		const char* q = p;
+		while ( q < end && *q && *q != stop && *q != stop2 )
+			++q;
+
+		tag->append( p, q - p );
+		TiXmlStreamBuffer::Skip( buf, (int)( q - p ) );
+		if ( q < end )
+			return (unsigned char) *q;
+	}
+	return EOF;
+}
 #endif
 
 // One of TinyXML's more performance demanding functions. Try to keep the memory overhead down. The
@@ -403,7 +1115,8 @@ const char* TiXmlBase::ReadName( const char* p, TIXML_STRING * name, TiXmlEncodi
 	// Oddly, not supported on some comilers,
 	//name->clear();
 	// So use this:
-	*name = "";
+	if ( name )
+		*name = "";
 	assert( p );
 
 	// Names start with letters or underscores.
@@ -427,7 +1140,7 @@ const char* TiXmlBase::ReadName( const char* p, TIXML_STRING * name, TiXmlEncodi
 			//(*name) += *p; // expensive
 			++p;
 		}
-		if ( p-start > 0 ) {
+		if ( name && p-start > 0 ) {
 			name->assign( start, p-start );
 		}
 		return p;
@@ -576,39 +1289,87 @@ const char* TiXmlBase::ReadText(	const char* p,
 									bool trimWhiteSpace, 
 									const char* endTag, 
 									bool caseInsensitive,
-									TiXmlEncoding encoding )
+									TiXmlEncoding encoding,
+									bool normalizeNewLines,
+									TextSpan* span )
 {
-    *text = "";
-	if (    !trimWhiteSpace			// certain tags always keep whitespace
-		 || !condenseWhiteSpace )	// if true, whitespace is always kept
-	{
-		// Keep all the white space.
+	if ( text )
+		*text = "";
+	if ( span )
+		span->flags = ( encoding == TIXML_ENCODING_UTF8 ) ? INSITU_UTF8 : 0;
+
+	if ( !trimWhiteSpace )			// certain tags, and documents that don't condense, keep whitespace
+	{
+		// Keep all the white space. Plain ASCII text is copied in runs; bytes of
+		// UTF-8 sequences go through GetChar() as before.
+		TiXmlScanSet stops;
+		MakeScanSet( &stops, endTag[0], (char)toupper( (unsigned char)endTag[0] ), '&', '\r',
+					 encoding == TIXML_ENCODING_UTF8 || caseInsensitive, false );
+		if ( span )
+			span->start = span->end = p;
 		while (	   p && *p
 				&& !StringEqual( p, endTag, caseInsensitive, encoding )
 			  )
 		{
+			const char* run = ScanText( p, &stops );
+			if ( run != p )
+			{
+				if ( text )
+					text->append( p, run - p );
+				p = run;
+				if ( span )
+					span->end = p;
+				continue;
+			}
+			if ( *p == '\r' && normalizeNewLines )
+			{
+				// CR+LF and CR are read as LF.
+				if ( text )
+					(*text) += '\n';
+				if ( span )
+					span->flags |= INSITU_NEWLINES;
+				p += ( *(p+1) == '\n' ) ? 2 : 1;
+				if ( span )
+					span->end = p;
+				continue;
+			}
+			if ( span && *p == '&' )
+				span->flags |= INSITU_ENTITIES;
 			int len;
 			char cArr[4] = { 0, 0, 0, 0 };
 			p = GetChar( p, cArr, &len, encoding );
-			text->append( cArr, len );
+			if ( text )
+				text->append( cArr, len );
+			if ( span && p )
+				span->end = p;
 		}
 	}
 	else
 	{
 		bool whitespace = false;
+		bool irregular = false;		// the white space is more than one space
+
+		// Words of plain ASCII text are copied in runs, and the white space
+		// after a new line is skipped in one go.
+		TiXmlScanSet stops;
+		MakeScanSet( &stops, endTag[0], (char)toupper( (unsigned char)endTag[0] ), '&', '&', true, true );
 
 		// Remove leading white space:
 		p = SkipWhiteSpace( p, encoding );
+		if ( span )
+			span->start = span->end = p;
 		while (	   p && *p
 				&& !StringEqual( p, endTag, caseInsensitive, encoding ) )
 		{
 			if ( *p == '\r' || *p == '\n' )
 			{
 				whitespace = true;
-				++p;
+				irregular = true;
+				p = ScanSpace( p + 1 );
 			}
 			else if ( IsWhiteSpace( *p ) )
 			{
+				irregular = irregular || whitespace || *p != ' ';
 				whitespace = true;
 				++p;
 			}
@@ -618,16 +1379,37 @@ const char* TiXmlBase::ReadText(	const char* p,
 				// new character. Any whitespace just becomes a space.
 				if ( whitespace )
 				{
-					(*text) += ' ';
+					if ( text )
+						(*text) += ' ';
+					if ( span && irregular )
+						span->flags |= INSITU_CONDENSE;
 					whitespace = false;
+					irregular = false;
 				}
+				const char* run = ScanText( p, &stops );
+				if ( run != p )
+				{
+					if ( text )
+						text->append( p, run - p );
+					p = run;
+					if ( span )
+						span->end = p;
+					continue;
+				}
+				if ( span && *p == '&' )
+					span->flags |= INSITU_ENTITIES;
 				int len;
 				char cArr[4] = { 0, 0, 0, 0 };
 				p = GetChar( p, cArr, &len, encoding );
-				if ( len == 1 )
-					(*text) += cArr[0];	// more efficient
-				else
-					text->append( cArr, len );
+				if ( text )
+				{
+					if ( len == 1 )
+						(*text) += cArr[0];	// more efficient
+					else
+						text->append( cArr, len );
+				}
+				if ( span && p )
+					span->end = p;
 			}
 		}
 	}
@@ -636,26 +1418,332 @@ const char* TiXmlBase::ReadText(	const char* p,
 	return ( p && *p ) ? p : 0;
 }
 
-#ifdef TIXML_USE_STL
-
-void TiXmlDocument::StreamIn( std::istream * in, TIXML_STRING * tag )
+const char* TiXmlBase::ReadRaw( const char* p, TIXML_STRING* text, const char* endTag, TiXmlEncoding encoding,
+								bool normalizeNewLines, TextSpan* span )
 {
-	// The basic issue with a document is that we don't know what we're
-	// streaming. Read something presumed to be a tag (and hope), then
-	// identify it, and call the appropriate stream method on the tag.
-	//
-	// This "pre-streaming" will never read the closing ">" so the
-	// sub-tag can orient itself.
-
-	if ( !StreamTo( in, '<', tag ) ) 
+	if ( text )
+		*text = "";
+	if ( span )
 	{
-		SetError( TIXML_ERROR_PARSING_EMPTY, 0, 0, TIXML_ENCODING_UNKNOWN );
-		return;
+		span->start = p;
+		span->flags = 0;
 	}
 
-	while ( in->good() )
+	TiXmlScanSet stops;
+	MakeScanSet( &stops, endTag[0], '\r', '\r', '\r', false, false );
+
+	const char* run = p;	// chars not appended to 'text' yet
+	while ( p && *p && !StringEqual( p, endTag, false, encoding ) )
+	{
+		if ( *p == '\r' && normalizeNewLines )
+		{
+			// CR+LF and CR are read as LF.
+			if ( text )
+			{
+				text->append( run, p - run );
+				(*text) += '\n';
+			}
+			if ( span )
+				span->flags |= INSITU_NEWLINES;
+			p += ( *(p+1) == '\n' ) ? 2 : 1;
+			run = p;
+		}
+		else
+		{
+			p = ScanText( p + 1, &stops );
+		}
+	}
+	if ( text )
+		text->append( run, p - run );
+	if ( span )
+		span->end = p;
+	return p;
+}
+
+size_t TiXmlBase::DecodeInSitu( char* out, const char* in, size_t length, int flags )
+{
+	if ( !( flags & ( INSITU_ENTITIES | INSITU_CONDENSE ) ) )
+	{
+		if ( !( flags & INSITU_NEWLINES ) )
+		{
+			memmove( out, in, length );
+			return length;
+		}
+
+		// Only the new lines to fold.
+		const char* end = in + length;
+		char* q = out;
+		while ( in < end )
+		{
+			if ( *in == '\r' )
+			{
+				*q++ = '\n';
+				in += ( in+1 < end && *(in+1) == '\n' ) ? 2 : 1;
+			}
+			else
+			{
+				*q++ = *in++;
+			}
+		}
+		return q - out;
+	}
+
+	// Same steps as ReadText(), over text it has already checked. Every step
+	// writes no more than it reads, so 'q' stays behind 'in'.
+	TiXmlEncoding encoding = ( flags & INSITU_UTF8 ) ? TIXML_ENCODING_UTF8 : TIXML_ENCODING_UNKNOWN;
+	const char* end = in + length;
+	char* q = out;
+	bool whitespace = false;
+
+	while ( in && in < end )
+	{
+		if ( ( flags & INSITU_CONDENSE ) && IsWhiteSpace( *in ) )
+		{
+			whitespace = true;
+			++in;
+			continue;
+		}
+		if ( whitespace )
+		{
+			*q++ = ' ';
+			whitespace = false;
+		}
+		if ( ( flags & INSITU_NEWLINES ) && *in == '\r' )
+		{
+			*q++ = '\n';
+			in += ( in+1 < end && *(in+1) == '\n' ) ? 2 : 1;
+			continue;
+		}
+		int len;
+		char cArr[4] = { 0, 0, 0, 0 };
+		in = GetChar( in, cArr, &len, encoding );
+		for ( int i=0; i<len; ++i )
+			*q++ = cArr[i];
+	}
+	return q - out;
+}
+
+void TiXmlBase::Borrow( TIXML_STRING* str, const char* start, const char* end, int flags )
+{
+	#ifdef TIXML_USE_STL
+	// Not reached: documents only parse in situ with TiXmlString.
+	str->assign( start, end - start );
+	(void)flags;
+	#else
+	str->borrow( const_cast< char* >( start ), end - start, flags );
+	#endif
+}
+
+
+// The white space sscanf() and strtod() skip in the "C" locale.
+static inline bool IsNumberSpace( char c )
+{
+	return c == ' ' || ( c >= '\t' && c <= '\r' );
+}
+
+static inline bool IsDigit( char c )
+{
+	return (unsigned)( c - '0' ) < 10;
+}
+
+const char* TiXmlBase::ReadInt( const char* p, int* value )
+{
+	if ( !p )
+		return 0;
+	while ( IsNumberSpace( *p ) )
+		++p;
+
+	bool negative = false;
+	if ( *p == '-' || *p == '+' )
+		negative = ( *p++ == '-' );
+	if ( !IsDigit( *p ) )
+		return 0;
+	while ( *p == '0' && IsDigit( p[1] ) )
+		++p;
+
+	// Nine digits always fit. A tenth might; an eleventh never does.
+	const char* start = p;
+	unsigned n = 0;
+	while ( IsDigit( *p ) && p - start < 9 )
+		n = n * 10 + ( *p++ - '0' );
+	if ( IsDigit( *p ) )
+	{
+		const unsigned limit = negative ? 2147483648u : 2147483647u;
+		const unsigned digit = *p++ - '0';
+		if ( IsDigit( *p ) || n > ( limit - digit ) / 10 )
+			return 0;
+		n = n * 10 + digit;
+	}
+
+	*value = negative ? -(int)( n - 1 ) - 1 : (int)n;
+	return p;
+}
+
+// Hands what ReadDouble() can't read exactly to strtod(), which wants the
+// decimal point of the current locale.
+static const char* ReadDoubleSlowly( const char* p, double* value )
+{
+	const char* point = localeconv()->decimal_point;
+	char* end = 0;
+	double d = 0;
+
+	if ( point[0] == '.' || point[0] == 0 || point[1] != 0 )
+	{
+		d = strtod( p, &end );
+	}
+	else
+	{
+		// Copy what might be the number, with the locale's point, and read that.
+		const char* q = p;
+		while ( isalnum( (unsigned char)*q ) || *q == '.' || *q == '+' || *q == '-' )
+			++q;
+
+		TIXML_STRING text( p, q - p );
+		for ( size_t i = 0; i < text.length(); ++i )
+		{
+			if ( text[i] == '.' )
+				text[i] = point[0];
+		}
+		d = strtod( text.c_str(), &end );
+		end = const_cast< char* >( p ) + ( end - text.c_str() );
+	}
+
+	if ( end == p )
+		return 0;
+	*value = d;
+	return end;
+}
+
+const char* TiXmlBase::ReadDouble( const char* p, double* value )
+{
+	// Powers of ten a double holds exactly.
+	static const double powers[] =
+	{
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	if ( !p )
+		return 0;
+	while ( IsNumberSpace( *p ) )
+		++p;
+
+	const char* start = p;
+	bool negative = false;
+	if ( *p == '-' || *p == '+' )
+		negative = ( *p++ == '-' );
+
+	// Up to 19 significant digits are kept in 'mantissa'; 'exponent' scales it.
+	unsigned long long mantissa = 0;
+	int significant = 0;
+	int exponent = 0;
+	bool digits = false;
+	bool truncated = false;
+
+	if ( *p == '0' && ( p[1] == 'x' || p[1] == 'X' ) )
+		return ReadDoubleSlowly( start, value );
+
+	for ( ; IsDigit( *p ); ++p )
+	{
+		digits = true;
+		if ( significant < 19 )
+		{
+			mantissa = mantissa * 10 + ( *p - '0' );
+			if ( mantissa )
+				++significant;
+		}
+		else
+		{
+			++exponent;
+			truncated = truncated || *p != '0';
+		}
+	}
+	if ( *p == '.' )
+	{
+		for ( ++p; IsDigit( *p ); ++p )
+		{
+			digits = true;
+			if ( significant < 19 )
+			{
+				mantissa = mantissa * 10 + ( *p - '0' );
+				if ( mantissa )
+					++significant;
+				--exponent;
+			}
+			else
+			{
+				truncated = truncated || *p != '0';
+			}
+		}
+	}
+	if ( !digits )
+	{
+		// "inf", "infinity" and "nan" are left to strtod().
+		if ( *p == 'i' || *p == 'I' || *p == 'n' || *p == 'N' )
+			return ReadDoubleSlowly( start, value );
+		return 0;
+	}
+
+	if ( *p == 'e' || *p == 'E' )
+	{
+		const char* q = p + 1;
+		bool negativeExponent = false;
+		if ( *q == '-' || *q == '+' )
+			negativeExponent = ( *q++ == '-' );
+		if ( IsDigit( *q ) )
+		{
+			// Anything past 99999 is out of range either way.
+			int e = 0;
+			for ( ; IsDigit( *q ); ++q )
+			{
+				if ( e < 100000 )
+					e = e * 10 + ( *q - '0' );
+			}
+			exponent += negativeExponent ? -e : e;
+			p = q;
+		}
+	}
+
+	// Exact when the digits and the power of ten are both exact doubles.
+	if ( !truncated && mantissa <= ( 1ULL << 53 ) && exponent >= -22 && exponent <= 22 )
+	{
+		double d = (double)mantissa;
+		if ( exponent < 0 )
+			d /= powers[ -exponent ];
+		else
+			d *= powers[ exponent ];
+		*value = negative ? -d : d;
+		return p;
+	}
+	if ( mantissa == 0 && !truncated )
+	{
+		*value = negative ? -0.0 : 0.0;
+		return p;
+	}
+	return ReadDoubleSlowly( start, value );
+}
+
+#ifdef TIXML_USE_STL
+
+void TiXmlDocument::StreamIn( std::istream * in, TIXML_STRING * tag )
+{
+	// The basic issue with a document is that we don't know what we're
+	// streaming. Read something presumed to be a tag (and hope), then
+	// identify it, and call the appropriate stream method on the tag.
+	//
+	// This "pre-streaming" will never read the closing ">" so the
+	// sub-tag can orient itself.
+
+	if ( !StreamTo( in, '<', tag ) ) 
+	{
+		SetError( TIXML_ERROR_PARSING_EMPTY, 0, 0, TIXML_ENCODING_UNKNOWN );
+		return;
+	}
+
+	while ( in->good() )
 	{
 		int tagIndex = (int) tag->length();
+		StreamUntil( in, tag, '>', '>' );
 		while ( in->good() && in->peek() != '>' )
 		{
 			int c = in->get();
@@ -701,10 +1789,41 @@ void TiXmlDocument::StreamIn( std::istream * in, TIXML_STRING * tag )
 
 #endif
 
+void TiXmlDocument::ResolveLocations() const
+{
+	const TiXmlNode* node = firstChild;
+	while ( node )
+	{
+		if ( node->location.Pending() )
+			ResolveLocation( &node->location );
+		const TiXmlElement* element = node->ToElement();
+		if ( element )
+		{
+			for ( const TiXmlAttribute* attribute = element->FirstAttribute(); attribute; attribute = attribute->Next() )
+				attribute->Row();
+		}
+
+		if ( node->firstChild )
+		{
+			node = node->firstChild;
+			continue;
+		}
+		while ( !node->next && node->parent != this )
+			node = node->parent;
+		node = node->next;
+	}
+}
+
+
 const char* TiXmlDocument::Parse( const char* p, TiXmlParsingData* prevData, TiXmlEncoding encoding )
 {
 	ClearError();
 
+	// Everything created from here on goes to the arena, if the document uses one.
+	if ( useArena && !arena )
+		arena = new TiXmlArena();
+	TiXmlArena::Scope scope( useArena ? arena : 0 );
+
 	// Parse away, at the document level. Since a document
 	// contains nothing but other tags, most of what happens
 	// here is skipping white space.
@@ -714,6 +1833,13 @@ const char* TiXmlDocument::Parse( const char* p, TiXmlParsingData* prevData, TiX
 		return 0;
 	}
 
+	// The nodes note where they lie in the text. That holds for the document
+	// too, unless it had children already.
+	const bool ranged = !prevData && !firstChild;
+	SetSourceRange( -1, -1 );
+	edits = 0;
+	fileSize = -1;
+
 	// Note that, for a document, this needs to come
 	// before the while space skip, so that parsing
 	// starts from the pointer we are given.
@@ -728,7 +1854,21 @@ const char* TiXmlDocument::Parse( const char* p, TiXmlParsingData* prevData, TiX
 		location.row = 0;
 		location.col = 0;
 	}
-	TiXmlParsingData data( p, TabSize(), location.row, location.col );
+
+	// A file the document keeps, or text that Reparse() copies for later
+	// edits, is indexed: the nodes only note where they start, and the line
+	// index works out their rows and columns when asked. Other text belongs
+	// to the caller, so its nodes are located while parsing rather than
+	// copying it. The nodes of an earlier parse are located first, while
+	// their text is still indexed.
+	if ( lineIndex.Active() )
+	{
+		ResolveLocations();
+		lineIndex.Clear();
+	}
+	const bool lazy = !parsingInSitu && !prevData && TabSize() >= 1 && ( parsingFile || reparsing );
+	TiXmlParsingData data( p, TabSize(), location.row, location.col, parsingInSitu, parsingFile, condense, lazy );
+	data.document = this;
 	location = data.Cursor();
 
 	if ( encoding == TIXML_ENCODING_UNKNOWN )
@@ -743,6 +1883,8 @@ const char* TiXmlDocument::Parse( const char* p, TiXmlParsingData* prevData, TiX
 			useMicrosoftBOM = true;
 		}
 	}
+	if ( lazy )
+		lineIndex.Reset( p, !parsingFile, parsingFile, location.row, location.col, TabSize(), encoding );
 
     p = SkipWhiteSpace( p, encoding );
 	if ( !p )
@@ -756,7 +1898,10 @@ const char* TiXmlDocument::Parse( const char* p, TiXmlParsingData* prevData, TiX
 		TiXmlNode* node = Identify( p, encoding );
 		if ( node )
 		{
+			const char* begin = p;
 			p = node->Parse( p, &data, encoding );
+			if ( p )
+				node->SetSourceRange( data.Offset( begin ), data.Offset( p ) );
 			LinkEndChild( node );
 		}
 		else
@@ -780,6 +1925,10 @@ const char* TiXmlDocument::Parse( const char* p, TiXmlParsingData* prevData, TiX
 				encoding = TIXML_ENCODING_UTF8;	// incorrect, but be nice
 			else 
 				encoding = TIXML_ENCODING_LEGACY;
+
+			// The stamps so far went by the old encoding, up to the last one.
+			if ( lazy && data.Cursor().Pending() )
+				lineIndex.SetEncoding( encoding, data.Cursor().Offset() );
 		}
 
 		p = SkipWhiteSpace( p, encoding );
@@ -792,9 +1941,180 @@ const char* TiXmlDocument::Parse( const char* p, TiXmlParsingData* prevData, TiX
 	}
 
 	// All is well.
+	sourceEncoding = encoding;
+	if ( ranged && p && !error )
+		SetSourceRange( 0, data.Offset( p ) );
 	return p;
 }
 
+const char* TiXmlDocument::ParseInSitu( char* p, TiXmlEncoding encoding )
+{
+	#ifndef TIXML_USE_STL
+	parsingInSitu = true;
+	#endif
+	const char* result = Parse( p, 0, encoding );
+	parsingInSitu = false;
+	return result;
+}
+
+void TiXmlDocument::ParseFile( char* p, TiXmlEncoding encoding )
+{
+	parsingFile = true;
+	if ( inSitu )
+		ParseInSitu( p, encoding );
+	else
+		Parse( p, 0, encoding );
+	parsingFile = false;
+}
+
+bool TiXmlDocument::Reparse( const char* text, int offset, int removed, int inserted, TiXmlEncoding encoding )
+{
+	// Find the innermost element around the edit, leaving its first and last
+	// bytes alone. Its source range and those after it have to be in step
+	// with the text, and its locations have to be found again once moved.
+	TiXmlNode* target = 0;
+	const int editEnd = offset + removed;
+	if ( sourceBegin >= 0 && !edits && !inSitu && !error && ( lineIndex.Active() || TabSize() < 1 ) )
+	{
+		TiXmlNode* node = this;
+		while ( node )
+		{
+			TiXmlNode* inside = 0;
+			for ( TiXmlNode* child = node->firstChild; child && child->sourceBegin < editEnd; child = child->next )
+			{
+				if ( child->sourceBegin < offset && editEnd < child->sourceEnd )
+				{
+					inside = child;
+					break;
+				}
+			}
+			if ( !inside || !inside->ToElement() )
+				break;
+			target = node = inside;
+		}
+	}
+
+	if ( target )
+	{
+		TiXmlNode* parentNode = target->parent;
+		const int begin = target->sourceBegin;
+		const int end = target->sourceEnd;
+		const int delta = inserted - removed;
+		const bool lazy = lineIndex.Active();
+		const TiXmlEncoding parseEncoding = ( encoding == TIXML_ENCODING_UNKNOWN ) ? sourceEncoding : encoding;
+
+		// The locations from the end of the element on move from 'from' to 'to'.
+		// The index goes over to the new text before the parse stamps it.
+		TiXmlCursor from, to;
+		if ( lazy )
+		{
+			from.SetOffset( end );
+			lineIndex.Locate( &from );
+			lineIndex.Replace( text, true, false );
+		}
+
+		TiXmlArena::Scope scope( useArena ? arena : 0 );
+		TiXmlParsingData data( text, TabSize(), 0, 0, false, false, condense, lazy );
+		data.document = this;
+		const char* p = text + begin;
+		TiXmlNode* node = parentNode->Identify( p, parseEncoding );
+		if ( node && node->ToElement() )
+			p = node->Parse( p, &data, parseEncoding );
+		else
+			p = 0;
+
+		if ( p && !error && data.Offset( p ) == end + delta )
+		{
+			if ( lazy )
+			{
+				to.SetOffset( end + delta );
+				lineIndex.Locate( &to );
+				// The index has its own copy now.
+				sourceMap.Close();
+				delete [] sourceBuffer;
+				sourceBuffer = 0;
+			}
+			node->SetSourceRange( begin, end + delta );
+			parentNode->LinkReplaceChild( target, node );
+			MoveSource( this, node, end, delta, from, to );
+			sourceEnd += delta;
+
+			// Nothing was edited before, and the new element matches the text.
+			for ( TiXmlNode* ancestor = parentNode; ancestor; ancestor = ancestor->parent )
+				ancestor->edits = 0;
+			fileSize = -1;
+			return true;
+		}
+		delete node;
+	}
+
+	Clear();
+	location.Clear();
+	reparsing = true;
+	const bool result = Parse( text, 0, encoding ) && !error;
+	reparsing = false;
+	return result;
+}
+
+
+// Move a cursor that is at or after 'end' along with the text, for Reparse().
+static void MoveCursor( TiXmlCursor* cursor, int end, int delta, const TiXmlCursor& from, const TiXmlCursor& to )
+{
+	if ( cursor->Pending() )
+	{
+		if ( cursor->Offset() >= end )
+			cursor->SetOffset( cursor->Offset() + delta );
+	}
+	else if ( from.row >= 0 && cursor->row >= 0 )
+	{
+		if ( cursor->row > from.row )
+		{
+			cursor->row += to.row - from.row;
+		}
+		else if ( cursor->row == from.row && cursor->col >= from.col )
+		{
+			cursor->row = to.row;
+			cursor->col += to.col - from.col;
+		}
+	}
+}
+
+
+void TiXmlDocument::MoveSource( TiXmlNode* node, const TiXmlNode* skip, int end, int delta, const TiXmlCursor& from, const TiXmlCursor& to )
+{
+	TiXmlNode* child = node->firstChild;
+	while ( child )
+	{
+		// Whatever ends before the edit stays where it is, and so does all below it.
+		if ( child != skip && child->sourceEnd >= end )
+		{
+			if ( child->sourceBegin >= end )
+				child->sourceBegin += delta;
+			child->sourceEnd += delta;
+			MoveCursor( &child->location, end, delta, from, to );
+
+			TiXmlElement* element = child->ToElement();
+			if ( element )
+			{
+				if ( element->sourceTagEnd >= end )
+					element->sourceTagEnd += delta;
+				for ( TiXmlAttribute* attribute = element->FirstAttribute(); attribute; attribute = attribute->Next() )
+					MoveCursor( &attribute->location, end, delta, from, to );
+			}
+
+			if ( child->firstChild )
+			{
+				child = child->firstChild;
+				continue;
+			}
+		}
+		while ( !child->next && child->parent != node )
+			child = child->parent;
+		child = child->next;
+	}
+}
+
+
 void TiXmlDocument::SetError( int err, const char* pError, TiXmlParsingData* data, TiXmlEncoding encoding )
 {	
 	// The first error in a chain is more accurate - don't set again!
@@ -804,13 +2124,19 @@ void TiXmlDocument::SetError( int err, const char* pError, TiXmlParsingData* dat
 	assert( err > 0 && err < TIXML_ERROR_STRING_COUNT );
 	error   = true;
 	errorId = err;
-	errorDesc = errorString[ errorId ];
+	{
+		// The document's own strings must outlive Clear(), so never use the arena.
+		TiXmlArena::Scope heap( 0 );
+		errorDesc = errorString[ errorId ];
+	}
 
 	errorLocation.Clear();
 	if ( pError && data )
 	{
 		data->Stamp( pError, encoding );
 		errorLocation = data->Cursor();
+		if ( errorLocation.Pending() )
+			lineIndex.Locate( &errorLocation );
 	}
 }
 
@@ -901,18 +2227,45 @@ TiXmlNode* TiXmlNode::Identify( const char* p, TiXmlEncoding encoding )
 #ifdef TIXML_USE_STL
 
 void TiXmlElement::StreamIn (std::istream * in, TIXML_STRING * tag)
+{
+	if ( !StreamStartTag( in, tag ) )
+		return;
+
+	// The elements inside this one are streamed here too: 'depth' counts
+	// those whose start tag has been read but not their end tag.
+	int depth = 0;
+	for ( ;; )
+	{
+		if ( StreamValue( in, tag ) )
+		{
+			// An element starts: read its start tag, and go in if it has more.
+			if ( StreamStartTag( in, tag ) )
+				++depth;
+			continue;
+		}
+		// The innermost element is done.
+		if ( depth == 0 )
+			return;
+		--depth;
+	}
+}
+
+
+bool TiXmlElement::StreamStartTag( std::istream * in, TIXML_STRING * tag )
 {
 	// We're called with some amount of pre-parsing. That is, some of "this"
 	// element is in "tag". Go ahead and stream to the closing ">"
 	while( in->good() )
 	{
+		StreamUntil( in, tag, '>', '>' );
+
 		int c = in->get();
 		if ( c <= 0 )
 		{
 			TiXmlDocument* document = GetDocument();
 			if ( document )
 				document->SetError( TIXML_ERROR_EMBEDDED_NULL, 0, 0, TIXML_ENCODING_UNKNOWN );
-			return;
+			return false;
 		}
 		(*tag) += (char) c ;
 		
@@ -920,7 +2273,7 @@ void TiXmlElement::StreamIn (std::istream * in, TIXML_STRING * tag)
 			break;
 	}
 
-	if ( tag->length() < 3 ) return;
+	if ( tag->length() < 3 ) return false;
 
 	// Okay...if we are a "/>" tag, then we're done. We've read a complete tag.
 	// If not, identify and stream.
@@ -929,121 +2282,148 @@ void TiXmlElement::StreamIn (std::istream * in, TIXML_STRING * tag)
 		 && tag->at( tag->length() - 2 ) == '/' )
 	{
 		// All good!
-		return;
+		return false;
 	}
-	else if ( tag->at( tag->length() - 1 ) == '>' )
+	return tag->at( tag->length() - 1 ) == '>';
+}
+
+
+bool TiXmlElement::StreamValue( std::istream * in, TIXML_STRING * tag )
+{
+	// There is more. Could be:
+	//		text
+	//		cdata text (which looks like another node)
+	//		closing tag
+	//		another node.
+	for ( ;; )
 	{
-		// There is more. Could be:
-		//		text
-		//		cdata text (which looks like another node)
-		//		closing tag
-		//		another node.
-		for ( ;; )
+		StreamWhiteSpace( in, tag );
+
+		// Do we have text?
+		if ( in->good() && in->peek() != '<' ) 
 		{
-			StreamWhiteSpace( in, tag );
+			// Yep, text.
+			TiXmlText text( "" );
+			text.StreamIn( in, tag );
 
-			// Do we have text?
-			if ( in->good() && in->peek() != '<' ) 
-			{
-				// Yep, text.
-				TiXmlText text( "" );
-				text.StreamIn( in, tag );
+			// What follows text is a closing tag or another node.
+			// Go around again and figure it out.
+			continue;
+		}
 
-				// What follows text is a closing tag or another node.
-				// Go around again and figure it out.
-				continue;
-			}
+		// We now have either a closing tag...or another node.
+		// We should be at a "<", regardless.
+		if ( !in->good() ) return false;
+		assert( in->peek() == '<' );
+		int tagIndex = (int) tag->length();
 
-			// We now have either a closing tag...or another node.
-			// We should be at a "<", regardless.
-			if ( !in->good() ) return;
-			assert( in->peek() == '<' );
-			int tagIndex = (int) tag->length();
+		bool closingTag = false;
+		bool firstCharFound = false;
 
-			bool closingTag = false;
-			bool firstCharFound = false;
+		for( ;; )
+		{
+			if ( !in->good() )
+				return false;
 
-			for( ;; )
-			{
-				if ( !in->good() )
-					return;
+			// Once the tag is known not to close an element, only the end
+			// and a CDATA id matter.
+			if ( firstCharFound )
+				StreamUntil( in, tag, '>', '[' );
 
-				int c = in->peek();
-				if ( c <= 0 )
-				{
-					TiXmlDocument* document = GetDocument();
-					if ( document )
-						document->SetError( TIXML_ERROR_EMBEDDED_NULL, 0, 0, TIXML_ENCODING_UNKNOWN );
-					return;
-				}
-				
-				if ( c == '>' )
-					break;
+			int c = in->peek();
+			if ( c <= 0 )
+			{
+				TiXmlDocument* document = GetDocument();
+				if ( document )
+					document->SetError( TIXML_ERROR_EMBEDDED_NULL, 0, 0, TIXML_ENCODING_UNKNOWN );
+				return false;
+			}
+			
+			if ( c == '>' )
+				break;
 
-				*tag += (char) c;
-				in->get();
+			*tag += (char) c;
+			in->get();
 
-				// Early out if we find the CDATA id.
-				if ( c == '[' && tag->size() >= 9 )
-				{
-					size_t len = tag->size();
-					const char* start = tag->c_str() + len - 9;
-					if ( strcmp( start, "<![CDATA[" ) == 0 ) {
-						assert( !closingTag );
-						break;
-					}
-				}
-
-				if ( !firstCharFound && c != '<' && !IsWhiteSpace( c ) )
-				{
-					firstCharFound = true;
-					if ( c == '/' )
-						closingTag = true;
+			// Early out if we find the CDATA id.
+			if ( c == '[' && tag->size() >= 9 )
+			{
+				size_t len = tag->size();
+				const char* start = tag->c_str() + len - 9;
+				if ( strcmp( start, "<![CDATA[" ) == 0 ) {
+					assert( !closingTag );
+					break;
 				}
 			}
-			// If it was a closing tag, then read in the closing '>' to clean up the input stream.
-			// If it was not, the streaming will be done by the tag.
-			if ( closingTag )
-			{
-				if ( !in->good() )
-					return;
 
-				int c = in->get();
-				if ( c <= 0 )
-				{
-					TiXmlDocument* document = GetDocument();
-					if ( document )
-						document->SetError( TIXML_ERROR_EMBEDDED_NULL, 0, 0, TIXML_ENCODING_UNKNOWN );
-					return;
-				}
-				assert( c == '>' );
-				*tag += (char) c;
+			if ( !firstCharFound && c != '<' && !IsWhiteSpace( c ) )
+			{
+				firstCharFound = true;
+				if ( c == '/' )
+					closingTag = true;
+			}
+		}
+		// If it was a closing tag, then read in the closing '>' to clean up the input stream.
+		// If it was not, the streaming will be done by the tag.
+		if ( closingTag )
+		{
+			if ( !in->good() )
+				return false;
 
-				// We are done, once we've found our closing tag.
-				return;
+			int c = in->get();
+			if ( c <= 0 )
+			{
+				TiXmlDocument* document = GetDocument();
+				if ( document )
+					document->SetError( TIXML_ERROR_EMBEDDED_NULL, 0, 0, TIXML_ENCODING_UNKNOWN );
+				return false;
 			}
-			else
+			assert( c == '>' );
+			*tag += (char) c;
+
+			// We are done, once we've found our closing tag.
+			return false;
+		}
+		else
+		{
+			// If not a closing tag, id it, and stream.
+			const char* tagloc = tag->c_str() + tagIndex;
+			TiXmlNode* node = Identify( tagloc, TIXML_DEFAULT_ENCODING );
+			if ( !node )
+				return false;
+			if ( node->ToElement() )
 			{
-				// If not a closing tag, id it, and stream.
-				const char* tagloc = tag->c_str() + tagIndex;
-				TiXmlNode* node = Identify( tagloc, TIXML_DEFAULT_ENCODING );
-				if ( !node )
-					return;
-				node->StreamIn( in, tag );
+				// The caller reads the element.
 				delete node;
-				node = 0;
-
-				// No return: go around from the beginning: text, closing tag, or node.
+				return true;
 			}
+			node->StreamIn( in, tag );
+			delete node;
+			node = 0;
+
+			// No return: go around from the beginning: text, closing tag, or node.
 		}
 	}
 }
 #endif
 
 const char* TiXmlElement::Parse( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding )
+{
+	TiXmlDocument* document = ParsingDocument( this, data );
+
+	bool open = false;
+	p = ReadStartTag( p, data, encoding, document, &open );
+	if ( !p || !open )
+		return p;
+
+	// Read the value -- which can include other elements -- and the end tag.
+	return ReadValue( p, data, encoding );		// Note this is an Element method, and will set the error if one happens.
+}
+
+
+const char* TiXmlElement::ReadStartTag( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding, TiXmlDocument* document, bool* open )
 {
 	p = SkipWhiteSpace( p, encoding );
-	TiXmlDocument* document = GetDocument();
 
 	if ( !p || !*p )
 	{
@@ -1067,19 +2447,23 @@ const char* TiXmlElement::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
 
 	// Read the name.
 	const char* pErr = p;
+	const bool inSitu = data && data->InSitu();
 
-    p = ReadName( p, &value, encoding );
+    p = ReadName( p, inSitu ? 0 : &value, encoding );
+	// A name the text ends with is kept, as a copied one is.
+	if ( inSitu && p )
+		Borrow( &value, pErr, p, 0 );
 	if ( !p || !*p )
 	{
 		if ( document )	document->SetError( TIXML_ERROR_FAILED_TO_READ_ELEMENT_NAME, pErr, data, encoding );
 		return 0;
 	}
-
-    TIXML_STRING endTag ("</");
-	endTag += value;
+	atom = document ? document->Intern( value.c_str(), value.length() ) : TiXmlAtom();
+	if ( parent )
+		parent->ChildrenChanged();		// in case this element is read again, under a new name
 
 	// Check for and read attributes. Also look for an empty
-	// tag or an end tag.
+	// tag or the end of the start tag.
 	while ( p && *p )
 	{
 		pErr = p;
@@ -1098,43 +2482,18 @@ const char* TiXmlElement::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
 				if ( document ) document->SetError( TIXML_ERROR_PARSING_EMPTY, p, data, encoding );		
 				return 0;
 			}
+			if ( data )
+				sourceTagEnd = data->Offset( p+1 );
 			return (p+1);
 		}
 		else if ( *p == '>' )
 		{
 			// Done with attributes (if there were any.)
-			// Read the value -- which can include other
-			// elements -- read the end tag, and return.
 			++p;
-			p = ReadValue( p, data, encoding );		// Note this is an Element method, and will set the error if one happens.
-			if ( !p || !*p ) {
-				// We were looking for the end tag, but found nothing.
-				// Fix for [ 1663758 ] Failure to report error on bad XML
-				if ( document ) document->SetError( TIXML_ERROR_READING_END_TAG, p, data, encoding );
-				return 0;
-			}
-
-			// We should find the end tag now
-			// note that:
-			// </foo > and
-			// </foo> 
-			// are both valid end tags.
-			if ( StringEqual( p, endTag.c_str(), false, encoding ) )
-			{
-				p += endTag.length();
-				p = SkipWhiteSpace( p, encoding );
-				if ( p && *p && *p == '>' ) {
-					++p;
-					return p;
-				}
-				if ( document ) document->SetError( TIXML_ERROR_READING_END_TAG, p, data, encoding );
-				return 0;
-			}
-			else
-			{
-				if ( document ) document->SetError( TIXML_ERROR_READING_END_TAG, p, data, encoding );
-				return 0;
-			}
+			if ( data )
+				sourceTagEnd = data->Offset( p );
+			*open = true;
+			return p;
 		}
 		else
 		{
@@ -1178,7 +2537,13 @@ const char* TiXmlElement::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
 
 const char* TiXmlElement::ReadValue( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding )
 {
-	TiXmlDocument* document = GetDocument();
+	TiXmlDocument* document = ParsingDocument( this, data );
+
+	// The elements inside this one are read here too, rather than by their own
+	// Parse(): 'element' is the innermost one open, and goes back up to its
+	// parent at its end tag. While open, an element keeps the offset of its
+	// start in its source end, out of the way of MarkEdited().
+	TiXmlElement* element = this;
 
 	// Read in text and elements in any order.
 	const char* pWithWhiteSpace = p;
@@ -1196,7 +2561,8 @@ const char* TiXmlElement::ReadValue( const char* p, TiXmlParsingData* data, TiXm
 			    return 0;
 			}
 
-			if ( TiXmlBase::IsWhiteSpaceCondensed() )
+			const char* begin = p;
+			if ( data ? data->CondenseWhiteSpace() : IsWhiteSpaceCondensed() )
 			{
 				p = textNode->Parse( p, data, encoding );
 			}
@@ -1204,46 +2570,94 @@ const char* TiXmlElement::ReadValue( const char* p, TiXmlParsingData* data, TiXm
 			{
 				// Special case: we want to keep the white space
 				// so that leading spaces aren't removed.
+				begin = pWithWhiteSpace;
 				p = textNode->Parse( pWithWhiteSpace, data, encoding );
 			}
+			if ( p && data )
+				textNode->SetSourceRange( data->Offset( begin ), data->Offset( p ) );
 
 			if ( !textNode->Blank() )
-				LinkEndChild( textNode );
+				element->LinkEndChild( textNode );
 			else
 				delete textNode;
 		} 
-		else 
+		else if ( StringEqual( p, "</", false, encoding ) )
+		{
+			// We should find the end tag now
+			// note that:
+			// </foo > and
+			// </foo> 
+			// are both valid end tags.
+			const TIXML_STRING& name = element->value;
+			if ( strncmp( p+2, name.c_str(), name.length() ) != 0 )
+			{
+				if ( document ) document->SetError( TIXML_ERROR_READING_END_TAG, p, data, encoding );
+				return 0;
+			}
+			p += 2 + name.length();
+			p = SkipWhiteSpace( p, encoding );
+			if ( !p || !*p || *p != '>' )
+			{
+				if ( document ) document->SetError( TIXML_ERROR_READING_END_TAG, p, data, encoding );
+				return 0;
+			}
+			++p;
+
+			if ( element == this )
+				return p;
+			if ( data )
+				element->SetSourceRange( element->sourceEnd, data->Offset( p ) );
+			else
+				element->SetSourceRange( -1, -1 );
+			element = element->parent->ToElement();
+		}
+		else
 		{
 			// We hit a '<'
-			// Have we hit a new element or an end tag? This could also be
+			// Have we hit a new element? This could also be
 			// a TiXmlText in the "CDATA" style.
-			if ( StringEqual( p, "</", false, encoding ) )
+			TiXmlNode* node = element->Identify( p, encoding );
+			if ( !node )
 			{
-				return p;
+				if ( document ) document->SetError( TIXML_ERROR_READING_END_TAG, 0, data, encoding );
+				return 0;
 			}
-			else
+
+			const char* begin = p;
+			TiXmlElement* child = node->ToElement();
+			if ( child )
 			{
-				TiXmlNode* node = Identify( p, encoding );
-				if ( node )
-				{
-					p = node->Parse( p, data, encoding );
-					LinkEndChild( node );
-				}				
-				else
+				bool open = false;
+				p = child->ReadStartTag( p, data, encoding, document, &open );
+				element->LinkEndChild( child );
+				if ( p && open )
 				{
-					return 0;
+					// Go in, to read its value.
+					child->sourceEnd = data ? data->Offset( begin ) : -1;
+					element = child;
+					begin = 0;
 				}
 			}
+			else
+			{
+				p = node->Parse( p, data, encoding );
+				element->LinkEndChild( node );
+			}
+			if ( p && data && begin )
+				node->SetSourceRange( data->Offset( begin ), data->Offset( p ) );
 		}
 		pWithWhiteSpace = p;
 		p = SkipWhiteSpace( p, encoding );
 	}
 
-	if ( !p )
+	// The text ran out, or a node in it failed, before the end tag.
+	if ( document )
 	{
-		if ( document ) document->SetError( TIXML_ERROR_READING_ELEMENT_VALUE, 0, 0, encoding );
-	}	
-	return p;
+		if ( !p )
+			document->SetError( TIXML_ERROR_READING_ELEMENT_VALUE, 0, 0, encoding );
+		document->SetError( TIXML_ERROR_READING_END_TAG, p, data, encoding );
+	}
+	return 0;
 }
 
 
@@ -1252,6 +2666,8 @@ void TiXmlUnknown::StreamIn( std::istream * in, TIXML_STRING * tag )
 {
 	while ( in->good() )
 	{
+		StreamUntil( in, tag, '>', '>' );
+
 		int c = in->get();	
 		if ( c <= 0 )
 		{
@@ -1274,7 +2690,7 @@ void TiXmlUnknown::StreamIn( std::istream * in, TIXML_STRING * tag )
 
 const char* TiXmlUnknown::Parse( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding )
 {
-	TiXmlDocument* document = GetDocument();
+	TiXmlDocument* document = ParsingDocument( this, data );
 	p = SkipWhiteSpace( p, encoding );
 
 	if ( data )
@@ -1288,13 +2704,12 @@ const char* TiXmlUnknown::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
 		return 0;
 	}
 	++p;
-    value = "";
-
-	while ( p && *p && *p != '>' )
-	{
-		value += *p;
-		++p;
-	}
+	const bool inSitu = data && data->InSitu();
+	const bool newLines = data && data->NormalizeNewLines();
+	TextSpan span;
+	p = ReadRaw( p, inSitu ? 0 : &value, ">", encoding, newLines, inSitu ? &span : 0 );
+	if ( inSitu )
+		Borrow( &value, span.start, span.end, span.flags );
 
 	if ( !p )
 	{
@@ -1311,6 +2726,8 @@ void TiXmlComment::StreamIn( std::istream * in, TIXML_STRING * tag )
 {
 	while ( in->good() )
 	{
+		StreamUntil( in, tag, '>', '>' );
+
 		int c = in->get();	
 		if ( c <= 0 )
 		{
@@ -1336,7 +2753,7 @@ void TiXmlComment::StreamIn( std::istream * in, TIXML_STRING * tag )
 
 const char* TiXmlComment::Parse( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding )
 {
-	TiXmlDocument* document = GetDocument();
+	TiXmlDocument* document = ParsingDocument( this, data );
 	value = "";
 
 	p = SkipWhiteSpace( p, encoding );
@@ -1375,13 +2792,13 @@ const char* TiXmlComment::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
 				  <!-- declarations for <head> & <body> -->
 	*/
 
-    value = "";
 	// Keep all the white space.
-	while (	p && *p && !StringEqual( p, endTag, false, encoding ) )
-	{
-		value.append( p, 1 );
-		++p;
-	}
+	const bool inSitu = data && data->InSitu();
+	const bool newLines = data && data->NormalizeNewLines();
+	TextSpan span;
+	p = ReadRaw( p, inSitu ? 0 : &value, endTag, encoding, newLines, inSitu ? &span : 0 );
+	if ( inSitu )
+		Borrow( &value, span.start, span.end, span.flags );
 	if ( p && *p ) 
 		p += strlen( endTag );
 
@@ -1401,12 +2818,16 @@ const char* TiXmlAttribute::Parse( const char* p, TiXmlParsingData* data, TiXmlE
 	}
 	// Read the name, the '=' and the value.
 	const char* pErr = p;
-	p = ReadName( p, &name, encoding );
+	const bool inSitu = data && data->InSitu();
+	p = ReadName( p, inSitu ? 0 : &name, encoding );
 	if ( !p || !*p )
 	{
 		if ( document ) document->SetError( TIXML_ERROR_READING_ATTRIBUTES, pErr, data, encoding );
 		return 0;
 	}
+	if ( inSitu )
+		Borrow( &name, pErr, p, 0 );
+	atom = document ? document->Intern( name.c_str(), name.length() ) : TiXmlAtom();
 	p = SkipWhiteSpace( p, encoding );
 	if ( !p || !*p || *p != '=' )
 	{
@@ -1426,17 +2847,25 @@ const char* TiXmlAttribute::Parse( const char* p, TiXmlParsingData* data, TiXmlE
 	const char SINGLE_QUOTE = '\'';
 	const char DOUBLE_QUOTE = '\"';
 
-	if ( *p == SINGLE_QUOTE )
-	{
-		++p;
-		end = "\'";		// single quote in string
-		p = ReadText( p, &value, false, end, false, encoding );
-	}
-	else if ( *p == DOUBLE_QUOTE )
+	if ( *p == SINGLE_QUOTE || *p == DOUBLE_QUOTE )
 	{
+		end = ( *p == SINGLE_QUOTE ) ? "\'" : "\"";	// the quote in the string
 		++p;
-		end = "\"";		// double quote in string
-		p = ReadText( p, &value, false, end, false, encoding );
+		const bool newLines = data && data->NormalizeNewLines();
+		if ( inSitu )
+		{
+			TextSpan span;
+			const char* pText = p;
+			p = ReadText( p, 0, false, end, false, encoding, newLines, &span );
+			if ( p )
+				Borrow( &value, span.start, span.end, span.flags );
+			else
+				ReadText( pText, &value, false, end, false, encoding, newLines );	// what was read before the error
+		}
+		else
+		{
+			p = ReadText( p, &value, false, end, false, encoding, newLines );
+		}
 	}
 	else
 	{
@@ -1444,6 +2873,7 @@ const char* TiXmlAttribute::Parse( const char* p, TiXmlParsingData* data, TiXmlE
 		// But this is such a common error that the parser will try
 		// its best, even without them.
 		value = "";
+		const char* start = p;
 		while (    p && *p											// existence
 				&& !IsWhiteSpace( *p )								// whitespace
 				&& *p != '/' && *p != '>' )							// tag end
@@ -1455,9 +2885,12 @@ const char* TiXmlAttribute::Parse( const char* p, TiXmlParsingData* data, TiXmlE
 				if ( document ) document->SetError( TIXML_ERROR_READING_ATTRIBUTES, p, data, encoding );
 				return 0;
 			}
-			value += *p;
+			if ( !inSitu )
+				value += *p;
 			++p;
 		}
+		if ( inSitu )
+			Borrow( &value, start, p, 0 );
 	}
 	return p;
 }
@@ -1467,6 +2900,11 @@ void TiXmlText::StreamIn( std::istream * in, TIXML_STRING * tag )
 {
 	while ( in->good() )
 	{
+		if ( cdata )
+			StreamUntil( in, tag, '>', '>' );
+		else
+			StreamUntil( in, tag, '<', '<' );
+
 		int c = in->peek();	
 		if ( !cdata && (c == '<' ) ) 
 		{
@@ -1497,7 +2935,7 @@ void TiXmlText::StreamIn( std::istream * in, TIXML_STRING * tag )
 const char* TiXmlText::Parse( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding )
 {
 	value = "";
-	TiXmlDocument* document = GetDocument();
+	TiXmlDocument* document = ParsingDocument( this, data );
 
 	if ( data )
 	{
@@ -1521,13 +2959,12 @@ const char* TiXmlText::Parse( const char* p, TiXmlParsingData* data, TiXmlEncodi
 		p += strlen( startTag );
 
 		// Keep all the white space, ignore the encoding, etc.
-		while (	   p && *p
-				&& !StringEqual( p, endTag, false, encoding )
-			  )
-		{
-			value += *p;
-			++p;
-		}
+		const bool inSitu = data && data->InSitu();
+		const bool newLines = data && data->NormalizeNewLines();
+		TextSpan span;
+		p = ReadRaw( p, inSitu ? 0 : &value, endTag, encoding, newLines, inSitu ? &span : 0 );
+		if ( inSitu )
+			Borrow( &value, span.start, span.end, span.flags );
 
 		TIXML_STRING dummy; 
 		p = ReadText( p, &dummy, false, endTag, false, encoding );
@@ -1535,10 +2972,48 @@ const char* TiXmlText::Parse( const char* p, TiXmlParsingData* data, TiXmlEncodi
 	}
 	else
 	{
-		bool ignoreWhite = true;
+		// Without parsing data (reading a lone node) the default setting holds.
+		const bool ignoreWhite = data ? data->CondenseWhiteSpace() : IsWhiteSpaceCondensed();
 
 		const char* end = "<";
-		p = ReadText( p, &value, ignoreWhite, end, false, encoding );
+		const bool newLines = data && data->NormalizeNewLines();
+		if ( data && data->InSitu() )
+		{
+			TextSpan span;
+			const char* pText = p;
+			p = ReadText( p, 0, ignoreWhite, end, false, encoding, newLines, &span );
+			if ( !p )
+			{
+				// Keep what was read before the error, as a copying parse does.
+				ReadText( pText, &value, ignoreWhite, end, false, encoding, newLines );
+				return 0;
+			}
+			Borrow( &value, span.start, span.end, span.flags );
+
+			// Blank() can't tell from a pending value, so the value has to have
+			// a char outside white space and entity references to stay pending.
+			// Anything else is decoded now, after the location has moved past it.
+			bool entity = false;
+			const char* q = span.start;
+			for ( ; q < span.end; ++q )
+			{
+				if ( *q == '&' )
+					entity = true;
+				else if ( entity )
+					entity = ( *q != ';' );
+				else if ( !IsWhiteSpace( *q ) )
+					break;
+			}
+			if ( q == span.end )
+			{
+				data->Stamp( p-1, encoding );
+				value.c_str();
+			}
+		}
+		else
+		{
+			p = ReadText( p, &value, ignoreWhite, end, false, encoding, newLines );
+		}
 		if ( p && *p )
 			return p-1;	// don't truncate the '<'
 		return 0;
@@ -1550,6 +3025,8 @@ void TiXmlDeclaration::StreamIn( std::istream * in, TIXML_STRING * tag )
 {
 	while ( in->good() )
 	{
+		StreamUntil( in, tag, '>', '>' );
+
 		int c = in->get();
 		if ( c <= 0 )
 		{
@@ -1569,12 +3046,20 @@ void TiXmlDeclaration::StreamIn( std::istream * in, TIXML_STRING * tag )
 }
 #endif
 
+// An attribute value read in situ is decoded in place once it is read, so
+// the location has to be moved past it first.
+static void StampInSitu( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding )
+{
+	if ( p && data && data->InSitu() )
+		data->Stamp( p, encoding );
+}
+
 const char* TiXmlDeclaration::Parse( const char* p, TiXmlParsingData* data, TiXmlEncoding _encoding )
 {
 	p = SkipWhiteSpace( p, _encoding );
 	// Find the beginning, find the end, and look for
 	// the stuff in-between.
-	TiXmlDocument* document = GetDocument();
+	TiXmlDocument* document = ParsingDocument( this, data );
 	if ( !p || !*p || !StringEqual( p, "<?xml", true, _encoding ) )
 	{
 		if ( document ) document->SetError( TIXML_ERROR_PARSING_DECLARATION, 0, 0, _encoding );
@@ -1604,18 +3089,21 @@ const char* TiXmlDeclaration::Parse( const char* p, TiXmlParsingData* data, TiXm
 		{
 			TiXmlAttribute attrib;
 			p = attrib.Parse( p, data, _encoding );		
+			StampInSitu( p, data, _encoding );
 			version = attrib.Value();
 		}
 		else if ( StringEqual( p, "encoding", true, _encoding ) )
 		{
 			TiXmlAttribute attrib;
 			p = attrib.Parse( p, data, _encoding );		
+			StampInSitu( p, data, _encoding );
 			encoding = attrib.Value();
 		}
 		else if ( StringEqual( p, "standalone", true, _encoding ) )
 		{
 			TiXmlAttribute attrib;
 			p = attrib.Parse( p, data, _encoding );		
+			StampInSitu( p, data, _encoding );
 			standalone = attrib.Value();
 		}
 		else
@@ -1630,9 +3118,502 @@ const char* TiXmlDeclaration::Parse( const char* p, TiXmlParsingData* data, TiXm
 
 bool TiXmlText::Blank() const
 {
+	#ifndef TIXML_USE_STL
+	// Text parsed in situ is only left pending if it isn't blank.
+	if ( value.pending() )
+		return false;
+	#endif
 	for ( unsigned i=0; i<value.length(); i++ )
 		if ( !IsWhiteSpace( value[i] ) )
 			return false;
 	return true;
 }
 
+
+
+TiXmlSaxAttributes::TiXmlSaxAttributes()
+{
+	names = 0;
+	values = 0;
+	count = 0;
+	capacity = 0;
+}
+
+
+TiXmlSaxAttributes::~TiXmlSaxAttributes()
+{
+	delete [] names;
+	delete [] values;
+}
+
+
+int TiXmlSaxAttributes::Add()
+{
+	if ( count == capacity )
+	{
+		const int newCapacity = capacity ? capacity * 2 : 8;
+		TIXML_STRING* newNames = new TIXML_STRING[ newCapacity ];
+		TIXML_STRING* newValues = new TIXML_STRING[ newCapacity ];
+		for ( int i=0; i<capacity; ++i )
+		{
+			newNames[i].swap( names[i] );
+			newValues[i].swap( values[i] );
+		}
+		delete [] names;
+		delete [] values;
+		names = newNames;
+		values = newValues;
+		capacity = newCapacity;
+	}
+	return count++;
+}
+
+
+const char* TiXmlSaxAttributes::Find( const char* name ) const
+{
+	for ( int i=0; i<count; ++i )
+	{
+		if ( strcmp( names[i].c_str(), name ) == 0 )
+			return values[i].c_str();
+	}
+	return 0;
+}
+
+
+TiXmlSaxParser::TiXmlSaxParser()
+{
+	handler = 0;
+	start = 0;
+	current = 0;
+	newLines = false;
+	stopped = false;
+	depth = 0;
+	open = 0;
+	openCapacity = 0;
+	tabsize = 4;
+	condense = TiXmlBase::IsWhiteSpaceCondensed();
+	ClearError();
+}
+
+
+TiXmlSaxParser::~TiXmlSaxParser()
+{
+	delete [] open;
+}
+
+
+int TiXmlSaxParser::Row() const
+{
+	TiXmlCursor cursor;
+	Locate( &cursor, current );
+	return cursor.row + 1;
+}
+
+
+int TiXmlSaxParser::Column() const
+{
+	TiXmlCursor cursor;
+	Locate( &cursor, current );
+	return cursor.col + 1;
+}
+
+
+void TiXmlSaxParser::Locate( TiXmlCursor* cursor, const char* p ) const
+{
+	cursor->Clear();
+	if ( p && lineIndex.Active() )
+	{
+		cursor->SetOffset( (int)( p - start ) );
+		lineIndex.Locate( cursor );
+	}
+}
+
+
+void TiXmlSaxParser::ClearError()
+{
+	error = false;
+	errorId = 0;
+	errorDesc = "";
+	errorLocation.row = errorLocation.col = 0;
+}
+
+
+void TiXmlSaxParser::SetError( int err, const char* pError )
+{
+	// The first error in a chain is more accurate - don't set again!
+	if ( error )
+		return;
+
+	assert( err > 0 && err < TiXmlBase::TIXML_ERROR_STRING_COUNT );
+	error   = true;
+	errorId = err;
+	errorDesc = TiXmlBase::errorString[ errorId ];
+	Locate( &errorLocation, pError );
+}
+
+
+TIXML_STRING& TiXmlSaxParser::Push()
+{
+	if ( depth == openCapacity )
+	{
+		const int newCapacity = openCapacity ? openCapacity * 2 : 16;
+		TIXML_STRING* newOpen = new TIXML_STRING[ newCapacity ];
+		for ( int i=0; i<openCapacity; ++i )
+			newOpen[i].swap( open[i] );
+		delete [] open;
+		open = newOpen;
+		openCapacity = newCapacity;
+	}
+	return open[ depth++ ];
+}
+
+
+bool TiXmlSaxParser::Parse( const char* p, TiXmlSaxHandler* _handler, TiXmlEncoding encoding )
+{
+	assert( _handler );
+	handler = _handler;
+	start = p;
+	current = 0;
+	stopped = false;
+	depth = 0;
+	ClearError();
+
+	if ( !p || !*p )
+	{
+		SetError( TiXmlBase::TIXML_ERROR_DOCUMENT_EMPTY, 0 );
+		return false;
+	}
+
+	if ( encoding == TIXML_ENCODING_UNKNOWN )
+	{
+		// Check for the Microsoft UTF-8 lead bytes.
+		const unsigned char* pU = (const unsigned char*)p;
+		if (	*(pU+0) && *(pU+0) == TIXML_UTF_LEAD_0
+			 && *(pU+1) && *(pU+1) == TIXML_UTF_LEAD_1
+			 && *(pU+2) && *(pU+2) == TIXML_UTF_LEAD_2 )
+		{
+			encoding = TIXML_ENCODING_UTF8;
+		}
+	}
+	if ( tabsize >= 1 )
+		lineIndex.Reset( p, false, newLines, 0, 0, tabsize, encoding );
+
+	// The document level reads tags until something else comes, as
+	// TiXmlDocument::Parse() does; inside an element, text is read too, and
+	// the end tag, as TiXmlElement::ReadValue() does.
+	bool any = false;
+	if ( Go( handler->StartDocument() ) )
+	{
+		p = TiXmlBase::SkipWhiteSpace( p, encoding );
+		const char* pWithWhiteSpace = p;
+		while ( p && *p && !error && !stopped )
+		{
+			if ( depth == 0 )
+			{
+				if ( *p != '<' )
+					break;
+				any = true;
+				p = ReadMarkup( p, &encoding );
+			}
+			else if ( *p != '<' )
+			{
+				// Keep the leading white space, unless it is condensed.
+				current = condense ? p : pWithWhiteSpace;
+				p = TiXmlBase::ReadText( current, &text, condense, "<", false, encoding, newLines );
+
+				bool blank = true;
+				for ( unsigned i=0; blank && i<text.length(); i++ )
+					blank = TiXmlBase::IsWhiteSpace( text[i] );
+				if ( !blank )
+					Go( handler->Text( text.c_str(), false ) );
+
+				p = ( p && *p ) ? p-1 : 0;		// don't truncate the '<'
+			}
+			else if ( TiXmlBase::StringEqual( p, "</", false, encoding ) )
+			{
+				p = ReadEndTag( p, encoding );
+			}
+			else
+			{
+				p = ReadMarkup( p, &encoding );
+			}
+
+			pWithWhiteSpace = p;
+			p = TiXmlBase::SkipWhiteSpace( p, encoding );
+		}
+
+		if ( !error && !stopped )
+		{
+			// An element isn't closed: either nothing follows what was read last,
+			// or white space up to the end.
+			if ( depth > 0 && !p )
+				SetError( TiXmlBase::TIXML_ERROR_READING_ELEMENT_VALUE, 0 );
+			else if ( depth > 0 )
+				SetError( TiXmlBase::TIXML_ERROR_READING_END_TAG, p );
+			else if ( !any )
+				SetError( TiXmlBase::TIXML_ERROR_DOCUMENT_EMPTY, 0 );
+			else
+				Go( handler->EndDocument() );
+		}
+	}
+
+	lineIndex.Clear();
+	handler = 0;
+	current = 0;
+	return !error;
+}
+
+
+const char* TiXmlSaxParser::ReadMarkup( const char* p, TiXmlEncoding* encoding )
+{
+	current = p;
+
+	if ( TiXmlBase::StringEqual( p, "<?xml", true, *encoding ) )
+	{
+		return ReadDeclaration( p, encoding );
+	}
+	else if ( TiXmlBase::StringEqual( p, "<!--", false, *encoding ) )
+	{
+		p = TiXmlBase::ReadRaw( p + 4, &text, "-->", *encoding, newLines, 0 );
+		if ( p && *p )
+			p += 3;
+		Go( handler->Comment( text.c_str() ) );
+		return p;
+	}
+	else if ( TiXmlBase::StringEqual( p, "<![CDATA[", false, *encoding ) )
+	{
+		// Keep all the white space, ignore the encoding, etc.
+		p = TiXmlBase::ReadRaw( p + 9, &text, "]]>", *encoding, newLines, 0 );
+		Go( handler->Text( text.c_str(), true ) );
+
+		TIXML_STRING dummy;
+		return TiXmlBase::ReadText( p, &dummy, false, "]]>", false, *encoding );
+	}
+	else if ( TiXmlBase::IsAlpha( *(p+1), *encoding ) || *(p+1) == '_' )
+	{
+		return ReadElement( p, *encoding );
+	}
+
+	// Anything else is unknown, read up to the '>'.
+	p = TiXmlBase::ReadRaw( p + 1, &text, ">", *encoding, newLines, 0 );
+	Go( handler->Unknown( text.c_str() ) );
+	if ( p && *p == '>' )
+		return p+1;
+	return p;
+}
+
+
+const char* TiXmlSaxParser::ReadElement( const char* p, TiXmlEncoding encoding )
+{
+	p = TiXmlBase::SkipWhiteSpace( p+1, encoding );
+
+	// Read the name.
+	const char* pErr = p;
+	TIXML_STRING& name = Push();
+	p = TiXmlBase::ReadName( p, &name, encoding );
+	if ( !p || !*p )
+	{
+		SetError( TiXmlBase::TIXML_ERROR_FAILED_TO_READ_ELEMENT_NAME, pErr );
+		return 0;
+	}
+
+	// Read the attributes, up to the end of the tag.
+	attributes.Clear();
+	while ( p && *p )
+	{
+		pErr = p;
+		p = TiXmlBase::SkipWhiteSpace( p, encoding );
+		if ( !p || !*p )
+		{
+			SetError( TiXmlBase::TIXML_ERROR_READING_ATTRIBUTES, pErr );
+			return 0;
+		}
+		if ( *p == '/' )
+		{
+			++p;
+			// Empty tag.
+			if ( *p  != '>' )
+			{
+				SetError( TiXmlBase::TIXML_ERROR_PARSING_EMPTY, p );
+				return 0;
+			}
+			--depth;
+			if ( Go( handler->StartElement( name.c_str(), attributes ) ) )
+				Go( handler->EndElement( name.c_str() ) );
+			return p+1;
+		}
+		else if ( *p == '>' )
+		{
+			// The content follows; the end tag pops the name.
+			Go( handler->StartElement( name.c_str(), attributes ) );
+			return p+1;
+		}
+		else
+		{
+			pErr = p;
+			const int index = attributes.Add();
+			p = ReadAttribute( p, &attributes.names[index], &attributes.values[index], encoding, true );
+			if ( !p || !*p )
+			{
+				SetError( TiXmlBase::TIXML_ERROR_PARSING_ELEMENT, pErr );
+				return 0;
+			}
+
+			// Handle the strange case of double attributes:
+			for ( int i=0; i<index; ++i )
+			{
+				if ( attributes.names[i] == attributes.names[index] )
+				{
+					SetError( TiXmlBase::TIXML_ERROR_PARSING_ELEMENT, pErr );
+					return 0;
+				}
+			}
+		}
+	}
+	return p;
+}
+
+
+const char* TiXmlSaxParser::ReadEndTag( const char* p, TiXmlEncoding encoding )
+{
+	// Both </foo > and </foo> are valid end tags.
+	current = p;
+	const TIXML_STRING& name = open[ depth-1 ];
+	if ( strncmp( p+2, name.c_str(), name.length() ) == 0 )
+	{
+		p = TiXmlBase::SkipWhiteSpace( p + 2 + name.length(), encoding );
+		if ( p && *p && *p == '>' )
+		{
+			--depth;
+			Go( handler->EndElement( name.c_str() ) );
+			return p+1;
+		}
+	}
+	SetError( TiXmlBase::TIXML_ERROR_READING_END_TAG, p );
+	return 0;
+}
+
+
+const char* TiXmlSaxParser::ReadDeclaration( const char* p, TiXmlEncoding* encoding )
+{
+	// The DOM notes the location of the declaration and of its attributes; the
+	// encoding it names applies from the last of them on.
+	const char* stamp = p;
+	p += 5;
+
+	version = "";
+	encodingName = "";
+	standalone = "";
+
+	while ( p && *p )
+	{
+		if ( *p == '>' )
+		{
+			++p;
+			Go( handler->Declaration( version.c_str(), encodingName.c_str(), standalone.c_str() ) );
+
+			// Did we get encoding info? Only at the document level, as in
+			// TiXmlDocument::Parse().
+			if ( *encoding == TIXML_ENCODING_UNKNOWN && depth == 0 )
+			{
+				const char* enc = encodingName.c_str();
+				if ( *enc == 0 )
+					*encoding = TIXML_ENCODING_UTF8;
+				else if ( TiXmlBase::StringEqual( enc, "UTF-8", true, TIXML_ENCODING_UNKNOWN ) )
+					*encoding = TIXML_ENCODING_UTF8;
+				else if ( TiXmlBase::StringEqual( enc, "UTF8", true, TIXML_ENCODING_UNKNOWN ) )
+					*encoding = TIXML_ENCODING_UTF8;	// incorrect, but be nice
+				else 
+					*encoding = TIXML_ENCODING_LEGACY;
+				if ( lineIndex.Active() )
+					lineIndex.SetEncoding( *encoding, (int)( stamp - start ) );
+			}
+			return p;
+		}
+
+		p = TiXmlBase::SkipWhiteSpace( p, *encoding );
+		if ( !p )
+			break;
+		TIXML_STRING* value = 0;
+		if ( TiXmlBase::StringEqual( p, "version", true, *encoding ) )
+			value = &version;
+		else if ( TiXmlBase::StringEqual( p, "encoding", true, *encoding ) )
+			value = &encodingName;
+		else if ( TiXmlBase::StringEqual( p, "standalone", true, *encoding ) )
+			value = &standalone;
+
+		if ( value )
+		{
+			stamp = p;
+			p = ReadAttribute( p, &text, value, *encoding, false );
+		}
+		else
+		{
+			// Read over whatever it is.
+			while( p && *p && *p != '>' && !TiXmlBase::IsWhiteSpace( *p ) )
+				++p;
+		}
+	}
+	return 0;
+}
+
+
+const char* TiXmlSaxParser::ReadAttribute( const char* p, TIXML_STRING* name, TIXML_STRING* value, TiXmlEncoding encoding, bool report )
+{
+	// As TiXmlAttribute::Parse(), which only reports errors for an element's
+	// attributes.
+	p = TiXmlBase::SkipWhiteSpace( p, encoding );
+	if ( !p || !*p ) return 0;
+
+	// Read the name, the '=' and the value.
+	const char* pErr = p;
+	p = TiXmlBase::ReadName( p, name, encoding );
+	if ( !p || !*p )
+	{
+		if ( report ) SetError( TiXmlBase::TIXML_ERROR_READING_ATTRIBUTES, pErr );
+		return 0;
+	}
+	p = TiXmlBase::SkipWhiteSpace( p, encoding );
+	if ( !p || !*p || *p != '=' )
+	{
+		if ( report ) SetError( TiXmlBase::TIXML_ERROR_READING_ATTRIBUTES, p );
+		return 0;
+	}
+
+	++p;	// skip '='
+	p = TiXmlBase::SkipWhiteSpace( p, encoding );
+	if ( !p || !*p )
+	{
+		if ( report ) SetError( TiXmlBase::TIXML_ERROR_READING_ATTRIBUTES, p );
+		return 0;
+	}
+
+	const char SINGLE_QUOTE = '\'';
+	const char DOUBLE_QUOTE = '\"';
+
+	if ( *p == SINGLE_QUOTE || *p == DOUBLE_QUOTE )
+	{
+		const char* end = ( *p == SINGLE_QUOTE ) ? "\'" : "\"";	// the quote in the string
+		return TiXmlBase::ReadText( p+1, value, false, end, false, encoding, newLines );
+	}
+
+	// All attribute values should be in single or double quotes.
+	// But this is such a common error that the parser will try
+	// its best, even without them.
+	*value = "";
+	const char* start = p;
+	while (    p && *p											// existence
+			&& !TiXmlBase::IsWhiteSpace( *p )					// whitespace
+			&& *p != '/' && *p != '>' )							// tag end
+	{
+		if ( *p == SINGLE_QUOTE || *p == DOUBLE_QUOTE ) {
+			// We did not have an opening quote but seem to have a 
+			// closing one. Give up and throw an error.
+			if ( report ) SetError( TiXmlBase::TIXML_ERROR_READING_ATTRIBUTES, p );
+			return 0;
+		}
+		++p;
+	}
+	value->assign( start, p - start );
+	return p;
+}
@@ -0,0 +1,97 @@
+﻿// TinyXML Benchmark - Arena allocation
+// ============================================================================
+// NOTE:
+// キャリブレーションライブラリを繰り返しParse()/Clear()し、ノードを1つずつ
+// ヒープに確保する場合と、TiXmlDocument::SetUseArena()でドキュメント単位の
+// アリーナに確保する場合の、確保回数と時間を比較します。
+//
+//     usage: bench_arena [robots] [repeat]
+
+// 標準C++ライブラリ
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+#include "bench_util.h"
+
+
+namespace
+{
+	// Parse()とClear()をrepeat回繰り返して計測し、最後のDOMを文字列で返す
+	std::string run(const char* name, const std::string& xml, int repeat, bool use_arena)
+	{
+		TiXmlDocument document;
+		document.SetUseArena(use_arena);
+
+		double             parse_time = 0;
+		double             clear_time = 0;
+		unsigned long long parse_allocations = 0;
+		unsigned long long parse_bytes = 0;
+		std::string        printed;
+
+		for (int count = 0; count < repeat; count++)
+		{
+			unsigned long long allocations = Bench::allocations();
+			unsigned long long bytes = Bench::allocatedBytes();
+			double start = Bench::now();
+
+			document.Parse(xml.c_str());
+
+			double parsed = Bench::now();
+			parse_allocations += Bench::allocations() - allocations;
+			parse_bytes += Bench::allocatedBytes() - bytes;
+
+			if (document.Error())
+			{
+				std::fprintf(stderr, "error: %s\n", document.ErrorDesc());
+				std::exit(1);
+			}
+
+			if (count == repeat - 1)
+			{
+				TiXmlPrinter printer;
+				document.Accept(&printer);
+				printed = printer.CStr();
+			}
+
+			parse_time += parsed - start;
+
+			double clear_start = Bench::now();
+			document.Clear();
+			clear_time += Bench::now() - clear_start;
+		}
+
+		std::string label(name);
+		Bench::report((label + " parse").c_str(), parse_time / repeat, xml.size(), parse_allocations / repeat, parse_bytes / repeat);
+		Bench::report((label + " clear").c_str(), clear_time / repeat, xml.size(), 0, 0);
+
+		return printed;
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	int robots = (argc > 1) ? std::atoi(argv[1]) : 2000;
+	int repeat = (argc > 2) ? std::atoi(argv[2]) : 10;
+
+	std::string xml = Bench::calibrationLibrary(robots);
+
+	std::printf("calibration library: %d robots, %.1f KiB, %d runs (per-run averages)\n",
+		robots, xml.size() / 1024.0, repeat);
+
+	std::string heap  = ::run("heap",  xml, repeat, false);
+	std::string arena = ::run("arena", xml, repeat, true);
+
+	// 両者のDOMが一致することを確認する
+	if (heap != arena)
+	{
+		std::fprintf(stderr, "error: the arena DOM differs from the heap DOM.\n");
+
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,111 @@
+﻿// TinyXML Benchmark - Interned names
+// ============================================================================
+// NOTE:
+// キャリブレーションライブラリを名前でたどる時間を、名前の文字列で引く場合と、
+// TiXmlDocument::Intern()で得たアトムで引く場合とで比較します。
+//
+// - robotとjointをFirstChildElement()/NextSiblingElement()でたどる
+// - 各jointのnameとhomeをAttribute()/QueryIntAttribute()で読む
+// - 各robotのnote(18個のjointの後ろ)と、TiXmlHandleで18番目のjointを引く
+//
+// 文書が解析した要素と属性は名前のアトムを持つため、アトムで引くと
+// strcmp()の代わりにポインタを比べます。解析の時間も計測します。
+//
+//     usage: bench_atoms [robots] [repeat]
+
+// 標準C++ライブラリ
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+#include "bench_util.h"
+
+
+namespace
+{
+	// 名前の型(const char*かTiXmlAtom)によらない走査。チェックサムを返す
+	template <typename Name>
+	long long walk(TiXmlDocument& document, Name robot_name, Name joint_name, Name note_name, Name name_name, Name home_name)
+	{
+		long long sum = 0;
+
+		for (TiXmlElement* robot = document.RootElement()->FirstChildElement(robot_name); robot != NULL; robot = robot->NextSiblingElement(robot_name))
+		{
+			for (TiXmlElement* joint = robot->FirstChildElement(joint_name); joint != NULL; joint = joint->NextSiblingElement(joint_name))
+			{
+				const char* name = joint->Attribute(name_name);
+				int         home = 0;
+
+				if (name != NULL && joint->QueryIntAttribute(home_name, &home) == TIXML_SUCCESS)
+				{
+					sum += std::strlen(name) + home;
+				}
+			}
+
+			TiXmlElement* note = robot->FirstChildElement(note_name);
+			TiXmlElement* last = TiXmlHandle(robot).ChildElement(joint_name, 17).ToElement();
+
+			if (note != NULL && last != NULL)
+			{
+				sum += std::strlen(note->GetText()) + std::strlen(last->Attribute(name_name));
+			}
+		}
+
+		return sum;
+	}
+
+	void run(int robots, int repeat)
+	{
+		std::string xml = Bench::calibrationLibrary(robots);
+
+		double parse_time = 0;
+		double string_time = 0;
+		double atom_time = 0;
+		long long string_sum = 0;
+		long long atom_sum = 0;
+
+		for (int count = 0; count < repeat; count++)
+		{
+			TiXmlDocument document;
+
+			double start = Bench::now();
+			document.Parse(xml.c_str());
+			parse_time += Bench::now() - start;
+
+			start = Bench::now();
+			string_sum = walk<const char*>(document, "robot", "joint", "note", "name", "home");
+			string_time += Bench::now() - start;
+
+			start = Bench::now();
+			atom_sum = walk<TiXmlAtom>(document, document.Intern("robot"), document.Intern("joint"), document.Intern("note"), document.Intern("name"), document.Intern("home"));
+			atom_time += Bench::now() - start;
+		}
+
+		Bench::report("parse", parse_time / repeat, xml.size(), 0, 0);
+		Bench::report("walk by string", string_time / repeat, xml.size(), 0, 0);
+		Bench::report("walk by atom", atom_time / repeat, xml.size(), 0, 0);
+
+		// どちらで引いても同じ結果になることを確認する
+		if (string_sum != atom_sum)
+		{
+			std::fprintf(stderr, "error: the walks differ (%lld, %lld).\n", string_sum, atom_sum);
+			std::exit(1);
+		}
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	int robots = (argc > 1) ? std::atoi(argv[1]) : 2000;
+	int repeat = (argc > 2) ? std::atoi(argv[2]) : 10;
+
+	std::printf("calibration library: %d robots, %d runs (per-run averages)\n", robots, repeat);
+
+	::run(robots, repeat);
+
+	return 0;
+}
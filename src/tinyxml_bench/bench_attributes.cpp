@@ -0,0 +1,137 @@
+﻿// TinyXML Benchmark - Attribute lookup
+// ============================================================================
+// NOTE:
+// 属性の数が異なる要素を並べたXMLを生成し、Parse()の時間と、すべての属性を
+// 名前で引くTiXmlElement::Attribute()の時間を計測します。
+//
+// TiXmlAttributeSetは属性がINDEX_THRESHOLDを超えるとハッシュ表で名前を引くため、
+// 属性の多い要素でも、構築(重複の確認)と検索の時間は属性の数に比例します。
+//
+//     usage: bench_attributes [total attributes] [repeat]
+
+// 標準C++ライブラリ
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+#include "bench_util.h"
+
+
+namespace
+{
+	// 属性の名前 (関節の設定を模したもの)
+	std::string attributeName(int index)
+	{
+		char name[32];
+		std::sprintf(name, "joint%03d_offset", index);
+
+		return name;
+	}
+
+	// 1要素あたりper_element個、合計がおよそtotal個の属性を持つXMLを生成する
+	std::string attributeDocument(int per_element, int total)
+	{
+		std::string xml = "<profiles>\n";
+
+		for (int element = 0; element < total / per_element; element++)
+		{
+			xml += "<profile";
+
+			for (int index = 0; index < per_element; index++)
+			{
+				char value[16];
+				std::sprintf(value, "%d", (element + index) % 1800 - 900);
+				xml += " " + attributeName(index) + "=\"" + value + "\"";
+			}
+
+			xml += "/>\n";
+		}
+
+		xml += "</profiles>\n";
+
+		return xml;
+	}
+
+	void run(int per_element, int total, int repeat)
+	{
+		std::string xml = attributeDocument(per_element, total);
+
+		std::vector<std::string> names;
+
+		for (int index = 0; index < per_element; index++)
+		{
+			names.push_back(attributeName(index));
+		}
+
+		double             parse_time = 0;
+		double             find_time = 0;
+		unsigned long long parse_allocations = 0;
+		unsigned long long parse_bytes = 0;
+		long long          sum = 0;
+
+		for (int count = 0; count < repeat; count++)
+		{
+			TiXmlDocument document;
+
+			unsigned long long allocations = Bench::allocations();
+			unsigned long long bytes = Bench::allocatedBytes();
+			double start = Bench::now();
+
+			document.Parse(xml.c_str());
+
+			double parsed = Bench::now();
+			parse_allocations += Bench::allocations() - allocations;
+			parse_bytes += Bench::allocatedBytes() - bytes;
+
+			if (document.Error())
+			{
+				std::fprintf(stderr, "error: %s\n", document.ErrorDesc());
+				std::exit(1);
+			}
+
+			for (const TiXmlElement* profile = document.RootElement()->FirstChildElement(); profile; profile = profile->NextSiblingElement())
+			{
+				for (std::size_t index = 0; index < names.size(); index++)
+				{
+					sum += std::atoi(profile->Attribute(names[index].c_str()));
+				}
+			}
+
+			parse_time += parsed - start;
+			find_time += Bench::now() - parsed;
+		}
+
+		char label[64];
+		std::sprintf(label, "%d attrs parse", per_element);
+		Bench::report(label, parse_time / repeat, xml.size(), parse_allocations / repeat, parse_bytes / repeat);
+		std::sprintf(label, "%d attrs find all", per_element);
+		Bench::report(label, find_time / repeat, xml.size(), 0, 0);
+
+		// 検索結果を使い、最適化で消されないようにする
+		if (sum == 1)
+		{
+			std::printf("\n");
+		}
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	int total  = (argc > 1) ? std::atoi(argv[1]) : 65536;
+	int repeat = (argc > 2) ? std::atoi(argv[2]) : 10;
+
+	std::printf("%d attributes per document, %d runs (per-run averages)\n", total, repeat);
+
+	const int per_element[] = { 4, 8, 16, 64, 256, 1024 };
+
+	for (std::size_t index = 0; index < sizeof(per_element) / sizeof(per_element[0]); index++)
+	{
+		::run(per_element[index], total, repeat);
+	}
+
+	return 0;
+}
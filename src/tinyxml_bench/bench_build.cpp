@@ -0,0 +1,153 @@
+﻿// TinyXML Benchmark - Building documents
+// ============================================================================
+// NOTE:
+// キャリブレーションライブラリと同じ形のDOMをプログラムで組み立て、
+// 時間と確保回数、確保量を計測します。組み立てた要素をInsertEndChild()で
+// 親に加える場合、コピーを渡すと部分木が複製されますが、ムーブを渡すと
+// 子は付け替えられ、文字列は持ち主が替わるだけです。
+// 比べるために、newした要素をLinkEndChild()でつなぐ場合も計測します。
+//
+//     usage: bench_build [robots] [repeat]
+
+// 標準C++ライブラリ
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+#include "bench_util.h"
+
+
+namespace
+{
+	enum Mode
+	{
+		COPY,
+		MOVE,
+		LINK
+	};
+
+	// 子をモードに応じた方法で加える
+	void add(TiXmlNode& parent, TiXmlNode* child, Mode mode)
+	{
+		if (mode == LINK)
+		{
+			parent.LinkEndChild(child);
+
+			return;
+		}
+
+		if (mode == COPY)
+		{
+			parent.InsertEndChild(*child);
+		}
+		else
+		{
+			parent.InsertEndChild(std::move(*child));
+		}
+
+		delete child;
+	}
+
+	void build(TiXmlDocument& document, int robots, Mode mode)
+	{
+		document.LinkEndChild(new TiXmlDeclaration("1.0", "UTF-8", ""));
+
+		TiXmlElement* library = new TiXmlElement("library");
+		library->SetAttribute("version", 1);
+
+		for (int robot = 0; robot < robots; robot++)
+		{
+			TiXmlElement* element = new TiXmlElement("robot");
+			std::string   name = "plen2-" + std::to_string(robot);
+			std::string   firmware = "1.3." + std::to_string(robot % 7);
+
+			element->SetAttribute("name", name.c_str());
+			element->SetAttribute("firmware", firmware.c_str());
+			add(*element, new TiXmlComment(" calibrated by the joint config app "), mode);
+
+			for (int joint = 0; joint < 18; joint++)
+			{
+				int           home = 900 + ((robot * 37 + joint * 11) % 200) - 100;
+				TiXmlElement* child = new TiXmlElement("joint");
+
+				child->SetAttribute("id", joint + 1);
+				child->SetAttribute("name", ("joint-" + std::to_string(joint + 1)).c_str());
+				child->SetAttribute("min", home - 600);
+				child->SetAttribute("max", home + 600);
+				child->SetAttribute("home", home);
+				child->SetAttribute("trim", (robot + joint) % 25 - 12);
+				add(*element, child, mode);
+			}
+
+			TiXmlElement* note = new TiXmlElement("note");
+			std::string   text = "Checked & adjusted on bench " + std::to_string(robot % 4) + " <ok>";
+			add(*note, new TiXmlText(text.c_str()), mode);
+			add(*element, note, mode);
+
+			add(*library, element, mode);
+		}
+
+		add(document, library, mode);
+	}
+
+	// 組み立てをrepeat回繰り返して計測し、最後のDOMを文字列で返す
+	std::string run(const char* name, int robots, int repeat, Mode mode)
+	{
+		double             build_time = 0;
+		unsigned long long build_allocations = 0;
+		unsigned long long build_bytes = 0;
+		std::string        printed;
+
+		for (int count = 0; count < repeat; count++)
+		{
+			TiXmlDocument document;
+
+			unsigned long long allocations = Bench::allocations();
+			unsigned long long bytes = Bench::allocatedBytes();
+			double start = Bench::now();
+
+			::build(document, robots, mode);
+
+			build_time += Bench::now() - start;
+			build_allocations += Bench::allocations() - allocations;
+			build_bytes += Bench::allocatedBytes() - bytes;
+
+			if (count == repeat - 1)
+			{
+				TiXmlPrinter printer;
+				document.Accept(&printer);
+				printed = printer.CStr();
+			}
+		}
+
+		Bench::report(name, build_time / repeat, printed.size(), build_allocations / repeat, build_bytes / repeat);
+
+		return printed;
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	int robots = (argc > 1) ? std::atoi(argv[1]) : 2000;
+	int repeat = (argc > 2) ? std::atoi(argv[2]) : 10;
+
+	std::printf("calibration library: %d robots, %d runs (per-run averages, MB/s of the printed DOM)\n", robots, repeat);
+
+	std::string copied = ::run("InsertEndChild copy", robots, repeat, COPY);
+	std::string moved  = ::run("InsertEndChild move", robots, repeat, MOVE);
+	std::string linked = ::run("LinkEndChild", robots, repeat, LINK);
+
+	// どの方法で組み立てても同じDOMになることを確認する
+	if (moved != copied || linked != copied)
+	{
+		std::fprintf(stderr, "error: the DOM differs between the builds.\n");
+
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,168 @@
+﻿// TinyXML Benchmark - Cached documents
+// ============================================================================
+// NOTE:
+// キャリブレーションライブラリを一時ファイルに書き出し、次の読み込みを
+// 比較します。
+//
+//   - LoadFile(filename)による通常の読み込み
+//   - in-situとアリーナを使ったLoadFile(filename)
+//   - キャッシュがない状態のLoadCachedFile() (解析してキャッシュを書き出す)
+//   - キャッシュがある状態のLoadCache() (キャッシュをマップして組み立てる)
+//
+// キャッシュからの読み込みは解析を行わず、ノードはアリーナに、文字列は
+// マップしたキャッシュを参照するため、確保回数はブロック単位になります。
+// 時間、確保回数、確保量を計測し、すべてのDOMが一致することを確認します。
+//
+//     usage: bench_cache [robots] [repeat]
+
+// 標準C++ライブラリ
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+#include "bench_util.h"
+
+
+namespace
+{
+	enum Mode
+	{
+		MODE_LOAD,
+		MODE_IN_SITU,
+		MODE_COLD,
+		MODE_WARM
+	};
+
+	// xmlを一時ファイルに書き出し、そのパスを返す
+	std::string write(const std::string& xml)
+	{
+		char  path[] = "/tmp/bench_cache_XXXXXX";
+		FILE* file = NULL;
+		int   fd = mkstemp(path);
+
+		if (fd < 0 || (file = fdopen(fd, "wb")) == NULL || std::fwrite(xml.data(), 1, xml.size(), file) != xml.size())
+		{
+			std::fprintf(stderr, "error: failed to write %s.\n", path);
+			std::exit(1);
+		}
+
+		std::fclose(file);
+
+		return path;
+	}
+
+	// 読み込みをrepeat回繰り返して計測し、最後のDOMを文字列で返す
+	std::string run(const char* name, const std::string& path, const std::string& cache, std::size_t input_bytes, int repeat, Mode mode)
+	{
+		double             load_time = 0;
+		unsigned long long load_allocations = 0;
+		unsigned long long load_bytes = 0;
+		std::string        printed;
+
+		for (int count = 0; count < repeat; count++)
+		{
+			TiXmlDocument document;
+
+			if (mode == MODE_IN_SITU)
+			{
+				document.SetInSitu(true);
+				document.SetUseArena(true);
+			}
+
+			if (mode == MODE_COLD)
+			{
+				std::remove(cache.c_str());
+			}
+
+			unsigned long long allocations = Bench::allocations();
+			unsigned long long bytes = Bench::allocatedBytes();
+			double start = Bench::now();
+
+			bool loaded = false;
+
+			switch (mode)
+			{
+			case MODE_COLD:
+				loaded = document.LoadCachedFile(path.c_str(), cache.c_str());
+				break;
+
+			case MODE_WARM:
+				loaded = document.LoadCache(path.c_str(), cache.c_str());
+				break;
+
+			default:
+				loaded = document.LoadFile(path.c_str());
+				break;
+			}
+
+			load_time += Bench::now() - start;
+			load_allocations += Bench::allocations() - allocations;
+			load_bytes += Bench::allocatedBytes() - bytes;
+
+			if (!loaded)
+			{
+				std::fprintf(stderr, "error: %s failed to load.\n", name);
+				std::exit(1);
+			}
+
+			if (count == repeat - 1)
+			{
+				TiXmlPrinter printer;
+				document.Accept(&printer);
+				printed = printer.CStr();
+			}
+		}
+
+		Bench::report(name, load_time / repeat, input_bytes, load_allocations / repeat, load_bytes / repeat);
+
+		return printed;
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	int robots = (argc > 1) ? std::atoi(argv[1]) : 2000;
+	int repeat = (argc > 2) ? std::atoi(argv[2]) : 10;
+
+	std::string xml   = Bench::calibrationLibrary(robots);
+	std::string path  = ::write(xml);
+	std::string cache = path + ".cache";
+
+	std::printf("calibration library: %d robots, %.1f KiB, %d runs (per-run averages)\n",
+		robots, xml.size() / 1024.0, repeat);
+
+	std::string results[] = {
+		::run("LoadFile",                path, cache, xml.size(), repeat, MODE_LOAD),
+		::run("LoadFile in-situ arena",  path, cache, xml.size(), repeat, MODE_IN_SITU),
+		::run("LoadCachedFile cold",     path, cache, xml.size(), repeat, MODE_COLD),
+		::run("LoadCache warm",          path, cache, xml.size(), repeat, MODE_WARM)
+	};
+
+	FILE* file = std::fopen(cache.c_str(), "rb");
+
+	if (file != NULL)
+	{
+		std::fseek(file, 0, SEEK_END);
+		std::printf("%-24s %10.1f KiB\n", "cache file", std::ftell(file) / 1024.0);
+		std::fclose(file);
+	}
+
+	std::remove(path.c_str());
+	std::remove(cache.c_str());
+
+	// 読み込み方によらず、すべてのDOMが一致することを確認する
+	for (std::size_t index = 1; index < sizeof(results) / sizeof(results[0]); index++)
+	{
+		if (results[index] != results[0])
+		{
+			std::fprintf(stderr, "error: the DOM differs between the loads.\n");
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,172 @@
+﻿// TinyXML Benchmark - Wide elements
+// ============================================================================
+// NOTE:
+// 子を多く持つ要素で、すべての子を名前で引く時間を計測します。子の名前は
+// すべて異なるため、線形に探すと子の数の2乗に比例します。
+//
+// 索引なしで引いた時間と、TiXmlElement::BuildChildIndex()で子の索引を作って
+// から引いた時間(索引を作る時間を含む)を比べます。末尾への追加は索引に
+// 書き足され、それ以外の変更では索引が捨てられます。
+//
+// 続けて、キャリブレーションライブラリ(1台あたりjoint 18個とnote)を
+// 名前でたどる時間を計測し、幅の狭い要素でも遅くならないことを確認します。
+//
+//     usage: bench_children [children] [robots] [repeat]
+
+// 標準C++ライブラリ
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+#include "bench_util.h"
+
+
+namespace
+{
+	// 子の名前 (関節ごとの設定を模したもの)
+	std::string childName(int index)
+	{
+		char name[32];
+		std::sprintf(name, "setting%05d", index);
+
+		return name;
+	}
+
+	// 幅の広い要素のすべての子を、名前で1回ずつ引く
+	void runWide(int children, int repeat)
+	{
+		std::vector<std::string> names;
+		std::string              xml = "<settings>\n";
+
+		for (int index = 0; index < children; index++)
+		{
+			names.push_back(childName(index));
+			xml += "\t<" + names.back() + " value=\"" + std::to_string(index) + "\" />\n";
+		}
+
+		xml += "</settings>\n";
+
+		double walk_time = 0;
+		double first_time = 0;
+		double iterate_time = 0;
+		double edit_time = 0;
+		long   found = 0;
+
+		for (int count = 0; count < repeat; count++)
+		{
+			TiXmlDocument document;
+			document.Parse(xml.c_str());
+
+			TiXmlElement* root = document.RootElement();
+			double        start = Bench::now();
+
+			for (int index = 0; index < children; index++)
+			{
+				if (root->FirstChildElement(names[index].c_str()) != NULL)
+				{
+					found++;
+				}
+			}
+
+			walk_time += Bench::now() - start;
+			start = Bench::now();
+
+			root->BuildChildIndex();
+
+			for (int index = 0; index < children; index++)
+			{
+				if (root->FirstChildElement(names[index].c_str()) != NULL)
+				{
+					found++;
+				}
+			}
+
+			first_time += Bench::now() - start;
+			start = Bench::now();
+
+			// IterateChildren()で同名の子を順にたどる
+			for (int index = 0; index < children; index++)
+			{
+				for (TiXmlNode* child = NULL; (child = root->IterateChildren(names[index].c_str(), child)) != NULL; )
+				{
+					found++;
+				}
+			}
+
+			iterate_time += Bench::now() - start;
+			start = Bench::now();
+
+			// 子の追加と検索を交互に行う (末尾への追加は索引に書き足される)
+			for (int index = 0; index < 100; index++)
+			{
+				root->LinkEndChild(new TiXmlElement(names[index].c_str()));
+
+				if (root->FirstChildElement(names[children - 1 - index].c_str()) != NULL)
+				{
+					found++;
+				}
+			}
+
+			edit_time += Bench::now() - start;
+		}
+
+		Bench::report("wide walk", walk_time / repeat, xml.size(), 0, 0);
+		Bench::report("wide FirstChildElement", first_time / repeat, xml.size(), 0, 0);
+		Bench::report("wide IterateChildren", iterate_time / repeat, xml.size(), 0, 0);
+		Bench::report("wide link and find", edit_time / repeat, xml.size(), 0, 0);
+		std::printf("%-24s %10ld found\n", "", found / repeat);
+	}
+
+	// キャリブレーションライブラリを名前でたどる
+	void runLibrary(int robots, int repeat)
+	{
+		std::string xml = Bench::calibrationLibrary(robots);
+
+		double    time = 0;
+		long long sum = 0;
+
+		for (int count = 0; count < repeat; count++)
+		{
+			TiXmlDocument document;
+			document.Parse(xml.c_str());
+
+			double start = Bench::now();
+
+			for (TiXmlElement* robot = document.RootElement()->FirstChildElement("robot"); robot != NULL; robot = robot->NextSiblingElement("robot"))
+			{
+				for (TiXmlElement* joint = robot->FirstChildElement("joint"); joint != NULL; joint = joint->NextSiblingElement("joint"))
+				{
+					sum++;
+				}
+
+				if (robot->FirstChildElement("note") != NULL)
+				{
+					sum++;
+				}
+			}
+
+			time += Bench::now() - start;
+		}
+
+		Bench::report("library walk", time / repeat, xml.size(), 0, 0);
+		std::printf("%-24s %10lld elements\n", "", sum / repeat);
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	int children = (argc > 1) ? std::atoi(argv[1]) : 5000;
+	int robots = (argc > 2) ? std::atoi(argv[2]) : 2000;
+	int repeat = (argc > 3) ? std::atoi(argv[3]) : 5;
+
+	std::printf("%d children, %d robots, %d runs (per-run averages)\n", children, robots, repeat);
+
+	::runWide(children, repeat);
+	::runLibrary(robots, repeat);
+
+	return 0;
+}
@@ -0,0 +1,225 @@
+﻿// TinyXML Benchmark - Very deep and very wide trees
+// ============================================================================
+// NOTE:
+// 極端に深い文書と極端に幅の広い文書で、構文解析・Accept()・Print()・
+// 複製(Clone)・削除(Delete)の時間を計測します。
+//
+// - chain  : 深さdepthの要素の鎖 (各階層に属性1つとテキスト)
+// - forest : 深さ1000の鎖を、要素の数がchainと同じになるだけ並べたもの
+// - wide   : 子をwidth個持つルート
+//
+// これらの処理は木を明示的なループでたどるため、深さはスタックの大きさに
+// 制限されません(既定の深さは ulimit -s 8192 でも動くことを確かめるもの)。
+// インデント付きの出力は深さの2乗に比例する量のタブを書くため、chainでは
+// Print()を計測せず、Accept()はSetStreamPrinting()で出力します。
+//
+//     usage: bench_deep [depth] [width] [repeat]
+
+// 標準C++ライブラリ
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+#include "bench_util.h"
+
+
+namespace
+{
+	const int FOREST_LEVEL = 1000;
+
+	// 深さlevelの鎖を1本書き足す
+	void appendChain(std::string& xml, int level)
+	{
+		char tag[64];
+
+		for (int index = 0; index < level; index++)
+		{
+			std::snprintf(tag, sizeof(tag), "<link index=\"%d\">offset", index);
+			xml += tag;
+		}
+
+		for (int index = 0; index < level; index++)
+		{
+			xml += "</link>";
+		}
+	}
+
+	std::string chain(int depth)
+	{
+		std::string xml;
+		appendChain(xml, depth);
+
+		return xml;
+	}
+
+	std::string forest(int depth)
+	{
+		std::string xml = "<forest>";
+
+		for (int count = 0; count < depth / FOREST_LEVEL; count++)
+		{
+			appendChain(xml, FOREST_LEVEL);
+		}
+
+		xml += "</forest>";
+
+		return xml;
+	}
+
+	std::string wide(int width)
+	{
+		std::string xml = "<joints>\n";
+		char        tag[64];
+
+		for (int index = 0; index < width; index++)
+		{
+			std::snprintf(tag, sizeof(tag), "\t<joint id=\"%d\" home=\"800\" />\n", index);
+			xml += tag;
+		}
+
+		xml += "</joints>\n";
+
+		return xml;
+	}
+
+	// 1つの処理の、repeat回のうち最も速かった時間と1回あたりの確保
+	class Meter
+	{
+	public:
+		Meter() : best(0), runs(0), allocations(0), bytes(0), allocations_before(0), bytes_before(0), begin(0) {}
+
+		void start()
+		{
+			allocations_before = Bench::allocations();
+			bytes_before = Bench::allocatedBytes();
+			begin = Bench::now();
+		}
+
+		void stop()
+		{
+			double seconds = Bench::now() - begin;
+
+			if (runs == 0 || seconds < best)
+			{
+				best = seconds;
+			}
+
+			allocations = Bench::allocations() - allocations_before;
+			bytes = Bench::allocatedBytes() - bytes_before;
+			runs++;
+		}
+
+		void report(const char* workload, const char* operation, std::size_t input_bytes) const
+		{
+			if (runs == 0)
+			{
+				return;
+			}
+
+			char name[32];
+			std::snprintf(name, sizeof(name), "%s %s", workload, operation);
+			Bench::report(name, best, input_bytes, allocations, bytes);
+		}
+
+	private:
+		double             best;
+		int                runs;
+		unsigned long long allocations;
+		unsigned long long bytes;
+		unsigned long long allocations_before;
+		unsigned long long bytes_before;
+		double             begin;
+	};
+
+	void run(const char* workload, const std::string& xml, int repeat, bool print)
+	{
+		Meter parse;
+		Meter accept;
+		Meter printing;
+		Meter clone;
+		Meter destroy;
+
+		FILE* file = print ? std::fopen("/dev/null", "w") : NULL;
+
+		for (int count = 0; count < repeat; count++)
+		{
+			TiXmlDocument* document = new TiXmlDocument();
+
+			parse.start();
+			document->Parse(xml.c_str());
+			parse.stop();
+
+			if (document->Error())
+			{
+				std::fprintf(stderr, "error: %s: %s\n", workload, document->ErrorDesc());
+				std::exit(1);
+			}
+
+			TiXmlPrinter printer;
+			printer.SetStreamPrinting();
+
+			accept.start();
+			document->Accept(&printer);
+			accept.stop();
+
+			if (file != NULL)
+			{
+				printing.start();
+				document->Print(file, 0);
+				std::fflush(file);
+				printing.stop();
+			}
+
+			clone.start();
+			TiXmlNode* copy = static_cast<const TiXmlNode*>(document)->Clone();
+			clone.stop();
+
+			// 複製が元と同じ内容か確かめる
+			TiXmlPrinter copied;
+			copied.SetStreamPrinting();
+			copy->Accept(&copied);
+
+			if (std::strcmp(copied.CStr(), printer.CStr()) != 0)
+			{
+				std::fprintf(stderr, "error: %s: the copy differs.\n", workload);
+				std::exit(1);
+			}
+
+			destroy.start();
+			delete copy;
+			destroy.stop();
+
+			delete document;
+		}
+
+		if (file != NULL)
+		{
+			std::fclose(file);
+		}
+
+		parse.report(workload, "Parse", xml.size());
+		accept.report(workload, "Accept", xml.size());
+		printing.report(workload, "Print", xml.size());
+		clone.report(workload, "Clone", xml.size());
+		destroy.report(workload, "Delete", xml.size());
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	int depth  = (argc > 1) ? std::atoi(argv[1]) : 200000;
+	int width  = (argc > 2) ? std::atoi(argv[2]) : 1000000;
+	int repeat = (argc > 3) ? std::atoi(argv[3]) : 3;
+
+	std::printf("depth %d, width %d (best of %d)\n", depth, width, repeat);
+
+	::run("chain", ::chain(depth), repeat, false);
+	::run("forest", ::forest(depth), repeat, true);
+	::run("wide", ::wide(width), repeat, true);
+
+	return 0;
+}
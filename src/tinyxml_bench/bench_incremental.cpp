@@ -0,0 +1,238 @@
+﻿// TinyXML Benchmark - Incremental save and parse
+// ============================================================================
+// NOTE:
+// 大きなキャリブレーションライブラリで1関節のhomeだけを変え、ファイルに保存
+// する時間と、編集したテキストを読み直す時間を比較します。
+//
+// - SaveFile()でファイル全体を書き直す
+// - SaveChanges()で変わったバイトだけを書き換える(値の桁数が変わらない場合)
+// - SaveChanges()で最初の変更からファイルの末尾までを書き直す(桁数が増える場合)
+// - Parse()でテキスト全体を読み直す
+// - Reparse()で編集を含む要素(ロボット1台分)だけを読み直す
+//
+//     usage: bench_incremental [robots] [edits]
+
+// 標準C++ライブラリ
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// POSIX
+#include <unistd.h>
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+#include "bench_util.h"
+
+
+namespace
+{
+	void load(TiXmlDocument& document, const char* path)
+	{
+		if (!document.LoadFile(path))
+		{
+			std::fprintf(stderr, "error: failed to load %s.\n", path);
+			std::exit(1);
+		}
+	}
+
+	// 全ロボットの関節を文書の順に集める
+	std::vector<TiXmlElement*> joints(TiXmlDocument& document)
+	{
+		std::vector<TiXmlElement*> result;
+
+		for (TiXmlElement* robot = document.RootElement()->FirstChildElement("robot"); robot != NULL; robot = robot->NextSiblingElement("robot"))
+		{
+			for (TiXmlElement* joint = robot->FirstChildElement("joint"); joint != NULL; joint = joint->NextSiblingElement("joint"))
+			{
+				result.push_back(joint);
+			}
+		}
+
+		return result;
+	}
+
+	// 1関節のhomeを変えて保存することをedits回繰り返し、1回あたりの時間を返す
+	// (wider がtrueなら、値を4桁にしてファイルを伸ばす)
+	double edit(TiXmlDocument& document, const char* path, int edits, bool incremental, bool wider)
+	{
+		std::vector<TiXmlElement*> list = joints(document);
+		double total = 0;
+
+		for (int count = 0; count < edits; count++)
+		{
+			TiXmlElement* joint = list[(count * 7919) % list.size()];
+			int home = wider ? 1000 + count % 1000 : 800 + count % 200;
+
+			double start = Bench::now();
+			joint->SetAttribute("home", home);
+
+			bool saved = incremental ? document.SaveChanges() : document.SaveFile(path);
+			total += Bench::now() - start;
+
+			if (!saved)
+			{
+				std::fprintf(stderr, "error: failed to save %s.\n", path);
+				std::exit(1);
+			}
+		}
+
+		return total / edits;
+	}
+
+	// 保存したファイルが、DOMをすべて書き出したものと同じ内容か確かめる
+	void verify(TiXmlDocument& document, const char* path)
+	{
+		TiXmlDocument saved;
+		load(saved, path);
+
+		TiXmlPrinter expected;
+		TiXmlPrinter actual;
+		document.Accept(&expected);
+		saved.Accept(&actual);
+
+		if (std::strcmp(expected.CStr(), actual.CStr()) != 0)
+		{
+			std::fprintf(stderr, "error: %s differs from the document.\n", path);
+			std::exit(1);
+		}
+	}
+
+	void saving(const std::string& xml, int edits)
+	{
+		char path[] = "/tmp/bench_incremental_XXXXXX";
+		int  descriptor = mkstemp(path);
+
+		if (descriptor < 0)
+		{
+			std::perror("mkstemp");
+			std::exit(1);
+		}
+		close(descriptor);
+
+		const char* names[] = { "SaveFile", "SaveChanges", "SaveChanges, wider" };
+
+		for (int mode = 0; mode < 3; mode++)
+		{
+			FILE* file = std::fopen(path, "wb");
+			std::fwrite(xml.data(), 1, xml.size(), file);
+			std::fclose(file);
+
+			TiXmlDocument document;
+			load(document, path);
+
+			double seconds = edit(document, path, edits, mode != 0, mode == 2);
+			verify(document, path);
+
+			Bench::report(names[mode], seconds, xml.size(), 0, 0);
+		}
+
+		unlink(path);
+	}
+
+	// テキストのcount番目のhomeの値を書き換え、その位置を返す
+	int retype(std::string& text, int count, int& removed, int& inserted)
+	{
+		std::size_t position = 0;
+		int         index = (count * 7919) % 1000;
+
+		for (int skip = 0; skip <= index; skip++)
+		{
+			std::size_t next = text.find("home=\"", position);
+			position = (next == std::string::npos) ? text.find("home=\"") : next + 1;
+		}
+		position += 5;
+
+		std::size_t end = text.find('"', position);
+		char value[16];
+		std::snprintf(value, sizeof(value), "%d", 800 + count % 200);
+
+		removed  = static_cast<int>(end - position);
+		inserted = static_cast<int>(std::strlen(value));
+		text.replace(position, removed, value);
+
+		return static_cast<int>(position);
+	}
+
+	void parsing(const std::string& xml, int edits)
+	{
+		for (int mode = 0; mode < 2; mode++)
+		{
+			std::string   text = xml;
+			TiXmlDocument document;
+
+			// メモリ上のテキストの位置はParse()中に求められるため、Reparse()で
+			// 読み直すには、テキストの写しを保つ最初のReparse()が要る
+			if (mode == 0)
+			{
+				document.Parse(text.c_str());
+			}
+			else
+			{
+				document.Reparse(text.c_str(), 0, 0, 0);
+			}
+
+			double total = 0;
+
+			for (int count = 0; count < edits; count++)
+			{
+				int removed  = 0;
+				int inserted = 0;
+				int offset   = retype(text, count, removed, inserted);
+
+				double start = Bench::now();
+
+				if (mode == 0)
+				{
+					document.Clear();
+					document.Parse(text.c_str());
+				}
+				else
+				{
+					document.Reparse(text.c_str(), offset, removed, inserted);
+				}
+				total += Bench::now() - start;
+
+				if (document.Error())
+				{
+					std::fprintf(stderr, "error: %s\n", document.ErrorDesc());
+					std::exit(1);
+				}
+			}
+
+			TiXmlDocument expected;
+			expected.Parse(text.c_str());
+
+			TiXmlPrinter expected_text;
+			TiXmlPrinter actual_text;
+			expected.Accept(&expected_text);
+			document.Accept(&actual_text);
+
+			if (std::strcmp(expected_text.CStr(), actual_text.CStr()) != 0)
+			{
+				std::fprintf(stderr, "error: the reparsed document differs.\n");
+				std::exit(1);
+			}
+
+			Bench::report(mode == 0 ? "Parse, whole text" : "Reparse", total / edits, text.size(), 0, 0);
+		}
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	int robots = (argc > 1) ? std::atoi(argv[1]) : 2000;
+	int edits  = (argc > 2) ? std::atoi(argv[2]) : 50;
+
+	std::string xml = Bench::calibrationLibrary(robots);
+
+	std::printf("%d robots, %d edits of one home value (per-edit averages)\n", robots, edits);
+
+	::saving(xml, edits);
+	::parsing(xml, edits);
+
+	return 0;
+}
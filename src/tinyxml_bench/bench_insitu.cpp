@@ -0,0 +1,182 @@
+﻿// TinyXML Benchmark - In-situ parsing
+// ============================================================================
+// NOTE:
+// キャリブレーションライブラリを一時ファイルに書き出し、LoadFile()で繰り返し
+// 読み込みます。名前と値をコピーする通常の読み込みと、TiXmlDocument::SetInSitu()
+// でファイルのバッファを参照する読み込み(アリーナ併用を含む)について、時間、
+// 確保回数、確保量のピークを比較します。
+//
+// in-situの値は初めて読んだときにデコードされるため、読み込み後にすべての
+// 名前と値を読む時間も別に計測します。
+//
+// 短い名前と値はTiXmlStringの中に収まり、コピーでも確保しないため、in-situで
+// 減るのは長い文字列の確保だけです。確保回数がノードと属性の数にどれだけ
+// 近いかを見られるよう、その数も表示します。確保量の大半はノードと属性の
+// 大きさで、in-situはそれに加えてファイルのバッファを保ちます。
+//
+//     usage: bench_insitu [robots] [repeat]
+
+// 標準C++ライブラリ
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+#include "bench_util.h"
+
+
+namespace
+{
+	// すべての名前と値を読み、その長さの合計を返す
+	std::size_t touch(const TiXmlNode* node)
+	{
+		std::size_t length = std::string(node->Value()).size();
+
+		if (const TiXmlElement* element = node->ToElement())
+		{
+			for (const TiXmlAttribute* attribute = element->FirstAttribute(); attribute; attribute = attribute->Next())
+			{
+				length += std::string(attribute->Name()).size() + std::string(attribute->Value()).size();
+			}
+		}
+
+		for (const TiXmlNode* child = node->FirstChild(); child; child = child->NextSibling())
+		{
+			length += touch(child);
+		}
+
+		return length;
+	}
+
+	// ノードと属性の数を返す
+	std::size_t count(const TiXmlNode* node)
+	{
+		std::size_t objects = 1;
+
+		if (const TiXmlElement* element = node->ToElement())
+		{
+			for (const TiXmlAttribute* attribute = element->FirstAttribute(); attribute; attribute = attribute->Next())
+			{
+				objects++;
+			}
+		}
+
+		for (const TiXmlNode* child = node->FirstChild(); child; child = child->NextSibling())
+		{
+			objects += count(child);
+		}
+
+		return objects;
+	}
+
+	// LoadFile()と全体の読み出しをrepeat回繰り返して計測し、最後のDOMを文字列で返す
+	std::string run(const char* name, const char* path, std::size_t input_bytes, int repeat, bool in_situ, bool use_arena)
+	{
+		double             load_time = 0;
+		double             read_time = 0;
+		unsigned long long load_allocations = 0;
+		unsigned long long load_bytes = 0;
+		unsigned long long peak = 0;
+		std::string        printed;
+
+		for (int count = 0; count < repeat; count++)
+		{
+			TiXmlDocument document;
+			document.SetInSitu(in_situ);
+			document.SetUseArena(use_arena);
+
+			unsigned long long allocations = Bench::allocations();
+			unsigned long long bytes = Bench::allocatedBytes();
+			unsigned long long live = Bench::liveBytes();
+			Bench::resetPeak();
+			double start = Bench::now();
+
+			if (!document.LoadFile(path))
+			{
+				std::fprintf(stderr, "error: %s\n", document.ErrorDesc());
+				std::exit(1);
+			}
+
+			double loaded = Bench::now();
+			load_allocations += Bench::allocations() - allocations;
+			load_bytes += Bench::allocatedBytes() - bytes;
+
+			std::size_t length = ::touch(&document);
+
+			double read = Bench::now();
+			peak = Bench::peakBytes() - live;
+
+			if (length == 0)
+			{
+				std::exit(1);
+			}
+
+			load_time += loaded - start;
+			read_time += read - loaded;
+
+			if (count == repeat - 1)
+			{
+				TiXmlPrinter printer;
+				document.Accept(&printer);
+				printed = printer.CStr();
+			}
+		}
+
+		std::string label(name);
+		Bench::report((label + " load").c_str(), load_time / repeat, input_bytes, load_allocations / repeat, load_bytes / repeat);
+		Bench::report((label + " read all").c_str(), read_time / repeat, input_bytes, 0, 0);
+		std::printf("%-24s %10.1f KiB peak\n", (label + " memory").c_str(), peak / 1024.0);
+
+		return printed;
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	int robots = (argc > 1) ? std::atoi(argv[1]) : 2000;
+	int repeat = (argc > 2) ? std::atoi(argv[2]) : 10;
+
+	std::string xml = Bench::calibrationLibrary(robots);
+
+	char  path[] = "/tmp/bench_insitu_XXXXXX";
+	FILE* file = NULL;
+	int   fd = mkstemp(path);
+
+	if (fd < 0 || (file = fdopen(fd, "wb")) == NULL || std::fwrite(xml.data(), 1, xml.size(), file) != xml.size())
+	{
+		std::fprintf(stderr, "error: failed to write %s.\n", path);
+
+		return 1;
+	}
+
+	std::fclose(file);
+
+	std::size_t objects = 0;
+
+	{
+		TiXmlDocument document;
+		document.Parse(xml.c_str());
+		objects = ::count(&document) - 1;
+	}
+
+	std::printf("calibration library: %d robots, %.1f KiB, %lu nodes and attributes, %d runs (per-run averages)\n",
+		robots, xml.size() / 1024.0, static_cast<unsigned long>(objects), repeat);
+
+	std::string copied  = ::run("copy",           path, xml.size(), repeat, false, false);
+	std::string in_situ = ::run("in-situ",        path, xml.size(), repeat, true,  false);
+	std::string both    = ::run("in-situ + arena", path, xml.size(), repeat, true,  true);
+
+	std::remove(path);
+
+	// すべてのDOMが一致することを確認する
+	if (copied != in_situ || copied != both)
+	{
+		std::fprintf(stderr, "error: the in-situ DOM differs from the copied DOM.\n");
+
+		return 1;
+	}
+
+	return 0;
+}
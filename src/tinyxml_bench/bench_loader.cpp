@@ -0,0 +1,186 @@
+﻿// TinyXML Benchmark - Directory loader
+// ============================================================================
+// NOTE:
+// ロボットごとのプロファイル(キャリブレーションライブラリ)を1ファイルずつ
+// 一時ディレクトリに書き出し、そのディレクトリを読み込む時間を比較します。
+//
+// - TiXmlDocument::LoadFile()でファイルを順に読み、すべての文書を保持する
+// - TiXmlDirectoryLoaderで1スレッドで読む
+// - TiXmlDirectoryLoaderでシステムのスレッド数で読む
+//
+// ローダーは1スレッドにつき1つの文書しか保持しないため、確保中のバイト数の
+// 最大値はファイル数によらず、スレッド数に比例します。ファイルごとの読み込み
+// 時間(平均と最大)も表示します。
+//
+//     usage: bench_loader [files] [robots] [repeat]
+
+// 標準C++ライブラリ
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// POSIX
+#include <unistd.h>
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+#include "bench_util.h"
+
+
+namespace
+{
+	// 読み込んだファイルごとの時間を集める
+	class Timings : public TiXmlLoadHandler
+	{
+	public:
+		Timings() : errors(0), total(0), longest(0), count(0) {}
+
+		virtual bool Loaded(const char* filename, TiXmlDocument& document, double seconds)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if (document.Error())
+			{
+				errors++;
+			}
+
+			total += seconds;
+			longest = std::max(longest, seconds);
+			count++;
+
+			return true;
+		}
+
+		std::mutex mutex;
+		int        errors;
+		double     total;
+		double     longest;
+		int        count;
+	};
+
+	void report(const char* name, double seconds, std::size_t bytes, unsigned long long peak, const Timings* timings)
+	{
+		Bench::report(name, seconds, bytes, 0, peak);
+
+		if (timings != NULL && timings->count > 0)
+		{
+			std::printf("%-24s %10.3f ms avg %8.3f ms max per file\n", "", timings->total / timings->count * 1000.0, timings->longest * 1000.0);
+		}
+	}
+
+	void run(int files, int robots, int repeat)
+	{
+		char directory[] = "/tmp/bench_loader_XXXXXX";
+
+		if (mkdtemp(directory) == NULL)
+		{
+			std::perror("mkdtemp");
+			std::exit(1);
+		}
+
+		std::string xml = Bench::calibrationLibrary(robots);
+		std::vector<std::string> names;
+
+		for (int index = 0; index < files; index++)
+		{
+			char name[256];
+			std::snprintf(name, sizeof(name), "%s/plen2-%04d.xml", directory, index);
+
+			FILE* file = std::fopen(name, "wb");
+			std::fwrite(xml.data(), 1, xml.size(), file);
+			std::fclose(file);
+
+			names.push_back(name);
+		}
+
+		std::size_t bytes = xml.size() * files;
+		double serial_time = 0;
+		double single_time = 0;
+		double pool_time = 0;
+		unsigned long long serial_peak = 0;
+		unsigned long long single_peak = 0;
+		unsigned long long pool_peak = 0;
+		Timings single_timings;
+		Timings pool_timings;
+
+		for (int count = 0; count < repeat; count++)
+		{
+			// 今のAPIで順に読み、文書を保持する
+			Bench::resetPeak();
+			unsigned long long base = Bench::liveBytes();
+			double start = Bench::now();
+			{
+				std::vector<TiXmlDocument*> documents;
+
+				for (int index = 0; index < files; index++)
+				{
+					documents.push_back(new TiXmlDocument());
+					documents.back()->LoadFile(names[index].c_str());
+				}
+
+				serial_time += Bench::now() - start;
+
+				for (int index = 0; index < files; index++)
+				{
+					delete documents[index];
+				}
+			}
+			serial_peak = Bench::peakBytes() - base;
+
+			Bench::resetPeak();
+			base = Bench::liveBytes();
+			start = Bench::now();
+			{
+				TiXmlDirectoryLoader loader;
+				loader.SetThreads(1);
+				loader.Load(directory, &single_timings);
+			}
+			single_time += Bench::now() - start;
+			single_peak = Bench::peakBytes() - base;
+
+			Bench::resetPeak();
+			base = Bench::liveBytes();
+			start = Bench::now();
+			{
+				TiXmlDirectoryLoader loader;
+				loader.Load(directory, &pool_timings);
+			}
+			pool_time += Bench::now() - start;
+			pool_peak = Bench::peakBytes() - base;
+		}
+
+		if (single_timings.errors != 0 || pool_timings.errors != 0 || pool_timings.count != files * repeat)
+		{
+			std::fprintf(stderr, "error: the loader read %d files, %d with errors.\n", pool_timings.count, pool_timings.errors);
+			std::exit(1);
+		}
+
+		std::printf("(the last column is the peak of the bytes allocated at once)\n");
+		report("LoadFile, keep all", serial_time / repeat, bytes, serial_peak, NULL);
+		report("loader 1 thread", single_time / repeat, bytes, single_peak, &single_timings);
+		report("loader all threads", pool_time / repeat, bytes, pool_peak, &pool_timings);
+
+		for (int index = 0; index < files; index++)
+		{
+			unlink(names[index].c_str());
+		}
+		rmdir(directory);
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	int files  = (argc > 1) ? std::atoi(argv[1]) : 64;
+	int robots = (argc > 2) ? std::atoi(argv[2]) : 100;
+	int repeat = (argc > 3) ? std::atoi(argv[3]) : 5;
+
+	std::printf("%d profiles of %d robots, %d runs (per-run averages)\n", files, robots, repeat);
+
+	::run(files, robots, repeat);
+
+	return 0;
+}
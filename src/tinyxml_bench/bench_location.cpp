@@ -0,0 +1,232 @@
+﻿// TinyXML Benchmark - Row and column tracking
+// ============================================================================
+// NOTE:
+// 多数の要素を持つ平坦なXML(モーションのフレーム列を模したもの)を生成し、
+// 読み込みの時間と確保量を、行・列の追跡あり(既定のタブ幅4)となし
+// (SetTabSize(0))で比較します。
+//
+// - Parse(): テキストは呼び出し側のものなので、行と列は読みながら求められる
+// - LoadFile(): 文書がファイルの内容を保つので、ノードの位置(バイトオフセット)
+//   だけを記録し、行と列はRow()/Column()が呼ばれたときに改行の索引から求める
+//
+// 改行の多い文書と1行の文書のそれぞれについて、全ノード・全属性の
+// Row()/Column()を求める時間と、末尾の構文エラーの位置を求める時間も計測します。
+//
+//     usage: bench_location [frames] [repeat]
+
+// 標準C++ライブラリ
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+#include "bench_util.h"
+
+
+namespace
+{
+	// フレームごとに18関節の角度を持つモーションのXMLを生成する
+	std::string frameDocument(int frames, bool one_line)
+	{
+		const char* indent = one_line ? "" : "\n\t\t";
+
+		std::string xml = "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>";
+		xml += one_line ? "<motion slot=\"0\">" : "\n<motion slot=\"0\">\n";
+
+		for (int index = 0; index < frames; index++)
+		{
+			char frame[64];
+			std::sprintf(frame, "\t<frame index=\"%d\" transition=\"%d\">", index, 100 + index % 7);
+			xml += frame;
+
+			for (int joint = 0; joint < 18; joint++)
+			{
+				char angle[64];
+				std::sprintf(angle, "%s<joint id=\"%d\">%d</joint>", indent, joint, (index * 37 + joint * 11) % 1800 - 900);
+				xml += angle;
+			}
+
+			xml += one_line ? "</frame>" : "\n\t</frame>\n";
+		}
+
+		xml += "</motion>\n";
+
+		return xml;
+	}
+
+	// 全ノード・全属性の位置を求める(行と列の合計を返す)
+	long locate(const TiXmlNode* node)
+	{
+		long sum = 0;
+
+		for (const TiXmlNode* child = node->FirstChild(); child; child = child->NextSibling())
+		{
+			sum += child->Row() + child->Column();
+
+			if (const TiXmlElement* element = child->ToElement())
+			{
+				for (const TiXmlAttribute* attribute = element->FirstAttribute(); attribute; attribute = attribute->Next())
+				{
+					sum += attribute->Row() + attribute->Column();
+				}
+			}
+
+			sum += locate(child);
+		}
+
+		return sum;
+	}
+
+	// 読み込みと全体の位置の計測結果
+	struct Measure
+	{
+		double             load_time;
+		double             locate_time;
+		unsigned long long allocations;
+		unsigned long long bytes;
+		long               sum;
+	};
+
+	// xml(pathがあればそのファイル)をrepeat回読み込み、locatingなら全体の位置を求める
+	Measure measure(const std::string& xml, const char* path, int tabsize, bool locating, int repeat)
+	{
+		Measure result = {0, 0, 0, 0, 0};
+
+		for (int count = 0; count < repeat; count++)
+		{
+			TiXmlDocument document;
+			document.SetTabSize(tabsize);
+
+			unsigned long long allocations = Bench::allocations();
+			unsigned long long bytes = Bench::allocatedBytes();
+			double start = Bench::now();
+
+			if (path != NULL)
+			{
+				document.LoadFile(path);
+			}
+			else
+			{
+				document.Parse(xml.c_str());
+			}
+
+			result.load_time += Bench::now() - start;
+			result.allocations += Bench::allocations() - allocations;
+			result.bytes += Bench::allocatedBytes() - bytes;
+
+			if (document.Error())
+			{
+				std::fprintf(stderr, "error: %s\n", document.ErrorDesc());
+				std::exit(1);
+			}
+
+			if (locating)
+			{
+				start = Bench::now();
+				result.sum += locate(&document);
+				result.locate_time += Bench::now() - start;
+			}
+		}
+
+		result.load_time /= repeat;
+		result.locate_time /= repeat;
+		result.allocations /= repeat;
+		result.bytes /= repeat;
+
+		return result;
+	}
+
+	void run(const char* name, const std::string& xml, const char* path, int repeat)
+	{
+		double error_time = 0;
+		long   sum = 0;
+
+		// 末尾の閉じタグを壊した文書(エラー位置は最終行になる)
+		std::string broken = xml.substr(0, xml.size() - 3) + "<\n";
+
+		// 最初のParse()はヒープを広げる分だけ遅いため、計測しない
+		{
+			TiXmlDocument document;
+			document.Parse(xml.c_str());
+		}
+
+		// 計測ごとにループを分け、前の計測で解放したメモリの影響をそろえる
+		Measure untracked = ::measure(xml, NULL, 0, false, repeat);
+		Measure parsed    = ::measure(xml, NULL, 4, true, repeat);
+		Measure loaded    = ::measure(xml, path, 4, true, repeat);
+
+		sum += parsed.sum + loaded.sum;
+
+		if (parsed.sum != loaded.sum)
+		{
+			std::fprintf(stderr, "error: locations differ (%ld / %ld)\n", parsed.sum, loaded.sum);
+			std::exit(1);
+		}
+
+		for (int count = 0; count < repeat; count++)
+		{
+			TiXmlDocument document;
+
+			double start = Bench::now();
+			document.Parse(broken.c_str());
+			error_time += Bench::now() - start;
+
+			sum += document.ErrorRow() + document.ErrorCol();
+		}
+
+		std::string label = name;
+		Bench::report((label + " untracked").c_str(), untracked.load_time, xml.size(), untracked.allocations, untracked.bytes);
+		Bench::report((label + " parse").c_str(), parsed.load_time, xml.size(), parsed.allocations, parsed.bytes);
+		Bench::report((label + " locate all").c_str(), parsed.locate_time, xml.size(), 0, 0);
+		Bench::report((label + " load file").c_str(), loaded.load_time, xml.size(), loaded.allocations, loaded.bytes);
+		Bench::report((label + " locate all, file").c_str(), loaded.locate_time, xml.size(), 0, 0);
+		Bench::report((label + " parse error").c_str(), error_time / repeat, broken.size(), 0, 0);
+
+		if (sum == 0)
+		{
+			std::printf("(no locations)\n");
+		}
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	int frames = (argc > 1) ? std::atoi(argv[1]) : 5000;
+	int repeat = (argc > 2) ? std::atoi(argv[2]) : 10;
+
+	std::string lines    = frameDocument(frames, false);
+	std::string one_line = frameDocument(frames, true);
+
+	char  lines_path[] = "/tmp/bench_location_XXXXXX";
+	char  one_line_path[] = "/tmp/bench_location_XXXXXX";
+	const std::string* texts[] = { &lines, &one_line };
+	char* paths[] = { lines_path, one_line_path };
+
+	for (int index = 0; index < 2; index++)
+	{
+		FILE* file = NULL;
+		int   fd = mkstemp(paths[index]);
+
+		if (fd < 0 || (file = fdopen(fd, "wb")) == NULL || std::fwrite(texts[index]->data(), 1, texts[index]->size(), file) != texts[index]->size())
+		{
+			std::fprintf(stderr, "error: failed to write %s.\n", paths[index]);
+
+			return 1;
+		}
+
+		std::fclose(file);
+	}
+
+	std::printf("%d frames, %.1f KiB, %d runs (per-run averages)\n",
+		frames, lines.size() / 1024.0, repeat);
+
+	::run("lines", lines, lines_path, repeat);
+	::run("one line", one_line, one_line_path, repeat);
+
+	std::remove(lines_path);
+	std::remove(one_line_path);
+
+	return 0;
+}
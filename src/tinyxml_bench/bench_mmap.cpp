@@ -0,0 +1,156 @@
+﻿// TinyXML Benchmark - Mapped files
+// ============================================================================
+// NOTE:
+// キャリブレーションライブラリを改行LFとCR+LFの一時ファイルに書き出し、
+// ファイルをマップして読むLoadFile(filename)と、ファイル全体をヒープに読み込む
+// LoadFile(FILE*)を比較します。改行の正規化はパーサが行うため、どちらも
+// 入力を一度だけ走査します。通常の読み込みとin-situの読み込みについて、
+// 時間、確保回数、確保量のピークを計測します。
+//
+// マップした読み込みでは、ファイルの内容はヒープに乗らないため、ピークは
+// おおよそファイルの大きさだけ小さくなります。
+//
+//     usage: bench_mmap [robots] [repeat]
+
+// 標準C++ライブラリ
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+#include "bench_util.h"
+
+
+namespace
+{
+	// xmlを一時ファイルに書き出し、そのパスを返す
+	std::string write(const std::string& xml)
+	{
+		char  path[] = "/tmp/bench_mmap_XXXXXX";
+		FILE* file = NULL;
+		int   fd = mkstemp(path);
+
+		if (fd < 0 || (file = fdopen(fd, "wb")) == NULL || std::fwrite(xml.data(), 1, xml.size(), file) != xml.size())
+		{
+			std::fprintf(stderr, "error: failed to write %s.\n", path);
+			std::exit(1);
+		}
+
+		std::fclose(file);
+
+		return path;
+	}
+
+	// 読み込みをrepeat回繰り返して計測し、最後のDOMを文字列で返す
+	std::string run(const char* name, const std::string& path, std::size_t input_bytes, int repeat, bool mapped, bool in_situ)
+	{
+		double             load_time = 0;
+		unsigned long long load_allocations = 0;
+		unsigned long long load_bytes = 0;
+		unsigned long long peak = 0;
+		std::string        printed;
+
+		for (int count = 0; count < repeat; count++)
+		{
+			TiXmlDocument document;
+			document.SetInSitu(in_situ);
+
+			FILE* file = NULL;
+
+			if (!mapped && (file = std::fopen(path.c_str(), "rb")) == NULL)
+			{
+				std::fprintf(stderr, "error: failed to open %s.\n", path.c_str());
+				std::exit(1);
+			}
+
+			unsigned long long allocations = Bench::allocations();
+			unsigned long long bytes = Bench::allocatedBytes();
+			unsigned long long live = Bench::liveBytes();
+			Bench::resetPeak();
+			double start = Bench::now();
+
+			bool loaded = mapped ? document.LoadFile(path.c_str()) : document.LoadFile(file);
+
+			load_time += Bench::now() - start;
+			load_allocations += Bench::allocations() - allocations;
+			load_bytes += Bench::allocatedBytes() - bytes;
+			peak = Bench::peakBytes() - live;
+
+			if (file != NULL)
+			{
+				std::fclose(file);
+			}
+
+			if (!loaded)
+			{
+				std::fprintf(stderr, "error: %s\n", document.ErrorDesc());
+				std::exit(1);
+			}
+
+			if (count == repeat - 1)
+			{
+				TiXmlPrinter printer;
+				document.Accept(&printer);
+				printed = printer.CStr();
+			}
+		}
+
+		std::string label(name);
+		Bench::report((label + " load").c_str(), load_time / repeat, input_bytes, load_allocations / repeat, load_bytes / repeat);
+		std::printf("%-28s %10.1f KiB peak\n", (label + " memory").c_str(), peak / 1024.0);
+
+		return printed;
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	int robots = (argc > 1) ? std::atoi(argv[1]) : 2000;
+	int repeat = (argc > 2) ? std::atoi(argv[2]) : 10;
+
+	std::string xml = Bench::calibrationLibrary(robots);
+	std::string xml_crlf;
+
+	for (std::size_t index = 0; index < xml.size(); index++)
+	{
+		if (xml[index] == '\n')
+		{
+			xml_crlf += '\r';
+		}
+
+		xml_crlf += xml[index];
+	}
+
+	std::string lf   = ::write(xml);
+	std::string crlf = ::write(xml_crlf);
+
+	std::printf("calibration library: %d robots, %.1f KiB (LF), %.1f KiB (CR+LF), %d runs (per-run averages)\n",
+		robots, xml.size() / 1024.0, xml_crlf.size() / 1024.0, repeat);
+
+	std::string results[] = {
+		::run("read LF",                 lf,   xml.size(),      repeat, false, false),
+		::run("mapped LF",               lf,   xml.size(),      repeat, true,  false),
+		::run("read CR+LF",              crlf, xml_crlf.size(), repeat, false, false),
+		::run("mapped CR+LF",            crlf, xml_crlf.size(), repeat, true,  false),
+		::run("read in-situ CR+LF",      crlf, xml_crlf.size(), repeat, false, true),
+		::run("mapped in-situ CR+LF",    crlf, xml_crlf.size(), repeat, true,  true)
+	};
+
+	std::remove(lf.c_str());
+	std::remove(crlf.c_str());
+
+	// 改行と読み込み方によらず、すべてのDOMが一致することを確認する
+	for (std::size_t index = 1; index < sizeof(results) / sizeof(results[0]); index++)
+	{
+		if (results[index] != results[0])
+		{
+			std::fprintf(stderr, "error: the DOM differs between the loads.\n");
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,144 @@
+﻿// TinyXML Benchmark - Numeric attributes
+// ============================================================================
+// NOTE:
+// 数値ばかりの2種類の文書で、数値属性の読み書きの時間を計測します。
+//
+// - キャリブレーションライブラリ: 関節ごとのid、min、max、home、trimを
+//   QueryIntAttribute()で読む
+// - モーション: time、joint、angleを持つフレームを、SetDoubleAttribute()と
+//   SetAttribute(int)で作り、QueryDoubleAttribute()とQueryIntAttribute()で読む
+//
+// 変換はロケールに依存せず、sscanf()/sprintf()を通りません。
+//
+//     usage: bench_numbers [robots] [frames] [repeat]
+
+// 標準C++ライブラリ
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+#include "bench_util.h"
+
+
+namespace
+{
+	const char* const JOINT_ATTRIBUTES[] = { "id", "min", "max", "home", "trim" };
+
+	// キャリブレーションライブラリの数値属性をすべて読む
+	void runLibrary(int robots, int repeat)
+	{
+		std::string xml = Bench::calibrationLibrary(robots);
+
+		TiXmlDocument document;
+		document.Parse(xml.c_str());
+
+		double    time = 0;
+		long long sum = 0;
+		long      values = 0;
+
+		for (int count = 0; count < repeat; count++)
+		{
+			double start = Bench::now();
+
+			for (TiXmlElement* robot = document.RootElement()->FirstChildElement("robot"); robot != NULL; robot = robot->NextSiblingElement("robot"))
+			{
+				for (TiXmlElement* joint = robot->FirstChildElement("joint"); joint != NULL; joint = joint->NextSiblingElement("joint"))
+				{
+					for (int index = 0; index < 5; index++)
+					{
+						int value = 0;
+						if (joint->QueryIntAttribute(JOINT_ATTRIBUTES[index], &value) == TIXML_SUCCESS)
+						{
+							sum += value;
+							values++;
+						}
+					}
+				}
+			}
+
+			time += Bench::now() - start;
+		}
+
+		Bench::report("library query int", time / repeat, xml.size(), 0, 0);
+		std::printf("%-24s %10ld values (sum %lld)\n", "", values / repeat, sum / repeat);
+	}
+
+	// モーションを作って読む
+	void runMotion(int frames, int repeat)
+	{
+		double             build_time = 0;
+		double             query_time = 0;
+		unsigned long long build_allocations = 0;
+		unsigned long long build_bytes = 0;
+		std::size_t        size = 0;
+		double             sum = 0;
+
+		for (int count = 0; count < repeat; count++)
+		{
+			TiXmlDocument document;
+			TiXmlElement* root = new TiXmlElement("motion");
+			document.LinkEndChild(root);
+
+			unsigned long long allocations = Bench::allocations();
+			unsigned long long bytes = Bench::allocatedBytes();
+			double start = Bench::now();
+
+			for (int index = 0; index < frames; index++)
+			{
+				TiXmlElement* frame = new TiXmlElement("frame");
+				frame->SetDoubleAttribute("time", index * 12.5);
+				frame->SetAttribute("joint", index % 18);
+				frame->SetAttribute("angle", (index * 37) % 1801);
+				root->LinkEndChild(frame);
+			}
+
+			build_time += Bench::now() - start;
+			build_allocations += Bench::allocations() - allocations;
+			build_bytes += Bench::allocatedBytes() - bytes;
+
+			start = Bench::now();
+
+			for (TiXmlElement* frame = root->FirstChildElement("frame"); frame != NULL; frame = frame->NextSiblingElement("frame"))
+			{
+				double time = 0;
+				int    joint = 0;
+				int    angle = 0;
+
+				frame->QueryDoubleAttribute("time", &time);
+				frame->QueryIntAttribute("joint", &joint);
+				frame->QueryIntAttribute("angle", &angle);
+				sum += time + joint + angle;
+			}
+
+			query_time += Bench::now() - start;
+
+			if (count == 0)
+			{
+				TiXmlPrinter printer;
+				document.Accept(&printer);
+				size = printer.Size();
+			}
+		}
+
+		Bench::report("motion build", build_time / repeat, size, build_allocations / repeat, build_bytes / repeat);
+		Bench::report("motion query", query_time / repeat, size, 0, 0);
+		std::printf("%-24s %10d frames (sum %.1f)\n", "", frames, sum / repeat);
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	int robots = (argc > 1) ? std::atoi(argv[1]) : 2000;
+	int frames = (argc > 2) ? std::atoi(argv[2]) : 200000;
+	int repeat = (argc > 3) ? std::atoi(argv[3]) : 10;
+
+	std::printf("library: %d robots, motion: %d frames, %d runs (per-run averages)\n", robots, frames, repeat);
+
+	::runLibrary(robots, repeat);
+	::runMotion(frames, repeat);
+
+	return 0;
+}
@@ -0,0 +1,206 @@
+﻿// TinyXML Benchmark - Path queries
+// ============================================================================
+// NOTE:
+// キャリブレーションライブラリから、各robotの7番目のjointのminを取り出す時間を
+// 次の方法で比較します。
+//
+// - TiXmlHandleのChildElement()をつないで、i番目のrobotを毎回先頭から引く
+// - FirstChildElement()/NextSiblingElement()とAttribute()で手書きでたどる
+// - TiXmlPathで"/library/robot/joint[@id=7]/@min"を一度コンパイルして実行する
+// - 同じく"//joint[@id=7]/@min"(子孫をすべてたどる)
+//
+// 続けて、複数の文書に同じパスをTiXmlPath::SelectEach()で実行する時間を、
+// 1スレッドとシステムのスレッド数とで比較します。
+//
+//     usage: bench_path [robots] [documents] [repeat]
+
+// 標準C++ライブラリ
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+#include "bench_util.h"
+
+
+namespace
+{
+	long long handleChain(TiXmlDocument& document, int robots)
+	{
+		long long sum = 0;
+		TiXmlHandle library = TiXmlHandle(&document).FirstChildElement("library");
+
+		for (int robot = 0; robot < robots; robot++)
+		{
+			TiXmlElement* joint = library.ChildElement("robot", robot).ChildElement("joint", 6).ToElement();
+
+			if (joint != NULL)
+			{
+				sum += std::atoi(joint->Attribute("min"));
+			}
+		}
+
+		return sum;
+	}
+
+	long long handWritten(TiXmlDocument& document)
+	{
+		long long sum = 0;
+
+		for (TiXmlElement* robot = document.RootElement()->FirstChildElement("robot"); robot != NULL; robot = robot->NextSiblingElement("robot"))
+		{
+			for (TiXmlElement* joint = robot->FirstChildElement("joint"); joint != NULL; joint = joint->NextSiblingElement("joint"))
+			{
+				const char* id = joint->Attribute("id");
+
+				if (id != NULL && std::strcmp(id, "7") == 0)
+				{
+					sum += std::atoi(joint->Attribute("min"));
+				}
+			}
+		}
+
+		return sum;
+	}
+
+	long long sumValues(const TiXmlPathResult& result)
+	{
+		long long sum = 0;
+
+		for (int index = 0; index < result.Count(); index++)
+		{
+			sum += std::atoi(result.Value(index));
+		}
+
+		return sum;
+	}
+
+	void check(const char* name, long long expected, long long actual)
+	{
+		if (expected != actual)
+		{
+			std::fprintf(stderr, "error: %s differs (%lld, %lld).\n", name, expected, actual);
+			std::exit(1);
+		}
+	}
+
+	void runLibrary(int robots, int repeat)
+	{
+		std::string xml = Bench::calibrationLibrary(robots);
+
+		TiXmlDocument document;
+		document.Parse(xml.c_str());
+
+		double start = Bench::now();
+		TiXmlPath child_path;
+		TiXmlPath descendant_path;
+		for (int count = 0; count < 1000; count++)
+		{
+			child_path.Compile("/library/robot/joint[@id=7]/@min");
+			descendant_path.Compile("//joint[@id=7]/@min");
+		}
+		double compile_time = (Bench::now() - start) / 2;
+
+		double handle_time = 0;
+		double hand_time = 0;
+		double child_time = 0;
+		double descendant_time = 0;
+		long long expected = 0;
+		TiXmlPathResult result;
+
+		for (int count = 0; count < repeat; count++)
+		{
+			start = Bench::now();
+			expected = handleChain(document, robots);
+			handle_time += Bench::now() - start;
+
+			start = Bench::now();
+			long long sum = handWritten(document);
+			hand_time += Bench::now() - start;
+			check("the hand-written walk", expected, sum);
+
+			start = Bench::now();
+			child_path.Select(&document, &result);
+			sum = sumValues(result);
+			child_time += Bench::now() - start;
+			check(child_path.Path(), expected, sum);
+
+			start = Bench::now();
+			descendant_path.Select(&document, &result);
+			sum = sumValues(result);
+			descendant_time += Bench::now() - start;
+			check(descendant_path.Path(), expected, sum);
+		}
+
+		Bench::report("compile path x1000", compile_time, 0, 0, 0);
+		Bench::report("handle ChildElement", handle_time / repeat, xml.size(), 0, 0);
+		Bench::report("hand-written walk", hand_time / repeat, xml.size(), 0, 0);
+		Bench::report("path /library/robot/..", child_time / repeat, xml.size(), 0, 0);
+		Bench::report("path //joint", descendant_time / repeat, xml.size(), 0, 0);
+	}
+
+	void runEach(int robots, int documents, int repeat)
+	{
+		std::string xml = Bench::calibrationLibrary(robots);
+
+		std::vector<TiXmlDocument*> library(documents);
+		std::vector<const TiXmlNode*> contexts(documents);
+		for (int index = 0; index < documents; index++)
+		{
+			library[index] = new TiXmlDocument();
+			library[index]->Parse(xml.c_str());
+			contexts[index] = library[index];
+		}
+
+		TiXmlPath path("//robot[@firmware='1.3.4']/joint[@trim<0]/@name");
+		std::vector<TiXmlPathResult> results(documents);
+
+		double serial_time = 0;
+		double parallel_time = 0;
+		int found = 0;
+
+		for (int count = 0; count < repeat; count++)
+		{
+			double start = Bench::now();
+			path.SelectEach(&contexts[0], documents, &results[0], 1);
+			serial_time += Bench::now() - start;
+
+			start = Bench::now();
+			path.SelectEach(&contexts[0], documents, &results[0]);
+			parallel_time += Bench::now() - start;
+
+			found = 0;
+			for (int index = 0; index < documents; index++)
+			{
+				found += results[index].Count();
+			}
+		}
+
+		std::printf("%d documents, %d results\n", documents, found);
+		Bench::report("SelectEach 1 thread", serial_time / repeat, xml.size() * documents, 0, 0);
+		Bench::report("SelectEach all threads", parallel_time / repeat, xml.size() * documents, 0, 0);
+
+		for (int index = 0; index < documents; index++)
+		{
+			delete library[index];
+		}
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	int robots    = (argc > 1) ? std::atoi(argv[1]) : 2000;
+	int documents = (argc > 2) ? std::atoi(argv[2]) : 16;
+	int repeat    = (argc > 3) ? std::atoi(argv[3]) : 5;
+
+	std::printf("calibration library: %d robots, %d runs (per-run averages)\n", robots, repeat);
+
+	::runLibrary(robots, repeat);
+	::runEach(robots, documents, repeat);
+
+	return 0;
+}
@@ -0,0 +1,150 @@
+﻿// TinyXML Benchmark - Saving
+// ============================================================================
+// NOTE:
+// キャリブレーションライブラリのDOMを、SaveFile(FILE*)で一時ファイルに書き出す
+// 時間と、TiXmlPrinterで文字列に書き出す時間を計測します。比べるために、
+// 書き出される内容と同じ大きさのバイト列を一度のfwriteで書く時間も計測します。
+// 保存がI/Oで律速されていれば、SaveFile()はこれに近い時間になります。
+//
+//     usage: bench_save [robots] [repeat]
+
+// 標準C++ライブラリ
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+#include "bench_util.h"
+
+
+namespace
+{
+	FILE* open(const char* path)
+	{
+		FILE* file = std::fopen(path, "wb");
+
+		if (file == NULL)
+		{
+			std::fprintf(stderr, "error: failed to open %s.\n", path);
+			std::exit(1);
+		}
+
+		return file;
+	}
+
+	// 書き出したファイルの中身を返す
+	std::string read(const char* path)
+	{
+		std::string contents;
+		FILE*       file = std::fopen(path, "rb");
+		char        buffer[4096];
+		std::size_t length;
+
+		while (file != NULL && (length = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+		{
+			contents.append(buffer, length);
+		}
+
+		if (file != NULL)
+		{
+			std::fclose(file);
+		}
+
+		return contents;
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	int robots = (argc > 1) ? std::atoi(argv[1]) : 2000;
+	int repeat = (argc > 2) ? std::atoi(argv[2]) : 10;
+
+	const char* path = "/tmp/bench_save.xml";
+
+	TiXmlDocument document;
+	document.Parse(Bench::calibrationLibrary(robots).c_str());
+
+	if (document.Error())
+	{
+		std::fprintf(stderr, "error: %s\n", document.ErrorDesc());
+
+		return 1;
+	}
+
+	// 書き出される大きさを知るため、計測の前に一度保存しておく
+	FILE* file = ::open(path);
+	document.SaveFile(file);
+	std::fclose(file);
+
+	std::string saved = ::read(path);
+
+	std::printf("calibration library: %d robots, %.1f KiB saved, %d runs (per-run averages)\n",
+		robots, saved.size() / 1024.0, repeat);
+
+	double             time[3] = { 0, 0, 0 };
+	unsigned long long allocations[3] = { 0, 0, 0 };
+	unsigned long long bytes[3] = { 0, 0, 0 };
+	std::string        printed;
+
+	for (int count = 0; count < repeat; count++)
+	{
+		// 同じ大きさを一度のfwriteで書く
+		file = ::open(path);
+		unsigned long long allocations_before = Bench::allocations();
+		unsigned long long bytes_before = Bench::allocatedBytes();
+		double start = Bench::now();
+
+		std::fwrite(saved.data(), 1, saved.size(), file);
+		std::fclose(file);
+
+		time[0] += Bench::now() - start;
+		allocations[0] += Bench::allocations() - allocations_before;
+		bytes[0] += Bench::allocatedBytes() - bytes_before;
+
+		// SaveFile(FILE*)
+		file = ::open(path);
+		allocations_before = Bench::allocations();
+		bytes_before = Bench::allocatedBytes();
+		start = Bench::now();
+
+		document.SaveFile(file);
+		std::fclose(file);
+
+		time[1] += Bench::now() - start;
+		allocations[1] += Bench::allocations() - allocations_before;
+		bytes[1] += Bench::allocatedBytes() - bytes_before;
+
+		// TiXmlPrinter
+		allocations_before = Bench::allocations();
+		bytes_before = Bench::allocatedBytes();
+		start = Bench::now();
+
+		TiXmlPrinter printer;
+		document.Accept(&printer);
+
+		time[2] += Bench::now() - start;
+		allocations[2] += Bench::allocations() - allocations_before;
+		bytes[2] += Bench::allocatedBytes() - bytes_before;
+
+		printed = printer.CStr();
+	}
+
+	Bench::report("fwrite only", time[0] / repeat, saved.size(), allocations[0] / repeat, bytes[0] / repeat);
+	Bench::report("SaveFile", time[1] / repeat, saved.size(), allocations[1] / repeat, bytes[1] / repeat);
+	Bench::report("TiXmlPrinter", time[2] / repeat, printed.size(), allocations[2] / repeat, bytes[2] / repeat);
+
+	bool same = (::read(path) == saved);
+	std::remove(path);
+
+	// 何度保存しても同じ内容になることを確認する
+	if (!same)
+	{
+		std::fprintf(stderr, "error: the saved file differs between the runs.\n");
+
+		return 1;
+	}
+
+	return 0;
+}
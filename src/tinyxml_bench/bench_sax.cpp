@@ -0,0 +1,175 @@
+﻿// TinyXML Benchmark - SAX parser
+// ============================================================================
+// NOTE:
+// キャリブレーションライブラリを、DOMを組み立てるTiXmlDocument::Parse()と、
+// イベントをハンドラに渡すだけのTiXmlSaxParser::Parse()で読み、要素と属性の
+// 数を数えます。時間、確保回数、確保量、確保量のピークを計測します。
+//
+// SAXパーサは報告した文字列を使い回すため、ピークは文書の大きさではなく
+// 要素の深さと一つの要素の属性の数で決まります。
+//
+//     usage: bench_sax [robots] [repeat]
+
+// 標準C++ライブラリ
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+#include "bench_util.h"
+
+
+namespace
+{
+	struct Counts
+	{
+		unsigned long elements;
+		unsigned long attributes;
+		unsigned long texts;
+
+		Counts() : elements(0), attributes(0), texts(0) {}
+
+		bool operator==(const Counts& other) const
+		{
+			return elements == other.elements && attributes == other.attributes && texts == other.texts;
+		}
+	};
+
+	// SAXのイベントを数えるハンドラ
+	class Counter : public TiXmlSaxHandler
+	{
+	public:
+		Counts counts;
+
+		virtual bool StartElement(const char*, const TiXmlSaxAttributes& attributes)
+		{
+			counts.elements++;
+			counts.attributes += attributes.Count();
+
+			return true;
+		}
+
+		virtual bool Text(const char*, bool)
+		{
+			counts.texts++;
+
+			return true;
+		}
+	};
+
+	// DOMを辿って同じものを数える
+	void count(const TiXmlNode* node, Counts& counts)
+	{
+		for (const TiXmlNode* child = node->FirstChild(); child != NULL; child = child->NextSibling())
+		{
+			if (const TiXmlElement* element = child->ToElement())
+			{
+				counts.elements++;
+
+				for (const TiXmlAttribute* attribute = element->FirstAttribute(); attribute != NULL; attribute = attribute->Next())
+				{
+					counts.attributes++;
+				}
+			}
+			else if (child->ToText() != NULL)
+			{
+				counts.texts++;
+			}
+
+			count(child, counts);
+		}
+	}
+
+	// 読み込みをrepeat回繰り返して計測し、最後に数えた結果を返す
+	Counts run(const char* name, const std::string& xml, int repeat, bool sax)
+	{
+		double             parse_time = 0;
+		unsigned long long parse_allocations = 0;
+		unsigned long long parse_bytes = 0;
+		unsigned long long peak = 0;
+		Counts             counts;
+
+		for (int index = 0; index < repeat; index++)
+		{
+			unsigned long long allocations = Bench::allocations();
+			unsigned long long bytes = Bench::allocatedBytes();
+			unsigned long long live = Bench::liveBytes();
+			Bench::resetPeak();
+			double start = Bench::now();
+
+			bool   parsed;
+			Counts current;
+
+			if (sax)
+			{
+				TiXmlSaxParser parser;
+				Counter        counter;
+
+				parser.Parse(xml.c_str(), &counter);
+				parsed = !parser.Error();
+				current = counter.counts;
+			}
+			else
+			{
+				TiXmlDocument document;
+
+				document.Parse(xml.c_str());
+				parsed = !document.Error();
+				::count(&document, current);
+			}
+
+			parse_time += Bench::now() - start;
+			parse_allocations += Bench::allocations() - allocations;
+			parse_bytes += Bench::allocatedBytes() - bytes;
+			peak = Bench::peakBytes() - live;
+
+			if (!parsed)
+			{
+				std::fprintf(stderr, "error: failed to parse (%s).\n", name);
+				std::exit(1);
+			}
+
+			counts = current;
+		}
+
+		std::string label(name);
+		Bench::report((label + " parse").c_str(), parse_time / repeat, xml.size(), parse_allocations / repeat, parse_bytes / repeat);
+		std::printf("%-28s %10.1f KiB peak\n", (label + " memory").c_str(), peak / 1024.0);
+
+		return counts;
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	int robots = (argc > 1) ? std::atoi(argv[1]) : 2000;
+	int repeat = (argc > 2) ? std::atoi(argv[2]) : 10;
+
+	std::string xml = Bench::calibrationLibrary(robots);
+
+	std::printf("calibration library: %d robots, %.1f KiB, %d runs (per-run averages)\n",
+		robots, xml.size() / 1024.0, repeat);
+
+	// 最初の読み込みだけ遅くならないよう、計測の前に一度読んでおく
+	{
+		TiXmlDocument document;
+		document.Parse(xml.c_str());
+	}
+
+	Counts dom = ::run("DOM", xml, repeat, false);
+	Counts sax = ::run("SAX", xml, repeat, true);
+
+	std::printf("%lu elements, %lu attributes, %lu texts\n", sax.elements, sax.attributes, sax.texts);
+
+	// 両方のパーサが同じものを見たことを確認する
+	if (!(dom == sax))
+	{
+		std::fprintf(stderr, "error: the SAX events differ from the DOM.\n");
+
+		return 1;
+	}
+
+	return 0;
+}
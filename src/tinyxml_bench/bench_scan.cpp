@@ -0,0 +1,112 @@
+﻿// TinyXML Benchmark - Tokenizer scanning
+// ============================================================================
+// NOTE:
+// テキストの多いXML(モーションの説明文やコメントを模したもの)を生成し、
+// Parse()のスループットを計測します。空白の読み飛ばしとテキストのコピーは、
+// CPUに応じてAVX2/SSE2のカーネルで行われます。"make NO_SIMD=1"でビルドすると
+// 1バイトずつ読む実装になるため、両者を比較できます。
+//
+// 空白の扱い(TiXmlDocument::SetCondenseWhiteSpace())ごとに、ASCIIのみの文書と
+// 日本語(UTF-8)を含む文書を計測します。
+//
+//     usage: bench_scan [paragraphs] [repeat]
+
+// 標準C++ライブラリ
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+#include "bench_util.h"
+
+
+namespace
+{
+	// 説明文を多く含むモーションのXMLを生成する
+	std::string textDocument(int paragraphs, bool japanese)
+	{
+		const char* sentence = "Raise the left arm slowly while the right leg keeps the balance of the robot. ";
+		const char* japanese_sentence = "\xE5\xB7\xA6\xE8\x85\x95\xE3\x82\x92\xE3\x82\x86\xE3\x81\xA3\xE3\x81\x8F\xE3\x82\x8A\xE4\xB8\x8A\xE3\x81\x92\xE3\x81\xBE\xE3\x81\x99\xE3\x80\x82 ";
+
+		std::string xml = "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n<motions>\n";
+
+		for (int index = 0; index < paragraphs; index++)
+		{
+			char header[128];
+			std::sprintf(header, "    <motion slot=\"%d\" name=\"Motion number %d\">\n", index % 90, index);
+			xml += header;
+			xml += "        <!-- generated by the joint config app, edit with care -->\n";
+			xml += "        <description>\n            ";
+
+			for (int count = 0; count < 8; count++)
+			{
+				xml += (japanese && count % 2 == 1) ? japanese_sentence : sentence;
+
+				if (count == 3)
+				{
+					xml += "\n            ";
+				}
+			}
+
+			xml += "\n        </description>\n";
+			xml += "        <note>Angles are in tenths of a degree &amp; times are in milliseconds.</note>\n";
+			xml += "    </motion>\n";
+		}
+
+		xml += "</motions>\n";
+
+		return xml;
+	}
+
+	void run(const char* name, const std::string& xml, bool condense, int repeat)
+	{
+		double             parse_time = 0;
+		unsigned long long parse_allocations = 0;
+		unsigned long long parse_bytes = 0;
+
+		for (int count = 0; count < repeat; count++)
+		{
+			TiXmlDocument document;
+			document.SetCondenseWhiteSpace(condense);
+
+			unsigned long long allocations = Bench::allocations();
+			unsigned long long bytes = Bench::allocatedBytes();
+			double start = Bench::now();
+
+			document.Parse(xml.c_str());
+
+			parse_time += Bench::now() - start;
+			parse_allocations += Bench::allocations() - allocations;
+			parse_bytes += Bench::allocatedBytes() - bytes;
+
+			if (document.Error())
+			{
+				std::fprintf(stderr, "error: %s\n", document.ErrorDesc());
+				std::exit(1);
+			}
+		}
+
+		Bench::report(name, parse_time / repeat, xml.size(), parse_allocations / repeat, parse_bytes / repeat);
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	int paragraphs = (argc > 1) ? std::atoi(argv[1]) : 5000;
+	int repeat     = (argc > 2) ? std::atoi(argv[2]) : 10;
+
+	std::string ascii = textDocument(paragraphs, false);
+	std::string utf8  = textDocument(paragraphs, true);
+
+	std::printf("%d paragraphs, %.1f KiB (ASCII), %.1f KiB (UTF-8), %d runs (per-run averages)\n",
+		paragraphs, ascii.size() / 1024.0, utf8.size() / 1024.0, repeat);
+
+	::run("condense ASCII", ascii, true, repeat);
+	::run("condense UTF-8", utf8, true, repeat);
+	::run("keep ASCII", ascii, false, repeat);
+	::run("keep UTF-8", utf8, false, repeat);
+
+	return 0;
+}
@@ -0,0 +1,136 @@
+﻿// TinyXML Benchmark - Stream input
+// ============================================================================
+// NOTE:
+// キャリブレーションライブラリを、LoadFile()と、std::ifstream/std::istringstream
+// からのoperator>>で読み、時間を比較します。
+//
+// operator>>はストリームのバッファにある文字をまとめて検索してコピーするため、
+// 1文字ずつget()していた頃より速く、LoadFile()に近い時間で読めます。
+// TIXML_USE_STLのときだけ使えるので、make STL=1でビルドしてください。
+//
+//     usage: bench_stream [robots] [repeat]
+
+// 標準C++ライブラリ
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+#include "bench_util.h"
+
+
+#ifdef TIXML_USE_STL
+namespace
+{
+	enum Source
+	{
+		LOAD_FILE,
+		FILE_STREAM,
+		STRING_STREAM
+	};
+
+	// 読み込みをrepeat回繰り返して計測し、最後のDOMを文字列で返す
+	std::string run(const char* name, Source source, const char* path, const std::string& xml, int repeat)
+	{
+		double             time = 0;
+		unsigned long long total_allocations = 0;
+		unsigned long long total_bytes = 0;
+		std::string        printed;
+
+		for (int count = 0; count < repeat; count++)
+		{
+			TiXmlDocument document;
+
+			unsigned long long allocations = Bench::allocations();
+			unsigned long long bytes = Bench::allocatedBytes();
+			double start = Bench::now();
+
+			if (source == LOAD_FILE)
+			{
+				document.LoadFile(path);
+			}
+			else if (source == FILE_STREAM)
+			{
+				std::ifstream in(path, std::ios::binary);
+				in >> document;
+			}
+			else
+			{
+				std::istringstream in(xml);
+				in >> document;
+			}
+
+			time += Bench::now() - start;
+			total_allocations += Bench::allocations() - allocations;
+			total_bytes += Bench::allocatedBytes() - bytes;
+
+			if (document.Error())
+			{
+				std::fprintf(stderr, "error: %s\n", document.ErrorDesc());
+				std::exit(1);
+			}
+
+			if (count == repeat - 1)
+			{
+				TiXmlPrinter printer;
+				document.Accept(&printer);
+				printed = printer.Str();
+			}
+		}
+
+		Bench::report(name, time / repeat, xml.size(), total_allocations / repeat, total_bytes / repeat);
+
+		return printed;
+	}
+}
+#endif
+
+
+int main(int argc, char* argv[])
+{
+#ifdef TIXML_USE_STL
+	int robots = (argc > 1) ? std::atoi(argv[1]) : 2000;
+	int repeat = (argc > 2) ? std::atoi(argv[2]) : 10;
+
+	std::string xml = Bench::calibrationLibrary(robots);
+
+	char  path[] = "/tmp/bench_stream_XXXXXX";
+	FILE* file = NULL;
+	int   fd = mkstemp(path);
+
+	if (fd < 0 || (file = fdopen(fd, "wb")) == NULL || std::fwrite(xml.data(), 1, xml.size(), file) != xml.size())
+	{
+		std::fprintf(stderr, "error: failed to write %s.\n", path);
+
+		return 1;
+	}
+
+	std::fclose(file);
+
+	std::printf("calibration library: %d robots, %.1f KiB, %d runs (per-run averages)\n",
+		robots, xml.size() / 1024.0, repeat);
+
+	std::string loaded  = ::run("LoadFile",              LOAD_FILE,     path, xml, repeat);
+	std::string file_in = ::run("ifstream >>",           FILE_STREAM,   path, xml, repeat);
+	std::string text_in = ::run("istringstream >>",      STRING_STREAM, path, xml, repeat);
+
+	std::remove(path);
+
+	// すべてのDOMが一致することを確認する
+	if (loaded != file_in || loaded != text_in)
+	{
+		std::fprintf(stderr, "error: the documents differ.\n");
+
+		return 1;
+	}
+
+	return 0;
+#else
+	std::fprintf(stderr, "bench_stream needs TIXML_USE_STL: build with \"make STL=1\".\n");
+
+	return 0;
+#endif
+}
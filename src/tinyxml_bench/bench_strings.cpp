@@ -0,0 +1,140 @@
+﻿// TinyXML Benchmark - Short strings
+// ============================================================================
+// NOTE:
+// 1台分のキャリブレーションファイル(アプリが読む設定ファイルの大きさ)と、
+// 大きなキャリブレーションライブラリを読み、時間と確保回数、確保量、
+// 確保量のピークを計測します。
+//
+// 要素名、属性名、"900"のような属性値はほとんどが短く、TiXmlStringは
+// 短い文字列を自分の中に持つため、文字列ごとの確保が起きません。
+// DOMにある文字列の長さの内訳も表示します。
+//
+//     usage: bench_strings [robots] [repeat]
+
+// 標準C++ライブラリ
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+#include "bench_util.h"
+
+
+namespace
+{
+	struct Lengths
+	{
+		unsigned long empty;
+		unsigned long short_ones;	// 18文字以下
+		unsigned long long_ones;
+
+		Lengths() : empty(0), short_ones(0), long_ones(0) {}
+
+		void add(const char* text)
+		{
+			std::size_t length = std::strlen(text);
+
+			if (length == 0)
+			{
+				empty++;
+			}
+			else if (length <= 18)
+			{
+				short_ones++;
+			}
+			else
+			{
+				long_ones++;
+			}
+		}
+	};
+
+	void count(const TiXmlNode* node, Lengths& lengths)
+	{
+		for (const TiXmlNode* child = node->FirstChild(); child != NULL; child = child->NextSibling())
+		{
+			lengths.add(child->Value());
+
+			if (const TiXmlElement* element = child->ToElement())
+			{
+				for (const TiXmlAttribute* attribute = element->FirstAttribute(); attribute != NULL; attribute = attribute->Next())
+				{
+					lengths.add(attribute->Name());
+					lengths.add(attribute->Value());
+				}
+			}
+
+			count(child, lengths);
+		}
+	}
+
+	// 読み込みをrepeat回繰り返して計測する
+	void run(const char* name, const std::string& xml, int repeat)
+	{
+		double             parse_time = 0;
+		unsigned long long parse_allocations = 0;
+		unsigned long long parse_bytes = 0;
+		unsigned long long peak = 0;
+		Lengths            lengths;
+
+		for (int index = 0; index < repeat; index++)
+		{
+			TiXmlDocument document;
+
+			unsigned long long allocations = Bench::allocations();
+			unsigned long long bytes = Bench::allocatedBytes();
+			unsigned long long live = Bench::liveBytes();
+			Bench::resetPeak();
+			double start = Bench::now();
+
+			document.Parse(xml.c_str());
+
+			parse_time += Bench::now() - start;
+			parse_allocations += Bench::allocations() - allocations;
+			parse_bytes += Bench::allocatedBytes() - bytes;
+			peak = Bench::peakBytes() - live;
+
+			if (document.Error())
+			{
+				std::fprintf(stderr, "error: %s\n", document.ErrorDesc());
+				std::exit(1);
+			}
+
+			if (index == repeat - 1)
+			{
+				::count(&document, lengths);
+			}
+		}
+
+		std::string label(name);
+		Bench::report((label + " parse").c_str(), parse_time / repeat, xml.size(), parse_allocations / repeat, parse_bytes / repeat);
+		std::printf("%-28s %10.1f KiB peak\n", (label + " memory").c_str(), peak / 1024.0);
+		std::printf("%-28s %10lu empty %10lu short %10lu long\n", (label + " strings").c_str(), lengths.empty, lengths.short_ones, lengths.long_ones);
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	int robots = (argc > 1) ? std::atoi(argv[1]) : 2000;
+	int repeat = (argc > 2) ? std::atoi(argv[2]) : 10;
+
+	std::string profile = Bench::calibrationLibrary(1);
+	std::string library = Bench::calibrationLibrary(robots);
+
+	std::printf("calibration file: %.1f KiB, %d runs; library: %d robots, %.1f KiB, %d runs (per-run averages)\n",
+		profile.size() / 1024.0, repeat * 1000, robots, library.size() / 1024.0, repeat);
+
+	// 最初の読み込みだけ遅くならないよう、計測の前に一度読んでおく
+	{
+		TiXmlDocument document;
+		document.Parse(library.c_str());
+	}
+
+	::run("file", profile, repeat * 1000);
+	::run("library", library, repeat);
+
+	return 0;
+}
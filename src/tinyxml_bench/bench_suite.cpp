@@ -0,0 +1,566 @@
+﻿// TinyXML Benchmark - Document-level suite
+// ============================================================================
+// NOTE:
+// 実際の使い方に近い形の文書を生成し、文書単位の処理をひと通り計測します。
+// 結果はCSVで標準出力に書くので、ファイルに保存して実行ごとに比べられます。
+//
+// 文書の形(workload):
+// - library : キャリブレーションライブラリ(Bench::calibrationLibrary())
+// - wide    : 数値の属性が多いモーションのフレームの並び
+// - deep    : 深い入れ子の要素の鎖
+// - text    : 大きなテキストとCDATA
+// - files   : 1台分のプロファイルの小さなファイルがたくさん
+//
+// 処理(operation): LoadFile, Parse, Accept(TiXmlPrinter), Print(FILE*),
+// Clone, Delete(複製の削除), Query(すべての属性をQueryDoubleAttribute()で読む)
+//
+// 列: workload, operation, 入力のバイト数, 1回の時間[s](repeat回の最小),
+// MB/s, 1回の確保回数, 1回の確保バイト数, 確保中のバイト数の最大値,
+// 常駐メモリ(RSS)の最大値[KB]
+//
+// RSSはプロセス全体のものです。解放したメモリがmallocに残ったままになるため、
+// 前の処理で増えた分も含まれます。
+//
+//     usage: bench_suite [scale] [repeat] > result.csv
+
+// 標準C++ライブラリ
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// POSIX
+#include <unistd.h>
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+#include "bench_util.h"
+
+
+namespace
+{
+	struct Workload
+	{
+		const char*              name;
+		std::vector<std::string> texts;
+		std::vector<std::string> files;
+		std::size_t              bytes;
+	};
+
+	// 数値の属性が多いフレームの並び(1フレームに24関節)
+	std::string wideDocument(int frames)
+	{
+		std::ostringstream xml;
+
+		xml << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"
+			<< "<motion slot=\"12\" name=\"walk forward\">\n";
+
+		for (int frame = 0; frame < frames; frame++)
+		{
+			xml << "\t<frame index=\"" << frame << "\" transition=\"" << 20 + frame % 80
+				<< "\" speed=\"" << (frame % 100) / 100.0 << "\"";
+
+			for (int joint = 0; joint < 24; joint++)
+			{
+				xml << " a" << joint << "=\"" << ((frame * 13 + joint * 47) % 1800) - 900 << "\"";
+			}
+
+			xml << " />\n";
+		}
+
+		xml << "</motion>\n";
+
+		return xml.str();
+	}
+
+	// depth段の入れ子をchains本
+	std::string deepDocument(int chains, int depth)
+	{
+		std::ostringstream xml;
+
+		xml << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"
+			<< "<tree>\n";
+
+		for (int chain = 0; chain < chains; chain++)
+		{
+			for (int level = 0; level < depth; level++)
+			{
+				xml << "<node level=\"" << level << "\" id=\"" << chain * depth + level << "\">";
+			}
+
+			xml << "leaf " << chain;
+
+			for (int level = 0; level < depth; level++)
+			{
+				xml << "</node>";
+			}
+
+			xml << "\n";
+		}
+
+		xml << "</tree>\n";
+
+		return xml.str();
+	}
+
+	// 64KBほどのテキストをsections個(半分はCDATA)
+	std::string textDocument(int sections)
+	{
+		std::ostringstream xml;
+
+		xml << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"
+			<< "<notes>\n";
+
+		for (int section = 0; section < sections; section++)
+		{
+			xml << "\t<note id=\"" << section << "\">";
+
+			if (section % 2 == 1)
+			{
+				xml << "<![CDATA[";
+			}
+
+			for (int line = 0; line < 1000; line++)
+			{
+				xml << "Joint " << line % 18 << " was moved by " << line % 90 << " steps"
+					<< ((section % 2 == 1) ? " <raw> & \"quoted\"" : " &amp; checked &lt;ok&gt;") << ".\n";
+			}
+
+			if (section % 2 == 1)
+			{
+				xml << "]]>";
+			}
+
+			xml << "</note>\n";
+		}
+
+		xml << "</notes>\n";
+
+		return xml.str();
+	}
+
+	void add(Workload& workload, const std::string& text)
+	{
+		workload.texts.push_back(text);
+		workload.bytes += text.size();
+	}
+
+	std::vector<Workload> generate(int scale)
+	{
+		std::vector<Workload> workloads(5);
+
+		workloads[0].name = "library";
+		workloads[1].name = "wide";
+		workloads[2].name = "deep";
+		workloads[3].name = "text";
+		workloads[4].name = "files";
+
+		for (std::size_t index = 0; index < workloads.size(); index++)
+		{
+			workloads[index].bytes = 0;
+		}
+
+		add(workloads[0], Bench::calibrationLibrary(1000 * scale));
+		add(workloads[1], wideDocument(4000 * scale));
+		add(workloads[2], deepDocument(100 * scale, 256));
+		add(workloads[3], textDocument(16 * scale));
+
+		for (int file = 0; file < 500 * scale; file++)
+		{
+			add(workloads[4], Bench::calibrationLibrary(1));
+		}
+
+		return workloads;
+	}
+
+	void writeFiles(Workload& workload, const char* directory)
+	{
+		for (std::size_t index = 0; index < workload.texts.size(); index++)
+		{
+			char name[256];
+			std::snprintf(name, sizeof(name), "%s/%s-%04d.xml", directory, workload.name, static_cast<int>(index));
+
+			FILE* file = std::fopen(name, "wb");
+
+			if (file == NULL)
+			{
+				std::perror(name);
+				std::exit(1);
+			}
+
+			std::fwrite(workload.texts[index].data(), 1, workload.texts[index].size(), file);
+			std::fclose(file);
+
+			workload.files.push_back(name);
+		}
+	}
+
+	void check(const TiXmlDocument& document, const char* what)
+	{
+		if (document.Error())
+		{
+			std::fprintf(stderr, "error: %s: %s\n", what, document.ErrorDesc());
+			std::exit(1);
+		}
+	}
+
+	void clear(std::vector<TiXmlNode*>& nodes)
+	{
+		for (std::size_t index = 0; index < nodes.size(); index++)
+		{
+			delete nodes[index];
+		}
+		nodes.clear();
+	}
+
+	// 1回分の処理。prepare()とfinish()は計測に含めない
+	class Operation
+	{
+	public:
+		virtual ~Operation() {}
+
+		virtual void prepare() {}
+		virtual void run() = 0;
+		virtual void finish() {}
+	};
+
+	class LoadFile : public Operation
+	{
+	public:
+		LoadFile(const Workload& _workload) : workload(_workload) {}
+
+		virtual void prepare()
+		{
+			for (std::size_t index = 0; index < workload.files.size(); index++)
+			{
+				documents.push_back(new TiXmlDocument());
+			}
+		}
+
+		virtual void run()
+		{
+			for (std::size_t index = 0; index < documents.size(); index++)
+			{
+				static_cast<TiXmlDocument*>(documents[index])->LoadFile(workload.files[index].c_str());
+			}
+		}
+
+		virtual void finish()
+		{
+			for (std::size_t index = 0; index < documents.size(); index++)
+			{
+				check(*static_cast<TiXmlDocument*>(documents[index]), workload.files[index].c_str());
+			}
+			clear(documents);
+		}
+
+	private:
+		const Workload&         workload;
+		std::vector<TiXmlNode*> documents;
+	};
+
+	class Parse : public Operation
+	{
+	public:
+		Parse(const Workload& _workload) : workload(_workload) {}
+
+		virtual void prepare()
+		{
+			for (std::size_t index = 0; index < workload.texts.size(); index++)
+			{
+				documents.push_back(new TiXmlDocument());
+			}
+		}
+
+		virtual void run()
+		{
+			for (std::size_t index = 0; index < documents.size(); index++)
+			{
+				static_cast<TiXmlDocument*>(documents[index])->Parse(workload.texts[index].c_str());
+			}
+		}
+
+		virtual void finish()
+		{
+			for (std::size_t index = 0; index < documents.size(); index++)
+			{
+				check(*static_cast<TiXmlDocument*>(documents[index]), workload.name);
+			}
+			clear(documents);
+		}
+
+	private:
+		const Workload&         workload;
+		std::vector<TiXmlNode*> documents;
+	};
+
+	class Accept : public Operation
+	{
+	public:
+		Accept(const std::vector<TiXmlDocument*>& _documents) : documents(_documents), printed(0) {}
+
+		virtual void run()
+		{
+			for (std::size_t index = 0; index < documents.size(); index++)
+			{
+				TiXmlPrinter printer;
+				documents[index]->Accept(&printer);
+				printed += printer.Size();
+			}
+		}
+
+	private:
+		const std::vector<TiXmlDocument*>& documents;
+		std::size_t                        printed;
+	};
+
+	class Print : public Operation
+	{
+	public:
+		Print(const std::vector<TiXmlDocument*>& _documents, FILE* _file) : documents(_documents), file(_file) {}
+
+		virtual void prepare()
+		{
+			std::rewind(file);
+		}
+
+		virtual void run()
+		{
+			for (std::size_t index = 0; index < documents.size(); index++)
+			{
+				documents[index]->Print(file, 0);
+			}
+			std::fflush(file);
+		}
+
+	private:
+		const std::vector<TiXmlDocument*>& documents;
+		FILE*                              file;
+	};
+
+	class Clone : public Operation
+	{
+	public:
+		Clone(const std::vector<TiXmlDocument*>& _documents) : documents(_documents) {}
+
+		virtual void run()
+		{
+			for (std::size_t index = 0; index < documents.size(); index++)
+			{
+				clones.push_back(static_cast<const TiXmlNode*>(documents[index])->Clone());
+			}
+		}
+
+		virtual void finish()
+		{
+			clear(clones);
+		}
+
+	private:
+		const std::vector<TiXmlDocument*>& documents;
+		std::vector<TiXmlNode*>            clones;
+	};
+
+	class Delete : public Operation
+	{
+	public:
+		Delete(const std::vector<TiXmlDocument*>& _documents) : documents(_documents) {}
+
+		virtual void prepare()
+		{
+			for (std::size_t index = 0; index < documents.size(); index++)
+			{
+				clones.push_back(static_cast<const TiXmlNode*>(documents[index])->Clone());
+			}
+		}
+
+		virtual void run()
+		{
+			clear(clones);
+		}
+
+	private:
+		const std::vector<TiXmlDocument*>& documents;
+		std::vector<TiXmlNode*>            clones;
+	};
+
+	class Query : public Operation
+	{
+	public:
+		Query(const std::vector<TiXmlDocument*>& _documents) : documents(_documents), sum(0) {}
+
+		virtual void run()
+		{
+			for (std::size_t index = 0; index < documents.size(); index++)
+			{
+				// 再帰せずに、文書の順にすべての要素をたどる
+				TiXmlElement* element = documents[index]->RootElement();
+
+				while (element != NULL)
+				{
+					for (const TiXmlAttribute* attribute = element->FirstAttribute(); attribute != NULL; attribute = attribute->Next())
+					{
+						double value = 0;
+
+						if (element->QueryDoubleAttribute(attribute->Name(), &value) == TIXML_SUCCESS)
+						{
+							sum += value;
+						}
+					}
+
+					TiXmlElement* next = element->FirstChildElement();
+
+					while (next == NULL && element != NULL)
+					{
+						next = element->NextSiblingElement();
+						element = (next == NULL) ? element->Parent()->ToElement() : NULL;
+					}
+
+					element = next;
+				}
+			}
+		}
+
+	private:
+		const std::vector<TiXmlDocument*>& documents;
+		double                             sum;
+	};
+
+	// repeat回実行し、CSVの1行を書く
+	void measure(const Workload& workload, const char* name, Operation& operation, int repeat)
+	{
+		double             best = 0;
+		unsigned long long allocations = 0;
+		unsigned long long allocated = 0;
+		unsigned long long peak = 0;
+		unsigned long long rss = 0;
+
+		for (int count = 0; count < repeat; count++)
+		{
+			operation.prepare();
+
+			Bench::resetPeak();
+			Bench::resetPeakRss();
+			unsigned long long base = Bench::liveBytes();
+			unsigned long long allocations_before = Bench::allocations();
+			unsigned long long allocated_before = Bench::allocatedBytes();
+			double start = Bench::now();
+
+			operation.run();
+
+			double seconds = Bench::now() - start;
+			unsigned long long used = Bench::peakBytes() - base;
+
+			if (count == 0 || seconds < best)
+			{
+				best = seconds;
+			}
+
+			allocations = Bench::allocations() - allocations_before;
+			allocated = Bench::allocatedBytes() - allocated_before;
+			peak = (used > peak) ? used : peak;
+
+			unsigned long long resident = Bench::peakRss();
+			rss = (resident > rss) ? resident : rss;
+
+			operation.finish();
+		}
+
+		std::printf("%s,%s,%lu,%.6f,%.1f,%llu,%llu,%llu,%llu\n",
+			workload.name, name, static_cast<unsigned long>(workload.bytes), best,
+			(best > 0) ? workload.bytes / best / (1024.0 * 1024.0) : 0.0,
+			allocations, allocated, peak, rss);
+		std::fflush(stdout);
+	}
+
+	void run(const Workload& workload, int repeat, FILE* output)
+	{
+		{
+			LoadFile load(workload);
+			measure(workload, "LoadFile", load, repeat);
+
+			Parse parse(workload);
+			measure(workload, "Parse", parse, repeat);
+		}
+
+		std::vector<TiXmlDocument*> documents;
+
+		for (std::size_t index = 0; index < workload.texts.size(); index++)
+		{
+			documents.push_back(new TiXmlDocument());
+			documents.back()->Parse(workload.texts[index].c_str());
+			check(*documents.back(), workload.name);
+		}
+
+		Accept accept(documents);
+		measure(workload, "Accept", accept, repeat);
+
+		Print print(documents, output);
+		measure(workload, "Print", print, repeat);
+
+		Clone clone(documents);
+		measure(workload, "Clone", clone, repeat);
+
+		Delete destroy(documents);
+		measure(workload, "Delete", destroy, repeat);
+
+		Query query(documents);
+		measure(workload, "Query", query, repeat);
+
+		for (std::size_t index = 0; index < documents.size(); index++)
+		{
+			delete documents[index];
+		}
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	int scale  = (argc > 1) ? std::atoi(argv[1]) : 1;
+	int repeat = (argc > 2) ? std::atoi(argv[2]) : 5;
+
+	char directory[] = "/tmp/bench_suite_XXXXXX";
+
+	if (mkdtemp(directory) == NULL)
+	{
+		std::perror("mkdtemp");
+		return 1;
+	}
+
+	std::string output_name = std::string(directory) + "/print.xml";
+	FILE*       output = std::fopen(output_name.c_str(), "wb");
+
+	if (output == NULL)
+	{
+		std::perror(output_name.c_str());
+		return 1;
+	}
+
+	if (!Bench::resetPeakRss())
+	{
+		std::fprintf(stderr, "warning: the peak RSS can't be reset; it counts from the start of the process.\n");
+	}
+
+	std::vector<Workload> workloads = ::generate(scale);
+
+	std::printf("workload,operation,bytes,seconds,mb_per_s,allocs,alloc_bytes,peak_heap_bytes,peak_rss_kb\n");
+
+	for (std::size_t index = 0; index < workloads.size(); index++)
+	{
+		::writeFiles(workloads[index], directory);
+		::run(workloads[index], repeat, output);
+
+		for (std::size_t file = 0; file < workloads[index].files.size(); file++)
+		{
+			unlink(workloads[index].files[file].c_str());
+		}
+	}
+
+	std::fclose(output);
+	unlink(output_name.c_str());
+	rmdir(directory);
+
+	return 0;
+}
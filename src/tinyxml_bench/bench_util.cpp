@@ -0,0 +1,232 @@
+﻿// 標準C++ライブラリ
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+#include <sstream>
+
+// POSIX
+#include <sys/resource.h>
+
+// 独自実装ライブラリ
+#include "bench_util.h"
+
+
+namespace
+{
+	std::atomic<unsigned long long> allocation_count(0);
+	std::atomic<unsigned long long> allocation_bytes(0);
+	std::atomic<unsigned long long> live_bytes(0);
+	std::atomic<unsigned long long> peak_bytes(0);
+
+	const char* JOINT_NAMES[] =
+	{
+		"left_shoulder_pitch", "left_thigh_yaw",     "left_shoulder_roll",
+		"left_elbow_roll",     "left_thigh_roll",    "left_thigh_pitch",
+		"left_knee_pitch",     "left_foot_pitch",    "left_foot_roll",
+		"right_shoulder_pitch","right_thigh_yaw",    "right_shoulder_roll",
+		"right_elbow_roll",    "right_thigh_roll",   "right_thigh_pitch",
+		"right_knee_pitch",    "right_foot_pitch",   "right_foot_roll"
+	};
+}
+
+
+// 確保の計測のため、グローバルなoperator new/deleteを置き換える
+// ============================================================================
+// NOTE:
+// 配列版、サイズ付き、nothrow版も同じ実装に揃えます。(一部だけを置き換えると、
+// ASanなどが別の実装で解放したとみなし、alloc-dealloc-mismatchを報告するため)
+void* operator new(std::size_t size)
+{
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+
+	void* p = std::malloc(size ? size : 1);
+
+	if (p == NULL)
+	{
+		throw std::bad_alloc();
+	}
+
+	std::size_t        usable = malloc_usable_size(p);
+	unsigned long long live = live_bytes.fetch_add(usable, std::memory_order_relaxed) + usable;
+	unsigned long long peak = peak_bytes.load(std::memory_order_relaxed);
+
+	while (live > peak && !peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+	{
+	}
+
+	return p;
+}
+
+void operator delete(void* p) noexcept
+{
+	if (p != NULL)
+	{
+		live_bytes.fetch_sub(malloc_usable_size(p), std::memory_order_relaxed);
+	}
+
+	std::free(p);
+}
+
+void* operator new[](std::size_t size)
+{
+	return ::operator new(size);
+}
+
+void operator delete[](void* p) noexcept
+{
+	::operator delete(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	::operator delete(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+	::operator delete(p);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return ::operator new(size);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return NULL;
+	}
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return ::operator new(size, std::nothrow);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	::operator delete(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	::operator delete(p);
+}
+
+
+namespace Bench
+{
+	double now()
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	unsigned long long allocations()
+	{
+		return allocation_count.load();
+	}
+
+	unsigned long long allocatedBytes()
+	{
+		return allocation_bytes.load();
+	}
+
+	unsigned long long liveBytes()
+	{
+		return live_bytes.load();
+	}
+
+	unsigned long long peakBytes()
+	{
+		return peak_bytes.load();
+	}
+
+	void resetPeak()
+	{
+		peak_bytes.store(live_bytes.load());
+	}
+
+	unsigned long long peakRss()
+	{
+		unsigned long long kilobytes = 0;
+		FILE*              status = std::fopen("/proc/self/status", "r");
+
+		if (status != NULL)
+		{
+			char line[256];
+
+			while (std::fgets(line, sizeof(line), status) != NULL)
+			{
+				if (std::sscanf(line, "VmHWM: %llu kB", &kilobytes) == 1)
+				{
+					break;
+				}
+			}
+			std::fclose(status);
+		}
+
+		if (kilobytes == 0)
+		{
+			struct rusage usage;
+			getrusage(RUSAGE_SELF, &usage);
+			kilobytes = usage.ru_maxrss;
+		}
+
+		return kilobytes;
+	}
+
+	bool resetPeakRss()
+	{
+		FILE* clear = std::fopen("/proc/self/clear_refs", "w");
+
+		if (clear == NULL)
+		{
+			return false;
+		}
+
+		bool reset = std::fputs("5", clear) >= 0;
+
+		return (std::fclose(clear) == 0) && reset;
+	}
+
+	std::string calibrationLibrary(int robots)
+	{
+		std::ostringstream xml;
+
+		xml << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"
+			<< "<library version=\"1\">\n";
+
+		for (int robot = 0; robot < robots; robot++)
+		{
+			xml << "\t<robot name=\"plen2-" << robot << "\" firmware=\"1.3." << robot % 7 << "\">\n"
+				<< "\t\t<!-- calibrated by the joint config app -->\n";
+
+			for (int joint = 0; joint < 18; joint++)
+			{
+				int home = 900 + ((robot * 37 + joint * 11) % 200) - 100;
+
+				xml << "\t\t<joint id=\"" << joint + 1 << "\" name=\"" << JOINT_NAMES[joint]
+					<< "\" min=\"" << home - 600 << "\" max=\"" << home + 600
+					<< "\" home=\"" << home << "\" trim=\"" << (robot + joint) % 25 - 12 << "\" />\n";
+			}
+
+			xml << "\t\t<note>Checked &amp; adjusted on bench " << robot % 4 << " &lt;ok&gt;</note>\n"
+				<< "\t</robot>\n";
+		}
+
+		xml << "</library>\n";
+
+		return xml.str();
+	}
+
+	void report(const char* name, double seconds, std::size_t input_bytes, unsigned long long allocations, unsigned long long bytes)
+	{
+		std::printf("%-24s %10.3f ms %9.1f MB/s %12llu allocs %14llu bytes\n",
+			name, seconds * 1000.0, (seconds > 0) ? input_bytes / seconds / (1024.0 * 1024.0) : 0.0, allocations, bytes);
+	}
+}
@@ -0,0 +1,47 @@
+﻿#ifndef _BENCH_UTIL_H_
+#define _BENCH_UTIL_H_
+
+// 標準C++ライブラリ
+#include <cstddef>
+#include <string>
+
+
+// TinyXMLベンチマークの共通処理
+// ============================================================================
+// NOTE:
+// joint_config_guiに組み込んでいるTinyXMLの性能を、Linux上で計測するための
+// 共通処理です。各ベンチマーク(bench_*.cpp)は、これと一緒にリンクされます。
+//
+// このファイルの実装はグローバルなoperator newを置き換え、確保回数と確保量を
+// 数えます。TinyXML内部の確保もすべて数えられます。
+namespace Bench
+{
+	// 単調増加する時刻 [s]
+	double now();
+
+	// プロセス開始からのoperator newの呼び出し回数と確保バイト数
+	unsigned long long allocations();
+	unsigned long long allocatedBytes();
+
+	// 確保中のバイト数と、resetPeak()以降のその最大値
+	// (malloc_usable_size()で数えるため、要求サイズより少し大きくなる)
+	unsigned long long liveBytes();
+	unsigned long long peakBytes();
+	void resetPeak();
+
+	// プロセスの常駐メモリ(RSS)の最大値 [KB] と、そのリセット
+	// (リセットは/proc/self/clear_refsによる。できなければfalseを返し、
+	// 最大値はプロセス開始からのものになる)
+	unsigned long long peakRss();
+	bool resetPeakRss();
+
+	// 関節キャリブレーションのライブラリを模したXMLを生成する
+	// (robots台分のプロファイル、1台あたり18関節)
+	std::string calibrationLibrary(int robots);
+
+	// 計測結果を1行で表示する
+	void report(const char* name, double seconds, std::size_t input_bytes, unsigned long long allocations, unsigned long long bytes);
+}
+
+
+#endif // _BENCH_UTIL_H_
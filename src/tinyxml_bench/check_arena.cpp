@@ -0,0 +1,219 @@
+﻿// TinyXML Check - Arena allocation
+// ============================================================================
+// NOTE:
+// 検査用の文書を、通常のヒープ、アリーナ(SetUseArena())、アリーナとin-situで
+// 読み、DOM(ノード、属性、行と列)、エラー、出力が一致することを確かめます。
+//
+// 読めた文書には、同じ乱数列で同じ編集(削除、コピー、移動、属性と値の変更、
+// 別のヒープの文書への移動)を加えて比べます。さらに、アリーナの文書をコピーして
+// から読み直し(アリーナを再利用する)、コピーと移動先の文書が元の文書より長く
+// 生きても同じ内容であることを確かめます。
+//
+// 解放済みのアリーナを指していないかは、CXXFLAGSに-fsanitize=addressを加えて
+// ビルドすると確かめられます。
+//
+//     usage: check_arena [documents]
+
+// 標準C++ライブラリ
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+#include "check_util.h"
+
+
+namespace
+{
+	enum Kind
+	{
+		HEAP,
+		ARENA,
+		ARENA_IN_SITU,
+		KINDS
+	};
+
+	const char* const KIND_NAMES[KINDS] = { "heap", "arena", "arena + in-situ" };
+
+	std::string contents(const TiXmlDocument& document)
+	{
+		TiXmlPrinter printer;
+		document.Accept(&printer);
+
+		return Check::error(document) + Check::dump(&document) + printer.CStr();
+	}
+
+	// 文書順のノード(文書自身を除く)
+	std::vector<TiXmlNode*> nodes(TiXmlNode* top)
+	{
+		std::vector<TiXmlNode*> result;
+		TiXmlNode* node = top->FirstChild();
+
+		while (node)
+		{
+			result.push_back(node);
+
+			if (node->FirstChild())
+			{
+				node = node->FirstChild();
+				continue;
+			}
+
+			while (node != top && !node->NextSibling())
+			{
+				node = node->Parent();
+			}
+
+			node = (node == top) ? NULL : node->NextSibling();
+		}
+
+		return result;
+	}
+
+	// 同じseedなら、どの文書にも同じ編集を加える
+	void edit(TiXmlDocument& document, TiXmlDocument& outside, unsigned int seed, int edits)
+	{
+		Check::Random random(seed);
+
+		for (int count = 0; count < edits; count++)
+		{
+			std::vector<TiXmlNode*> all = nodes(&document);
+
+			if (all.empty())
+			{
+				return;
+			}
+
+			TiXmlNode*    node = all[random.below(static_cast<int>(all.size()))];
+			TiXmlElement* target = all[random.below(static_cast<int>(all.size()))]->ToElement();
+			char          text[32];
+
+			std::sprintf(text, "edit%d", count);
+
+			switch (random.below(6))
+			{
+				case 0:
+					node->Parent()->RemoveChild(node);
+					break;
+
+				case 1:
+					if (target)
+					{
+						target->InsertEndChild(*node);
+					}
+					break;
+
+				case 2:
+					if (target)
+					{
+						target->InsertEndChild(std::move(*node));
+					}
+					break;
+
+				case 3:
+					if (target)
+					{
+						target->SetAttribute(text, count);
+					}
+					break;
+
+				case 4:
+					node->SetValue(text);
+					break;
+
+				default:
+					outside.InsertEndChild(std::move(*node));
+					break;
+			}
+		}
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	int generated = (argc > 1) ? std::atoi(argv[1]) : 400;
+	int tests = 0;
+
+	std::vector<std::string> documents = Check::corpus(generated);
+
+	for (int index = 0; index < static_cast<int>(documents.size()); index++)
+	{
+		for (int condense = 0; condense < 2; condense++)
+		{
+			std::vector<char> buffer(documents[index].begin(), documents[index].end());
+			buffer.push_back('\0');
+
+			TiXmlDocument* read[KINDS];
+			TiXmlDocument  outside[KINDS];
+			std::string    results[KINDS];
+			std::string    moved[KINDS];
+			std::string    copied[KINDS];
+
+			for (int kind = 0; kind < KINDS; kind++)
+			{
+				read[kind] = new TiXmlDocument;
+				read[kind]->SetCondenseWhiteSpace(condense != 0);
+				read[kind]->SetUseArena(kind != HEAP);
+
+				if (kind == ARENA_IN_SITU)
+				{
+					read[kind]->ParseInSitu(&buffer[0]);
+				}
+				else
+				{
+					read[kind]->Parse(documents[index].c_str());
+				}
+
+				results[kind] = ::contents(*read[kind]);
+			}
+
+			// 同じ編集を加え、アリーナの文書はコピーしてから読み直して捨てる
+			for (int kind = 0; kind < KINDS; kind++)
+			{
+				if (!read[kind]->Error())
+				{
+					::edit(*read[kind], outside[kind], 1000 + index, 8);
+					results[kind] += ::contents(*read[kind]);
+				}
+
+				TiXmlDocument copy(*read[kind]);
+
+				read[kind]->Clear();
+				read[kind]->Parse(documents[(index + 1) % documents.size()].c_str());
+				results[kind] += ::contents(*read[kind]);
+				delete read[kind];
+
+				copied[kind] = ::contents(copy);
+				moved[kind] = ::contents(outside[kind]);
+			}
+
+			for (int kind = ARENA; kind < KINDS; kind++)
+			{
+				std::string what = std::string(KIND_NAMES[kind]) + (condense ? ", condensed" : "");
+
+				if (results[kind] != results[HEAP])
+				{
+					Check::fail("check_arena", index, what + ": the DOM differs from the heap one");
+				}
+
+				if (copied[kind] != copied[HEAP])
+				{
+					Check::fail("check_arena", index, what + ": the copy differs from the heap one");
+				}
+
+				if (moved[kind] != moved[HEAP])
+				{
+					Check::fail("check_arena", index, what + ": the moved nodes differ from the heap ones");
+				}
+
+				tests++;
+			}
+		}
+	}
+
+	return Check::finish("check_arena", tests);
+}
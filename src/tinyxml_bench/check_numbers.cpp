@@ -0,0 +1,267 @@
+﻿// TinyXML Check - Numeric conversion
+// ============================================================================
+// NOTE:
+// TiXmlBase::ReadInt()/ReadDouble()/WriteInt()/WriteDouble()と、それを使う
+// 数値属性の呼び出しが、Cランタイムと同じ結果になることを確かめます。
+//
+// - WriteDouble(): 乱数のビット列、小数、大小の指数の値について、"%g"の出力と比べる
+// - ReadDouble(): "%.17g"と"%.6g"で書いた値と、数字・符号・小数点・指数・
+//   inf/nan・16進などを並べた文字列について、strtod()の値と読み終わりの位置と比べる
+// - ReadInt(): 空白、符号、桁数の多い数字、後続の文字を並べた文字列について、
+//   strtol()がintに収まる値を読めたときだけ、同じ値と位置を返すことを確かめる
+// - 属性: SetDoubleAttribute()/SetAttribute()で書いた値を、QueryDoubleAttribute()/
+//   QueryIntAttribute()で読み戻す
+//
+// 小数点が','のロケール(de_DE、fr_FRなど)が入っていれば、それに切り替えても
+// '.'で読み書きすることを確かめます。(なければ、その旨を表示して飛ばします)
+//
+//     usage: check_numbers [values]
+
+// 標準C++ライブラリ
+#include <cerrno>
+#include <climits>
+#include <clocale>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+#include "check_util.h"
+
+
+namespace
+{
+	const char* const COMMA_LOCALES[] = { "de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "fr_FR.utf8", "fr_FR" };
+
+	// 検査する値(種類をindexで回す)
+	double value(Check::Random& random, int index)
+	{
+		double result = 0;
+
+		switch (index % 4)
+		{
+			case 0:
+			{
+				unsigned long long bits = (static_cast<unsigned long long>(random.next()) << 32) | random.next();
+				std::memcpy(&result, &bits, sizeof(result));
+				break;
+			}
+
+			case 1:
+				result = static_cast<double>(random.below(2000000) - 1000000) / static_cast<double>(1 << random.below(20));
+				break;
+
+			case 2:
+				result = static_cast<double>(random.below(10000000)) * std::pow(10.0, random.below(40) - 20);
+				result = random.below(2) ? -result : result;
+				break;
+
+			default:
+				result = static_cast<double>(random.below(1801));
+				break;
+		}
+
+		return result;
+	}
+
+	// 数値らしい部品を並べた文字列
+	std::string numberText(Check::Random& random, bool integer)
+	{
+		static const char* const PIECES[] =
+		{
+			" ", "\t", "\n", "\r", "\v", "+", "-", "0", "1", "9", "12345678901234567890", "00000",
+			"2147483647", "2147483648", ".", "e", "E", "e+", "e-", "308", "400", "inf", "nan",
+			"Infinity", "0x", "p3", ",", "x", "abc"
+		};
+		const int count = sizeof(PIECES) / sizeof(PIECES[0]);
+
+		std::string text;
+		int pieces = 1 + random.below(integer ? 4 : 6);
+
+		for (int index = 0; index < pieces; index++)
+		{
+			text += PIECES[random.below(count)];
+		}
+
+		return text;
+	}
+
+	bool sameDouble(double a, double b)
+	{
+		return (std::memcmp(&a, &b, sizeof(a)) == 0) || (a != a && b != b);
+	}
+
+	// 値と文字列の変換を検査し、行った検査の数を返す
+	int convert(Check::Random& random, int values, const char* locale)
+	{
+		int tests = 0;
+
+		for (int index = 0; index < values; index++)
+		{
+			char expected[64];
+			char written[TiXmlBase::NUMBER_BUFFER_SIZE];
+			char message[256];
+			double v = ::value(random, index);
+
+			// WriteDouble()と"%g"("C"ロケールで書く)
+			std::setlocale(LC_NUMERIC, "C");
+			std::snprintf(expected, sizeof(expected), "%g", v);
+			std::setlocale(LC_NUMERIC, locale);
+			TiXmlBase::WriteDouble(v, written);
+
+			if (std::strcmp(written, expected) != 0)
+			{
+				std::snprintf(message, sizeof(message), "WriteDouble(%.17g) wrote %s, not %s", v, written, expected);
+				Check::fail("check_numbers", index, message);
+			}
+
+			// ReadDouble()とstrtod()
+			std::string texts[3];
+
+			std::setlocale(LC_NUMERIC, "C");
+			std::snprintf(expected, sizeof(expected), "%.17g", v);
+			texts[0] = expected;
+			std::snprintf(expected, sizeof(expected), "%.6g", v);
+			texts[1] = expected;
+			texts[2] = ::numberText(random, false);
+
+			for (int text = 0; text < 3; text++)
+			{
+				const char* p = texts[text].c_str();
+				char*       end = NULL;
+				double      reference = std::strtod(p, &end);
+
+				if (end == p)
+				{
+					end = NULL;
+				}
+
+				std::setlocale(LC_NUMERIC, locale);
+				double      read = 777;
+				const char* stop = TiXmlBase::ReadDouble(p, &read);
+				std::setlocale(LC_NUMERIC, "C");
+
+				if (stop != end || (stop && !sameDouble(read, reference)))
+				{
+					std::snprintf(message, sizeof(message), "ReadDouble(\"%s\") read %.17g up to %d, not %.17g up to %d",
+						p, read, stop ? static_cast<int>(stop - p) : -1, reference, end ? static_cast<int>(end - p) : -1);
+					Check::fail("check_numbers", index, message);
+				}
+			}
+
+			// ReadInt()とstrtol()
+			{
+				std::string text = ::numberText(random, true);
+				const char* p = text.c_str();
+				char*       end = NULL;
+
+				errno = 0;
+				long long reference = std::strtoll(p, &end, 10);
+
+				if (end == p || errno == ERANGE || reference < INT_MIN || reference > INT_MAX)
+				{
+					end = NULL;
+				}
+
+				std::setlocale(LC_NUMERIC, locale);
+				int         read = 777;
+				const char* stop = TiXmlBase::ReadInt(p, &read);
+				std::setlocale(LC_NUMERIC, "C");
+
+				if (stop != end || (stop && read != reference) || (!stop && read != 777))
+				{
+					std::snprintf(message, sizeof(message), "ReadInt(\"%s\") read %d up to %d, not %lld up to %d",
+						p, read, stop ? static_cast<int>(stop - p) : -1, reference, end ? static_cast<int>(end - p) : -1);
+					Check::fail("check_numbers", index, message);
+				}
+			}
+
+			tests += 5;
+		}
+
+		std::setlocale(LC_NUMERIC, "C");
+
+		return tests;
+	}
+
+	// 属性に書いて読み戻す
+	int attributes(Check::Random& random, int values, const char* locale)
+	{
+		int tests = 0;
+
+		std::setlocale(LC_NUMERIC, locale);
+
+		for (int index = 0; index < values; index++)
+		{
+			char         message[256];
+			TiXmlElement element("joint");
+			double       v = ::value(random, index);
+			int          i = static_cast<int>(random.next());
+
+			element.SetDoubleAttribute("d", v);
+			element.SetAttribute("i", i);
+
+			char expected[64];
+			std::setlocale(LC_NUMERIC, "C");
+			std::snprintf(expected, sizeof(expected), "%g", v);
+			double reference = std::strtod(expected, NULL);
+			std::setlocale(LC_NUMERIC, locale);
+
+			double d = 777;
+			int    n = 777;
+
+			if (element.QueryDoubleAttribute("d", &d) != TIXML_SUCCESS || !sameDouble(d, reference)
+				|| element.QueryIntAttribute("i", &n) != TIXML_SUCCESS || n != i)
+			{
+				std::snprintf(message, sizeof(message), "attributes %s/%s read back as %.17g/%d",
+					element.Attribute("d"), element.Attribute("i"), d, n);
+				Check::fail("check_numbers", index, message);
+			}
+
+			tests += 2;
+		}
+
+		std::setlocale(LC_NUMERIC, "C");
+
+		return tests;
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	int values = (argc > 1) ? std::atoi(argv[1]) : 1000000;
+	int tests = 0;
+
+	Check::Random random(41);
+
+	tests += ::convert(random, values, "C");
+	tests += ::attributes(random, values / 10, "C");
+
+	const char* comma = NULL;
+
+	for (std::size_t index = 0; index < sizeof(COMMA_LOCALES) / sizeof(COMMA_LOCALES[0]) && !comma; index++)
+	{
+		if (std::setlocale(LC_NUMERIC, COMMA_LOCALES[index]) != NULL)
+		{
+			comma = COMMA_LOCALES[index];
+		}
+	}
+
+	std::setlocale(LC_NUMERIC, "C");
+
+	if (comma)
+	{
+		tests += ::convert(random, values / 10, comma);
+		tests += ::attributes(random, values / 10, comma);
+	}
+	else
+	{
+		std::fprintf(stderr, "check_numbers: no locale with a decimal comma is installed; skipped that part.\n");
+	}
+
+	return Check::finish("check_numbers", tests);
+}
@@ -0,0 +1,132 @@
+﻿// TinyXML Check - Scan kernels
+// ============================================================================
+// NOTE:
+// 検査用の文書をParse()、ParseInSitu()、LoadFile()で読み、DOM(ノード、属性、
+// 行と列)とエラーの位置を標準出力に書き出します。`make check`はこれを、
+// TIXML_NO_SIMD(1バイトずつ)、TIXML_NO_AVX2(SSE2)、既定(AVX2)の3通りの
+// TinyXMLでビルドして実行し、出力が一致することを確かめます。
+//
+// 空白の圧縮の有無と2通りのタブ幅で読みます。同じビルドの中でも、メモリから
+// 読んだ結果(行と列を読みながら求める)とin-situの結果、ファイルから読んだ
+// 結果(行と列を改行の索引から求める)が一致することを確かめます。LoadFile()は
+// CR LFとCRをLFにしてから読むため、同じようにしたテキストのParse()と比べます。
+//
+// AVX2のないCPUでは、既定のビルドもSSE2で走査します(標準エラーに表示します)。
+//
+//     usage: check_scan [documents]
+
+// 標準C++ライブラリ
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+#include "check_util.h"
+
+
+namespace
+{
+	std::string parse(const std::string& xml, bool condense, int tabsize)
+	{
+		TiXmlDocument document;
+		document.SetCondenseWhiteSpace(condense);
+		document.SetTabSize(tabsize);
+		document.Parse(xml.c_str());
+
+		return Check::error(document) + Check::dump(&document);
+	}
+
+	std::string parseInSitu(const std::string& xml, bool condense, int tabsize)
+	{
+		std::vector<char> buffer(xml.begin(), xml.end());
+		buffer.push_back('\0');
+
+		TiXmlDocument document;
+		document.SetCondenseWhiteSpace(condense);
+		document.SetTabSize(tabsize);
+		document.ParseInSitu(&buffer[0]);
+
+		return Check::error(document) + Check::dump(&document);
+	}
+
+	// CR LFとCRをLFにする(LoadFile()と同じ)
+	std::string newlines(const std::string& xml)
+	{
+		std::string text;
+
+		for (std::size_t index = 0; index < xml.size(); index++)
+		{
+			if (xml[index] != '\r')
+			{
+				text += xml[index];
+			}
+			else if (index + 1 >= xml.size() || xml[index + 1] != '\n')
+			{
+				text += '\n';
+			}
+		}
+
+		return text;
+	}
+
+	std::string load(const std::string& path, bool condense, int tabsize)
+	{
+		TiXmlDocument document;
+		document.SetCondenseWhiteSpace(condense);
+		document.SetTabSize(tabsize);
+		document.LoadFile(path.c_str());
+
+		return Check::error(document) + Check::dump(&document);
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	int generated = (argc > 1) ? std::atoi(argv[1]) : 1000;
+	int tests = 0;
+
+	#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(TIXML_NO_SIMD) && !defined(TIXML_NO_AVX2)
+	if (!__builtin_cpu_supports("avx2"))
+	{
+		std::fprintf(stderr, "check_scan: this CPU has no AVX2, so the kernels are SSE2.\n");
+	}
+	#endif
+
+	std::vector<std::string> documents = Check::corpus(generated);
+
+	for (int index = 0; index < static_cast<int>(documents.size()); index++)
+	{
+		std::string path = Check::writeTemp(documents[index]);
+		std::string normalized = ::newlines(documents[index]);
+
+		for (int mode = 0; mode < 4; mode++)
+		{
+			bool condense = (mode & 1) == 0;
+			int  tabsize = (mode & 2) ? 3 : 4;
+
+			std::string parsed = ::parse(documents[index], condense, tabsize);
+			std::string in_situ = ::parseInSitu(documents[index], condense, tabsize);
+			std::string loaded = ::load(path, condense, tabsize);
+
+			if (in_situ != parsed)
+			{
+				Check::fail("check_scan", index, "ParseInSitu() differs from Parse()");
+			}
+
+			if (loaded != ::parse(normalized, condense, tabsize))
+			{
+				Check::fail("check_scan", index, "LoadFile() differs from Parse()");
+			}
+
+			std::printf("#%d condense=%d tabsize=%d\n%s%s", index, condense, tabsize, parsed.c_str(), loaded.c_str());
+			tests++;
+		}
+
+		std::remove(path.c_str());
+	}
+
+	return Check::finish("check_scan", tests);
+}
@@ -0,0 +1,200 @@
+﻿// TinyXML Check - Stream input
+// ============================================================================
+// NOTE:
+// operator>>で文書を読み、istreamのバッファからまとめて読む方法
+// (TiXmlBase::StreamUntil())が、1文字ずつ読む方法と同じ結果になることを
+// 確かめます。バッファを持たないstreambufは1文字ずつ読むので、それを基準に、
+// istringstreamと、1～7文字ずつしか渡さないstreambufの結果を比べます。
+//
+// 比べるのは、読んだDOMの出力、エラー、ストリームの状態、読み残した残りです。
+// 入力は検査用の文書と、タグや記号の断片を乱数で並べたもの(一部はルート要素の
+// 後に続きがある)です。ルート要素は文書のStreamIn()から読まれます。要素への
+// operator>>は'<'で始まらない入力で止まらない(元のTinyXMLと同じ)ため、直接は
+// 使いません。要素の中の'\0'でも止まらない(同じく元のまま)ため、断片に'\0'は
+// 入れません。
+//
+// operator>>はTIXML_USE_STLのときだけあるため、`make STL=1 check`で検査します。
+//
+//     usage: check_stream [fragments]
+
+// 標準C++ライブラリ
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef TIXML_USE_STL
+#include <algorithm>
+#include <istream>
+#include <iterator>
+#include <sstream>
+#include <streambuf>
+#endif
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+#include "check_util.h"
+
+
+#ifdef TIXML_USE_STL
+
+namespace
+{
+	// 1回にsize文字までしかバッファに入れないstreambuf
+	class SmallBuffer : public std::streambuf
+	{
+	public:
+		SmallBuffer(const std::string& _text, std::size_t _size) : text(_text), position(0), size(_size) {}
+
+	protected:
+		int_type underflow()
+		{
+			if (position >= text.size())
+			{
+				return traits_type::eof();
+			}
+
+			std::size_t length = std::min(size, text.size() - position);
+			std::memcpy(buffer, text.data() + position, length);
+			position += length;
+			setg(buffer, buffer, buffer + length);
+
+			return traits_type::to_int_type(buffer[0]);
+		}
+
+	private:
+		std::string text;
+		std::size_t position;
+		std::size_t size;
+		char        buffer[8];
+	};
+
+	// バッファを持たないstreambuf(StreamIn()は1文字ずつ読む)
+	class Unbuffered : public std::streambuf
+	{
+	public:
+		explicit Unbuffered(const std::string& _text) : text(_text), position(0) {}
+
+	protected:
+		int_type underflow()
+		{
+			return (position < text.size()) ? traits_type::to_int_type(text[position]) : traits_type::eof();
+		}
+
+		int_type uflow()
+		{
+			return (position < text.size()) ? traits_type::to_int_type(text[position++]) : traits_type::eof();
+		}
+
+	private:
+		std::string text;
+		std::size_t position;
+	};
+
+	// 文書を読み、結果と読み残しを返す
+	std::string read(std::istream& in)
+	{
+		TiXmlDocument document;
+		in >> document;
+
+		TiXmlPrinter printer;
+		document.Accept(&printer);
+
+		char        state[64];
+		std::string result = Check::error(document) + printer.CStr();
+
+		std::sprintf(state, "state %d\n", static_cast<int>(in.rdstate()));
+		result += state;
+
+		in.clear();
+		result += "rest [" + std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()) + "]\n";
+
+		return result;
+	}
+
+	std::string fragments(Check::Random& random, int index)
+	{
+		static const char* const PIECES[] =
+		{
+			"<a>", "</a>", "<b x='1' y=\"2\">", "</b>", "<c/>", "text ", " ", "\n", "<!-- c > d -->",
+			"<![CDATA[ x ]] > ]]>", "<?xml version='1.0'?>", "<!DOCTYPE q>", "&amp;", "<", ">",
+			"]]>", "--", "<d\n/>", "</ a>", "<  /a>", "[", "<e>z</e>"
+		};
+		const int count = sizeof(PIECES) / sizeof(PIECES[0]);
+
+		std::string text;
+		int pieces = random.below(30);
+
+		for (int piece = 0; piece < pieces; piece++)
+		{
+			text += PIECES[random.below(count)];
+		}
+
+		if (index % 3 == 0)
+		{
+			text = "<r>" + text + "</r> trailing <x/>";
+		}
+
+		return text;
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	int generated = (argc > 1) ? std::atoi(argv[1]) : 3000;
+	int tests = 0;
+
+	std::vector<std::string> texts = Check::corpus(200);
+	Check::Random random(42);
+
+	for (int index = 0; index < generated; index++)
+	{
+		texts.push_back(::fragments(random, index));
+	}
+
+	for (int index = 0; index < static_cast<int>(texts.size()); index++)
+	{
+		const std::string& text = texts[index];
+
+		Unbuffered   unbuffered(text);
+		std::istream unbuffered_in(&unbuffered);
+		std::string  expected = ::read(unbuffered_in);
+
+		std::istringstream string_in(text);
+
+		if (::read(string_in) != expected)
+		{
+			Check::fail("check_stream", index, "istringstream differs");
+		}
+
+		for (std::size_t size = 1; size <= 7; size++)
+		{
+			SmallBuffer  small(text, size);
+			std::istream small_in(&small);
+
+			if (::read(small_in) != expected)
+			{
+				char message[64];
+				std::sprintf(message, "%d-char buffer differs", static_cast<int>(size));
+				Check::fail("check_stream", index, message);
+			}
+		}
+
+		tests += 8;
+	}
+
+	return Check::finish("check_stream", tests);
+}
+
+#else
+
+int main()
+{
+	std::fprintf(stderr, "check_stream: operator>> needs TIXML_USE_STL (make STL=1 check); skipped.\n");
+
+	return 0;
+}
+
+#endif
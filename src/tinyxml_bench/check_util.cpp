@@ -0,0 +1,347 @@
+﻿// 標準C++ライブラリ
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// POSIX
+#include <unistd.h>
+
+// 独自実装ライブラリ
+#include "check_util.h"
+
+
+namespace
+{
+	int failure_count = 0;
+
+	// 手書きの境界例(改行の種類、BOM、実体参照、CDATA、構文エラーなど)
+	const char* const SAMPLES[] =
+	{
+		"<?xml version=\"1.0\"?>\r\n<a x=\"1\r\n2\">\r\n\tline1\r\n  line2\rline3\n<b>  spaced   text  </b>\r\n<!-- c\r\nc -->\r\n</a>\r\n",
+		"\xEF\xBB\xBF<?xml version=\"1.0\"?><r a='sq\"v' b=\"dq'v\" c=unq>\xC3\xA9t\xC3\xA9 \xE6\x97\xA5\xE6\x9C\xAC <x/>\t<y   z = \"3\" /></r>",
+		"<a t=\"&#x1F600; &#128512; &#0; &#x;&bogus; &amp\">&#x41;&#x3042;&#12354; &unknown; &amp &#65</a>",
+		"<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>\n<a b=\"\xE9\">\xE9t\xE9 &#233;</a>",
+		"<!DOCTYPE foo [ <!ELEMENT foo ANY> ]>\n<foo><?pi stuff?><bar baz=\"1.5e3\" q=\"-12abc\" w=\" 7\"/></foo>",
+		"<?xml version=\"1.0\"?>\n<r><a/><!--c1--><b>t</b><![CDATA[x]]><c><d/></c>tail</r>\n<!-- after -->\n",
+		"<r><![CDATA[<a>b</a>]]><![CDATA[]]></r>",
+		"<r>\n\t<a>\n\t\t<b c=\"1\"/>\n\t</a>\n</r>",
+		"<a>\n   <b>   lead and trail   </b>\n  mixed <i>inline</i> tail \n\t</a>",
+		"<a><b></a>",
+		"<a x=\"1\" x=\"2\"/>",
+		"<a>\n  <b attr=>\n</a>",
+		"",
+		"   \n  ",
+		"<a/><b/>text",
+		"<r \xE3<b\">\xC3</r>",
+		"<r>\n <a v=\"a&amp;\nb\" w=\"x\">hello &lt; world\n  more</a>\n <b>&#xZZ;</b>\n</r>\n"
+	};
+
+	const char* const NAMES[] = { "a", "joint", "b_2", "x.y", "n:s", "\xC3\xA9l\xC3\xA9ment", "long_element_name_for_runs" };
+
+	// 文字の種類を混ぜた、長さがまちまちの文字列(SIMDの16/32バイトの境界をまたぐ)
+	std::string run(Check::Random& random, bool attribute, char quote)
+	{
+		static const char* const PIECES[] =
+		{
+			" ", "  ", "\t", "\n", "\r\n", "\r", "text", "x", "0123456789abcdef",
+			"&amp;", "&lt;", "&gt;", "&quot;", "&apos;", "&#65;", "&#x3042;", "&bogus;", "&",
+			"\xC3\xA9", "\xE6\x97\xA5\xE6\x9C\xAC", "\xF0\x9F\x98\x80", "\xFF", ">", "]]", "-", "'", "\""
+		};
+		const int count = sizeof(PIECES) / sizeof(PIECES[0]);
+
+		std::string text;
+		int length = random.below(72);
+
+		while (static_cast<int>(text.size()) < length)
+		{
+			const char* piece = PIECES[random.below(count)];
+
+			// 属性値を閉じる引用符と、テキスト中の'<'は、構文エラーのときだけ入れる
+			if (attribute && piece[0] == quote && piece[1] == '\0')
+			{
+				continue;
+			}
+
+			text += piece;
+		}
+
+		return text;
+	}
+
+	void element(Check::Random& random, std::string& xml, int depth)
+	{
+		const char* name = NAMES[random.below(sizeof(NAMES) / sizeof(NAMES[0]))];
+
+		xml += "<";
+		xml += name;
+
+		int attributes = random.below(5);
+
+		for (int index = 0; index < attributes; index++)
+		{
+			char quote = random.below(2) ? '"' : '\'';
+			char attribute_name[16];
+
+			int  spaces = random.below(4);
+			char space = random.below(2) ? ' ' : '\n';
+
+			std::sprintf(attribute_name, "a%d", index);
+			xml += std::string(spaces, space);
+			xml += " ";
+			xml += attribute_name;
+			xml += random.below(4) ? "=" : " = ";
+			xml += quote;
+			xml += run(random, true, quote);
+			xml += quote;
+		}
+
+		if (depth > 5 || random.below(5) == 0)
+		{
+			xml += random.below(2) ? "/>" : " />";
+			return;
+		}
+
+		xml += ">";
+
+		int children = random.below(5);
+
+		for (int index = 0; index < children; index++)
+		{
+			switch (random.below(6))
+			{
+				case 0:
+					xml += "<!--" + run(random, true, '-') + "-->";
+					break;
+
+				case 1:
+					xml += "<![CDATA[" + run(random, true, ']') + "]]>";
+					break;
+
+				case 2:
+				case 3:
+					element(random, xml, depth + 1);
+					break;
+
+				default:
+					xml += run(random, false, 0);
+					break;
+			}
+		}
+
+		xml += "</";
+		xml += name;
+		xml += ">";
+	}
+
+	// 1バイトの値を、表示できる形にして追加する
+	void escape(std::string& out, const char* text)
+	{
+		for (const unsigned char* p = reinterpret_cast<const unsigned char*>(text); *p; p++)
+		{
+			if (*p < 0x20 || *p == '\\')
+			{
+				char code[8];
+				std::sprintf(code, "\\x%02x", *p);
+				out += code;
+			}
+			else
+			{
+				out += static_cast<char>(*p);
+			}
+		}
+	}
+
+	void line(std::string& out, const TiXmlNode* node, int depth)
+	{
+		char location[64];
+
+		out.append(depth * 2, ' ');
+		std::sprintf(location, "T%d @%d:%d [", node->Type(), node->Row(), node->Column());
+		out += location;
+
+		// 文書の値はファイル名なので、読み方によって変わる
+		if (!node->ToDocument())
+		{
+			escape(out, node->Value());
+		}
+
+		out += "]";
+
+		if (const TiXmlElement* element = node->ToElement())
+		{
+			for (const TiXmlAttribute* attribute = element->FirstAttribute(); attribute; attribute = attribute->Next())
+			{
+				std::sprintf(location, " {@%d:%d ", attribute->Row(), attribute->Column());
+				out += location;
+				escape(out, attribute->Name());
+				out += "=";
+				escape(out, attribute->Value());
+				out += "}";
+			}
+		}
+		else if (const TiXmlText* text = node->ToText())
+		{
+			out += text->CDATA() ? " cdata" : "";
+		}
+		else if (const TiXmlDeclaration* declaration = node->ToDeclaration())
+		{
+			out += " v=";
+			escape(out, declaration->Version());
+			out += " e=";
+			escape(out, declaration->Encoding());
+			out += " s=";
+			escape(out, declaration->Standalone());
+		}
+
+		out += "\n";
+	}
+}
+
+
+unsigned int Check::Random::next()
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+
+	return state;
+}
+
+
+std::vector<std::string> Check::corpus(int generated)
+{
+	std::vector<std::string> documents(SAMPLES, SAMPLES + sizeof(SAMPLES) / sizeof(SAMPLES[0]));
+	Random random(20261019);
+
+	for (int index = 0; index < generated; index++)
+	{
+		std::string xml;
+
+		switch (random.below(4))
+		{
+			case 0:
+				xml += "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n";
+				break;
+
+			case 1:
+				xml += "\xEF\xBB\xBF<?xml version=\"1.0\"?>\r\n";
+				break;
+
+			case 2:
+				xml += "<?xml version=\"1.0\" encoding=\"ISO-8859-1\" standalone=\"yes\"?>";
+				break;
+
+			default:
+				break;
+		}
+
+		int  spaces = random.below(40);
+		char space = random.below(2) ? ' ' : '\t';
+		int  prolog = static_cast<int>(xml.size());
+
+		xml += std::string(spaces, space);
+		element(random, xml, 0);
+		xml += "\n";
+
+		// 4つに1つは壊す(途中で切る、または'<'と'&'を入れる)。XML宣言の途中で
+		// 終わる文書は、TinyXML本来のassert(StringEqual())に当たるため、壊すのは
+		// 宣言より後だけにする
+		switch (random.below(8))
+		{
+			case 0:
+				xml.resize(prolog + random.below(static_cast<int>(xml.size()) - prolog));
+				break;
+
+			case 1:
+			{
+				int  position = prolog + random.below(static_cast<int>(xml.size()) - prolog);
+				char inserted = random.below(2) ? '<' : '&';
+
+				xml.insert(position, 1, inserted);
+				break;
+			}
+
+			default:
+				break;
+		}
+
+		documents.push_back(xml);
+	}
+
+	return documents;
+}
+
+
+std::string Check::dump(const TiXmlNode* top)
+{
+	std::string out;
+	const TiXmlNode* node = top;
+	int depth = 0;
+
+	while (node)
+	{
+		line(out, node, depth);
+
+		if (node->FirstChild())
+		{
+			node = node->FirstChild();
+			depth++;
+			continue;
+		}
+
+		while (node != top && !node->NextSibling())
+		{
+			node = node->Parent();
+			depth--;
+		}
+
+		node = (node == top) ? NULL : node->NextSibling();
+	}
+
+	return out;
+}
+
+
+std::string Check::error(const TiXmlDocument& document)
+{
+	char text[64];
+
+	std::sprintf(text, "error %d @%d:%d ", document.ErrorId(), document.ErrorRow(), document.ErrorCol());
+
+	return text + std::string(document.Error() ? document.ErrorDesc() : "") + "\n";
+}
+
+
+std::string Check::writeTemp(const std::string& text)
+{
+	char  path[] = "/tmp/tinyxml_check_XXXXXX";
+	FILE* file = NULL;
+	int   fd = mkstemp(path);
+
+	if (fd < 0 || (file = fdopen(fd, "wb")) == NULL || std::fwrite(text.data(), 1, text.size(), file) != text.size())
+	{
+		std::fprintf(stderr, "error: failed to write %s.\n", path);
+		std::exit(1);
+	}
+
+	std::fclose(file);
+
+	return path;
+}
+
+
+void Check::fail(const char* check, int index, const std::string& detail)
+{
+	if (++failure_count <= 10)
+	{
+		std::fprintf(stderr, "%s: document %d: %s\n", check, index, detail.c_str());
+	}
+}
+
+
+int Check::finish(const char* check, int tests)
+{
+	std::fprintf(stderr, "%s: %d tests, %d failed\n", check, tests, failure_count);
+
+	return (failure_count == 0) ? 0 : 1;
+}
@@ -0,0 +1,59 @@
+﻿#ifndef _CHECK_UTIL_H_
+#define _CHECK_UTIL_H_
+
+// 標準C++ライブラリ
+#include <string>
+#include <vector>
+
+// 独自実装ライブラリ
+#include "tinyxml.h"
+
+
+// TinyXMLの検査の共通処理
+// ============================================================================
+// NOTE:
+// ベンチマークで使う高速化(SIMD、アリーナ、数値変換、ストリーム、ループ化した
+// 木の走査)が、素直な実装と同じ結果になることを確かめる検査(check_*.cpp)の
+// 共通処理です。`make check`で、すべての検査をビルドして実行します。
+//
+// 入力は手書きの境界例と、固定のseedから生成する文書です。同じビルドなら
+// 何度実行しても同じ入力になり、失敗した文書の番号から再現できます。
+namespace Check
+{
+	// 環境によらず同じ列を返す乱数(xorshift32)
+	class Random
+	{
+	public:
+		explicit Random(unsigned int seed) : state(seed ? seed : 1) {}
+
+		unsigned int next();
+
+		// [0, n) の整数
+		int below(int n) { return static_cast<int>(next() % static_cast<unsigned int>(n)); }
+
+	private:
+		unsigned int state;
+	};
+
+	// 手書きの境界例と、generated個の生成した文書(一部は構文エラーを含む)
+	std::vector<std::string> corpus(int generated);
+
+	// nodeから下の、ノードの種類、値、属性、行と列を1行に1ノードずつ書き出す
+	// (深い文書でもスタックを使わないよう、ループで走査する)
+	std::string dump(const TiXmlNode* node);
+
+	// 文書のエラーの番号、説明、行と列
+	std::string error(const TiXmlDocument& document);
+
+	// textを一時ファイルに書き出し、そのパスを返す(失敗したら終了する)
+	std::string writeTemp(const std::string& text);
+
+	// 失敗を記録して表示する(最初のいくつかだけ詳細を表示する)
+	void fail(const char* check, int index, const std::string& detail);
+
+	// 結果を表示し、終了コード(失敗がなければ0)を返す
+	int finish(const char* check, int tests);
+}
+
+
+#endif // _CHECK_UTIL_H_